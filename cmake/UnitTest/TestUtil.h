@@ -4,6 +4,11 @@
 #include <QCoreApplication>
 #include <QTest>
 #include <QDir>
+#include <QFileInfo>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+#include <random>
 
 #define expandstr(s) expandstr2(s)
 #define expandstr2(s) #s
@@ -21,8 +26,109 @@ public:
     {
         return QString::fromUtf8(readFile(fileName));
     }
+    static bool benchmarksEnabled()
+    {
+        return qEnvironmentVariableIsSet("MMC_BENCHMARKS");
+    }
+
+    /// Write a file, creating the folders it is in
+    static bool writeFile(const QString &path, const QByteArray &data)
+    {
+        if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+        {
+            return false;
+        }
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+    }
+
+    /// Run a Task to the end in an event loop, giving up after a while
+    template <typename T>
+    static bool runTask(T *task, int timeoutMs = 120000)
+    {
+        QEventLoop loop;
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        QObject::connect(task, &T::finished, &loop, &QEventLoop::quit);
+        timeout.start(timeoutMs);
+        task->start();
+        loop.exec();
+        if (!task->wasSuccessful())
+        {
+            qWarning() << "Task failed:" << task->failReason();
+        }
+        return task->wasSuccessful();
+    }
+
+    /// Data that doesn't compress
+    static QByteArray randomData(std::mt19937 &random, int size)
+    {
+        QByteArray out(size, Qt::Uninitialized);
+        for (int i = 0; i < size; i++)
+        {
+            out[i] = char(random());
+        }
+        return out;
+    }
+
+    /// Data that compresses well, like config files
+    static QByteArray textData(int lines)
+    {
+        QByteArray out;
+        for (int i = 0; i < lines; i++)
+        {
+            out.append(QString("option.number%1=%2\n").arg(i).arg(i * 7 % 13).toUtf8());
+        }
+        return out;
+    }
+
+    /// Something like an instance: lots of small config and mod files, and a few big region files. Returns the bytes written.
+    static qint64 makeInstance(const QString &root, int count)
+    {
+        qint64 total = 0;
+        for (int i = 0; i < count; i++)
+        {
+            QByteArray data(4096 + i % 1024, char('a' + i % 26));
+            writeFile(QDir(root).filePath(QString("folder%1/sub%2/file%3").arg(i % 50).arg(i % 7).arg(i)), data);
+            total += data.size();
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            QByteArray region(16 * 1024 * 1024, char(i));
+            writeFile(QDir(root).filePath(QString("saves/world/region/r.%1.0.mca").arg(i)), region);
+            total += region.size();
+        }
+        return total;
+    }
+
+    /// A modpack instance, scaled down: mod jars that don't compress, lots of configs that do, and region files.
+    /// Returns the bytes written.
+    static qint64 makeModpack(const QString &root, int mods)
+    {
+        std::mt19937 random(42);
+        qint64 total = 0;
+        for (int i = 0; i < mods; i++)
+        {
+            auto jar = randomData(random, 256 * 1024 + i * 1024);
+            writeFile(QDir(root).filePath(QString(".minecraft/mods/mod%1.jar").arg(i)), jar);
+            auto config = textData(200 + i * 10);
+            writeFile(QDir(root).filePath(QString(".minecraft/config/mod%1/settings.cfg").arg(i)), config);
+            total += jar.size() + config.size();
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            auto region = randomData(random, 4 * 1024 * 1024);
+            writeFile(QDir(root).filePath(QString(".minecraft/saves/world/region/r.%1.0.mca").arg(i)), region);
+            total += region.size();
+        }
+        return total;
+    }
 };
 
 #define GET_TEST_FILE(file) TestsInternal::readFile(QFINDTESTDATA(file))
 #define GET_TEST_FILE_UTF8(file) TestsInternal::readFileUtf8(QFINDTESTDATA(file))
+// benchmarks take minutes and gigabytes, they only run with MMC_BENCHMARKS set
+#define SKIP_UNLESS_BENCHMARKING() \
+    do { if (!TestsInternal::benchmarksEnabled()) QSKIP("Benchmarks only run with MMC_BENCHMARKS set"); } while (0)
 
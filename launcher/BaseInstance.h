@@ -28,6 +28,7 @@
 #include "BaseVersionList.h"
 #include "minecraft/auth/MinecraftAccount.h"
 #include "MessageLevel.h"
+#include "launch/LogClassifier.h"
 #include "pathmatcher/IPathMatcher.h"
 
 #include "net/Mode.h"
@@ -116,11 +117,11 @@ public:
     QString getPostExitCommand();
     QString getWrapperCommand();
 
-    /// guess log level from a line of game log
-    virtual MessageLevel::Enum guessLevel(const QString &line, MessageLevel::Enum level)
+    /// how to guess the levels of game log lines. Default is to not guess at all.
+    virtual LogClassifier::Config logClassifierConfig()
     {
-        return level;
-    };
+        return LogClassifier::Config();
+    }
 
     virtual QStringList extraArguments() const;
 
@@ -0,0 +1,385 @@
+// Licensed under the Apache-2.0 license. See README.md for details.
+
+#include "ContentStore.h"
+#include "FileSystem.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QTextStream>
+#include <QSaveFile>
+#include <QSet>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+QString algorithmName(QCryptographicHash::Algorithm algorithm)
+{
+    switch(algorithm)
+    {
+        case QCryptographicHash::Sha1:
+            return "sha1";
+        case QCryptographicHash::Sha256:
+            return "sha256";
+        default:
+            return QString();
+    }
+}
+
+int expectedLength(QCryptographicHash::Algorithm algorithm)
+{
+    return algorithm == QCryptographicHash::Sha1 ? 20 : 32;
+}
+
+QString referencesFile(const QString & root)
+{
+    return FS::PathCombine(root, "references");
+}
+}
+
+ContentStore::ContentStore(const QString& root) : m_root(root)
+{
+}
+
+ContentStore::LinkMode ContentStore::linkModeFromString(const QString& mode)
+{
+    if(mode == "Hardlink")
+        return LinkMode::Hardlink;
+    if(mode == "Symlink")
+        return LinkMode::Symlink;
+    if(mode == "Copy")
+        return LinkMode::Copy;
+    return LinkMode::Auto;
+}
+
+QString ContentStore::linkModeToString(LinkMode mode)
+{
+    switch(mode)
+    {
+        case LinkMode::Hardlink:
+            return "Hardlink";
+        case LinkMode::Symlink:
+            return "Symlink";
+        case LinkMode::Copy:
+            return "Copy";
+        case LinkMode::Auto:
+        default:
+            return "Auto";
+    }
+}
+
+bool ContentStore::isSupported(QCryptographicHash::Algorithm algorithm)
+{
+    return !algorithmName(algorithm).isNull();
+}
+
+void ContentStore::setLinkMode(LinkMode mode)
+{
+    QMutexLocker locker(&m_mutex);
+    m_mode = mode;
+}
+
+ContentStore::LinkMode ContentStore::linkMode() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_mode;
+}
+
+QString ContentStore::objectPath(QCryptographicHash::Algorithm algorithm, const QByteArray& hash) const
+{
+    auto name = algorithmName(algorithm);
+    if(name.isNull() || hash.size() != expectedLength(algorithm))
+    {
+        return QString();
+    }
+    QString hex = hash.toHex();
+    return FS::PathCombine(m_root, "objects", name, hex.left(2)) + "/" + hex;
+}
+
+bool ContentStore::contains(QCryptographicHash::Algorithm algorithm, const QByteArray& hash) const
+{
+    auto object = objectPath(algorithm, hash);
+    return !object.isEmpty() && QFileInfo(object).isFile();
+}
+
+bool ContentStore::insert(const QString& file, QCryptographicHash::Algorithm algorithm, const QByteArray& hash)
+{
+    auto object = objectPath(algorithm, hash);
+    if(object.isEmpty() || !QFileInfo(file).isFile())
+    {
+        return false;
+    }
+    auto mode = linkMode();
+    QMutexLocker locker(&m_mutex);
+    if(QFileInfo(object).isFile())
+    {
+        // we have it already. Make the file a reference to the stored copy, so only one copy of the data is kept.
+        auto identity = FS::fileIdentity(file);
+        if(identity != 0 && identity == FS::fileIdentity(object))
+        {
+            return true;
+        }
+        locker.unlock();
+        if(mode == LinkMode::Copy)
+        {
+            // the file stays as it is, as a copy of the object
+            recordReference(object, file, ReferenceKind::Copy);
+            return true;
+        }
+        auto temp = file + ".store";
+        QFile::remove(temp);
+        auto kind = ReferenceKind::Hardlink;
+        if(!reference(object, temp, mode, kind))
+        {
+            return false;
+        }
+        if(!FS::replaceFile(temp, file))
+        {
+            qWarning() << "Failed to replace" << file << "with a reference to" << object;
+            QFile::remove(temp);
+            return false;
+        }
+        recordReference(object, file, kind);
+        return true;
+    }
+    if(!FS::ensureFilePathExists(object))
+    {
+        qWarning() << "Failed to create content store folder for" << object;
+        return false;
+    }
+    if(mode != LinkMode::Copy && FS::hardlink(file, object))
+    {
+        return true;
+    }
+    // asked for copies or on a different file system, probably. Make a copy, atomically.
+    auto temp = object + ".tmp";
+    QFile::remove(temp);
+    if(!FS::cloneFile(file, temp))
+    {
+        qWarning() << "Failed to add" << file << "to the content store";
+        return false;
+    }
+    if(!FS::replaceFile(temp, object))
+    {
+        QFile::remove(temp);
+        return false;
+    }
+    locker.unlock();
+    // the file is a copy of the object now
+    recordReference(object, file, ReferenceKind::Copy);
+    return true;
+}
+
+QByteArray ContentStore::import(const QString& file)
+{
+    auto hash = FS::hashFile(file, QCryptographicHash::Sha1);
+    if(hash.isEmpty() || !insert(file, QCryptographicHash::Sha1, hash))
+    {
+        return QByteArray();
+    }
+    return hash;
+}
+
+bool ContentStore::materialize(QCryptographicHash::Algorithm algorithm, const QByteArray& hash, const QString& target)
+{
+    auto object = objectPath(algorithm, hash);
+    if(object.isEmpty() || !QFileInfo(object).isFile())
+    {
+        return false;
+    }
+    auto kind = ReferenceKind::Hardlink;
+    if(!reference(object, target, linkMode(), kind))
+    {
+        return false;
+    }
+    recordReference(object, target, kind);
+    return true;
+}
+
+bool ContentStore::linkFile(const QString& source, const QString& target)
+{
+    auto hash = import(source);
+    if(!hash.isEmpty() && materialize(QCryptographicHash::Sha1, hash, target))
+    {
+        return true;
+    }
+    qDebug() << "Could not use the content store for" << source << ", copying it";
+    QFile::remove(target);
+    FS::copy copy(source, target);
+    return copy();
+}
+
+bool ContentStore::reference(const QString& object, const QString& target, LinkMode mode, ReferenceKind & kind)
+{
+    kind = ReferenceKind::Hardlink;
+    if(!FS::ensureFilePathExists(target))
+    {
+        return false;
+    }
+    QFileInfo current(target);
+    if(current.exists() || current.isSymLink())
+    {
+        auto identity = FS::fileIdentity(target);
+        if(!current.isSymLink() && identity != 0 && identity == FS::fileIdentity(object))
+        {
+            // already a hard link to the object
+            return true;
+        }
+        if(!QFile::remove(target))
+        {
+            qWarning() << "Cannot replace" << target;
+            return false;
+        }
+    }
+    switch(mode)
+    {
+        case LinkMode::Auto:
+            if(FS::reflink(object, target))
+            {
+                kind = ReferenceKind::Copy;
+                return true;
+            }
+            if(FS::hardlink(object, target))
+                return true;
+            break;
+        case LinkMode::Hardlink:
+            if(FS::hardlink(object, target))
+                return true;
+            break;
+        case LinkMode::Symlink:
+            if(QFile::link(object, target))
+            {
+                kind = ReferenceKind::Symlink;
+                return true;
+            }
+            break;
+        case LinkMode::Copy:
+            break;
+    }
+    kind = ReferenceKind::Copy;
+    return QFile::copy(object, target);
+}
+
+void ContentStore::recordReference(const QString& object, const QString& target, ReferenceKind kind)
+{
+    if(kind == ReferenceKind::Hardlink)
+    {
+        return;
+    }
+    QMutexLocker locker(&m_mutex);
+    QFile registry(referencesFile(m_root));
+    if(!registry.open(QIODevice::Append | QIODevice::Text))
+    {
+        qWarning() << "Failed to record content store reference" << target << ":" << registry.errorString();
+        return;
+    }
+    QTextStream out(&registry);
+    out.setCodec("UTF-8");
+    out << (kind == ReferenceKind::Symlink ? "symlink" : "copy") << '\t' << QFileInfo(object).absoluteFilePath() << '\t'
+        << QFileInfo(target).absoluteFilePath() << '\n';
+}
+
+QHash<QString, int> ContentStore::liveReferences(bool prune)
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, int> live;
+    QStringList liveLines;
+    QSet<QString> targets;
+    QFile registry(referencesFile(m_root));
+    if(!registry.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return live;
+    }
+    QTextStream in(&registry);
+    in.setCodec("UTF-8");
+    while(!in.atEnd())
+    {
+        auto line = in.readLine();
+        auto parts = line.split('\t');
+        if(parts.size() != 3)
+        {
+            continue;
+        }
+        auto object = parts[1];
+        QFileInfo target(parts[2]);
+        if(targets.contains(parts[2]))
+        {
+            // made again, it's still one reference
+            continue;
+        }
+        bool alive;
+        if(parts[0] == "symlink")
+        {
+            alive = target.isSymLink() && target.symLinkTarget() == object;
+        }
+        else
+        {
+            // hashing every copy would take too long. One that was changed in place only keeps the object around.
+            alive = !target.isSymLink() && target.isFile() && target.size() == QFileInfo(object).size();
+        }
+        if(!alive)
+        {
+            // removed or replaced by something else
+            continue;
+        }
+        targets.insert(parts[2]);
+        live[object]++;
+        liveLines.append(line);
+    }
+    registry.close();
+    if(prune)
+    {
+        try
+        {
+            FS::write(registry.fileName(), liveLines.isEmpty() ? QByteArray() : (liveLines.join('\n') + '\n').toUtf8());
+        }
+        catch (const FS::FileSystemException & e)
+        {
+            qWarning() << "Failed to prune content store references:" << e.cause();
+        }
+    }
+    return live;
+}
+
+int ContentStore::references(QCryptographicHash::Algorithm algorithm, const QByteArray& hash)
+{
+    auto object = objectPath(algorithm, hash);
+    if(object.isEmpty() || !QFileInfo(object).isFile())
+    {
+        return 0;
+    }
+    int count = std::max(0, FS::linkCount(object) - 1);
+    return count + liveReferences(false).value(QFileInfo(object).absoluteFilePath());
+}
+
+ContentStore::GarbageStats ContentStore::collectGarbage()
+{
+    GarbageStats stats;
+    auto referenced = liveReferences(true);
+    QDirIterator iter(FS::PathCombine(m_root, "objects"), QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while(iter.hasNext())
+    {
+        auto path = iter.next();
+        auto info = iter.fileInfo();
+        bool leftover = path.endsWith(".tmp");
+        if(!leftover && (FS::linkCount(path) > 1 || referenced.contains(info.absoluteFilePath())))
+        {
+            stats.kept++;
+            continue;
+        }
+        auto size = info.size();
+        if(QFile::remove(path))
+        {
+            stats.removed++;
+            stats.freedBytes += size;
+        }
+        else
+        {
+            qWarning() << "Failed to remove unreferenced content store object" << path;
+            stats.kept++;
+        }
+    }
+    qDebug() << "Content store GC removed" << stats.removed << "objects," << stats.freedBytes << "bytes, kept" << stats.kept;
+    return stats;
+}
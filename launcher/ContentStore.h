@@ -0,0 +1,111 @@
+// Licensed under the Apache-2.0 license. See README.md for details.
+
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QHash>
+#include <memory>
+
+/**
+ * A store of files keyed by their content hash (SHA1 or SHA256), shared by all instances and cache bases.
+ *
+ * Objects live in <root>/objects/<algorithm>/<first two hex digits>/<hex hash>. Downloads that insert() themselves
+ * become references to the objects, and materialize() makes more of them: reflinks or hard links where the file
+ * system allows it, symlinks or copies if asked for. Hard links are counted by the file system itself. Symlinks and
+ * copies (reflinks too) are recorded in <root>/references: a symlink counts while it points at the object, a copy while
+ * a file of the same size is where it was put. collectGarbage() removes the objects nothing refers to anymore.
+ *
+ * Objects are shared, so they must never be modified in place. Only immutable downloads (libraries, asset objects
+ * and cached mod jars) go into the store; files in an instance's game folder are copies of their own (reflinks at
+ * best), because the game and the user change them.
+ */
+class ContentStore
+{
+public: /* types */
+    typedef std::shared_ptr<ContentStore> Ptr;
+    enum class LinkMode
+    {
+        /// reflink if possible, then hard link, then copy
+        Auto,
+        /// hard link if possible, then copy
+        Hardlink,
+        /// symlink if possible, then copy
+        Symlink,
+        /// always copy. The store only saves downloads then.
+        Copy
+    };
+    struct GarbageStats
+    {
+        int removed = 0;
+        qint64 freedBytes = 0;
+        int kept = 0;
+    };
+
+public: /* con/des */
+    explicit ContentStore(const QString & root);
+
+public: /* methods */
+    static LinkMode linkModeFromString(const QString & mode);
+    static QString linkModeToString(LinkMode mode);
+    static bool isSupported(QCryptographicHash::Algorithm algorithm);
+
+    void setLinkMode(LinkMode mode);
+    LinkMode linkMode() const;
+
+    QString root() const
+    {
+        return m_root;
+    }
+    /// Where the object with the hash is (or would be) stored. Empty for unsupported algorithms.
+    QString objectPath(QCryptographicHash::Algorithm algorithm, const QByteArray & hash) const;
+    bool contains(QCryptographicHash::Algorithm algorithm, const QByteArray & hash) const;
+
+    /**
+     * Add a file with a known hash to the store. The caller is responsible for the hash being right.
+     * The file is hard linked into the store when possible (copied in Copy mode), so it must be a file nothing
+     * modifies in place. If the store already has the object, the file is atomically replaced by a reference to it
+     * instead, so only one copy of the data is kept.
+     */
+    bool insert(const QString & file, QCryptographicHash::Algorithm algorithm, const QByteArray & hash);
+
+    /// Hash the file and add it to the store. Returns the SHA1 of the file, or an empty array on failure.
+    QByteArray import(const QString & file);
+
+    /// Make target a reference to the object, replacing whatever is there
+    bool materialize(QCryptographicHash::Algorithm algorithm, const QByteArray & hash, const QString & target);
+
+    /// Put a reference to the data of source at target, adding it to the store on the way (hashing it)
+    bool linkFile(const QString & source, const QString & target);
+
+    /// How many references to the object exist: hard links other than the object itself and recorded references
+    int references(QCryptographicHash::Algorithm algorithm, const QByteArray & hash);
+
+    /// Remove all objects without references
+    GarbageStats collectGarbage();
+
+private: /* types */
+    enum class ReferenceKind
+    {
+        /// counted by the file system
+        Hardlink,
+        Symlink,
+        /// a copy or reflink, nothing ties it to the object
+        Copy
+    };
+
+private: /* methods */
+    /// make target a reference to object. kind tells whether it has to be recorded.
+    bool reference(const QString & object, const QString & target, LinkMode mode, ReferenceKind & kind);
+    void recordReference(const QString & object, const QString & target, ReferenceKind kind);
+    /// object path -> number of recorded references to it that still exist
+    QHash<QString, int> liveReferences(bool prune);
+
+private: /* data */
+    QString m_root;
+    LinkMode m_mode = LinkMode::Auto;
+    // materialize() is called from worker threads during modpack installs
+    mutable QMutex m_mutex;
+};
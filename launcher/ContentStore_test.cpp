@@ -0,0 +1,212 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QCryptographicHash>
+#include "TestUtil.h"
+
+#include "ContentStore.h"
+#include "FileSystem.h"
+
+class ContentStoreTest : public QObject
+{
+    Q_OBJECT
+
+    QByteArray sha1(const QByteArray & data)
+    {
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    }
+
+private
+slots:
+    void test_objectPath()
+    {
+        ContentStore store("/store");
+        auto hash = sha1("hello");
+        QCOMPARE(store.objectPath(QCryptographicHash::Sha1, hash),
+                 QString("/store/objects/sha1/aa/aaf4c61ddcc5e8a2dabede0f3b482cd9aea9434d"));
+        QVERIFY(!store.objectPath(QCryptographicHash::Sha256, QCryptographicHash::hash("hello", QCryptographicHash::Sha256)).isEmpty());
+        // wrong length or unsupported algorithm
+        QVERIFY(store.objectPath(QCryptographicHash::Sha1, QByteArray("abc")).isEmpty());
+        QVERIFY(store.objectPath(QCryptographicHash::Md5, QCryptographicHash::hash("hello", QCryptographicHash::Md5)).isEmpty());
+    }
+
+    void test_insertAndMaterialize_data()
+    {
+        QTest::addColumn<QString>("mode");
+        QTest::newRow("auto") << "Auto";
+        QTest::newRow("hardlink") << "Hardlink";
+        QTest::newRow("symlink") << "Symlink";
+        QTest::newRow("copy") << "Copy";
+    }
+
+    void test_insertAndMaterialize()
+    {
+        QFETCH(QString, mode);
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::linkModeFromString(mode));
+        QCOMPARE(ContentStore::linkModeToString(store.linkMode()), mode);
+
+        QByteArray data(100000, 'm');
+        auto download = FS::PathCombine(dir.path(), "cache", "mod.jar");
+        FS::write(download, data);
+        QVERIFY(store.insert(download, QCryptographicHash::Sha1, sha1(data)));
+        QVERIFY(store.contains(QCryptographicHash::Sha1, sha1(data)));
+
+        // two instances using the same mod
+        auto first = FS::PathCombine(dir.path(), "instances", "a", "mods", "mod.jar");
+        auto second = FS::PathCombine(dir.path(), "instances", "b", "mods", "mod.jar");
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(data), first));
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(data), second));
+        QCOMPARE(FS::read(first), data);
+        QCOMPARE(FS::read(second), data);
+
+        // objects that are not there can't be materialized
+        QVERIFY(!store.materialize(QCryptographicHash::Sha1, sha1("nope"), FS::PathCombine(dir.path(), "nope")));
+    }
+
+    void test_insertCopy()
+    {
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::LinkMode::Copy);
+
+        QByteArray data(1000, 'c');
+        auto download = FS::PathCombine(dir.path(), "cache", "library.jar");
+        FS::write(download, data);
+        QVERIFY(store.insert(download, QCryptographicHash::Sha1, sha1(data)));
+        // the store got a copy of its own, the file is left alone
+        QCOMPARE(FS::linkCount(download), 1);
+        QCOMPARE(FS::read(store.objectPath(QCryptographicHash::Sha1, sha1(data))), data);
+    }
+
+    void test_insertExisting()
+    {
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::LinkMode::Hardlink);
+
+        QByteArray data(1000, 'e');
+        auto first = FS::PathCombine(dir.path(), "first.jar");
+        auto second = FS::PathCombine(dir.path(), "second.jar");
+        FS::write(first, data);
+        FS::write(second, data);
+        QVERIFY(store.insert(first, QCryptographicHash::Sha1, sha1(data)));
+        QVERIFY(store.insert(second, QCryptographicHash::Sha1, sha1(data)));
+        // replaced in place by a reference to the object, nothing left behind
+        QCOMPARE(FS::read(second), data);
+        QVERIFY(!QFile::exists(second + ".store"));
+        if(FS::linkCount(second) < 2)
+        {
+            QSKIP("The file system doesn't support hard links");
+        }
+        QCOMPARE(FS::fileIdentity(second), FS::fileIdentity(first));
+    }
+
+    void test_garbageCollection()
+    {
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::LinkMode::Hardlink);
+
+        QByteArray used(1000, 'u');
+        QByteArray unused(2000, 'x');
+        auto usedFile = FS::PathCombine(dir.path(), "used.jar");
+        auto unusedFile = FS::PathCombine(dir.path(), "unused.jar");
+        FS::write(usedFile, used);
+        FS::write(unusedFile, unused);
+        QVERIFY(!store.import(usedFile).isEmpty());
+        QVERIFY(!store.import(unusedFile).isEmpty());
+
+        auto instanceFile = FS::PathCombine(dir.path(), "instance", "mods", "used.jar");
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(used), instanceFile));
+        QFile::remove(usedFile);
+        QFile::remove(unusedFile);
+
+        if(FS::linkCount(instanceFile) < 2)
+        {
+            QSKIP("The file system doesn't support hard links");
+        }
+        QCOMPARE(store.references(QCryptographicHash::Sha1, sha1(used)), 1);
+        QCOMPARE(store.references(QCryptographicHash::Sha1, sha1(unused)), 0);
+
+        auto stats = store.collectGarbage();
+        QCOMPARE(stats.removed, 1);
+        QCOMPARE(stats.freedBytes, qint64(2000));
+        QCOMPARE(stats.kept, 1);
+        QVERIFY(store.contains(QCryptographicHash::Sha1, sha1(used)));
+        QVERIFY(!store.contains(QCryptographicHash::Sha1, sha1(unused)));
+        QCOMPARE(FS::read(instanceFile), used);
+
+        // once the instance is gone, so is the object
+        QFile::remove(instanceFile);
+        QCOMPARE(store.collectGarbage().removed, 1);
+    }
+
+    void test_copyReferences()
+    {
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::LinkMode::Copy);
+
+        QByteArray used(1000, 'u');
+        QByteArray unused(2000, 'x');
+        auto usedFile = FS::PathCombine(dir.path(), "used.jar");
+        auto unusedFile = FS::PathCombine(dir.path(), "unused.jar");
+        FS::write(usedFile, used);
+        FS::write(unusedFile, unused);
+        QVERIFY(!store.import(usedFile).isEmpty());
+        QVERIFY(!store.import(unusedFile).isEmpty());
+
+        // copies don't show up in the link count, the store remembers them
+        auto instanceFile = FS::PathCombine(dir.path(), "instance", "mods", "used.jar");
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(used), instanceFile));
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(used), instanceFile));
+        QCOMPARE(FS::linkCount(instanceFile), 1);
+        QFile::remove(usedFile);
+        QFile::remove(unusedFile);
+        QCOMPARE(store.references(QCryptographicHash::Sha1, sha1(used)), 1);
+        QCOMPARE(store.references(QCryptographicHash::Sha1, sha1(unused)), 0);
+
+        auto stats = store.collectGarbage();
+        QCOMPARE(stats.removed, 1);
+        QCOMPARE(stats.kept, 1);
+        QVERIFY(store.contains(QCryptographicHash::Sha1, sha1(used)));
+        QVERIFY(!store.contains(QCryptographicHash::Sha1, sha1(unused)));
+
+        // a copy that was replaced by something else doesn't count
+        FS::write(instanceFile, "replaced");
+        QCOMPARE(store.collectGarbage().removed, 1);
+        QVERIFY(!store.contains(QCryptographicHash::Sha1, sha1(used)));
+    }
+
+    void test_symlinkReferences()
+    {
+#if defined(Q_OS_WIN)
+        QSKIP("Symlinks need special privileges on Windows");
+#endif
+        QTemporaryDir dir;
+        ContentStore store(FS::PathCombine(dir.path(), "store"));
+        store.setLinkMode(ContentStore::LinkMode::Symlink);
+
+        QByteArray data(500, 's');
+        auto file = FS::PathCombine(dir.path(), "file.jar");
+        FS::write(file, data);
+        // the first copy is linked into the store as it is
+        QVERIFY(!store.import(file).isEmpty());
+        QCOMPARE(FS::read(file), data);
+
+        auto target = FS::PathCombine(dir.path(), "instance", "file.jar");
+        QVERIFY(store.materialize(QCryptographicHash::Sha1, sha1(data), target));
+        QVERIFY(QFileInfo(target).isSymLink());
+        QCOMPARE(store.references(QCryptographicHash::Sha1, sha1(data)), 2);
+
+        QCOMPARE(store.collectGarbage().removed, 0);
+        QFile::remove(file);
+        QFile::remove(target);
+        QCOMPARE(store.collectGarbage().removed, 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(ContentStoreTest)
+
+#include "ContentStore_test.moc"
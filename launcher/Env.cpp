@@ -1,5 +1,8 @@
 #include "Env.h"
 #include "net/HttpMetaCache.h"
+#include "net/Scheduler.h"
+#include "ContentStore.h"
+#include "minecraft/mod/ModDetailsCache.h"
 #include "BaseVersion.h"
 #include "BaseVersionList.h"
 #include <QDir>
@@ -17,6 +20,9 @@ struct Env::Private
 {
     QNetworkAccessManager m_qnam;
     shared_qobject_ptr<HttpMetaCache> m_metacache;
+    std::shared_ptr<Net::Scheduler> m_netScheduler;
+    std::shared_ptr<ContentStore> m_contentStore;
+    std::shared_ptr<ModDetailsCache> m_modDetailsCache;
     std::shared_ptr<IIconList> m_iconlist;
     shared_qobject_ptr<Meta::Index> m_metadataIndex;
     QString m_jarsPath;
@@ -59,6 +65,35 @@ shared_qobject_ptr< HttpMetaCache > Env::metacache()
     return d->m_metacache;
 }
 
+std::shared_ptr<Net::Scheduler> Env::netScheduler()
+{
+    if (!d->m_netScheduler)
+    {
+        d->m_netScheduler = std::make_shared<Net::Scheduler>();
+    }
+    return d->m_netScheduler;
+}
+
+std::shared_ptr<ContentStore> Env::contentStore()
+{
+    return d->m_contentStore;
+}
+
+void Env::initContentStore(const QString& root)
+{
+    d->m_contentStore = std::make_shared<ContentStore>(root);
+}
+
+std::shared_ptr<ModDetailsCache> Env::modDetailsCache()
+{
+    return d->m_modDetailsCache;
+}
+
+void Env::initModDetailsCache(const QString& path)
+{
+    d->m_modDetailsCache = std::make_shared<ModDetailsCache>(path);
+}
+
 QNetworkAccessManager& Env::qnam() const
 {
     return d->m_qnam;
@@ -9,6 +9,8 @@
 
 class QNetworkAccessManager;
 class HttpMetaCache;
+class ContentStore;
+class ModDetailsCache;
 class BaseVersionList;
 class BaseVersion;
 
@@ -17,6 +19,11 @@ namespace Meta
 class Index;
 }
 
+namespace Net
+{
+class Scheduler;
+}
+
 #if defined(ENV)
     #undef ENV
 #endif
@@ -38,11 +45,26 @@ public:
 
     shared_qobject_ptr<HttpMetaCache> metacache();
 
+    /// The connection scheduler shared by all NetJobs
+    std::shared_ptr<Net::Scheduler> netScheduler();
+
+    /// The content-addressed store shared by all instances. Null until initContentStore() is called.
+    std::shared_ptr<ContentStore> contentStore();
+
+    /// What is known about mod files, shared by all mod lists. Null until initModDetailsCache() is called.
+    std::shared_ptr<ModDetailsCache> modDetailsCache();
+
     std::shared_ptr<IIconList> icons();
 
     /// init the cache. FIXME: possible future hook point
     void initHttpMetaCache();
 
+    /// init the content store in the given folder
+    void initContentStore(const QString & root);
+
+    /// init the mod details cache, stored in the given file
+    void initModDetailsCache(const QString & path);
+
     /// Updates the application proxy settings from the settings object.
     void updateProxySettings(QString proxyTypeStr, QString addr, int port, QString user, QString password);
 
@@ -5,11 +5,18 @@
 #include <QDir>
 #include <QFile>
 #include <QSaveFile>
+#include <QTemporaryFile>
 #include <QFileInfo>
 #include <QDebug>
 #include <QUrl>
 #include <QStandardPaths>
 #include <QTextStream>
+#include <QQueue>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <atomic>
+#include <algorithm>
 
 #if defined Q_OS_WIN32
     #include <windows.h>
@@ -23,6 +30,26 @@
     #include <shlobj.h>
 #else
     #include <utime.h>
+    #include <sys/stat.h>
+#endif
+
+#if !defined Q_OS_WIN32
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <cstdio>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+#if defined Q_OS_LINUX
+    #include <sys/ioctl.h>
+    #include <sys/sendfile.h>
+    #include <sys/syscall.h>
+    #include <linux/fs.h>
+#endif
+
+#if defined Q_OS_MACOS
+    #include <sys/clonefile.h>
 #endif
 
 namespace FS {
@@ -36,9 +63,42 @@ void ensureExists(const QDir &dir)
     }
 }
 
-void write(const QString &filename, const QByteArray &data)
+void write(const QString &filename, const QByteArray &data, bool sync)
 {
     ensureExists(QFileInfo(filename).dir());
+#if !defined Q_OS_WIN32
+    // QSaveFile always syncs, this is the same thing without it
+    if (!sync)
+    {
+        QTemporaryFile file(filename + ".XXXXXX");
+        if (!file.open())
+        {
+            throw FileSystemException("Couldn't open " + filename + " for writing: " +
+                                      file.errorString());
+        }
+        if (data.size() != file.write(data) || !file.flush())
+        {
+            throw FileSystemException("Error writing data to " + filename + ": " +
+                                      file.errorString());
+        }
+        // same as QSaveFile, the replaced file keeps its permissions
+        QFileInfo existing(filename);
+        file.setPermissions(existing.exists() ? existing.permissions()
+                                              : QFileDevice::ReadOwner | QFileDevice::WriteOwner |
+                                                    QFileDevice::ReadGroup | QFileDevice::ReadOther);
+        QByteArray fromBA = QFile::encodeName(file.fileName());
+        QByteArray toBA = QFile::encodeName(filename);
+        if (::rename(fromBA.constData(), toBA.constData()) != 0)
+        {
+            throw FileSystemException("Error while committing data to " + filename + ": " +
+                                      QString::fromLocal8Bit(strerror(errno)));
+        }
+        file.setAutoRemove(false);
+        return;
+    }
+#else
+    Q_UNUSED(sync);
+#endif
     QSaveFile file(filename);
     if (!file.open(QSaveFile::WriteOnly))
     {
@@ -87,6 +147,163 @@ bool updateTimestamp(const QString& filename)
 #endif
 }
 
+QByteArray hashFile(const QString& filename, QCryptographicHash::Algorithm algorithm)
+{
+    QFile input(filename);
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        return QByteArray();
+    }
+    QCryptographicHash hash(algorithm);
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    qint64 read;
+    while ((read = input.read(buffer.data(), buffer.size())) > 0)
+    {
+        hash.addData(buffer.constData(), read);
+    }
+    if (read < 0)
+    {
+        return QByteArray();
+    }
+    return hash.result();
+}
+
+quint64 fileIdentity(const QString& filename)
+{
+#ifdef Q_OS_WIN32
+    // there is no cheap equivalent that doesn't involve opening the file
+    Q_UNUSED(filename);
+    return 0;
+#else
+    QByteArray filenameBA = QFile::encodeName(filename);
+    struct stat info;
+    if (::stat(filenameBA.constData(), &info) != 0)
+    {
+        return 0;
+    }
+    return info.st_ino;
+#endif
+}
+
+bool preallocate(QFileDevice& file, qint64 size)
+{
+#if defined Q_OS_LINUX
+    if (size <= 0 || file.handle() == -1)
+    {
+        return false;
+    }
+    // keep the size, so a shorter file than announced doesn't end up with garbage at the end
+    return ::fallocate(file.handle(), FALLOC_FL_KEEP_SIZE, 0, size) == 0;
+#else
+    Q_UNUSED(file);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+bool hardlink(const QString& src, const QString& dst)
+{
+#if defined Q_OS_WIN32
+    std::wstring src_utf_16 = src.toStdWString();
+    std::wstring dst_utf_16 = dst.toStdWString();
+    return CreateHardLinkW(dst_utf_16.c_str(), src_utf_16.c_str(), nullptr) != 0;
+#else
+    QByteArray srcBA = QFile::encodeName(src);
+    QByteArray dstBA = QFile::encodeName(dst);
+    return ::link(srcBA.constData(), dstBA.constData()) == 0;
+#endif
+}
+
+bool reflink(const QString& src, const QString& dst)
+{
+#if defined Q_OS_LINUX && defined FICLONE
+    QByteArray srcBA = QFile::encodeName(src);
+    QByteArray dstBA = QFile::encodeName(dst);
+    int in = ::open(srcBA.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(in, &info) != 0)
+    {
+        ::close(in);
+        return false;
+    }
+    int out = ::open(dstBA.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, info.st_mode & 0777);
+    if (out < 0)
+    {
+        ::close(in);
+        return false;
+    }
+    // the umask took its part of the mode away when the file was created
+    bool success = ::fchmod(out, info.st_mode & 0777) == 0 && ::ioctl(out, FICLONE, in) == 0;
+    ::close(out);
+    ::close(in);
+    if (!success)
+    {
+        ::unlink(dstBA.constData());
+    }
+    return success;
+#elif defined Q_OS_MACOS
+    QByteArray srcBA = QFile::encodeName(src);
+    QByteArray dstBA = QFile::encodeName(dst);
+    return ::clonefile(srcBA.constData(), dstBA.constData(), 0) == 0;
+#else
+    Q_UNUSED(src);
+    Q_UNUSED(dst);
+    return false;
+#endif
+}
+
+bool cloneFile(const QString& src, const QString& dst)
+{
+    return reflink(src, dst) || QFile::copy(src, dst);
+}
+
+bool shareFile(const QString& src, const QString& dst)
+{
+    return reflink(src, dst) || hardlink(src, dst) || QFile::copy(src, dst);
+}
+
+bool replaceFile(const QString& src, const QString& dst)
+{
+#if defined Q_OS_WIN32
+    std::wstring src_utf_16 = src.toStdWString();
+    std::wstring dst_utf_16 = dst.toStdWString();
+    return MoveFileExW(src_utf_16.c_str(), dst_utf_16.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    QByteArray srcBA = QFile::encodeName(src);
+    QByteArray dstBA = QFile::encodeName(dst);
+    return ::rename(srcBA.constData(), dstBA.constData()) == 0;
+#endif
+}
+
+int linkCount(const QString& filename)
+{
+#if defined Q_OS_WIN32
+    std::wstring filename_utf_16 = filename.toStdWString();
+    HANDLE handle = CreateFileW(filename_utf_16.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    int count = GetFileInformationByHandle(handle, &info) ? int(info.nNumberOfLinks) : 0;
+    CloseHandle(handle);
+    return count;
+#else
+    QByteArray filenameBA = QFile::encodeName(filename);
+    struct stat info;
+    if (::lstat(filenameBA.constData(), &info) != 0)
+    {
+        return 0;
+    }
+    return int(info.st_nlink);
+#endif
+}
+
 bool ensureFilePathExists(QString filenamepath)
 {
     QFileInfo a(filenamepath);
@@ -96,6 +313,11 @@ bool ensureFilePathExists(QString filenamepath)
     return success;
 }
 
+int ioThreadCount()
+{
+    return qBound(2, QThread::idealThreadCount(), 8);
+}
+
 bool ensureFolderPathExists(QString foldernamepath)
 {
     QFileInfo a(foldernamepath);
@@ -105,70 +327,337 @@ bool ensureFolderPathExists(QString foldernamepath)
     return success;
 }
 
-bool copy::operator()(const QString &offset)
+struct CopyState
+{
+    std::atomic<qint64> copied{0};
+    std::atomic<qint64> total{0};
+    std::atomic<bool> canceled{false};
+    std::atomic<bool> failed{false};
+};
+
+namespace {
+// files are handed to the copying threads in batches of about this much
+const int copyBatchFiles = 64;
+const qint64 copyBatchBytes = 64 * 1024 * 1024;
+// how much is copied at once, between checks for cancellation
+const qint64 copyChunk = 8 * 1024 * 1024;
+
+struct PendingCopy
+{
+    QString src;
+    QString dst;
+    qint64 size;
+};
+
+bool stopped(const CopyState & state)
+{
+    return state.canceled || state.failed;
+}
+
+#if !defined Q_OS_WIN32
+bool copyDescriptor(int in, int out, CopyState & state)
+{
+    // the kernel can copy without the data coming up here, through copy_file_range and sendfile. Not all file systems
+    // and kernels support those, so it goes down that list, falling back to plain reads and writes.
+#if defined Q_OS_LINUX && defined __NR_copy_file_range
+    bool useCopyRange = true;
+#else
+    bool useCopyRange = false;
+#endif
+#if defined Q_OS_LINUX
+    bool useSendfile = true;
+#else
+    bool useSendfile = false;
+#endif
+    QByteArray buffer;
+    while (!stopped(state))
+    {
+        ssize_t copied = 0;
+        if (useCopyRange)
+        {
+#if defined Q_OS_LINUX && defined __NR_copy_file_range
+            copied = ::syscall(__NR_copy_file_range, in, nullptr, out, nullptr, size_t(copyChunk), 0u);
+            if (copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EPERM))
+            {
+                useCopyRange = false;
+                continue;
+            }
+#endif
+        }
+        else if (useSendfile)
+        {
+#if defined Q_OS_LINUX
+            copied = ::sendfile(out, in, nullptr, size_t(copyChunk));
+            if (copied < 0 && (errno == ENOSYS || errno == EINVAL))
+            {
+                useSendfile = false;
+                continue;
+            }
+#endif
+        }
+        else
+        {
+            if (buffer.isEmpty())
+            {
+                buffer.resize(1024 * 1024);
+            }
+            copied = ::read(in, buffer.data(), buffer.size());
+            for (ssize_t written = 0; copied > 0 && written < copied;)
+            {
+                auto result = ::write(out, buffer.constData() + written, copied - written);
+                if (result < 0 && errno != EINTR)
+                {
+                    return false;
+                }
+                written += std::max<ssize_t>(result, 0);
+            }
+        }
+        if (copied < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        if (copied == 0)
+        {
+            return true;
+        }
+        state.copied += copied;
+    }
+    return false;
+}
+#endif
+
+bool copyFileData(const QString & src, const QString & dst, qint64 size, CopyState & state)
+{
+    if (reflink(src, dst))
+    {
+        state.copied += size;
+        return true;
+    }
+#if defined Q_OS_WIN32
+    QFile in(src);
+    QFile out(dst);
+    if (QFileInfo::exists(dst) || !in.open(QIODevice::ReadOnly) || !out.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    preallocate(out, size);
+    bool success = true;
+    while (success && !in.atEnd())
+    {
+        auto data = in.read(copyChunk);
+        success = !stopped(state) && !data.isEmpty() && out.write(data) == data.size();
+        state.copied += data.size();
+    }
+    out.close();
+    success = success && out.error() == QFileDevice::NoError && out.setPermissions(in.permissions());
+    if (!success)
+    {
+        out.remove();
+    }
+    return success;
+#else
+    QByteArray srcBA = QFile::encodeName(src);
+    QByteArray dstBA = QFile::encodeName(dst);
+    int in = ::open(srcBA.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (::fstat(in, &info) != 0)
+    {
+        ::close(in);
+        return false;
+    }
+    // same as QFile::copy, the target must not exist yet and gets the permissions of the source
+    int out = ::open(dstBA.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, info.st_mode & 0777);
+    if (out < 0)
+    {
+        ::close(in);
+        return false;
+    }
+    // the umask took its part of the mode away when the file was created
+    bool success = ::fchmod(out, info.st_mode & 0777) == 0 && copyDescriptor(in, out, state);
+    success = ::close(out) == 0 && success;
+    ::close(in);
+    if (!success)
+    {
+        ::unlink(dstBA.constData());
+    }
+    return success;
+#endif
+}
+
+bool copyFiles(const std::vector<PendingCopy> & files, std::shared_ptr<CopyState> state)
+{
+    for (auto & file: files)
+    {
+        if (stopped(*state))
+        {
+            return false;
+        }
+        if (!copyFileData(file.src, file.dst, file.size, *state))
+        {
+            qWarning() << "Failed to copy" << file.src << "to" << file.dst;
+            state->failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+copy::copy(const QString & src, const QString & dst)
+    : m_src(src), m_dst(dst), m_state(std::make_shared<CopyState>())
+{
+    m_threads = ioThreadCount();
+}
+
+void copy::cancel()
+{
+    m_state->canceled = true;
+}
+
+bool copy::wasCanceled() const
+{
+    return m_state->canceled;
+}
+
+qint64 copy::bytesCopied() const
+{
+    return m_state->copied;
+}
+
+qint64 copy::bytesTotal() const
+{
+    return m_state->total;
+}
+
+bool copy::operator()()
 {
     //NOTE always deep copy on windows. the alternatives are too messy.
     #if defined Q_OS_WIN32
     m_followSymlinks = true;
     #endif
 
-    auto src = PathCombine(m_src.absolutePath(), offset);
-    auto dst = PathCombine(m_dst.absolutePath(), offset);
+    auto src = m_src.absolutePath();
+    auto dst = m_dst.absolutePath();
 
     QFileInfo currentSrc(src);
     if (!currentSrc.exists())
         return false;
 
-    if(!m_followSymlinks && currentSrc.isSymLink())
+    if (currentSrc.isDir() && (m_followSymlinks || !currentSrc.isSymLink()))
     {
-        qDebug() << "creating symlink" << src << " - " << dst;
-        if (!ensureFilePathExists(dst))
-        {
-            qWarning() << "Cannot create path!";
-            return false;
-        }
-        return QFile::link(currentSrc.symLinkTarget(), dst);
+        return copyTree(src, dst);
     }
-    else if(currentSrc.isFile())
+    if (!ensureFilePathExists(dst))
     {
-        qDebug() << "copying file" << src << " - " << dst;
-        if (!ensureFilePathExists(dst))
-        {
-            qWarning() << "Cannot create path!";
-            return false;
-        }
-        return QFile::copy(src, dst);
+        qWarning() << "Cannot create path!";
+        return false;
+    }
+    return copyEntry(currentSrc, dst);
+}
+
+bool copy::copyEntry(const QFileInfo & src, const QString & dst)
+{
+    if (!m_followSymlinks && src.isSymLink())
+    {
+        return QFile::link(src.symLinkTarget(), dst);
+    }
+    else if (src.isFile())
+    {
+        m_state->total += src.size();
+        return copyFileData(src.filePath(), dst, src.size(), *m_state);
+    }
+    qCritical() << "Copy ERROR: Unknown filesystem object:" << src.filePath();
+    return false;
+}
+
+bool copy::copyTree(const QString & src, const QString & dst)
+{
+    if (!ensureFolderPathExists(dst))
+    {
+        qWarning() << "Cannot create path!";
+        return false;
     }
-    else if(currentSrc.isDir())
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(1, m_threads));
+    std::vector<QFuture<bool>> running;
+    std::vector<PendingCopy> batch;
+    qint64 batchSize = 0;
+    auto startBatch = [&]()
     {
-        qDebug() << "recursing" << offset;
-        if (!ensureFolderPathExists(dst))
+        if (batch.empty())
         {
-            qWarning() << "Cannot create path!";
-            return false;
+            return;
         }
-        QDir currentDir(src);
-        for(auto & f : currentDir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System))
+        running.push_back(QtConcurrent::run(&pool, copyFiles, batch, m_state));
+        batch.clear();
+        batchSize = 0;
+    };
+
+    // a folder is always created before anything in it is handed out
+    bool success = true;
+    QQueue<QString> folders;
+    folders.enqueue(QString());
+    while (success && !folders.isEmpty() && !stopped(*m_state))
+    {
+        auto offset = folders.dequeue();
+        QDir currentDir(PathCombine(src, offset));
+        auto entries = currentDir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+        for (auto & entry: entries)
         {
-            auto inner_offset = PathCombine(offset, f);
+            auto innerOffset = PathCombine(offset, entry.fileName());
             // ignore and skip stuff that matches the blacklist.
-            if(m_blacklist && m_blacklist->matches(inner_offset))
+            if (m_blacklist && m_blacklist->matches(innerOffset))
             {
                 continue;
             }
-            if(!operator()(inner_offset))
+            auto target = PathCombine(dst, innerOffset);
+            if (entry.isDir() && (m_followSymlinks || !entry.isSymLink()))
+            {
+                if (!ensureFolderPathExists(target))
+                {
+                    qWarning() << "Cannot create path" << target;
+                    success = false;
+                    break;
+                }
+                folders.enqueue(innerOffset);
+            }
+            else if (entry.isFile() && (m_followSymlinks || !entry.isSymLink()))
             {
-                qWarning() << "Failed to copy" << inner_offset;
-                return false;
+                m_state->total += entry.size();
+                batch.push_back(PendingCopy{entry.filePath(), target, entry.size()});
+                batchSize += entry.size();
+                if (int(batch.size()) >= copyBatchFiles || batchSize >= copyBatchBytes)
+                {
+                    startBatch();
+                }
+            }
+            else if (!copyEntry(entry, target))
+            {
+                qWarning() << "Failed to copy" << innerOffset;
+                success = false;
+                break;
             }
         }
     }
-    else
+    startBatch();
+    if (!success)
     {
-        qCritical() << "Copy ERROR: Unknown filesystem object:" << src;
-        return false;
+        m_state->failed = true;
     }
-    return true;
+    for (auto & result: running)
+    {
+        success = result.result() && success;
+    }
+    return success && !m_state->canceled;
 }
 
 bool deletePath(QString path)
@@ -6,7 +6,11 @@
 #include "pathmatcher/IPathMatcher.h"
 
 #include <QDir>
+#include <QFileInfo>
 #include <QFlags>
+#include <QCryptographicHash>
+#include <QFileDevice>
+#include <memory>
 
 namespace FS
 {
@@ -19,8 +23,12 @@ public:
 
 /**
  * write data to a file safely
+ *
+ * The file is replaced in one step, so it's either all old or all new. With sync, the data is also on the disk
+ * before the file is replaced, which survives power loss but can take a while on slow disks.
+ * Skipping the sync is not supported on Windows.
  */
-void write(const QString &filename, const QByteArray &data);
+void write(const QString &filename, const QByteArray &data, bool sync = true);
 
 /**
  * read data from a file safely\
@@ -32,6 +40,56 @@ QByteArray read(const QString &filename);
  */
 bool updateTimestamp(const QString & filename);
 
+/**
+ * Hash a file, reading it in small chunks instead of loading it all into memory.
+ * Returns an empty array if the file can't be read.
+ */
+QByteArray hashFile(const QString & filename, QCryptographicHash::Algorithm algorithm);
+
+/**
+ * Get a number that identifies the file on its file system (the inode number on unix), or 0 if there is none.
+ */
+quint64 fileIdentity(const QString & filename);
+
+/**
+ * Reserve disk space for an open file that is about to receive size bytes, without changing its size.
+ * This is only a hint to the file system, and does nothing where it's not supported.
+ */
+bool preallocate(QFileDevice & file, qint64 size);
+
+/**
+ * Create a hard link to src at dst. Both have to be on the same file system.
+ */
+bool hardlink(const QString & src, const QString & dst);
+
+/**
+ * Create a copy of src at dst that shares its data blocks (copy-on-write), where the file system supports it.
+ */
+bool reflink(const QString & src, const QString & dst);
+
+/**
+ * Make dst a copy of src of its own, sharing data blocks with it if the file system can (reflinks).
+ * Use this for anything that may be changed in place later, like files in an instance.
+ */
+bool cloneFile(const QString & src, const QString & dst);
+
+/**
+ * Put the data of src at dst as cheaply as possible: a reflink, a hard link, or a copy if neither works.
+ * Only for files nothing modifies in place, like the launcher's cache entries and what it builds from them.
+ */
+bool shareFile(const QString & src, const QString & dst);
+
+/**
+ * Move src over dst in one step, so dst is always either the old or the new file.
+ * Both have to be on the same file system.
+ */
+bool replaceFile(const QString & src, const QString & dst);
+
+/**
+ * Number of hard links to a file, or 0 if it can't be determined
+ */
+int linkCount(const QString & filename);
+
 /**
  * Creates all the folders in a path for the specified path
  * last segment of the path is treated as a file name and is ignored!
@@ -44,14 +102,25 @@ bool ensureFilePathExists(QString filenamepath);
  */
 bool ensureFolderPathExists(QString filenamepath);
 
+struct CopyState;
+
+/// How many threads to read and write files with at once. Enough to keep a disk busy, not so many they fight over it.
+int ioThreadCount();
+
+/**
+ * Copy a file or a folder with everything in it.
+ *
+ * Folders are walked breadth first on the calling thread, which hands the files to a pool of copying threads in
+ * batches. File data is shared with the source where the file system allows it (reflinks), copied inside the kernel
+ * where it can be, and read and written in big chunks otherwise.
+ *
+ * Copies of this object share the progress and cancellation, so one can be given to another thread to run while the
+ * other one is used to watch it.
+ */
 class copy
 {
 public:
-    copy(const QString & src, const QString & dst)
-    {
-        m_src = src;
-        m_dst = dst;
-    }
+    copy(const QString & src, const QString & dst);
     copy & followSymlinks(const bool follow)
     {
         m_followSymlinks = follow;
@@ -62,19 +131,33 @@ public:
         m_blacklist = filter;
         return *this;
     }
-    bool operator()()
+    /// How many files are copied at the same time
+    copy & threads(const int count)
     {
-        return operator()(QString());
+        m_threads = count;
+        return *this;
     }
+    bool operator()();
+
+    /// Stop copying as soon as possible, which makes the copy fail. Can be called from any thread.
+    void cancel();
+    bool wasCanceled() const;
+    /// File data copied so far. Can be called from any thread.
+    qint64 bytesCopied() const;
+    /// File data found so far. Grows while the folders are still being walked. Can be called from any thread.
+    qint64 bytesTotal() const;
 
 private:
-    bool operator()(const QString &offset);
+    bool copyTree(const QString & src, const QString & dst);
+    bool copyEntry(const QFileInfo & src, const QString & dst);
 
 private:
     bool m_followSymlinks = true;
+    int m_threads = 1;
     const IPathMatcher * m_blacklist = nullptr;
     QDir m_src;
     QDir m_dst;
+    std::shared_ptr<CopyState> m_state;
 };
 
 /**
@@ -1,9 +1,17 @@
 #include <QTest>
 #include <QTemporaryDir>
 #include <QStandardPaths>
+#include <QDirIterator>
+#include <QThread>
+#include <QtConcurrent>
 #include "TestUtil.h"
 
 #include "FileSystem.h"
+#include "pathmatcher/RegexpMatcher.h"
+
+#ifndef Q_OS_WIN32
+#include <sys/stat.h>
+#endif
 
 class FileSystemTest : public QObject
 {
@@ -112,6 +120,132 @@ slots:
         f();
     }
 
+    void test_copy_tree()
+    {
+        QTemporaryDir dir;
+        QString src = FS::PathCombine(dir.path(), "src");
+        QString dst = FS::PathCombine(dir.path(), "dst");
+        qint64 total = TestsInternal::makeInstance(src, 500);
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(src, "bin/run.sh"), "#!/bin/sh\n"));
+        QVERIFY(QFile::setPermissions(FS::PathCombine(src, "bin/run.sh"), QFile::permissions(FS::PathCombine(src, "bin/run.sh")) | QFileDevice::ExeOwner));
+        QVERIFY(QDir().mkpath(FS::PathCombine(src, "empty/folder")));
+        total += 10;
+#ifndef Q_OS_WIN32
+        QVERIFY(QFile::link("run.sh", FS::PathCombine(src, "bin/link")));
+#endif
+
+        RegexpMatcher matcher("saves");
+        FS::copy c(src, dst);
+        c.followSymlinks(false).blacklist(&matcher);
+        QVERIFY(c());
+        QCOMPARE(c.bytesTotal(), total - 8 * 16 * 1024 * 1024);
+        QCOMPARE(c.bytesCopied(), c.bytesTotal());
+        QVERIFY(!QFileInfo::exists(FS::PathCombine(dst, "saves")));
+        QVERIFY(QFileInfo(FS::PathCombine(dst, "empty/folder")).isDir());
+        QCOMPARE(FS::read(FS::PathCombine(dst, "folder7/sub2/file457")), QByteArray(4096 + 457, char('a' + 457 % 26)));
+        QVERIFY(QFileInfo(FS::PathCombine(dst, "bin/run.sh")).permissions() & QFileDevice::ExeOwner);
+#ifndef Q_OS_WIN32
+        QVERIFY(QFileInfo(FS::PathCombine(dst, "bin/link")).isSymLink());
+#endif
+
+        // the target files have to be new, same as with QFile::copy
+        FS::copy again(src, dst);
+        QVERIFY(!again.blacklist(&matcher)());
+    }
+
+    void test_copy_keepsMode()
+    {
+#ifdef Q_OS_WIN32
+        QSKIP("There is no umask on Windows");
+#else
+        QTemporaryDir dir;
+        QString src = FS::PathCombine(dir.path(), "src");
+        QString dst = FS::PathCombine(dir.path(), "dst");
+        auto script = FS::PathCombine(src, "run.sh");
+        QVERIFY(TestsInternal::writeFile(script, "#!/bin/sh\n"));
+        auto mode = QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner | QFileDevice::ReadUser |
+                    QFileDevice::WriteUser | QFileDevice::ExeUser | QFileDevice::ReadGroup | QFileDevice::ExeGroup |
+                    QFileDevice::ReadOther | QFileDevice::ExeOther;
+        QVERIFY(QFile::setPermissions(script, mode));
+
+        // a strict umask doesn't take anything away from the copies
+        auto oldMask = ::umask(077);
+        FS::copy c(src, dst);
+        bool copied = c();
+        ::umask(oldMask);
+        QVERIFY(copied);
+        QCOMPARE(QFile::permissions(FS::PathCombine(dst, "run.sh")), mode);
+#endif
+    }
+
+    void test_copy_cancel()
+    {
+        QTemporaryDir dir;
+        QString src = FS::PathCombine(dir.path(), "src");
+        TestsInternal::makeInstance(src, 100);
+        FS::copy c(src, FS::PathCombine(dir.path(), "dst"));
+        auto running = c;
+        c.cancel();
+        QVERIFY(!running());
+        QVERIFY(running.wasCanceled());
+        QVERIFY(c.bytesCopied() < c.bytesTotal() || c.bytesTotal() == 0);
+    }
+
+    void test_copy_cancelRunning()
+    {
+        QTemporaryDir dir;
+        QString src = FS::PathCombine(dir.path(), "src");
+        QString dst = FS::PathCombine(dir.path(), "dst");
+        qint64 total = TestsInternal::makeInstance(src, 2000);
+        FS::copy c(src, dst);
+        auto running = c;
+        auto result = QtConcurrent::run([running]() mutable { return running(); });
+        while(c.bytesCopied() == 0 && !result.isFinished())
+        {
+            QThread::yieldCurrentThread();
+        }
+        c.cancel();
+        if(result.result())
+        {
+            QCOMPARE(c.bytesCopied(), total);
+            QSKIP("The copy finished before it could be canceled");
+        }
+        QVERIFY(c.wasCanceled());
+        QVERIFY(c.bytesCopied() < total);
+        // files cut off by the cancel are removed, whatever is left is complete
+        QDirIterator iter(dst, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while(iter.hasNext())
+        {
+            auto copied = iter.next();
+            QFileInfo original(FS::PathCombine(src, QDir(dst).relativeFilePath(copied)));
+            QCOMPARE(iter.fileInfo().size(), original.size());
+        }
+    }
+
+    void benchmark_copy_data()
+    {
+        QTest::addColumn<int>("threads");
+        QTest::newRow("one thread") << 1;
+        QTest::newRow("parallel") << 8;
+    }
+
+    // fifty thousand files and some big ones
+    void benchmark_copy()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, threads);
+        QTemporaryDir dir;
+        QString src = FS::PathCombine(dir.path(), "src");
+        qint64 total = TestsInternal::makeInstance(src, 50000);
+        FS::copy c(src, FS::PathCombine(dir.path(), "dst"));
+        c.threads(threads);
+        QBENCHMARK_ONCE
+        {
+            QVERIFY(c());
+        }
+        QCOMPARE(c.bytesCopied(), total);
+    }
+
     void test_getDesktop()
     {
         QCOMPARE(FS::getDesktopDir(), QStandardPaths::writableLocation(QStandardPaths::DesktopLocation));
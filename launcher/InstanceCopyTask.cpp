@@ -22,18 +22,49 @@ InstanceCopyTask::InstanceCopyTask(InstancePtr origInstance, bool copySaves, boo
 void InstanceCopyTask::executeTask()
 {
     setStatus(tr("Copying instance %1").arg(m_origInstance->name()));
+    // changes still waiting for the save timer belong in the copy
+    m_origInstance->settings()->flush();
 
-    FS::copy folderCopy(m_origInstance->instanceRoot(), m_stagingPath);
-    folderCopy.followSymlinks(false).blacklist(m_matcher.get());
+    m_copy.reset(new FS::copy(m_origInstance->instanceRoot(), m_stagingPath));
+    m_copy->followSymlinks(false).blacklist(m_matcher.get());
 
-    m_copyFuture = QtConcurrent::run(QThreadPool::globalInstance(), folderCopy);
+    // the copy runs on a copy of m_copy, which shares the progress and cancellation with it
+    m_copyFuture = QtConcurrent::run(QThreadPool::globalInstance(), *m_copy);
     connect(&m_copyFutureWatcher, &QFutureWatcher<bool>::finished, this, &InstanceCopyTask::copyFinished);
     connect(&m_copyFutureWatcher, &QFutureWatcher<bool>::canceled, this, &InstanceCopyTask::copyAborted);
     m_copyFutureWatcher.setFuture(m_copyFuture);
+    connect(&m_progressTimer, &QTimer::timeout, this, &InstanceCopyTask::copyProgress);
+    m_progressTimer.start(100);
+}
+
+void InstanceCopyTask::copyProgress()
+{
+    setByteProgress(m_copy->bytesCopied(), m_copy->bytesTotal());
+}
+
+bool InstanceCopyTask::canAbort() const
+{
+    return true;
+}
+
+bool InstanceCopyTask::abort()
+{
+    if(!m_copy)
+    {
+        return false;
+    }
+    m_copy->cancel();
+    return true;
 }
 
 void InstanceCopyTask::copyFinished()
 {
+    m_progressTimer.stop();
+    if(m_copy->wasCanceled())
+    {
+        emitAborted();
+        return;
+    }
     auto successful = m_copyFuture.result();
     if(!successful)
     {
@@ -50,6 +81,8 @@ void InstanceCopyTask::copyFinished()
     if(!m_keepPlaytime) {
         inst->resetTimePlayed();
     }
+    // the staging folder is moved into place as soon as this succeeds
+    instanceSettings->flush();
     emitSucceeded();
 }
 
@@ -0,0 +1,411 @@
+#include "InstanceExportTask.h"
+#include <quazip.h>
+#include <quazipfile.h>
+#include <zlib.h>
+#include <QDir>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "FileSystem.h"
+
+struct ExportState
+{
+    QString output;
+    QString root;
+    QString prefix;
+    InstanceExportTask::Filter exclude;
+    int threads = 1;
+
+    std::atomic<qint64> done{0};
+    std::atomic<qint64> total{0};
+    std::atomic<bool> canceled{false};
+    /// the zip is in place. Cancelling comes too late after that.
+    std::atomic<bool> completed{false};
+    std::atomic<int> stored{0};
+    std::atomic<int> deflated{0};
+};
+
+namespace {
+// files bigger than this are streamed into the zip by the writing thread instead of being compressed in memory
+const qint64 streamThreshold = 32 * 1024 * 1024;
+// how much compressed data can wait to be written
+const qint64 maxPendingBytes = 256 * 1024 * 1024;
+const qint64 streamChunk = 1024 * 1024;
+// local header, data descriptor and central directory record of an entry, without the name, generously
+const qint64 zipEntryOverhead = 256;
+
+struct Entry
+{
+    /// name in the zip, folders end with a /
+    QString name;
+    QString path;
+    qint64 size = 0;
+    bool isDir = false;
+};
+
+struct Compressed
+{
+    bool ok = false;
+    QByteArray data;
+    qint64 size = 0;
+    quint32 crc = 0;
+    int method = 0;
+};
+
+// ancestors has the canonical paths of the folders from the root down to this one, symlinks can point back up
+void walk(const QString & root, const QString & relPath, const QString & canonical, QSet<QString> & ancestors,
+          const ExportState & state, std::vector<Entry> & entries)
+{
+    QDir dir(FS::PathCombine(root, relPath));
+    auto infos = dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::Name);
+    for(auto & info: infos)
+    {
+        auto innerPath = relPath.isEmpty() ? info.fileName() : relPath + '/' + info.fileName();
+        if(state.exclude && state.exclude(innerPath))
+        {
+            continue;
+        }
+        Entry entry;
+        entry.path = info.absoluteFilePath();
+        if(info.isDir())
+        {
+            auto innerCanonical = info.isSymLink() ? info.canonicalFilePath() : FS::PathCombine(canonical, info.fileName());
+            if(ancestors.contains(innerCanonical))
+            {
+                qWarning() << "Export: Not following" << info.absoluteFilePath() << ", it links to a folder it is in";
+                continue;
+            }
+            entry.name = FS::PathCombine(state.prefix, innerPath) + '/';
+            entry.isDir = true;
+            entries.push_back(entry);
+            ancestors.insert(innerCanonical);
+            walk(root, innerPath, innerCanonical, ancestors, state, entries);
+            ancestors.remove(innerCanonical);
+        }
+        else
+        {
+            entry.name = FS::PathCombine(state.prefix, innerPath);
+            entry.size = info.size();
+            entries.push_back(entry);
+        }
+    }
+}
+
+bool deflateRaw(const QByteArray & in, QByteArray & out)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // no zlib header, zip entries are raw deflate streams
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+    out.resize(int(deflateBound(&zs, in.size())));
+    zs.next_in = (Bytef *)in.constData();
+    zs.avail_in = in.size();
+    zs.next_out = (Bytef *)out.data();
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(int(zs.total_out));
+    deflateEnd(&zs);
+    return ret == Z_STREAM_END;
+}
+
+Compressed compressFile(const QString & path, bool store, std::shared_ptr<ExportState> state)
+{
+    Compressed out;
+    if(state->canceled)
+    {
+        return out;
+    }
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Export: Cannot read" << path << ":" << file.errorString();
+        return out;
+    }
+    auto data = file.readAll();
+    if(file.error() != QFileDevice::NoError)
+    {
+        qWarning() << "Export: Cannot read" << path << ":" << file.errorString();
+        return out;
+    }
+    out.size = data.size();
+    out.crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data.constData(), data.size());
+    out.ok = true;
+    QByteArray deflated;
+    // a file that doesn't get any smaller is stored as well
+    if(!store && !data.isEmpty() && deflateRaw(data, deflated) && deflated.size() < data.size())
+    {
+        out.data = deflated;
+        out.method = Z_DEFLATED;
+        return out;
+    }
+    out.data = data;
+    out.method = 0;
+    return out;
+}
+
+bool writeCompressed(QuaZip & zip, const Entry & entry, const Compressed & compressed)
+{
+    QuaZipFile out(&zip);
+    QuaZipNewInfo info(entry.name, entry.path);
+    info.uncompressedSize = compressed.size;
+    int level = compressed.method ? Z_DEFAULT_COMPRESSION : 0;
+    if(!out.open(QIODevice::WriteOnly, info, nullptr, compressed.crc, compressed.method, level, true))
+    {
+        return false;
+    }
+    bool ok = out.write(compressed.data) == compressed.data.size();
+    out.close();
+    return ok && out.getZipError() == 0;
+}
+
+bool writeStreamed(QuaZip & zip, const Entry & entry, ExportState & state)
+{
+    QFile in(entry.path);
+    if(!in.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Export: Cannot read" << entry.path << ":" << in.errorString();
+        return false;
+    }
+    bool store = InstanceExportTask::isCompressedFormat(entry.name);
+    QuaZipFile out(&zip);
+    QuaZipNewInfo info(entry.name, entry.path);
+    info.uncompressedSize = entry.size;
+    if(!out.open(QIODevice::WriteOnly, info, nullptr, 0, store ? 0 : Z_DEFLATED, store ? 0 : Z_DEFAULT_COMPRESSION))
+    {
+        return false;
+    }
+    bool ok = true;
+    while(ok && !in.atEnd() && !state.canceled)
+    {
+        auto data = in.read(streamChunk);
+        ok = !data.isEmpty() && out.write(data) == data.size();
+        state.done += data.size();
+    }
+    out.close();
+    if(store)
+    {
+        state.stored++;
+    }
+    else
+    {
+        state.deflated++;
+    }
+    return ok && out.getZipError() == 0;
+}
+
+bool writeFolder(QuaZip & zip, const Entry & entry)
+{
+    QuaZipFile out(&zip);
+    if(!out.open(QIODevice::WriteOnly, QuaZipNewInfo(entry.name, entry.path)))
+    {
+        return false;
+    }
+    out.close();
+    return out.getZipError() == 0;
+}
+
+QString exportFolder(std::shared_ptr<ExportState> state)
+{
+    std::vector<Entry> entries;
+    auto canonicalRoot = QFileInfo(state->root).canonicalFilePath();
+    QSet<QString> ancestors = {canonicalRoot};
+    walk(state->root, QString(), canonicalRoot, ancestors, *state, entries);
+    qint64 total = 0;
+    // headers, names and the central directory count towards the 4 GiB too, and deflate makes data that doesn't
+    // compress a little bigger
+    qint64 overhead = 22;
+    for(auto & entry: entries)
+    {
+        total += entry.size;
+        overhead += zipEntryOverhead + 2 * entry.name.toUtf8().size() + entry.size / 256;
+    }
+    state->total = total;
+
+    QString partial = state->output + ".part";
+    QFile::remove(partial);
+    QuaZip zip(partial);
+    // only when it's needed, some tools don't like zip64 entries
+    zip.setZip64Enabled(total + overhead >= 0xffffffffLL || entries.size() >= 0xffff);
+    if(!zip.open(QuaZip::mdCreate))
+    {
+        return QObject::tr("Could not create %1").arg(partial);
+    }
+
+    QString error;
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(state->threads);
+        std::vector<QFuture<Compressed>> compressing(entries.size());
+        const std::size_t maxAhead = std::size_t(state->threads) * 16;
+        qint64 pendingBytes = 0;
+        std::size_t next = 0;
+        for(std::size_t i = 0; i < entries.size() && !state->canceled; i++)
+        {
+            // keep the workers busy with what comes next, as far as the memory limit allows
+            while(next < entries.size() && next - i < maxAhead && (next == i || pendingBytes < maxPendingBytes))
+            {
+                auto & entry = entries[next];
+                if(!entry.isDir && entry.size <= streamThreshold)
+                {
+                    compressing[next] = QtConcurrent::run(&pool, compressFile, entry.path, InstanceExportTask::isCompressedFormat(entry.name), state);
+                    pendingBytes += entry.size;
+                }
+                next++;
+            }
+
+            auto & entry = entries[i];
+            bool ok;
+            if(entry.isDir)
+            {
+                ok = writeFolder(zip, entry);
+            }
+            else if(entry.size > streamThreshold)
+            {
+                ok = writeStreamed(zip, entry, *state);
+            }
+            else
+            {
+                auto compressed = compressing[i].result();
+                compressing[i] = QFuture<Compressed>();
+                pendingBytes -= entry.size;
+                ok = compressed.ok && writeCompressed(zip, entry, compressed);
+                if(compressed.method)
+                {
+                    state->deflated++;
+                }
+                else
+                {
+                    state->stored++;
+                }
+                state->done += entry.size;
+            }
+            if(!ok && !state->canceled)
+            {
+                error = QObject::tr("Could not add %1 to the zip").arg(entry.path);
+                // no point in compressing the rest
+                state->canceled = true;
+            }
+        }
+    }
+
+    zip.close();
+    if(error.isEmpty() && zip.getZipError() != 0)
+    {
+        error = QObject::tr("Could not finish writing %1").arg(partial);
+    }
+    if(!error.isEmpty() || state->canceled)
+    {
+        QFile::remove(partial);
+        return error;
+    }
+    QFile::remove(state->output);
+    if(!QFile::rename(partial, state->output))
+    {
+        QFile::remove(partial);
+        return QObject::tr("Could not move the zip to %1").arg(state->output);
+    }
+    state->completed = true;
+    return QString();
+}
+}
+
+InstanceExportTask::InstanceExportTask(const QString& output, const QString& root, const QString& prefix, Filter exclude)
+    : m_state(std::make_shared<ExportState>())
+{
+    m_state->output = output;
+    m_state->root = root;
+    m_state->prefix = prefix;
+    m_state->exclude = exclude;
+    m_state->threads = std::max(1, QThread::idealThreadCount());
+    connect(&m_exportWatcher, &QFutureWatcher<QString>::finished, this, &InstanceExportTask::exportFinished);
+    connect(&m_progressTimer, &QTimer::timeout, this, &InstanceExportTask::exportProgress);
+}
+
+InstanceExportTask::~InstanceExportTask()
+{
+    m_state->canceled = true;
+    m_exportWatcher.waitForFinished();
+}
+
+void InstanceExportTask::setThreads(int count)
+{
+    m_state->threads = std::max(1, count);
+}
+
+int InstanceExportTask::storedCount() const
+{
+    return m_state->stored;
+}
+
+int InstanceExportTask::deflatedCount() const
+{
+    return m_state->deflated;
+}
+
+bool InstanceExportTask::isCompressedFormat(const QString& fileName)
+{
+    static const QSet<QString> suffixes = {
+        // archives
+        "jar", "zip", "gz", "tgz", "xz", "bz2", "lzma", "7z", "rar", "zst", "litemod", "mrpack",
+        // media
+        "png", "jpg", "jpeg", "gif", "webp", "ogg", "mp3", "opus", "flac",
+        // region files are made of compressed chunks
+        "mca", "mcr"
+    };
+    return suffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+void InstanceExportTask::executeTask()
+{
+    setStatus(tr("Exporting to %1").arg(m_state->output));
+    m_state->canceled = false;
+    m_state->completed = false;
+    m_exportWatcher.setFuture(QtConcurrent::run(exportFolder, m_state));
+    m_progressTimer.start(100);
+}
+
+void InstanceExportTask::exportProgress()
+{
+    setByteProgress(m_state->done, m_state->total);
+}
+
+void InstanceExportTask::exportFinished()
+{
+    m_progressTimer.stop();
+    auto error = m_exportWatcher.result();
+    if(!error.isEmpty())
+    {
+        emitFailed(error);
+        return;
+    }
+    if(!m_state->completed)
+    {
+        emitAborted();
+        return;
+    }
+    emitSucceeded();
+}
+
+bool InstanceExportTask::canAbort() const
+{
+    return true;
+}
+
+bool InstanceExportTask::abort()
+{
+    if(!isRunning())
+    {
+        return false;
+    }
+    m_state->canceled = true;
+    return true;
+}
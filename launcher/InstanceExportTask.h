@@ -0,0 +1,56 @@
+#pragma once
+
+#include "tasks/Task.h"
+#include <QFutureWatcher>
+#include <QTimer>
+#include <functional>
+#include <memory>
+
+struct ExportState;
+
+/**
+ * Pack a folder into a zip, the way instances are exported.
+ *
+ * Files are compressed on a pool of worker threads, a bit ahead of the one being written, and go into the zip in the
+ * order they were found. Formats that are compressed already (jars, zips, images, sounds, region files...) are stored
+ * as they are instead of being deflated again. Big files are streamed into the zip instead of being held in memory.
+ * The zip is written next to the output and only replaces it once it is complete.
+ */
+class InstanceExportTask : public Task
+{
+    Q_OBJECT
+public:
+    /// Gets the path relative to the root folder, returns true for files and folders to leave out
+    using Filter = std::function<bool(const QString &)>;
+
+    InstanceExportTask(const QString & output, const QString & root, const QString & prefix, Filter exclude = nullptr);
+    virtual ~InstanceExportTask();
+
+    /// How many files are compressed at the same time
+    void setThreads(int count);
+
+    /// How many files went into the zip without and with compression
+    int storedCount() const;
+    int deflatedCount() const;
+
+    /// Whether a file is compressed already, going by its name
+    static bool isCompressedFormat(const QString & fileName);
+
+    bool canAbort() const override;
+
+public slots:
+    bool abort() override;
+
+protected:
+    void executeTask() override;
+
+private slots:
+    void exportFinished();
+    void exportProgress();
+
+private:
+    std::shared_ptr<ExportState> m_state;
+    /// gives back an error message when something went wrong
+    QFutureWatcher<QString> m_exportWatcher;
+    QTimer m_progressTimer;
+};
@@ -0,0 +1,207 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <quazip.h>
+#include <quazipfile.h>
+#include <JlCompress.h>
+#include <QThread>
+#include <QSemaphore>
+#include <zlib.h>
+#include <random>
+#include <atomic>
+#include "TestUtil.h"
+
+#include "InstanceExportTask.h"
+#include "FileSystem.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+class InstanceExportTaskTest : public QObject
+{
+    Q_OBJECT
+
+    QMap<QString, QByteArray> readZip(const QString & path, QMap<QString, int> & methods)
+    {
+        QMap<QString, QByteArray> out;
+        QuaZip zip(path);
+        if(!zip.open(QuaZip::mdUnzip))
+        {
+            return out;
+        }
+        for(bool more = zip.goToFirstFile(); more; more = zip.goToNextFile())
+        {
+            QuaZipFileInfo64 info;
+            zip.getCurrentFileInfo(&info);
+            QuaZipFile file(&zip);
+            file.open(QIODevice::ReadOnly);
+            out.insert(info.name, file.readAll());
+            file.close();
+            methods.insert(info.name, info.method);
+        }
+        return out;
+    }
+
+    static double cpuSeconds()
+    {
+#ifdef Q_OS_UNIX
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#else
+        return 0;
+#endif
+    }
+
+private
+slots:
+    void test_compressedFormat()
+    {
+        QVERIFY(InstanceExportTask::isCompressedFormat("mods/Something-1.2.JAR"));
+        QVERIFY(InstanceExportTask::isCompressedFormat("icon.png"));
+        QVERIFY(InstanceExportTask::isCompressedFormat("saves/world/region/r.0.0.mca"));
+        QVERIFY(!InstanceExportTask::isCompressedFormat("options.txt"));
+        QVERIFY(!InstanceExportTask::isCompressedFormat("saves/world/level.dat"));
+        QVERIFY(!InstanceExportTask::isCompressedFormat("jar"));
+    }
+
+    void test_export()
+    {
+        QTemporaryDir dir;
+        QString root = dir.filePath("instance");
+        std::mt19937 random(1);
+        auto jar = TestsInternal::randomData(random, 100000);
+        auto text = TestsInternal::textData(1000);
+        // bigger than what gets compressed in memory
+        QByteArray big(40 * 1024 * 1024, 'x');
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "mods/mod.jar"), jar));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "icon.png"), text));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "options.txt"), text));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "empty.txt"), QByteArray()));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "logs/latest.log"), text));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "saves/big.dat"), big));
+        QVERIFY(QDir().mkpath(FS::PathCombine(root, "resourcepacks")));
+
+        QString output = dir.filePath("export.zip");
+        QVERIFY(TestsInternal::writeFile(output, "old export"));
+        InstanceExportTask task(output, root, "Instance", [](const QString & path)
+        {
+            return path == "logs";
+        });
+        task.setThreads(4);
+        QVERIFY(TestsInternal::runTask(&task));
+        QVERIFY(!QFile::exists(output + ".part"));
+
+        QMap<QString, int> methods;
+        auto contents = readZip(output, methods);
+        QCOMPARE(contents.keys(), QStringList() << "Instance/empty.txt" << "Instance/icon.png" << "Instance/mods/" << "Instance/mods/mod.jar"
+                 << "Instance/options.txt" << "Instance/resourcepacks/" << "Instance/saves/" << "Instance/saves/big.dat");
+        QCOMPARE(contents["Instance/mods/mod.jar"], jar);
+        QCOMPARE(contents["Instance/options.txt"], text);
+        QCOMPARE(contents["Instance/icon.png"], text);
+        QCOMPARE(contents["Instance/empty.txt"], QByteArray());
+        QCOMPARE(contents["Instance/saves/big.dat"], big);
+        // stored going by the name, even when it would compress
+        QCOMPARE(methods["Instance/icon.png"], 0);
+        QCOMPARE(methods["Instance/mods/mod.jar"], 0);
+        QCOMPARE(methods["Instance/options.txt"], int(Z_DEFLATED));
+        QCOMPARE(methods["Instance/saves/big.dat"], int(Z_DEFLATED));
+        QCOMPARE(task.storedCount(), 3);
+        QCOMPARE(task.deflatedCount(), 2);
+    }
+
+    void test_cancel()
+    {
+        QTemporaryDir dir;
+        QString root = dir.filePath("instance");
+        TestsInternal::makeModpack(root, 20);
+        QString output = dir.filePath("export.zip");
+        // the worker waits in the filter until the task was aborted, so it can't finish first
+        QSemaphore scanning;
+        QSemaphore aborted;
+        std::atomic<bool> blocked{false};
+        auto filter = [&](const QString &)
+        {
+            if(!blocked.exchange(true))
+            {
+                scanning.release();
+                aborted.acquire();
+            }
+            return false;
+        };
+        InstanceExportTask task(output, root, "Instance", filter);
+        connect(&task, &Task::started, &task, [&]()
+        {
+            scanning.acquire();
+            task.abort();
+            aborted.release();
+        }, Qt::QueuedConnection);
+        QVERIFY(!TestsInternal::runTask(&task));
+        QVERIFY(task.wasAborted());
+        QVERIFY(!QFile::exists(output));
+        QVERIFY(!QFile::exists(output + ".part"));
+    }
+
+    void test_symlinkLoop()
+    {
+#if defined(Q_OS_WIN)
+        QSKIP("Symlinks need special privileges on Windows");
+#endif
+        QTemporaryDir dir;
+        QString root = dir.filePath("instance");
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(root, "config/mod.cfg"), TestsInternal::textData(10)));
+        QVERIFY(TestsInternal::writeFile(FS::PathCombine(dir.path(), "shared/options.txt"), TestsInternal::textData(10)));
+        // one back up into the instance, one to a folder outside of it
+        QVERIFY(QFile::link(root, FS::PathCombine(root, "config/loop")));
+        QVERIFY(QFile::link(dir.filePath("shared"), FS::PathCombine(root, "shared")));
+
+        QString output = dir.filePath("export.zip");
+        InstanceExportTask task(output, root, "Instance");
+        QVERIFY(TestsInternal::runTask(&task));
+        QMap<QString, int> methods;
+        auto contents = readZip(output, methods);
+        QCOMPARE(contents.keys(), QStringList() << "Instance/config/" << "Instance/config/mod.cfg" << "Instance/shared/"
+                 << "Instance/shared/options.txt");
+    }
+
+    void benchmark_export_data()
+    {
+        QTest::addColumn<int>("threads");
+        QTest::newRow("compressDir") << 0;
+        QTest::newRow("one thread") << 1;
+        QTest::newRow("parallel") << QThread::idealThreadCount();
+    }
+
+    void benchmark_export()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, threads);
+        QTemporaryDir dir;
+        QString root = dir.filePath("instance");
+        auto total = TestsInternal::makeModpack(root, 200);
+        QString output = dir.filePath("export.zip");
+        QElapsedTimer timer;
+        double cpu = cpuSeconds();
+        timer.start();
+        QBENCHMARK_ONCE
+        {
+            if(threads == 0)
+            {
+                QVERIFY(JlCompress::compressDir(output, root, "Instance"));
+            }
+            else
+            {
+                InstanceExportTask task(output, root, "Instance");
+                task.setThreads(threads);
+                QVERIFY(TestsInternal::runTask(&task));
+            }
+        }
+        qDebug() << "Exported" << total / (1024 * 1024) << "MiB into" << QFileInfo(output).size() / (1024 * 1024) << "MiB in"
+                 << timer.elapsed() << "ms, CPU time" << cpuSeconds() - cpu << "s";
+    }
+};
+
+QTEST_GUILESS_MAIN(InstanceExportTaskTest)
+
+#include "InstanceExportTask_test.moc"
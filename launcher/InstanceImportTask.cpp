@@ -36,6 +36,27 @@
 InstanceImportTask::InstanceImportTask(const QUrl sourceUrl)
 {
     m_sourceUrl = sourceUrl;
+    connect(&m_extractProgressTimer, &QTimer::timeout, this, &InstanceImportTask::extractProgress);
+}
+
+bool InstanceImportTask::canAbort() const
+{
+    return true;
+}
+
+bool InstanceImportTask::abort()
+{
+    if(m_filesNetJob)
+    {
+        return m_filesNetJob->abort();
+    }
+    if(m_extractFutureWatcher.isRunning())
+    {
+        // the extraction stops between two chunks and cleans up after itself
+        m_extractProgress->canceled = true;
+        return true;
+    }
+    return false;
 }
 
 void InstanceImportTask::executeTask()
@@ -129,17 +150,30 @@ void InstanceImportTask::processZipPack()
     }
 
     // make sure we extract just the pack
-    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractSubDir, m_packZip.get(), root, extractDir.absolutePath());
+    m_extractProgress = std::make_shared<MMCZip::ExtractProgress>();
+    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractSubDir, m_packZip.get(), root, extractDir.absolutePath(), m_extractProgress);
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::finished, this, &InstanceImportTask::extractFinished);
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::canceled, this, &InstanceImportTask::extractAborted);
     m_extractFutureWatcher.setFuture(m_extractFuture);
+    m_extractProgressTimer.start(100);
+}
+
+void InstanceImportTask::extractProgress()
+{
+    setByteProgress(m_extractProgress->done, m_extractProgress->total);
 }
 
 void InstanceImportTask::extractFinished()
 {
+    m_extractProgressTimer.stop();
     m_packZip.reset();
     if (!m_extractFuture.result())
     {
+        if (m_extractProgress->canceled)
+        {
+            emitAborted();
+            return;
+        }
         emitFailed(tr("Failed to extract modpack"));
         return;
     }
@@ -452,5 +486,7 @@ void InstanceImportTask::processMultiMC()
             iconList->installIcons({importIconPath});
         }
     }
+    // the staging folder is moved into place as soon as this succeeds
+    instanceSettings->flush();
     emitSucceeded();
 }
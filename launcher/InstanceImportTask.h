@@ -20,8 +20,10 @@
 #include <QUrl>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QTimer>
 #include "settings/SettingsObject.h"
 #include "QObjectPtr.h"
+#include "MMCZip.h"
 
 #include <nonstd/optional>
 
@@ -37,6 +39,11 @@ class InstanceImportTask : public InstanceTask
 public:
     explicit InstanceImportTask(const QUrl sourceUrl);
 
+    bool canAbort() const override;
+
+public slots:
+    bool abort() override;
+
 protected:
     //! Entry point for tasks.
     virtual void executeTask() override;
@@ -53,6 +60,7 @@ private slots:
     void downloadProgressChanged(qint64 current, qint64 total);
     void extractFinished();
     void extractAborted();
+    void extractProgress();
 
 private: /* data */
     NetJobPtr m_filesNetJob;
@@ -63,6 +71,8 @@ private: /* data */
     std::unique_ptr<QuaZip> m_packZip;
     QFuture<nonstd::optional<QStringList>> m_extractFuture;
     QFutureWatcher<nonstd::optional<QStringList>> m_extractFutureWatcher;
+    MMCZip::ExtractProgressPtr m_extractProgress;
+    QTimer m_extractProgressTimer;
     enum class ModpackType{
         Unknown,
         MultiMC,
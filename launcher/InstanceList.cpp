@@ -27,11 +27,16 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QMimeData>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
 
 #include "InstanceList.h"
 #include "BaseInstance.h"
 #include "InstanceTask.h"
 #include "settings/INISettingsObject.h"
+#include "settings/INIFile.h"
+#include "settings/Setting.h"
 #include "minecraft/legacy/LegacyInstance.h"
 #include "NullInstance.h"
 #include "minecraft/MinecraftInstance.h"
@@ -40,6 +45,7 @@
 #include "WatchLock.h"
 
 const static int GROUP_FILE_FORMAT_VERSION = 1;
+const static int INDEX_FILE_FORMAT_VERSION = 1;
 
 InstanceList::InstanceList(SettingsObjectPtr settings, const QString & instDir, QObject *parent)
     : QAbstractListModel(parent), m_globalSettings(settings)
@@ -119,7 +125,7 @@ QModelIndex InstanceList::index(int row, int column, const QModelIndex &parent)
     Q_UNUSED(parent);
     if (row < 0 || row >= m_instances.size())
         return QModelIndex();
-    return createIndex(row, column, (void *)m_instances.at(row).get());
+    return createIndex(row, column);
 }
 
 QVariant InstanceList::data(const QModelIndex &index, int role) const
@@ -128,39 +134,45 @@ QVariant InstanceList::data(const QModelIndex &index, int role) const
     {
         return QVariant();
     }
-    BaseInstance *pdata = static_cast<BaseInstance *>(index.internalPointer());
+    // this doesn't load the instance, the header is enough to show it
+    auto & entry = m_instances.at(index.row());
     switch (role)
     {
     case InstancePointerRole:
     {
-        QVariant v = qVariantFromValue((void *)pdata);
+        // nothing that isn't loaded yet has anything to show beyond the header
+        QVariant v = qVariantFromValue((void *)entry.instance.get());
         return v;
     }
     case InstanceIDRole:
     {
-        return pdata->id();
+        return entry.header.id;
     }
     case Qt::EditRole:
     case Qt::DisplayRole:
     {
-        return pdata->name();
+        return entry.header.name;
     }
     case Qt::AccessibleTextRole:
     {
-        return tr("%1 Instance").arg(pdata->name());
+        return tr("%1 Instance").arg(entry.header.name);
     }
     case Qt::ToolTipRole:
     {
-        return pdata->instanceRoot();
+        return FS::PathCombine(m_instDir, entry.header.id);
     }
     case Qt::DecorationRole:
     {
-        return pdata->iconKey();
+        return entry.header.iconKey;
+    }
+    case LastLaunchRole:
+    {
+        return entry.header.lastLaunch;
     }
     // HACK: see InstanceView.h in gui!
     case GroupRole:
     {
-        return getInstanceGroup(pdata->id());
+        return getInstanceGroup(entry.header.id);
     }
     default:
         break;
@@ -178,13 +190,12 @@ bool InstanceList::setData(const QModelIndex& index, const QVariant& value, int
     {
         return false;
     }
-    BaseInstance *pdata = static_cast<BaseInstance *>(index.internalPointer());
     auto newName = value.toString();
-    if(pdata->name() == newName)
+    if(m_instances.at(index.row()).header.name == newName)
     {
         return true;
     }
-    pdata->setName(newName);
+    at(index.row())->setName(newName);
     return true;
 }
 
@@ -200,12 +211,11 @@ Qt::ItemFlags InstanceList::flags(const QModelIndex &index) const
 
 GroupId InstanceList::getInstanceGroup(const InstanceId& id) const
 {
-    auto inst = getInstanceById(id);
-    if(!inst)
+    if(getInstIndex(id) == -1)
     {
         return GroupId();
     }
-    auto iter = m_instanceGroupIndex.find(inst->id());
+    auto iter = m_instanceGroupIndex.find(id);
     if(iter != m_instanceGroupIndex.end())
     {
         return *iter;
@@ -215,15 +225,15 @@ GroupId InstanceList::getInstanceGroup(const InstanceId& id) const
 
 void InstanceList::setInstanceGroup(const InstanceId& id, const GroupId& name)
 {
-    auto inst = getInstanceById(id);
-    if(!inst)
+    auto idx = getInstIndex(id);
+    if(idx == -1)
     {
         qDebug() << "Attempt to set a null instance's group";
         return;
     }
 
     bool changed = false;
-    auto iter = m_instanceGroupIndex.find(inst->id());
+    auto iter = m_instanceGroupIndex.find(id);
     if(iter != m_instanceGroupIndex.end())
     {
         if(*iter != name)
@@ -241,7 +251,6 @@ void InstanceList::setInstanceGroup(const InstanceId& id, const GroupId& name)
     if(changed)
     {
         m_groupNameCache.insert(name);
-        auto idx = getInstIndex(inst.get());
         emit dataChanged(index(idx), index(idx), {GroupRole});
         saveGroupList();
     }
@@ -256,16 +265,15 @@ void InstanceList::deleteGroup(const QString& name)
 {
     bool removed = false;
     qDebug() << "Delete group" << name;
-    for(auto & instance: m_instances)
+    for(int idx = 0; idx < m_instances.size(); idx++)
     {
-        const auto & instID = instance->id();
+        const auto & instID = m_instances[idx].header.id;
         auto instGroupName = getInstanceGroup(instID);
         if(instGroupName == name)
         {
             m_instanceGroupIndex.remove(instID);
             qDebug() << "Remove" << instID << "from group" << name;
             removed = true;
-            auto idx = getInstIndex(instance.get());
             if(idx > 0)
             {
                 emit dataChanged(index(idx), index(idx), {GroupRole});
@@ -285,8 +293,7 @@ bool InstanceList::isGroupCollapsed(const QString& group)
 
 void InstanceList::deleteInstance(const InstanceId& id)
 {
-    auto inst = getInstanceById(id);
-    if(!inst)
+    if(getInstIndex(id) == -1)
     {
         qDebug() << "Cannot delete instance" << id << ". No such instance is present (deleted externally?).";
         return;
@@ -298,7 +305,7 @@ void InstanceList::deleteInstance(const InstanceId& id)
     }
 
     qDebug() << "Will delete instance" << id;
-    if(!FS::deletePath(inst->instanceRoot()))
+    if(!FS::deletePath(FS::PathCombine(m_instDir, id)))
     {
         qWarning() << "Deletion of instance" << id << "has not been completely successful ...";
         return;
@@ -307,88 +314,160 @@ void InstanceList::deleteInstance(const InstanceId& id)
     qDebug() << "Instance" << id << "has been deleted by the launcher.";
 }
 
-static QMap<InstanceId, InstanceLocator> getIdMapping(const QList<InstancePtr> &list)
+namespace {
+// looks at one folder in the instance folder, giving an empty header if it's not an instance
+struct HeaderProbe
 {
-    QMap<InstanceId, InstanceLocator> out;
-    int i = 0;
-    for(auto & item: list)
-    {
-        auto id = item->id();
-        if(out.contains(id))
-        {
-            qWarning() << "Duplicate ID" << id << "in instance list";
-        }
-        out[id] = std::make_pair(item, i);
-        i++;
-    }
-    return out;
-}
+    typedef InstanceHeader result_type;
 
-QList< InstanceId > InstanceList::discoverInstances()
-{
-    qDebug() << "Discovering instances in" << m_instDir;
-    QList<InstanceId> out;
-    QDirIterator iter(m_instDir, QDir::Dirs | QDir::NoDot | QDir::NoDotDot | QDir::Readable | QDir::Hidden, QDirIterator::FollowSymlinks);
-    while (iter.hasNext())
+    QString instDir;
+    QMap<InstanceId, InstanceHeader> index;
+
+    InstanceHeader operator()(const QString & subDir) const
     {
-        QString subDir = iter.next();
+        InstanceHeader header;
         QFileInfo dirInfo(subDir);
-        if (!QFileInfo(FS::PathCombine(subDir, "instance.cfg")).exists())
-            continue;
+        QFileInfo configInfo(FS::PathCombine(subDir, "instance.cfg"));
+        if (!configInfo.exists())
+            return header;
         // if it is a symlink, ignore it if it goes to the instance folder
         if(dirInfo.isSymLink())
         {
             QFileInfo targetInfo(dirInfo.symLinkTarget());
-            QFileInfo instDirInfo(m_instDir);
+            QFileInfo instDirInfo(instDir);
             if(targetInfo.canonicalPath() == instDirInfo.canonicalFilePath())
             {
                 qDebug() << "Ignoring symlink" << subDir << "that leads into the instances folder";
-                continue;
+                return header;
             }
         }
         auto id = dirInfo.fileName();
-        out.append(id);
-        qDebug() << "Found instance ID" << id;
+        qint64 size = configInfo.size();
+        qint64 modified = configInfo.lastModified().toMSecsSinceEpoch();
+        auto cached = index.find(id);
+        if(cached != index.end() && cached->configSize == size && cached->configModified == modified)
+        {
+            return *cached;
+        }
+        // same defaults as the instance settings
+        INIFile config;
+        config.loadFile(configInfo.filePath());
+        header.id = id;
+        header.name = config.get("name", "Unnamed Instance").toString();
+        header.iconKey = config.get("iconKey", "default").toString();
+        header.type = config.get("InstanceType", "Legacy").toString();
+        header.lastLaunch = config.get("lastLaunchTime", 0).toLongLong();
+        header.totalTimePlayed = config.get("totalTimePlayed", 0).toLongLong();
+        header.configSize = size;
+        header.configModified = modified;
+        return header;
+    }
+};
+}
+
+QList<InstanceHeader> InstanceList::discoverInstances()
+{
+    qDebug() << "Discovering instances in" << m_instDir;
+    if(!m_indexLoaded)
+    {
+        loadIndex();
+    }
+    QStringList subDirs;
+    QDirIterator iter(m_instDir, QDir::Dirs | QDir::NoDot | QDir::NoDotDot | QDir::Readable | QDir::Hidden, QDirIterator::FollowSymlinks);
+    while (iter.hasNext())
+    {
+        subDirs.append(iter.next());
+    }
+
+    // every folder needs at least a stat, which is slow on network storage, so they are all looked at in parallel
+    HeaderProbe probe;
+    probe.instDir = m_instDir;
+    probe.index = m_index;
+    auto headers = QtConcurrent::blockingMapped<QList<InstanceHeader>>(subDirs, probe);
+
+    QList<InstanceHeader> out;
+    for(auto & header: headers)
+    {
+        if(header.id.isEmpty())
+            continue;
+        out.append(header);
+        qDebug() << "Found instance ID" << header.id;
+    }
+    instanceSet.clear();
+    for(auto & header: out)
+    {
+        instanceSet.insert(header.id);
     }
-    instanceSet = out.toSet();
     m_instancesProbed = true;
     return out;
 }
 
 InstanceList::InstListError InstanceList::loadList()
 {
-    auto existingIds = getIdMapping(m_instances);
-
-    QList<InstancePtr> newList;
+    if(!m_groupsLoaded)
+    {
+        loadGroupList();
+    }
 
-    for(auto & id: discoverInstances())
+    QMap<InstanceId, int> existingIds;
+    for(int i = 0; i < m_instances.size(); i++)
     {
+        auto & id = m_instances[i].header.id;
         if(existingIds.contains(id))
         {
-            auto instPair = existingIds[id];
-            existingIds.remove(id);
-            qDebug() << "Should keep and soft-reload" << id;
+            qWarning() << "Duplicate ID" << id << "in instance list";
         }
-        else
+        existingIds[id] = i;
+    }
+
+    QList<InstanceHeader> newList;
+
+    auto headers = discoverInstances();
+    // remember what was read for next time, if anything changed
+    bool indexChanged = headers.size() != m_index.size();
+    for(auto & header: headers)
+    {
+        auto cached = m_index.find(header.id);
+        if(cached == m_index.end() || cached->configSize != header.configSize || cached->configModified != header.configModified)
         {
-            InstancePtr instPtr = loadInstance(id);
-            if(instPtr)
+            m_index[header.id] = header;
+            indexChanged = true;
+        }
+
+        if(existingIds.contains(header.id))
+        {
+            int row = existingIds.take(header.id);
+            auto & entry = m_instances[row];
+            // loaded instances keep their own state, the rest shows what's in the file now
+            if(!entry.instance && entry.header.configModified != header.configModified)
             {
-                newList.append(instPtr);
+                entry.header = header;
+                emit dataChanged(index(row), index(row));
             }
+            qDebug() << "Should keep and soft-reload" << header.id;
+        }
+        else
+        {
+            newList.append(header);
         }
     }
+    if(indexChanged)
+    {
+        QMap<InstanceId, InstanceHeader> index;
+        for(auto & header: headers)
+        {
+            index[header.id] = m_index[header.id];
+        }
+        m_index = index;
+        saveIndex();
+    }
 
     // TODO: looks like a general algorithm with a few specifics inserted. Do something about it.
     if(!existingIds.isEmpty())
     {
         // get the list of removed instances and sort it by their original index, from last to first
         auto deadList = existingIds.values();
-        auto orderSortPredicate = [](const InstanceLocator & a, const InstanceLocator & b) -> bool
-        {
-            return a.second > b.second;
-        };
-        std::sort(deadList.begin(), deadList.end(), orderSortPredicate);
+        std::sort(deadList.begin(), deadList.end(), std::greater<int>());
         // remove the contiguous ranges of rows
         int front_bookmark = -1;
         int back_bookmark = -1;
@@ -403,9 +482,12 @@ InstanceList::InstListError InstanceList::loadList()
         };
         for(auto & removedItem: deadList)
         {
-            auto instPtr = removedItem.first;
-            instPtr->invalidate();
-            currentItem = removedItem.second;
+            auto instPtr = m_instances[removedItem].instance;
+            if(instPtr)
+            {
+                instPtr->invalidate();
+            }
+            currentItem = removedItem;
             if(back_bookmark == -1)
             {
                 // no bookmark yet
@@ -441,7 +523,7 @@ void InstanceList::updateTotalPlayTime()
     totalPlayTime = 0;
     for(auto const& itr : m_instances)
     {
-        totalPlayTime += itr.get()->totalTimePlayed();
+        totalPlayTime += itr.instance ? itr.instance->totalTimePlayed() : itr.header.totalTimePlayed;
     }
 }
 
@@ -449,21 +531,40 @@ void InstanceList::saveNow()
 {
     for(auto & item: m_instances)
     {
-        item->saveNow();
+        // nothing to save in the ones that were never loaded
+        if(item.instance)
+        {
+            item.instance->saveNow();
+        }
     }
 }
 
-void InstanceList::add(const QList<InstancePtr> &t)
+void InstanceList::add(const QList<InstanceHeader> &t)
 {
     beginInsertRows(QModelIndex(), m_instances.count(), m_instances.count() + t.size() - 1);
-    m_instances.append(t);
-    for(auto & ptr : t)
+    for(auto & header : t)
     {
-        connect(ptr.get(), &BaseInstance::propertiesChanged, this, &InstanceList::propertiesChanged);
+        m_instances.append(Entry{header, nullptr});
     }
     endInsertRows();
 }
 
+InstancePtr InstanceList::at(int i)
+{
+    auto & entry = m_instances[i];
+    if(!entry.instance)
+    {
+        entry.instance = loadInstance(entry.header.id);
+        connect(entry.instance.get(), &BaseInstance::propertiesChanged, this, &InstanceList::propertiesChanged);
+    }
+    return entry.instance;
+}
+
+QString InstanceList::instanceRoot(int i) const
+{
+    return FS::PathCombine(m_instDir, m_instances.at(i).header.id);
+}
+
 void InstanceList::resumeWatch()
 {
     if(m_watchLevel > 0)
@@ -492,23 +593,17 @@ void InstanceList::providerUpdated()
     }
 }
 
-InstancePtr InstanceList::getInstanceById(QString instId) const
+InstancePtr InstanceList::getInstanceById(QString instId)
 {
-    if(instId.isEmpty())
+    int i = getInstIndex(instId);
+    if(i == -1)
         return InstancePtr();
-    for(auto & inst: m_instances)
-    {
-        if (inst->id() == instId)
-        {
-            return inst;
-        }
-    }
-    return InstancePtr();
+    return at(i);
 }
 
 QModelIndex InstanceList::getInstanceIndexById(const QString &id) const
 {
-    return index(getInstIndex(getInstanceById(id).get()));
+    return index(getInstIndex(id));
 }
 
 int InstanceList::getInstIndex(BaseInstance *inst) const
@@ -516,7 +611,22 @@ int InstanceList::getInstIndex(BaseInstance *inst) const
     int count = m_instances.count();
     for (int i = 0; i < count; i++)
     {
-        if (inst == m_instances[i].get())
+        if (inst == m_instances[i].instance.get())
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int InstanceList::getInstIndex(const InstanceId & id) const
+{
+    if(id.isEmpty())
+        return -1;
+    int count = m_instances.count();
+    for (int i = 0; i < count; i++)
+    {
+        if (id == m_instances[i].header.id)
         {
             return i;
         }
@@ -529,6 +639,12 @@ void InstanceList::propertiesChanged(BaseInstance *inst)
     int i = getInstIndex(inst);
     if (i != -1)
     {
+        // the header is what gets shown
+        auto & header = m_instances[i].header;
+        header.name = inst->name();
+        header.iconKey = inst->iconKey();
+        header.lastLaunch = inst->lastLaunch();
+        header.totalTimePlayed = inst->totalTimePlayed();
         emit dataChanged(index(i), index(i));
         updateTotalPlayTime();
     }
@@ -536,16 +652,21 @@ void InstanceList::propertiesChanged(BaseInstance *inst)
 
 InstancePtr InstanceList::loadInstance(const InstanceId& id)
 {
-    if(!m_groupsLoaded)
-    {
-        loadGroupList();
-    }
-
     auto instanceRoot = FS::PathCombine(m_instDir, id);
     auto instanceSettings = std::make_shared<INISettingsObject>(FS::PathCombine(instanceRoot, "instance.cfg"));
     InstancePtr inst;
 
     instanceSettings->registerSetting("InstanceType", "Legacy");
+    auto sync = m_globalSettings ? m_globalSettings->getSetting("SyncSettingsToDisk") : nullptr;
+    if(sync)
+    {
+        instanceSettings->setSyncOnSave(sync->get().toBool());
+        auto settingsPtr = instanceSettings.get();
+        connect(sync.get(), &Setting::SettingChanged, settingsPtr, [settingsPtr](const Setting &, QVariant value)
+        {
+            settingsPtr->setSyncOnSave(value.toBool());
+        });
+    }
 
     QString inst_type = instanceSettings->get("InstanceType").toString();
 
@@ -565,6 +686,93 @@ InstancePtr InstanceList::loadInstance(const InstanceId& id)
     return inst;
 }
 
+void InstanceList::setIndexFile(const QString& path)
+{
+    m_indexFile = path;
+    m_indexLoaded = false;
+}
+
+void InstanceList::loadIndex()
+{
+    m_indexLoaded = true;
+    m_index.clear();
+    if (m_indexFile.isEmpty() || !QFileInfo(m_indexFile).exists())
+        return;
+
+    QByteArray jsonData;
+    try
+    {
+        jsonData = FS::read(m_indexFile);
+    }
+    catch (const FS::FileSystemException &e)
+    {
+        qWarning() << "Failed to read instance index file :" << e.cause();
+        return;
+    }
+
+    QJsonParseError error;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &error);
+    if (error.error != QJsonParseError::NoError || !jsonDoc.isObject())
+    {
+        qWarning() << "Instance index file is broken, all instances will be read again.";
+        return;
+    }
+    QJsonObject rootObj = jsonDoc.object();
+    // it's only good for the folder it was made for
+    if (rootObj.value("formatVersion").toInt() != INDEX_FILE_FORMAT_VERSION || rootObj.value("instDir").toString() != m_instDir)
+        return;
+
+    QJsonObject instances = rootObj.value("instances").toObject();
+    for (auto iter = instances.begin(); iter != instances.end(); iter++)
+    {
+        QJsonObject obj = iter.value().toObject();
+        InstanceHeader header;
+        header.id = iter.key();
+        header.name = obj.value("name").toString();
+        header.iconKey = obj.value("iconKey").toString();
+        header.type = obj.value("type").toString();
+        header.lastLaunch = obj.value("lastLaunch").toVariant().toLongLong();
+        header.totalTimePlayed = obj.value("totalTimePlayed").toVariant().toLongLong();
+        header.configSize = obj.value("configSize").toVariant().toLongLong();
+        header.configModified = obj.value("configModified").toVariant().toLongLong();
+        m_index[header.id] = header;
+    }
+}
+
+void InstanceList::saveIndex()
+{
+    if(m_indexFile.isEmpty())
+    {
+        return;
+    }
+    QJsonObject instances;
+    for (auto & header: m_index)
+    {
+        QJsonObject obj;
+        obj.insert("name", header.name);
+        obj.insert("iconKey", header.iconKey);
+        obj.insert("type", header.type);
+        // as strings, so 64 bit values survive
+        obj.insert("lastLaunch", QString::number(header.lastLaunch));
+        obj.insert("totalTimePlayed", QString::number(header.totalTimePlayed));
+        obj.insert("configSize", QString::number(header.configSize));
+        obj.insert("configModified", QString::number(header.configModified));
+        instances.insert(header.id, obj);
+    }
+    QJsonObject toplevel;
+    toplevel.insert("formatVersion", INDEX_FILE_FORMAT_VERSION);
+    toplevel.insert("instDir", m_instDir);
+    toplevel.insert("instances", instances);
+    try
+    {
+        FS::write(m_indexFile, QJsonDocument(toplevel).toJson(QJsonDocument::Compact));
+    }
+    catch (const FS::FileSystemException &e)
+    {
+        qWarning() << "Failed to write instance index file :" << e.cause();
+    }
+}
+
 void InstanceList::saveGroupList()
 {
     qDebug() << "Will save group list now.";
@@ -744,6 +952,7 @@ void InstanceList::on_InstFolderChanged(const Setting &setting, QVariant value)
         }
         m_instDir = newInstDir;
         m_groupsLoaded = false;
+        m_indexLoaded = false;
         emit instancesChanged();
     }
 }
@@ -39,6 +39,23 @@ enum class InstCreateError
     CantCreateDir
 };
 
+/**
+ * What the instance list shows about an instance, without loading it.
+ * Read straight from instance.cfg and kept in an index file, so starting up doesn't need to read every instance.
+ */
+struct InstanceHeader
+{
+    QString id;
+    QString name;
+    QString iconKey;
+    QString type;
+    qint64 lastLaunch = 0;
+    qint64 totalTimePlayed = 0;
+    /// what instance.cfg looked like when this was read
+    qint64 configSize = -1;
+    qint64 configModified = 0;
+};
+
 enum class GroupsState
 {
     NotLoaded,
@@ -67,7 +84,8 @@ public:
     {
         GroupRole = Qt::UserRole,
         InstancePointerRole = 0x34B1CB48, ///< Return pointer to real instance
-        InstanceIDRole = 0x34B1CB49 ///< Return id if the instance
+        InstanceIDRole = 0x34B1CB49, ///< Return id if the instance
+        LastLaunchRole = 0x34B1CB4A ///< Return the time of the last launch, for sorting
     };
     /*!
      * \brief Error codes returned by functions in the InstanceList class.
@@ -80,9 +98,11 @@ public:
         UnknownError
     };
 
-    InstancePtr at(int i) const
+    /// Instances are only loaded when they are first asked for
+    InstancePtr at(int i);
+    bool isLoaded(int i) const
     {
-        return m_instances.at(i);
+        return m_instances.at(i).instance != nullptr;
     }
 
     int count() const
@@ -90,10 +110,16 @@ public:
         return m_instances.count();
     }
 
+    /// The folder of an instance. Doesn't load it.
+    QString instanceRoot(int i) const;
+
+    /// Where to keep instance headers between runs. Without it, every instance.cfg is read on startup.
+    void setIndexFile(const QString & path);
+
     InstListError loadList();
     void saveNow();
 
-    InstancePtr getInstanceById(QString id) const;
+    InstancePtr getInstanceById(QString id);
     QModelIndex getInstanceIndexById(const QString &id) const;
     QStringList getGroups();
     bool isGroupCollapsed(const QString &groupName);
@@ -158,17 +184,26 @@ private:
     void updateTotalPlayTime();
     void suspendWatch();
     void resumeWatch();
-    void add(const QList<InstancePtr> &list);
+    int getInstIndex(const InstanceId & id) const;
+    void add(const QList<InstanceHeader> &list);
     void loadGroupList();
     void saveGroupList();
-    QList<InstanceId> discoverInstances();
+    void loadIndex();
+    void saveIndex();
+    QList<InstanceHeader> discoverInstances();
     InstancePtr loadInstance(const InstanceId& id);
 
 private:
+    struct Entry
+    {
+        InstanceHeader header;
+        InstancePtr instance;
+    };
+
     int m_watchLevel = 0;
     int totalPlayTime = 0;
     bool m_dirty = false;
-    QList<InstancePtr> m_instances;
+    QList<Entry> m_instances;
     QSet<QString> m_groupNameCache;
 
     SettingsObjectPtr m_globalSettings;
@@ -180,4 +215,8 @@ private:
     QSet<InstanceId> instanceSet;
     bool m_groupsLoaded = false;
     bool m_instancesProbed = false;
+
+    QString m_indexFile;
+    QMap<InstanceId, InstanceHeader> m_index;
+    bool m_indexLoaded = false;
 };
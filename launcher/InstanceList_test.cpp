@@ -0,0 +1,151 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "InstanceList.h"
+#include "FileSystem.h"
+#include "settings/INISettingsObject.h"
+
+class InstanceListTest : public QObject
+{
+    Q_OBJECT
+
+    // what every instance expects to find in the global settings
+    SettingsObjectPtr makeGlobalSettings(const QString & path)
+    {
+        auto settings = std::make_shared<INISettingsObject>(path);
+        for(auto id: {"PreLaunchCommand", "WrapperCommand", "PostExitCommand", "ShowConsole", "AutoCloseConsole",
+                      "ShowConsoleOnError", "LogPrePostOutput", "ConsoleMaxLines", "ConsoleOverflowStop"})
+        {
+            settings->registerSetting(id, QVariant());
+        }
+        return settings;
+    }
+
+    void writeInstance(const QString & instDir, int i, const QString & name)
+    {
+        QString config = QString("InstanceType=Test\nname=%1\niconKey=icon%2\nlastLaunchTime=%2\ntotalTimePlayed=10\n").arg(name).arg(i);
+        FS::write(FS::PathCombine(instDir, QString("inst%1").arg(i), "instance.cfg"), config.toUtf8());
+    }
+
+    void makeInstances(const QString & instDir, int count)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            writeInstance(instDir, i, QString("Instance %1").arg(i));
+        }
+    }
+
+    QString nameOf(InstanceList & list, const QString & id)
+    {
+        return list.getInstanceIndexById(id).data(Qt::DisplayRole).toString();
+    }
+
+private
+slots:
+    void test_lazy()
+    {
+        QTemporaryDir dir;
+        QString instDir = FS::PathCombine(dir.path(), "instances");
+        makeInstances(instDir, 20);
+        InstanceList list(makeGlobalSettings(FS::PathCombine(dir.path(), "global.cfg")), instDir);
+        QCOMPARE(list.loadList(), InstanceList::NoError);
+        QCOMPARE(list.count(), 20);
+        QCOMPARE(nameOf(list, "inst7"), QString("Instance 7"));
+        QCOMPARE(list.getInstanceIndexById("inst7").data(Qt::DecorationRole).toString(), QString("icon7"));
+        QCOMPARE(list.getInstanceIndexById("inst7").data(InstanceList::LastLaunchRole).toLongLong(), qint64(7));
+        QCOMPARE(list.getTotalPlayTime(), 200);
+        for(int i = 0; i < list.count(); i++)
+        {
+            QVERIFY(!list.isLoaded(i));
+        }
+
+        // asking for the instance loads it
+        auto inst = list.getInstanceById("inst7");
+        QVERIFY(inst);
+        QCOMPARE(inst->name(), QString("Instance 7"));
+        QVERIFY(list.isLoaded(list.getInstanceIndexById("inst7").row()));
+        QVERIFY(list.getInstanceIndexById("inst7").data(InstanceList::InstancePointerRole).value<void *>() == inst.get());
+        QVERIFY(!list.getInstanceById("missing"));
+
+        // and changes to it show
+        inst->setName("Renamed");
+        QCOMPARE(nameOf(list, "inst7"), QString("Renamed"));
+    }
+
+    void test_index()
+    {
+        QTemporaryDir dir;
+        QString instDir = FS::PathCombine(dir.path(), "instances");
+        QString indexFile = FS::PathCombine(dir.path(), "cache", "instances.json");
+        auto globalSettings = makeGlobalSettings(FS::PathCombine(dir.path(), "global.cfg"));
+        makeInstances(instDir, 5);
+        {
+            InstanceList list(globalSettings, instDir);
+            list.setIndexFile(indexFile);
+            list.loadList();
+        }
+        QVERIFY(QFileInfo(indexFile).exists());
+
+        // entries matching the files on disk are used as they are
+        auto index = FS::read(indexFile);
+        index.replace("Instance 3", "From the index");
+        FS::write(indexFile, index);
+        // and the rest is read again
+        writeInstance(instDir, 4, "Changed on disk with a longer name");
+        writeInstance(instDir, 5, "Added");
+        QVERIFY(FS::deletePath(FS::PathCombine(instDir, "inst0")));
+        {
+            InstanceList list(globalSettings, instDir);
+            list.setIndexFile(indexFile);
+            list.loadList();
+            QCOMPARE(list.count(), 5);
+            QCOMPARE(nameOf(list, "inst3"), QString("From the index"));
+            QCOMPARE(nameOf(list, "inst4"), QString("Changed on disk with a longer name"));
+            QCOMPARE(nameOf(list, "inst5"), QString("Added"));
+            QVERIFY(!list.getInstanceIndexById("inst0").isValid());
+        }
+        // the index is kept up to date
+        index = FS::read(indexFile);
+        QVERIFY(index.contains("Added"));
+        QVERIFY(!index.contains("inst0"));
+    }
+
+    void benchmark_loadList_data()
+    {
+        QTest::addColumn<bool>("warm");
+        QTest::newRow("cold") << false;
+        QTest::newRow("warm") << true;
+    }
+
+    // a thousand instances, without and with the index from a previous start
+    void benchmark_loadList()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, warm);
+        QTemporaryDir dir;
+        QString instDir = FS::PathCombine(dir.path(), "instances");
+        QString indexFile = FS::PathCombine(dir.path(), "cache", "instances.json");
+        auto globalSettings = makeGlobalSettings(FS::PathCombine(dir.path(), "global.cfg"));
+        const int count = 1000;
+        makeInstances(instDir, count);
+        if(warm)
+        {
+            InstanceList list(globalSettings, instDir);
+            list.setIndexFile(indexFile);
+            list.loadList();
+        }
+        QBENCHMARK_ONCE
+        {
+            InstanceList list(globalSettings, instDir);
+            list.setIndexFile(indexFile);
+            list.loadList();
+            QCOMPARE(list.count(), count);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(InstanceListTest)
+
+#include "InstanceList_test.moc"
@@ -48,6 +48,9 @@
 #include "icons/IconList.h"
 #include "net/HttpMetaCache.h"
 #include "Env.h"
+#include "ContentStore.h"
+#include "minecraft/AssetMaintenance.h"
+#include "launch/LogStore.h"
 
 #include "java/JavaUtils.h"
 
@@ -250,6 +253,9 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
         parser.addShortOpt("import", 'I');
         parser.addDocumentation("import", "Import instance from specified zip (local path or URL)");
 
+        parser.addSwitch("gc-store");
+        parser.addDocumentation("gc-store", "Remove the files in the content store that no instance uses anymore, then exit");
+
         // parse the arguments
         try
         {
@@ -287,6 +293,7 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
     m_profileToUse = args["profile"].toString();
     m_liveCheck = args["alive"].toBool();
     m_zipToImport = args["import"].toUrl();
+    m_collectStoreGarbage = args["gc-store"].toBool();
 
     QString origcwdPath = QDir::currentPath();
     QString binPath = applicationDirPath();
@@ -391,6 +398,7 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
                     "meta",
                     "metacache",
                     "mods",
+                    "store",
                     BuildConfig.LAUNCHER_CONFIGFILE,
                     "themes",
                     "translations"
@@ -421,6 +429,17 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
     }
 #endif
 
+    // clean up the content store and exit
+    if(m_collectStoreGarbage)
+    {
+        ContentStore store(QDir("store").absolutePath());
+        auto stats = store.collectGarbage();
+        std::cout << "Removed " << stats.removed << " unused files (" << stats.freedBytes << " bytes), "
+                  << stats.kept << " files are still in use" << std::endl;
+        m_status = Launcher::Succeeded;
+        return;
+    }
+
     /*
      * Establish the mechanism for communication with an already running MultiMC that uses the same data path.
      * If there is one, tell it what the user actually wanted to do and exit.
@@ -620,6 +639,22 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
         m_settings->registerSetting({"CentralModsDir", "ModsDir"}, "mods");
         m_settings->registerSetting("IconsDir", "icons");
 
+        // Whether settings files are synced to the disk on every save, for this file and the instances
+        m_settings->registerSetting("SyncSettingsToDisk", true);
+        auto iniSettings = static_cast<INISettingsObject *>(m_settings.get());
+        iniSettings->setSyncOnSave(m_settings->get("SyncSettingsToDisk").toBool());
+        auto syncSetting = m_settings->getSetting("SyncSettingsToDisk");
+        connect(syncSetting.get(), &Setting::SettingChanged, iniSettings, [iniSettings](const Setting &, QVariant value)
+        {
+            iniSettings->setSyncOnSave(value.toBool());
+        });
+
+        // How instances refer to files in the content store: Auto, Hardlink, Symlink or Copy
+        m_settings->registerSetting("ContentStoreLinkMode", QString("Auto"));
+
+        // Verify and pre-fetch game assets in the background while idle
+        m_settings->registerSetting("AssetMaintenance", false);
+
         // Editors
         m_settings->registerSetting("JsonEditor", QString());
 
@@ -804,6 +839,8 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
         }
         m_instances.reset(new InstanceList(m_settings, instDir, this));
         connect(InstDirSetting.get(), &Setting::SettingChanged, m_instances.get(), &InstanceList::on_InstFolderChanged);
+        // what the instance list shows, so every instance doesn't have to be read on startup
+        m_instances->setIndexFile(QDir("cache/instances.json").absolutePath());
         qDebug() << "Loading Instances...";
         m_instances->loadList();
         qDebug() << "<> Instances loaded.";
@@ -824,6 +861,40 @@ Launcher::Launcher(int &argc, char **argv) : QApplication(argc, argv)
         qDebug() << "<> Cache initialized.";
     }
 
+    // init the content store
+    {
+        ENV.initContentStore(QDir("store").absolutePath());
+        auto linkMode = ContentStore::linkModeFromString(settings()->get("ContentStoreLinkMode").toString());
+        ENV.contentStore()->setLinkMode(linkMode);
+        qDebug() << "<> Content store initialized, linking with" << ContentStore::linkModeToString(linkMode);
+    }
+
+    // init the mod details cache
+    {
+        ENV.initModDetailsCache(QDir("cache/moddetails.dat").absolutePath());
+        qDebug() << "<> Mod details cache initialized.";
+    }
+
+    // game logs are only kept while their launch is around, these were left behind by a crash
+    {
+        LogStore::removeStale(QDir("cache/gamelogs").absolutePath());
+    }
+
+    // background asset verification, if wanted
+    {
+        m_assetMaintenance.reset(new AssetMaintenance(m_instances));
+        auto setting = m_settings->getSetting("AssetMaintenance");
+        connect(setting.get(), &Setting::SettingChanged, [&](const Setting &, QVariant value)
+        {
+            m_assetMaintenance->setEnabled(value.toBool());
+        });
+        connect(this, &Launcher::updateAllowedChanged, [&](bool idle)
+        {
+            m_assetMaintenance->setBusy(!idle);
+        });
+        m_assetMaintenance->setEnabled(setting->get().toBool());
+    }
+
     // init proxy settings
     {
         QString proxyTypeStr = settings()->get("ProxyType").toString();
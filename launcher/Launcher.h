@@ -35,6 +35,7 @@ class TranslationsModel;
 class ITheme;
 class MCEditTool;
 class GAnalytics;
+class AssetMaintenance;
 
 #if defined(LAUNCHER)
 #undef LAUNCHER
@@ -96,6 +97,11 @@ public:
         return m_instances;
     }
 
+    std::shared_ptr<AssetMaintenance> assetMaintenance() const
+    {
+        return m_assetMaintenance;
+    }
+
     FolderInstanceProvider * folderProvider() const
     {
         return m_instanceFolder;
@@ -189,6 +195,7 @@ private:
     FolderInstanceProvider * m_instanceFolder = nullptr;
     std::shared_ptr<IconList> m_icons;
     std::shared_ptr<UpdateChecker> m_updateChecker;
+    std::shared_ptr<AssetMaintenance> m_assetMaintenance;
     std::shared_ptr<AccountList> m_accounts;
     std::shared_ptr<JavaInstallList> m_javalist;
     std::shared_ptr<TranslationsModel> m_translations;
@@ -233,5 +240,6 @@ public:
     QString m_profileToUse;
     bool m_liveCheck = false;
     QUrl m_zipToImport;
+    bool m_collectStoreGarbage = false;
     std::unique_ptr<QFile> logFile;
 };
@@ -0,0 +1,606 @@
+#include "LogFileModel.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QByteArrayMatcher>
+#include <QtConcurrent>
+#include <QDebug>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+
+#include "MMCStrings.h"
+
+namespace {
+const int linesPerBlock = 64;
+// blocks of lines kept decoded
+const int blockCacheSize = 256;
+// uncompressed bytes between saved decompressor states
+const qint64 accessSpan = 2 * 1024 * 1024;
+// what deflate can refer back to, saved with every decompressor state
+const int windowSize = 32768;
+// inflated spans kept around, in KiB
+const int spanCacheSize = 16 * 1024;
+// compressed or plain bytes handled at once while indexing
+const qint64 indexPiece = 1024 * 1024;
+// most bytes read at once. QByteArray and QString sizes are ints.
+const qint64 maxReadLength = 1024 * 1024 * 1024;
+}
+
+struct LogFileModel::Source
+{
+    struct AccessPoint
+    {
+        /// where in the compressed file inflating can start again
+        qint64 in = 0;
+        /// and what uncompressed offset that is
+        qint64 out = 0;
+        /// bits of the byte before `in` that still belong to the data
+        int bits = 0;
+        /// the last 32 KiB of output before this point
+        QByteArray window;
+    };
+
+    ~Source()
+    {
+        if(data)
+        {
+            file.unmap(data);
+        }
+    }
+
+    QByteArray read(qint64 offset, qint64 length);
+    QByteArray inflateSpan(const AccessPoint & point, qint64 end) const;
+
+    QFile file;
+    uchar * data = nullptr;
+    qint64 size = 0;
+    bool gzip = false;
+    QAtomicInt cancelled;
+
+    QMutex mutex;
+    QVector<AccessPoint> points;
+    QCache<int, QByteArray> spans{spanCacheSize};
+};
+
+QByteArray LogFileModel::Source::inflateSpan(const AccessPoint & point, qint64 end) const
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if(inflateInit2(&strm, -MAX_WBITS) != Z_OK)
+    {
+        return QByteArray();
+    }
+    qint64 inPos = point.in;
+    if(point.bits)
+    {
+        int byte = data[inPos - 1];
+        inflatePrime(&strm, point.bits, byte >> (8 - point.bits));
+    }
+    inflateSetDictionary(&strm, reinterpret_cast<const Bytef *>(point.window.constData()), windowSize);
+
+    QByteArray out;
+    out.resize(int(std::min(end - point.out, maxReadLength)));
+    strm.next_out = reinterpret_cast<Bytef *>(out.data());
+    strm.avail_out = out.size();
+    while(strm.avail_out > 0)
+    {
+        if(strm.avail_in == 0)
+        {
+            if(inPos >= size)
+            {
+                break;
+            }
+            auto piece = std::min(size - inPos, indexPiece);
+            strm.next_in = data + inPos;
+            strm.avail_in = uInt(piece);
+            inPos += piece;
+        }
+        if(inflate(&strm, Z_NO_FLUSH) != Z_OK)
+        {
+            break;
+        }
+    }
+    out.resize(out.size() - int(strm.avail_out));
+    inflateEnd(&strm);
+    return out;
+}
+
+QByteArray LogFileModel::Source::read(qint64 offset, qint64 length)
+{
+    length = std::min(length, maxReadLength);
+    if(!gzip)
+    {
+        length = std::max<qint64>(0, std::min(length, size - offset));
+        return QByteArray(reinterpret_cast<const char *>(data + offset), int(length));
+    }
+    QByteArray out;
+    while(length > 0)
+    {
+        AccessPoint point;
+        qint64 spanEnd = offset + length;
+        bool last;
+        int index;
+        QByteArray span;
+        {
+            QMutexLocker locker(&mutex);
+            auto found = std::upper_bound(points.begin(), points.end(), offset, [](qint64 value, const AccessPoint & p) -> bool
+            {
+                return value < p.out;
+            });
+            if(found == points.begin())
+            {
+                break;
+            }
+            index = int(found - points.begin()) - 1;
+            last = found == points.end();
+            if(!last)
+            {
+                spanEnd = found->out;
+            }
+            auto cached = spans.object(index);
+            if(cached)
+            {
+                span = *cached;
+            }
+            point = points[index];
+        }
+        // the last span is still growing while the file is indexed, it may need inflating again
+        if(span.isNull() || point.out + span.size() < std::min(spanEnd, offset + length))
+        {
+            span = inflateSpan(point, spanEnd);
+            QMutexLocker locker(&mutex);
+            spans.insert(index, new QByteArray(span), span.size() / 1024 + 1);
+        }
+        qint64 from = offset - point.out;
+        qint64 count = std::min<qint64>(span.size() - from, length);
+        if(count <= 0)
+        {
+            break;
+        }
+        out.append(span.constData() + from, int(count));
+        offset += count;
+        length -= count;
+    }
+    return out;
+}
+
+namespace {
+// collects line starts from the bytes of a file, in order, and hands them to the model now and then
+class LineIndexer
+{
+public:
+    LineIndexer(LogFileModel * model, int generation) : m_model(model), m_generation(generation)
+    {
+        m_timer.start();
+    }
+
+    void feed(const char * bytes, qint64 length, qint64 offset)
+    {
+        const char * end = bytes + length;
+        const char * pos = bytes;
+        while(pos < end)
+        {
+            auto newline = static_cast<const char *>(memchr(pos, '\n', end - pos));
+            if(!newline)
+            {
+                break;
+            }
+            m_lines++;
+            m_lineStart = offset + (newline - bytes) + 1;
+            if(m_lines % linesPerBlock == 0)
+            {
+                m_checkpoints.append(m_lineStart);
+            }
+            pos = newline + 1;
+        }
+        // the first screen full goes out right away
+        int batch = m_posted ? 100000 : 1000;
+        if(m_lines - m_posted >= batch || m_timer.elapsed() > 100)
+        {
+            post(m_lineStart, false);
+        }
+    }
+
+    void finish(qint64 size)
+    {
+        if(size > m_lineStart)
+        {
+            // the last line doesn't end with a line break
+            m_lines++;
+        }
+        post(size, true);
+    }
+
+private:
+    void post(qint64 end, bool finished)
+    {
+        QMetaObject::invokeMethod(m_model, "linesIndexed", Qt::QueuedConnection, Q_ARG(int, m_generation),
+                                  Q_ARG(QVector<qint64>, m_checkpoints), Q_ARG(int, m_lines), Q_ARG(qint64, end),
+                                  Q_ARG(bool, finished));
+        m_checkpoints.clear();
+        m_posted = m_lines;
+        m_timer.restart();
+    }
+
+    LogFileModel * m_model;
+    int m_generation;
+    QVector<qint64> m_checkpoints;
+    int m_lines = 0;
+    int m_posted = 0;
+    qint64 m_lineStart = 0;
+    QElapsedTimer m_timer;
+};
+
+void indexPlain(LogFileModel::Source & source, LineIndexer & indexer)
+{
+    for(qint64 offset = 0; offset < source.size; offset += indexPiece)
+    {
+        if(source.cancelled.loadAcquire())
+        {
+            return;
+        }
+        auto length = std::min(indexPiece, source.size - offset);
+        indexer.feed(reinterpret_cast<const char *>(source.data + offset), length, offset);
+    }
+    indexer.finish(source.size);
+}
+
+// inflate the whole file once, saving the decompressor state at deflate block boundaries every few megabytes
+void indexGzip(LogFileModel::Source & source, LineIndexer & indexer)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    // accepts the gzip header
+    if(inflateInit2(&strm, 32 + MAX_WBITS) != Z_OK)
+    {
+        indexer.finish(0);
+        return;
+    }
+    QByteArray window(windowSize, 0);
+    qint64 inPos = 0;
+    qint64 totalIn = 0;
+    qint64 totalOut = 0;
+    qint64 lastPoint = 0;
+    while(!source.cancelled.loadAcquire())
+    {
+        if(strm.avail_in == 0)
+        {
+            if(inPos >= source.size)
+            {
+                qWarning() << source.file.fileName() << "ends before its compressed data does";
+                break;
+            }
+            auto piece = std::min(source.size - inPos, indexPiece);
+            strm.next_in = source.data + inPos;
+            strm.avail_in = uInt(piece);
+            inPos += piece;
+        }
+        if(strm.avail_out == 0)
+        {
+            strm.next_out = reinterpret_cast<Bytef *>(window.data());
+            strm.avail_out = windowSize;
+        }
+        auto written = windowSize - strm.avail_out;
+        auto availIn = strm.avail_in;
+        auto availOut = strm.avail_out;
+        int ret = inflate(&strm, Z_BLOCK);
+        totalIn += availIn - strm.avail_in;
+        qint64 produced = availOut - strm.avail_out;
+        indexer.feed(window.constData() + written, produced, totalOut);
+        totalOut += produced;
+        if(ret == Z_STREAM_END)
+        {
+            // only the first member of multi-member files is read, logs don't come like that
+            break;
+        }
+        if(ret != Z_OK)
+        {
+            qWarning() << source.file.fileName() << "is not readable past" << totalOut << "bytes:" << strm.msg;
+            break;
+        }
+        bool blockBoundary = (strm.data_type & 128) && !(strm.data_type & 64);
+        if(blockBoundary && (totalOut == 0 || totalOut - lastPoint > accessSpan))
+        {
+            LogFileModel::Source::AccessPoint point;
+            point.in = totalIn;
+            point.out = totalOut;
+            point.bits = strm.data_type & 7;
+            // the window is circular, the oldest byte is where the next one will be written
+            int left = strm.avail_out;
+            point.window.resize(windowSize);
+            memcpy(point.window.data(), window.constData() + windowSize - left, left);
+            memcpy(point.window.data() + left, window.constData(), windowSize - left);
+            QMutexLocker locker(&source.mutex);
+            source.points.append(point);
+            lastPoint = totalOut;
+        }
+    }
+    inflateEnd(&strm);
+    if(!source.cancelled.loadAcquire())
+    {
+        indexer.finish(totalOut);
+    }
+}
+
+void indexLines(std::shared_ptr<LogFileModel::Source> source, LogFileModel * model, int generation)
+{
+    LineIndexer indexer(model, generation);
+    if(source->gzip)
+    {
+        indexGzip(*source, indexer);
+    }
+    else
+    {
+        indexPlain(*source, indexer);
+    }
+}
+
+QByteArray blockBytes(LogFileModel::Source & source, const QVector<qint64> & checkpoints, qint64 end, int block)
+{
+    qint64 begin = checkpoints[block];
+    qint64 blockEnd = block + 1 < checkpoints.size() ? checkpoints[block + 1] : end;
+    return source.read(begin, blockEnd - begin);
+}
+
+// where the lines of a block are, without their line breaks
+QVector<QPair<int, int>> splitLines(const QByteArray & bytes, int count)
+{
+    QVector<QPair<int, int>> lines;
+    lines.reserve(count);
+    int start = 0;
+    while(lines.size() < count)
+    {
+        int newline = bytes.indexOf('\n', start);
+        int stop = newline < 0 ? bytes.size() : newline;
+        int length = stop - start;
+        if(length > 0 && bytes[stop - 1] == '\r')
+        {
+            length--;
+        }
+        lines.append(qMakePair(start, length));
+        if(newline < 0)
+        {
+            break;
+        }
+        start = newline + 1;
+    }
+    return lines;
+}
+
+struct Search
+{
+    std::shared_ptr<LogFileModel::Source> source;
+    QVector<qint64> checkpoints;
+    int lines = 0;
+    qint64 end = 0;
+    QString what;
+    int from = 0;
+    bool reverse = false;
+    std::shared_ptr<QAtomicInt> cancelled;
+};
+
+int findLine(const Search & search)
+{
+    if(!search.source || search.lines == 0 || search.what.isEmpty())
+    {
+        return -1;
+    }
+    // ASCII is looked for in the raw bytes, anything else needs the lines decoded
+    bool ascii = Strings::isAscii(search.what);
+    QByteArrayMatcher matcher(search.what.toLower().toLatin1());
+    int currentBlock = -1;
+    QByteArray bytes;
+    QVector<QPair<int, int>> lines;
+    int step = search.reverse ? -1 : 1;
+    for(int i = 1; i <= search.lines; i++)
+    {
+        int row = ((search.from + i * step) % search.lines + search.lines) % search.lines;
+        int block = row / linesPerBlock;
+        if(block != currentBlock)
+        {
+            if(search.cancelled->loadAcquire())
+            {
+                return -1;
+            }
+            bytes = blockBytes(*search.source, search.checkpoints, search.end, block);
+            if(ascii)
+            {
+                Strings::toLowerAscii(bytes);
+            }
+            lines = splitLines(bytes, std::min(linesPerBlock, search.lines - block * linesPerBlock));
+            currentBlock = block;
+        }
+        int line = row % linesPerBlock;
+        if(line >= lines.size())
+        {
+            continue;
+        }
+        auto text = bytes.constData() + lines[line].first;
+        int length = lines[line].second;
+        bool found = ascii ? matcher.indexIn(text, length) >= 0
+                           : QString::fromUtf8(text, length).contains(search.what, Qt::CaseInsensitive);
+        if(found)
+        {
+            return row;
+        }
+    }
+    return -1;
+}
+
+QString readText(std::shared_ptr<LogFileModel::Source> source, qint64 end)
+{
+    if(!source)
+    {
+        return QString();
+    }
+    return QString::fromUtf8(source->read(0, end));
+}
+}
+
+LogFileModel::LogFileModel(QObject *parent) : QAbstractListModel(parent), m_blocks(blockCacheSize)
+{
+    qRegisterMetaType<QVector<qint64>>("QVector<qint64>");
+}
+
+LogFileModel::~LogFileModel()
+{
+    if(m_source)
+    {
+        m_source->cancelled.storeRelease(1);
+    }
+    if(m_searchCancelled)
+    {
+        m_searchCancelled->storeRelease(1);
+    }
+    // the indexer posts to this
+    m_indexing.waitForFinished();
+}
+
+bool LogFileModel::open(const QString & path)
+{
+    close();
+    m_error.clear();
+    std::shared_ptr<Source> source(new Source);
+    source->file.setFileName(path);
+    if(!source->file.open(QIODevice::ReadOnly))
+    {
+        m_error = source->file.errorString();
+        return false;
+    }
+    source->size = source->file.size();
+    if(source->size > 0)
+    {
+        source->data = source->file.map(0, source->size);
+        if(!source->data)
+        {
+            m_error = source->file.errorString();
+            return false;
+        }
+    }
+    source->gzip = source->size >= 2 && source->data[0] == 0x1f && source->data[1] == 0x8b;
+
+    beginResetModel();
+    m_source = source;
+    m_checkpoints = {0};
+    m_finished = false;
+    endResetModel();
+    m_indexing = QtConcurrent::run(indexLines, source, this, m_generation);
+    return true;
+}
+
+void LogFileModel::close()
+{
+    if(m_source)
+    {
+        m_source->cancelled.storeRelease(1);
+    }
+    if(m_searchCancelled)
+    {
+        m_searchCancelled->storeRelease(1);
+    }
+    m_indexing.waitForFinished();
+    beginResetModel();
+    // anything still on its way from the indexer is for the old file
+    m_generation++;
+    m_source.reset();
+    m_checkpoints.clear();
+    m_lines = 0;
+    m_end = 0;
+    m_finished = true;
+    m_blocks.clear();
+    endResetModel();
+}
+
+bool LogFileModel::isIndexing() const
+{
+    return !m_finished;
+}
+
+void LogFileModel::linesIndexed(int generation, QVector<qint64> checkpoints, int lines, qint64 end, bool finished)
+{
+    if(generation != m_generation)
+    {
+        return;
+    }
+    m_checkpoints += checkpoints;
+    m_end = end;
+    // the last block can get more lines
+    m_blocks.remove(m_lines / linesPerBlock);
+    if(lines > m_lines)
+    {
+        beginInsertRows(QModelIndex(), m_lines, lines - 1);
+        m_lines = lines;
+        endInsertRows();
+    }
+    if(finished)
+    {
+        m_finished = true;
+        emit indexingFinished();
+    }
+}
+
+int LogFileModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid())
+    {
+        return 0;
+    }
+    return m_lines;
+}
+
+QVariant LogFileModel::data(const QModelIndex &index, int role) const
+{
+    if(!m_source || index.row() < 0 || index.row() >= m_lines)
+    {
+        return QVariant();
+    }
+    if(role != Qt::DisplayRole && role != Qt::EditRole)
+    {
+        return QVariant();
+    }
+    int block = index.row() / linesPerBlock;
+    auto lines = m_blocks.object(block);
+    if(!lines)
+    {
+        auto bytes = blockBytes(*m_source, m_checkpoints, m_end, block);
+        lines = new QStringList();
+        for(auto & line : splitLines(bytes, std::min(linesPerBlock, m_lines - block * linesPerBlock)))
+        {
+            lines->append(QString::fromUtf8(bytes.constData() + line.first, line.second));
+        }
+        m_blocks.insert(block, lines);
+    }
+    int line = index.row() % linesPerBlock;
+    if(line >= lines->size())
+    {
+        return QString();
+    }
+    return lines->at(line);
+}
+
+QFuture<QString> LogFileModel::toPlainText() const
+{
+    return QtConcurrent::run(readText, m_source, m_end);
+}
+
+QFuture<int> LogFileModel::find(const QString & what, int from, bool reverse)
+{
+    if(m_searchCancelled)
+    {
+        m_searchCancelled->storeRelease(1);
+    }
+    m_searchCancelled = std::make_shared<QAtomicInt>(0);
+    Search search;
+    search.source = m_source;
+    search.checkpoints = m_checkpoints;
+    search.lines = m_lines;
+    search.end = m_end;
+    search.what = what;
+    search.from = from;
+    search.reverse = reverse;
+    search.cancelled = m_searchCancelled;
+    return QtConcurrent::run(findLine, search);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QFuture>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+/**
+ * Lines of a log file, for viewing files of any size.
+ *
+ * Plain files are memory mapped. Gzipped files are inflated once, front to back, and the state of the decompressor
+ * is saved every few megabytes, so any part of the file can be inflated again later without starting over.
+ *
+ * Opening only starts indexing the lines on another thread, rows show up as it goes. Only every 64th line start is
+ * remembered, lines are read back in blocks of 64 when they are asked for.
+ */
+class LogFileModel : public QAbstractListModel
+{
+    Q_OBJECT
+public: /* types */
+    struct Source;
+
+public: /* con/des */
+    explicit LogFileModel(QObject *parent = nullptr);
+    virtual ~LogFileModel();
+
+public: /* methods */
+    /// Open a file (.gz files are inflated). Returns false and sets errorString() if it can't be read.
+    bool open(const QString & path);
+    /// Let go of the file, so it can be deleted
+    void close();
+    QString errorString() const
+    {
+        return m_error;
+    }
+    bool isIndexing() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+
+    /// Size of the text indexed so far, in bytes
+    qint64 textSize() const
+    {
+        return m_end;
+    }
+    /// The whole file as text, read on another thread. Files over 1 GiB are cut short.
+    QFuture<QString> toPlainText() const;
+
+    /**
+     * Look for a line containing what (ignoring case), starting after the row `from` and wrapping around.
+     * Runs on another thread and gives the row found or -1. Starting another search cancels this one.
+     */
+    QFuture<int> find(const QString & what, int from, bool reverse);
+
+signals:
+    void indexingFinished();
+
+private slots:
+    void linesIndexed(int generation, QVector<qint64> checkpoints, int lines, qint64 end, bool finished);
+
+private: /* data */
+    std::shared_ptr<Source> m_source;
+    QFuture<void> m_indexing;
+    std::shared_ptr<QAtomicInt> m_searchCancelled;
+    int m_generation = 0;
+    QString m_error;
+
+    /// where every 64th line starts
+    QVector<qint64> m_checkpoints;
+    int m_lines = 0;
+    /// end of the last indexed line
+    qint64 m_end = 0;
+    bool m_finished = true;
+
+    mutable QCache<int, QStringList> m_blocks;
+};
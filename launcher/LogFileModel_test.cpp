@@ -0,0 +1,168 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "LogFileModel.h"
+#include "GZip.h"
+
+class LogFileModelTest : public QObject
+{
+    Q_OBJECT
+
+    QString lineAt(LogFileModel & model, int row)
+    {
+        return model.data(model.index(row), Qt::DisplayRole).toString();
+    }
+
+    QByteArray makeLog(int count)
+    {
+        QByteArray out;
+        for(int i = 0; i < count; i++)
+        {
+            out.append(QString("[12:34:56] [Client thread/INFO] [examplemod]: Registered block examplemod:block_%1\n").arg(i).toUtf8());
+        }
+        return out;
+    }
+
+private
+slots:
+    void test_read_data()
+    {
+        QTest::addColumn<bool>("gzip");
+        QTest::newRow("plain") << false;
+        QTest::newRow("gzip") << true;
+    }
+
+    void test_read()
+    {
+        QFETCH(bool, gzip);
+        QTemporaryDir dir;
+        // big enough for a gzipped file to be read back from several places
+        const int count = 200000;
+        auto data = makeLog(count);
+        QString path = dir.filePath(gzip ? "latest.log.gz" : "latest.log");
+        if(gzip)
+        {
+            QByteArray compressed;
+            QVERIFY(GZip::zip(data, compressed));
+            QVERIFY(TestsInternal::writeFile(path, compressed));
+        }
+        else
+        {
+            QVERIFY(TestsInternal::writeFile(path, data));
+        }
+
+        LogFileModel model;
+        QVERIFY(model.open(path));
+        QTRY_VERIFY_WITH_TIMEOUT(!model.isIndexing(), 30000);
+        QCOMPARE(model.rowCount(), count);
+        // out of order, across the saved decompressor states
+        QVERIFY(lineAt(model, count - 1).endsWith(QString("block_%1").arg(count - 1)));
+        QVERIFY(lineAt(model, 0).endsWith("block_0"));
+        QVERIFY(lineAt(model, 123456).endsWith("block_123456"));
+        QVERIFY(lineAt(model, 64).endsWith("block_64"));
+        QCOMPARE(model.toPlainText().result().toUtf8(), data);
+
+        model.close();
+        QCOMPARE(model.rowCount(), 0);
+        QVERIFY(QFile::remove(path));
+    }
+
+    void test_lineEndings()
+    {
+        QTemporaryDir dir;
+        QString path = dir.filePath("crlf.log");
+        QVERIFY(TestsInternal::writeFile(path, QByteArray("first\r\n\r\nthird\r\nno newline at the end")));
+        LogFileModel model;
+        QVERIFY(model.open(path));
+        QTRY_VERIFY(!model.isIndexing());
+        QCOMPARE(model.rowCount(), 4);
+        QCOMPARE(lineAt(model, 0), QString("first"));
+        QCOMPARE(lineAt(model, 1), QString());
+        QCOMPARE(lineAt(model, 2), QString("third"));
+        QCOMPARE(lineAt(model, 3), QString("no newline at the end"));
+
+        QString empty = dir.filePath("empty.log");
+        QVERIFY(TestsInternal::writeFile(empty, QByteArray()));
+        QVERIFY(model.open(empty));
+        QTRY_VERIFY(!model.isIndexing());
+        QCOMPARE(model.rowCount(), 0);
+
+        QVERIFY(!model.open(dir.filePath("missing.log")));
+        QVERIFY(!model.errorString().isEmpty());
+    }
+
+    void test_find()
+    {
+        QTemporaryDir dir;
+        QString path = dir.filePath("find.log");
+        auto data = makeLog(500);
+        data.append(QString::fromUtf8("Crash in \xc5\xbdluva\n").toUtf8());
+        data.append("java.lang.NullPointerException\n");
+        QVERIFY(TestsInternal::writeFile(path, data));
+        LogFileModel model;
+        QVERIFY(model.open(path));
+        QTRY_VERIFY(!model.isIndexing());
+
+        auto find = [&](const QString & what, int from, bool reverse) -> int
+        {
+            auto future = model.find(what, from, reverse);
+            future.waitForFinished();
+            return future.result();
+        };
+        QCOMPARE(find("BLOCK_42", -1, false), 42);
+        QCOMPARE(find("block_42", 42, false), 420);
+        QCOMPARE(find("nullpointer", 10, false), 501);
+        // wraps around
+        QCOMPARE(find("block_1", 499, false), 1);
+        QCOMPARE(find("block_49", 10, true), 499);
+        QCOMPARE(find(QString::fromUtf8("\xc5\xbeluva"), 0, true), 500);
+        QCOMPARE(find("not there", 0, false), -1);
+    }
+
+    void benchmark_open_data()
+    {
+        QTest::addColumn<bool>("gzip");
+        QTest::newRow("plain") << false;
+        QTest::newRow("gzip") << true;
+    }
+
+    // how soon the first lines can be shown and how long it takes to go through the whole file
+    void benchmark_open()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, gzip);
+        QTemporaryDir dir;
+        const int count = 2000000;
+        QString path = dir.filePath("big.log");
+        {
+            auto data = makeLog(count);
+            if(gzip)
+            {
+                QByteArray compressed;
+                QVERIFY(GZip::zip(data, compressed));
+                data = compressed;
+            }
+            QVERIFY(TestsInternal::writeFile(path, data));
+        }
+        QBENCHMARK_ONCE
+        {
+            QElapsedTimer timer;
+            timer.start();
+            LogFileModel model;
+            QVERIFY(model.open(path));
+            QTRY_VERIFY(model.rowCount() > 0);
+            QVERIFY(lineAt(model, 0).endsWith("block_0"));
+            qDebug() << "First lines after" << timer.elapsed() << "ms";
+            QTRY_VERIFY_WITH_TIMEOUT(!model.isIndexing(), 120000);
+            QCOMPARE(model.rowCount(), count);
+            qDebug() << "All lines after" << timer.elapsed() << "ms";
+            QVERIFY(lineAt(model, count / 2).endsWith(QString("block_%1").arg(count / 2)));
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(LogFileModelTest)
+
+#include "LogFileModel_test.moc"
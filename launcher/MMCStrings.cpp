@@ -74,3 +74,27 @@ int Strings::naturalCompare(const QString &s1, const QString &s2, Qt::CaseSensit
     // The two strings are the same (02 == 2) so fall back to the normal sort
     return QString::compare(s1, s2, cs);
 }
+
+bool Strings::isAscii(const QString &s)
+{
+    for (auto c : s)
+    {
+        if (c.unicode() >= 0x80)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Strings::toLowerAscii(QByteArray &bytes)
+{
+    char *data = bytes.data();
+    for (int i = 0; i < bytes.size(); i++)
+    {
+        if (data[i] >= 'A' && data[i] <= 'Z')
+        {
+            data[i] += 'a' - 'A';
+        }
+    }
+}
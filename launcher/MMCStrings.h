@@ -1,8 +1,15 @@
 #pragma once
 
 #include <QString>
+#include <QByteArray>
 
 namespace Strings
 {
     int naturalCompare(const QString &s1, const QString &s2, Qt::CaseSensitivity cs);
+
+    /// True if the string has nothing outside of 7-bit ASCII
+    bool isAscii(const QString &s);
+
+    /// Lower the case of ASCII letters in place, leaving all other bytes (UTF-8 sequences included) alone
+    void toLowerAscii(QByteArray &bytes);
 }
@@ -21,6 +21,17 @@
 #include "FileSystem.h"
 
 #include <QDebug>
+#include <QDirIterator>
+#include <QCryptographicHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <errno.h>
+#endif
 
 // ours
 bool MMCZip::mergeZipFiles(QuaZip *into, QFileInfo from, QSet<QString> &contained, const JlCompress::FilterFunction filter)
@@ -35,27 +46,36 @@ bool MMCZip::mergeZipFiles(QuaZip *into, QFileInfo from, QSet<QString> &containe
         QString filename = modZip.getCurrentFileName();
         if (filter && !filter(filename))
         {
-            qDebug() << "Skipping file " << filename << " from "
-                        << from.fileName() << " - filtered";
             continue;
         }
         if (contained.contains(filename))
         {
-            qDebug() << "Skipping already contained file " << filename << " from "
-                        << from.fileName();
             continue;
         }
         contained.insert(filename);
 
-        if (!fileInsideMod.open(QIODevice::ReadOnly))
+        QuaZipFileInfo64 entryInfo;
+        if (!modZip.getCurrentFileInfo(&entryInfo))
+        {
+            qCritical() << "Failed to read the entry of" << filename << "from" << from.fileName();
+            return false;
+        }
+
+        // copy the compressed data as it is, there's no point in inflating and deflating it again
+        int method;
+        int level;
+        if (!fileInsideMod.open(QIODevice::ReadOnly, &method, &level, true))
         {
             qCritical() << "Failed to open " << filename << " from " << from.fileName();
             return false;
         }
 
         QuaZipNewInfo info_out(fileInsideMod.getActualFileName());
+        info_out.dateTime = entryInfo.dateTime;
+        info_out.externalAttr = entryInfo.externalAttr;
+        info_out.uncompressedSize = entryInfo.uncompressedSize;
 
-        if (!zipOutFile.open(QIODevice::WriteOnly, info_out))
+        if (!zipOutFile.open(QIODevice::WriteOnly, info_out, nullptr, entryInfo.crc, method, level, true))
         {
             qCritical() << "Failed to open " << filename << " in the jar";
             fileInsideMod.close();
@@ -70,10 +90,71 @@ bool MMCZip::mergeZipFiles(QuaZip *into, QFileInfo from, QSet<QString> &containe
         }
         zipOutFile.close();
         fileInsideMod.close();
+        if (zipOutFile.getZipError() != 0)
+        {
+            qCritical() << "Failed to finish" << filename << "in the jar";
+            return false;
+        }
     }
     return true;
 }
 
+// ours
+QByteArray MMCZip::moddedJarKey(QString sourceJarPath, const QList<Mod>& mods)
+{
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    // bump when the way the jar is made changes
+    key.addData("modded jar 1\n");
+    auto addFile = [&key](const QString & path, const QString & name) -> bool
+    {
+        auto hash = FS::hashFile(path, QCryptographicHash::Sha1);
+        if (hash.isEmpty())
+        {
+            return false;
+        }
+        key.addData(name.toUtf8());
+        key.addData("\n");
+        key.addData(hash);
+        return true;
+    };
+    if (!addFile(sourceJarPath, "minecraft.jar"))
+    {
+        return QByteArray();
+    }
+    for (auto & mod: mods)
+    {
+        if (!mod.enabled())
+        {
+            continue;
+        }
+        key.addData(QByteArray::number(int(mod.type())));
+        auto filename = mod.filename();
+        if (mod.type() == Mod::MOD_FOLDER)
+        {
+            QDir root(filename.absoluteFilePath());
+            QStringList files;
+            QDirIterator iter(root.absolutePath(), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+            while (iter.hasNext())
+            {
+                files.append(root.relativeFilePath(iter.next()));
+            }
+            files.sort();
+            for (auto & file: files)
+            {
+                if (!addFile(root.absoluteFilePath(file), filename.fileName() + "/" + file))
+                {
+                    return QByteArray();
+                }
+            }
+        }
+        else if (!addFile(filename.absoluteFilePath(), filename.fileName()))
+        {
+            return QByteArray();
+        }
+    }
+    return key.result();
+}
+
 // ours
 bool MMCZip::createModdedJar(QString sourceJarPath, QString targetJarPath, const QList<Mod>& mods)
 {
@@ -207,11 +288,177 @@ bool MMCZip::findFilesInZip(QuaZip * zip, const QString & what, QStringList & re
 }
 
 
+namespace {
+struct ExtractEntry
+{
+    /// position in the central directory
+    int index = 0;
+    QString name;
+    QString target;
+    qint64 size = 0;
+    QFile::Permissions permissions;
+    /// a later entry goes to the same place
+    bool skip = false;
+    /// something was there before, a failed extraction doesn't remove it
+    bool existed = false;
+};
+
+struct ExtractJob
+{
+    QString zipName;
+    std::vector<ExtractEntry> entries;
+    /// the next entry for a worker to take
+    std::atomic<std::size_t> next{0};
+    std::atomic<bool> failed{false};
+    MMCZip::ExtractProgressPtr progress;
+};
+
+const qint64 extractChunk = 1024 * 1024;
+
+// the absolute path of an entry, as long as it stays inside the target folder
+bool resolveEntryPath(const QDir & directory, QString name, QString & target)
+{
+#ifdef Q_OS_WIN32
+    // windows takes these as separators too
+    name.replace('\\', '/');
+#endif
+    auto root = QDir::cleanPath(directory.absolutePath());
+    target = QDir::cleanPath(directory.absoluteFilePath(name));
+    return target == root || target.startsWith(root + '/');
+}
+
+bool extractEntry(QuaZip & zip, const ExtractEntry & entry, MMCZip::ExtractProgress & progress)
+{
+    QuaZipFile in(&zip);
+    if(!in.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Failed to open" << entry.name << "in" << zip.getZipName();
+        return false;
+    }
+    QFile out(entry.target);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Failed to open" << entry.target << "for writing:" << out.errorString();
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    // all the space up front, and an early failure when there isn't enough of it
+    if(entry.size > 0 && posix_fallocate(out.handle(), 0, entry.size) == ENOSPC)
+    {
+        qWarning() << "Not enough space for" << entry.target;
+        return false;
+    }
+#endif
+    QByteArray buffer(int(extractChunk), Qt::Uninitialized);
+    qint64 written = 0;
+    while(!progress.canceled)
+    {
+        auto read = in.read(buffer.data(), buffer.size());
+        if(read < 0)
+        {
+            qWarning() << "Failed to read" << entry.name << "from" << zip.getZipName();
+            return false;
+        }
+        if(read == 0)
+        {
+            break;
+        }
+        if(out.write(buffer.constData(), read) != read)
+        {
+            qWarning() << "Failed to write" << entry.target << ":" << out.errorString();
+            return false;
+        }
+        written += read;
+        progress.done += read;
+    }
+    in.close();
+    // this is where the checksum is checked
+    if(progress.canceled || in.getZipError() != 0 || written != entry.size)
+    {
+        return false;
+    }
+    if(entry.permissions && !out.setPermissions(entry.permissions))
+    {
+        qWarning() << "Failed to set permissions of" << entry.target;
+    }
+    return true;
+}
+
+// takes entries until there are none left. The archive is only ever walked forward, so every worker reads the central directory once
+void extractWorker(ExtractJob * job)
+{
+    QuaZip zip(job->zipName);
+    if(!zip.open(QuaZip::mdUnzip) || !zip.goToFirstFile())
+    {
+        qWarning() << "Failed to open" << job->zipName << "for extracting";
+        job->failed = true;
+        return;
+    }
+    int position = 0;
+    while(!job->failed && !job->progress->canceled)
+    {
+        auto next = job->next++;
+        if(next >= job->entries.size())
+        {
+            return;
+        }
+        auto & entry = job->entries[next];
+        if(entry.skip)
+        {
+            continue;
+        }
+        bool found = true;
+        while(found && position < entry.index)
+        {
+            found = zip.goToNextFile();
+            position++;
+        }
+        if(!found || zip.getCurrentFileName() != entry.name || !extractEntry(zip, entry, *job->progress))
+        {
+            if(!job->progress->canceled)
+            {
+                qWarning() << "Failed to extract file" << entry.name << "to" << entry.target;
+            }
+            job->failed = true;
+            return;
+        }
+    }
+}
+
+// everything a worker took that wasn't there before, whether it got to it or not. The rest was left alone.
+void removeExtracted(const ExtractJob & job)
+{
+    auto taken = std::min<std::size_t>(job.next, job.entries.size());
+    for(std::size_t i = 0; i < taken; i++)
+    {
+        auto & entry = job.entries[i];
+        if(!entry.skip && !entry.existed)
+        {
+            QFile::remove(entry.target);
+        }
+    }
+}
+}
+
 // ours
-nonstd::optional<QStringList> MMCZip::extractSubDir(QuaZip *zip, const QString & subdir, const QString &target)
+nonstd::optional<QStringList> MMCZip::extractSubDir(QuaZip *zip, const QString & subdir, const QString &target, ExtractProgressPtr progress)
 {
     QDir directory(target);
     QStringList extracted;
+    // entries can come more than once, they are listed once
+    QSet<QString> listed;
+    auto list = [&](const QString & path)
+    {
+        if(!listed.contains(path))
+        {
+            listed.insert(path);
+            extracted.append(path);
+        }
+    };
+    if(!progress)
+    {
+        progress = std::make_shared<ExtractProgress>();
+    }
 
     qDebug() << "Extracting subdir" << subdir << "from" << zip->getZipName() << "to" << target;
     auto numEntries = zip->getEntriesCount();
@@ -229,28 +476,114 @@ nonstd::optional<QStringList> MMCZip::extractSubDir(QuaZip *zip, const QString &
         return nonstd::nullopt;
     }
 
+    // go through the central directory once, working out where everything goes
+    ExtractJob job;
+    job.zipName = zip->getZipName();
+    job.progress = progress;
+    QSet<QString> folders;
+    QHash<QString, std::size_t> targets;
+    qint64 total = 0;
+    int index = 0;
     do
     {
         QString name = zip->getCurrentFileName();
+        int position = index++;
         if(!name.startsWith(subdir))
         {
             continue;
         }
         name.remove(0, subdir.size());
         QString absFilePath = directory.absoluteFilePath(name);
-        if(name.isEmpty())
+        ExtractEntry entry;
+        if(!resolveEntryPath(directory, name, entry.target))
+        {
+            qWarning() << "Refusing to extract" << zip->getCurrentFileName() << "from" << zip->getZipName() << "outside of" << target;
+            return nonstd::nullopt;
+        }
+        if(name.isEmpty() || name.endsWith('/'))
         {
-            absFilePath += "/";
+            folders.insert(entry.target);
+            list(name.isEmpty() ? absFilePath + "/" : absFilePath);
+            continue;
         }
-        if (!JlCompress::extractFile(zip, "", absFilePath))
+        QuaZipFileInfo64 info;
+        if(!zip->getCurrentFileInfo(&info))
         {
-            qWarning() << "Failed to extract file" << name << "to" << absFilePath;
-            JlCompress::removeFile(extracted);
+            qWarning() << "Failed to read the entry of" << name << "from" << zip->getZipName();
             return nonstd::nullopt;
         }
-        extracted.append(absFilePath);
-        qDebug() << "Extracted file" << name;
+        entry.index = position;
+        entry.name = zip->getCurrentFileName();
+        entry.size = qint64(info.uncompressedSize);
+        entry.permissions = info.getPermissions();
+        QFileInfo existing(entry.target);
+        entry.existed = existing.exists() || existing.isSymLink();
+        folders.insert(QFileInfo(entry.target).absolutePath());
+        total += entry.size;
+        // the last one wins, like it would when extracting one after the other
+        if(targets.contains(entry.target))
+        {
+            auto & previous = job.entries[targets[entry.target]];
+            previous.skip = true;
+            total -= previous.size;
+        }
+        targets[entry.target] = job.entries.size();
+        job.entries.push_back(entry);
+        list(absFilePath);
     } while (zip->goToNextFile());
+    progress->total = total;
+
+    // the outermost folders that get created, removed again if extracting fails
+    QSet<QString> created;
+    for(auto & folder: folders)
+    {
+        QFileInfo info(folder);
+        if(info.exists())
+        {
+            continue;
+        }
+        while(!info.dir().exists())
+        {
+            info.setFile(info.absolutePath());
+        }
+        created.insert(info.absoluteFilePath());
+    }
+    auto removeCreated = [&]()
+    {
+        for(auto & folder: created)
+        {
+            FS::deletePath(folder);
+        }
+    };
+
+    // folders first, so the workers only have to deal with files
+    for(auto & folder: folders)
+    {
+        if(!QDir().mkpath(folder))
+        {
+            qWarning() << "Failed to create folder" << folder;
+            removeCreated();
+            return nonstd::nullopt;
+        }
+    }
+
+    int threads = int(std::min<std::size_t>(std::max(1, QThread::idealThreadCount()), job.entries.size()));
+    if(threads > 0)
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for(int i = 0; i < threads; i++)
+        {
+            QtConcurrent::run(&pool, extractWorker, &job);
+        }
+        pool.waitForDone();
+    }
+    if(job.failed || progress->canceled)
+    {
+        removeExtracted(job);
+        removeCreated();
+        return nonstd::nullopt;
+    }
     return extracted;
 }
 
@@ -261,7 +594,7 @@ bool MMCZip::extractRelFile(QuaZip *zip, const QString &file, const QString &tar
 }
 
 // ours
-nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString dir)
+nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString dir, ExtractProgressPtr progress)
 {
     QuaZip zip(fileCompressed);
     if (!zip.open(QuaZip::mdUnzip))
@@ -274,11 +607,11 @@ nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString
         qWarning() << "Could not open archive for unzipping:" << fileCompressed << "Error:" << zip.getZipError();;
         return nonstd::nullopt;
     }
-    return MMCZip::extractSubDir(&zip, "", dir);
+    return MMCZip::extractSubDir(&zip, "", dir, progress);
 }
 
 // ours
-nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString subdir, QString dir)
+nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString subdir, QString dir, ExtractProgressPtr progress)
 {
     QuaZip zip(fileCompressed);
     if (!zip.open(QuaZip::mdUnzip))
@@ -291,7 +624,7 @@ nonstd::optional<QStringList> MMCZip::extractDir(QString fileCompressed, QString
         qWarning() << "Could not open archive for unzipping:" << fileCompressed << "Error:" << zip.getZipError();;
         return nonstd::nullopt;
     }
-    return MMCZip::extractSubDir(&zip, subdir, dir);
+    return MMCZip::extractSubDir(&zip, subdir, dir, progress);
 }
 
 // ours
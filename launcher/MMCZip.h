@@ -20,6 +20,8 @@
 #include <QSet>
 #include "minecraft/mod/Mod.h"
 #include <functional>
+#include <atomic>
+#include <memory>
 
 #include <JlCompress.h>
 #include <nonstd/optional>
@@ -29,6 +31,7 @@ namespace MMCZip
 
     /**
      * Merge two zip files, using a filter function
+     * The compressed data of the entries is copied as is, without inflating and deflating it again.
      */
     bool mergeZipFiles(QuaZip *into, QFileInfo from, QSet<QString> &contained,
                                             const JlCompress::FilterFunction filter = nullptr);
@@ -38,6 +41,12 @@ namespace MMCZip
      */
     bool createModdedJar(QString sourceJarPath, QString targetJarPath, const QList<Mod>& mods);
 
+    /**
+     * A hash of everything createModdedJar would use to make the jar: the contents of the source jar and of the
+     * enabled mods, in order. Empty if something can't be read.
+     */
+    QByteArray moddedJarKey(QString sourceJarPath, const QList<Mod>& mods);
+
     /**
      * Find a single file in archive by file name (not path)
      *
@@ -53,10 +62,25 @@ namespace MMCZip
      */
     bool findFilesInZip(QuaZip * zip, const QString & what, QStringList & result, const QString &root = QString());
 
+    /**
+     * How far an extraction got, in uncompressed bytes. Set canceled from any thread to stop it.
+     */
+    struct ExtractProgress
+    {
+        std::atomic<qint64> done{0};
+        std::atomic<qint64> total{0};
+        std::atomic<bool> canceled{false};
+    };
+    using ExtractProgressPtr = std::shared_ptr<ExtractProgress>;
+
     /**
      * Extract a subdirectory from an archive
+     *
+     * The central directory is read once, then the files are inflated and written by a pool of workers, each with its
+     * own handle on the archive. Entries that would end up outside of the target are refused, along with the archive.
+     * On failure or when canceled, the files extracted so far are removed.
      */
-    nonstd::optional<QStringList> extractSubDir(QuaZip *zip, const QString & subdir, const QString &target);
+    nonstd::optional<QStringList> extractSubDir(QuaZip *zip, const QString & subdir, const QString &target, ExtractProgressPtr progress = nullptr);
 
     bool extractRelFile(QuaZip *zip, const QString & file, const QString &target);
 
@@ -67,7 +91,7 @@ namespace MMCZip
      * \param dir The directory to extract to, the current directory if left empty.
      * \return The list of the full paths of the files extracted, empty on failure.
      */
-    nonstd::optional<QStringList> extractDir(QString fileCompressed, QString dir);
+    nonstd::optional<QStringList> extractDir(QString fileCompressed, QString dir, ExtractProgressPtr progress = nullptr);
 
     /**
      * Extract a subdirectory from an archive
@@ -77,7 +101,7 @@ namespace MMCZip
      * \param dir The directory to extract to, the current directory if left empty.
      * \return The list of the full paths of the files extracted, empty on failure.
      */
-    nonstd::optional<QStringList> extractDir(QString fileCompressed, QString subdir, QString dir);
+    nonstd::optional<QStringList> extractDir(QString fileCompressed, QString subdir, QString dir, ExtractProgressPtr progress = nullptr);
 
     /**
      * Extract a single file from an archive into a directory
@@ -0,0 +1,396 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <quazip.h>
+#include <quazipfile.h>
+#include <QThread>
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "MMCZip.h"
+#include "FileSystem.h"
+
+class MMCZipTest : public QObject
+{
+    Q_OBJECT
+
+    // a jar with count class files of roughly the given size
+    QString makeJar(const QString & path, const QString & prefix, int count, int size)
+    {
+        QuaZip zip(path);
+        zip.open(QuaZip::mdCreate);
+        quint32 value = qHash(prefix);
+        for(int i = 0; i < count; i++)
+        {
+            // half noise, half text, a bit like class files
+            QByteArray data;
+            data.reserve(size);
+            while(data.size() < size / 2)
+            {
+                value = value * 1103515245 + 12345;
+                data.append(char(value >> 16));
+            }
+            while(data.size() < size)
+            {
+                data.append("net/minecraft/client/Minecraft;");
+            }
+            QuaZipFile file(&zip);
+            file.open(QIODevice::WriteOnly, QuaZipNewInfo(QString("%1/c%2.class").arg(prefix).arg(i)));
+            file.write(data);
+            file.close();
+        }
+        QuaZipFile manifest(&zip);
+        manifest.open(QIODevice::WriteOnly, QuaZipNewInfo("META-INF/MANIFEST.MF"));
+        manifest.write(prefix.toUtf8());
+        manifest.close();
+        zip.close();
+        return path;
+    }
+
+    QMap<QString, QByteArray> readJar(const QString & path)
+    {
+        QMap<QString, QByteArray> out;
+        QuaZip zip(path);
+        zip.open(QuaZip::mdUnzip);
+        QuaZipFile file(&zip);
+        for(bool more = zip.goToFirstFile(); more; more = zip.goToNextFile())
+        {
+            file.open(QIODevice::ReadOnly);
+            out.insert(zip.getCurrentFileName(), file.readAll());
+            file.close();
+        }
+        return out;
+    }
+
+    // what createModdedJar used to do with every entry: inflate and deflate it again
+    bool recompressingMerge(const QString & target, const QString & source, const QStringList & mods)
+    {
+        QuaZip zipOut(target);
+        if(!zipOut.open(QuaZip::mdCreate))
+        {
+            return false;
+        }
+        QSet<QString> contained;
+        QStringList inputs = mods;
+        inputs.append(source);
+        for(auto & input: inputs)
+        {
+            QuaZip zipIn(input);
+            zipIn.open(QuaZip::mdUnzip);
+            QuaZipFile in(&zipIn);
+            QuaZipFile out(&zipOut);
+            for(bool more = zipIn.goToFirstFile(); more; more = zipIn.goToNextFile())
+            {
+                auto name = zipIn.getCurrentFileName();
+                if(contained.contains(name) || (input == source && name.contains("META-INF")))
+                {
+                    continue;
+                }
+                contained.insert(name);
+                in.open(QIODevice::ReadOnly);
+                out.open(QIODevice::WriteOnly, QuaZipNewInfo(name));
+                JlCompress::copyData(in, out);
+                out.close();
+                in.close();
+            }
+        }
+        zipOut.close();
+        return zipOut.getZipError() == 0;
+    }
+
+    // a zip with the given contents, deflated
+    bool makeZip(const QString & path, const QList<QPair<QString, QByteArray>> & files)
+    {
+        QuaZip zip(path);
+        if(!zip.open(QuaZip::mdCreate))
+        {
+            return false;
+        }
+        for(auto & file: files)
+        {
+            QuaZipFile out(&zip);
+            if(!out.open(QIODevice::WriteOnly, QuaZipNewInfo(file.first)))
+            {
+                return false;
+            }
+            out.write(file.second);
+            out.close();
+        }
+        zip.close();
+        return zip.getZipError() == 0;
+    }
+
+    // a modpack, scaled down: mod jars that are noise to deflate, many small configs and a few big files
+    qint64 makePack(const QString & path)
+    {
+        QList<QPair<QString, QByteArray>> files;
+        qint64 total = 0;
+        quint32 value = 1;
+        for(int i = 0; i < 100; i++)
+        {
+            QByteArray jar;
+            jar.reserve(512 * 1024);
+            while(jar.size() < 512 * 1024)
+            {
+                value = value * 1103515245 + 12345;
+                jar.append(char(value >> 16));
+            }
+            files.append(qMakePair(QString("overrides/mods/mod%1.jar").arg(i), jar));
+            total += jar.size();
+        }
+        for(int i = 0; i < 2000; i++)
+        {
+            QByteArray config = QString("config %1\n").arg(i).toUtf8().repeated(200);
+            files.append(qMakePair(QString("overrides/config/mod%1/file%2.cfg").arg(i % 100).arg(i), config));
+            total += config.size();
+        }
+        for(int i = 0; i < 4; i++)
+        {
+            QByteArray big(32 * 1024 * 1024, char('a' + i));
+            files.append(qMakePair(QString("overrides/resourcepacks/pack%1.bin").arg(i), big));
+            total += big.size();
+        }
+        makeZip(path, files);
+        return total;
+    }
+
+private
+slots:
+    void test_createModdedJar()
+    {
+        QTemporaryDir dir;
+        auto source = makeJar(FS::PathCombine(dir.path(), "minecraft.jar"), "net", 20, 2000);
+        auto mod = makeJar(FS::PathCombine(dir.path(), "mod.jar"), "net", 5, 500);
+        auto other = makeJar(FS::PathCombine(dir.path(), "other.jar"), "other", 3, 500);
+        QList<Mod> mods = {Mod(QFileInfo(mod)), Mod(QFileInfo(other))};
+
+        auto target = FS::PathCombine(dir.path(), "modded.jar");
+        QVERIFY(MMCZip::createModdedJar(source, target, mods));
+
+        auto sourceFiles = readJar(source);
+        auto modFiles = readJar(mod);
+        auto otherFiles = readJar(other);
+        auto result = readJar(target);
+        // mods override the jar, the first mod wins
+        QCOMPARE(result["net/c3.class"], modFiles["net/c3.class"]);
+        QCOMPARE(result["net/c10.class"], sourceFiles["net/c10.class"]);
+        QCOMPARE(result["other/c2.class"], otherFiles["other/c2.class"]);
+        QCOMPARE(result["META-INF/MANIFEST.MF"], modFiles["META-INF/MANIFEST.MF"]);
+        QCOMPARE(result.size(), 20 + 3 + 1);
+
+        // the key follows the inputs
+        auto key = MMCZip::moddedJarKey(source, mods);
+        QCOMPARE(key.size(), 20);
+        QCOMPARE(MMCZip::moddedJarKey(source, mods), key);
+        QList<Mod> reordered = {Mod(QFileInfo(other)), Mod(QFileInfo(mod))};
+        QVERIFY(MMCZip::moddedJarKey(source, reordered) != key);
+        makeJar(other, "other", 4, 500);
+        QVERIFY(MMCZip::moddedJarKey(source, mods) != key);
+        QVERIFY(MMCZip::moddedJarKey(FS::PathCombine(dir.path(), "missing.jar"), mods).isEmpty());
+    }
+
+    void benchmark_createModdedJar_data()
+    {
+        QTest::addColumn<int>("mode");
+        QTest::newRow("recompress") << 0;
+        QTest::newRow("raw copy") << 1;
+        QTest::newRow("cached") << 2;
+    }
+
+    // a 1.7.10 sized jar with 20 jar mods
+    void benchmark_createModdedJar()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, mode);
+        QTemporaryDir dir;
+        auto source = makeJar(FS::PathCombine(dir.path(), "minecraft.jar"), "net", 2000, 4000);
+        QStringList modPaths;
+        QList<Mod> mods;
+        for(int i = 0; i < 20; i++)
+        {
+            auto path = makeJar(FS::PathCombine(dir.path(), QString("mod%1.jar").arg(i)), QString("mod%1").arg(i), 50, 4000);
+            modPaths.append(path);
+            mods.append(Mod(QFileInfo(path)));
+        }
+        auto target = FS::PathCombine(dir.path(), "modded.jar");
+        auto cached = FS::PathCombine(dir.path(), "cached.jar");
+        if(mode == 2)
+        {
+            QVERIFY(MMCZip::createModdedJar(source, cached, mods));
+        }
+
+        QBENCHMARK
+        {
+            QFile::remove(target);
+            if(mode == 0)
+            {
+                QVERIFY(recompressingMerge(target, source, modPaths));
+            }
+            else if(mode == 1)
+            {
+                QVERIFY(MMCZip::createModdedJar(source, target, mods));
+            }
+            else
+            {
+                // what a launch with unchanged inputs does
+                QVERIFY(!MMCZip::moddedJarKey(source, mods).isEmpty());
+                QVERIFY(FS::shareFile(cached, target));
+            }
+        }
+        // one manifest, from the first mod
+        QCOMPARE(readJar(target).size(), 2000 + 20 * 50 + 1);
+    }
+
+    void test_extractSubDir()
+    {
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "pack.zip");
+        QByteArray big(3 * 1024 * 1024, 'x');
+        QVERIFY(makeZip(zipPath, {
+            qMakePair(QString("manifest.json"), QByteArray("{}")),
+            qMakePair(QString("overrides/"), QByteArray()),
+            qMakePair(QString("overrides/config/"), QByteArray()),
+            qMakePair(QString("overrides/config/a.cfg"), QByteArray("a")),
+            qMakePair(QString("overrides/mods/b.jar"), big),
+            qMakePair(QString("overrides/empty.txt"), QByteArray()),
+            qMakePair(QString("overrides/options.txt"), QByteArray("old")),
+            qMakePair(QString("overrides/options.txt"), QByteArray("new")),
+        }));
+        auto target = FS::PathCombine(dir.path(), "out");
+        auto progress = std::make_shared<MMCZip::ExtractProgress>();
+        QuaZip zip(zipPath);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        auto extracted = MMCZip::extractSubDir(&zip, "overrides/", target, progress);
+        QVERIFY(extracted);
+        QVERIFY(extracted->contains(FS::PathCombine(target, "mods/b.jar")));
+        QCOMPARE(FS::read(FS::PathCombine(target, "config/a.cfg")), QByteArray("a"));
+        QCOMPARE(FS::read(FS::PathCombine(target, "mods/b.jar")), big);
+        QCOMPARE(FS::read(FS::PathCombine(target, "empty.txt")), QByteArray());
+        // the last entry of a name wins
+        QCOMPARE(FS::read(FS::PathCombine(target, "options.txt")), QByteArray("new"));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "manifest.json")));
+        QCOMPARE(qint64(progress->done), qint64(big.size() + 1 + 3));
+        QCOMPARE(qint64(progress->total), qint64(progress->done));
+    }
+
+    void test_extractSubDir_outside()
+    {
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "evil.zip");
+        QVERIFY(makeZip(zipPath, {
+            qMakePair(QString("fine.txt"), QByteArray("fine")),
+            qMakePair(QString("sub/../../evil.txt"), QByteArray("evil")),
+        }));
+        auto target = FS::PathCombine(dir.path(), "out");
+        QVERIFY(!MMCZip::extractDir(zipPath, target));
+        QVERIFY(!QFile::exists(FS::PathCombine(dir.path(), "evil.txt")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "fine.txt")));
+
+        QVERIFY(makeZip(zipPath, {qMakePair(FS::PathCombine(dir.path(), "absolute.txt"), QByteArray("evil"))}));
+        QVERIFY(!MMCZip::extractDir(zipPath, target));
+        QVERIFY(!QFile::exists(FS::PathCombine(dir.path(), "absolute.txt")));
+
+        // looks odd, stays inside
+        QVERIFY(makeZip(zipPath, {qMakePair(QString("sub/../fine..txt"), QByteArray("fine"))}));
+        QVERIFY(MMCZip::extractDir(zipPath, target));
+        QCOMPARE(FS::read(FS::PathCombine(target, "fine..txt")), QByteArray("fine"));
+    }
+
+    void test_extractSubDir_cancel()
+    {
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "pack.zip");
+        QVERIFY(makeZip(zipPath, {
+            qMakePair(QString("a.txt"), QByteArray("a")),
+            qMakePair(QString("b.txt"), QByteArray("b")),
+        }));
+        auto target = FS::PathCombine(dir.path(), "out");
+        auto progress = std::make_shared<MMCZip::ExtractProgress>();
+        progress->canceled = true;
+        QVERIFY(!MMCZip::extractDir(zipPath, target, progress));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "a.txt")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "b.txt")));
+    }
+
+    void test_extractSubDir_keepsExisting()
+    {
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "pack.zip");
+        // the last entry can't be written, there's a folder in the way
+        QVERIFY(makeZip(zipPath, {
+            qMakePair(QString("options.txt"), QByteArray("from the pack")),
+            qMakePair(QString("new.txt"), QByteArray("new")),
+            qMakePair(QString("blocked"), QByteArray("blocked")),
+        }));
+        auto target = FS::PathCombine(dir.path(), "out");
+        FS::write(FS::PathCombine(target, "options.txt"), "mine");
+        QVERIFY(QDir().mkpath(FS::PathCombine(target, "blocked")));
+        QVERIFY(!MMCZip::extractDir(zipPath, target));
+        // only what the extraction made is cleaned up
+        QVERIFY(QFile::exists(FS::PathCombine(target, "options.txt")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "new.txt")));
+        QVERIFY(QFileInfo(FS::PathCombine(target, "blocked")).isDir());
+    }
+
+    void test_extractSubDir_cancelRunning()
+    {
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "pack.zip");
+        makePack(zipPath);
+        auto target = FS::PathCombine(dir.path(), "out");
+        QVERIFY(QDir().mkpath(target));
+        auto progress = std::make_shared<MMCZip::ExtractProgress>();
+        auto result = QtConcurrent::run([zipPath, target, progress]()
+        {
+            return bool(MMCZip::extractDir(zipPath, "overrides/", target, progress));
+        });
+        while(progress->done == 0 && !result.isFinished())
+        {
+            QThread::yieldCurrentThread();
+        }
+        progress->canceled = true;
+        if(result.result())
+        {
+            QSKIP("The extraction finished before it could be canceled");
+        }
+        // files and folders that were made are gone, the target itself was there before
+        QVERIFY(QFileInfo(target).isDir());
+        QCOMPARE(QDir(target).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System), QStringList());
+    }
+
+    void benchmark_extract_data()
+    {
+        QTest::addColumn<bool>("parallel");
+        QTest::newRow("JlCompress") << false;
+        QTest::newRow("parallel") << true;
+    }
+
+    // about 200 MiB in 2100 files
+    void benchmark_extract()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, parallel);
+        QTemporaryDir dir;
+        auto zipPath = FS::PathCombine(dir.path(), "pack.zip");
+        auto total = makePack(zipPath);
+        auto target = FS::PathCombine(dir.path(), "out");
+        QElapsedTimer timer;
+        timer.start();
+        QBENCHMARK_ONCE
+        {
+            if(parallel)
+            {
+                QVERIFY(MMCZip::extractDir(zipPath, "overrides/", target));
+            }
+            else
+            {
+                QVERIFY(!JlCompress::extractDir(zipPath, target).isEmpty());
+            }
+        }
+        qDebug() << "Extracted" << total / (1024 * 1024) << "MiB in" << timer.elapsed() << "ms with up to" << QThread::idealThreadCount() << "threads";
+    }
+};
+
+QTEST_GUILESS_MAIN(MMCZipTest)
+
+#include "MMCZip_test.moc"
@@ -17,6 +17,7 @@
 #include "ui_ExportInstanceDialog.h"
 #include <BaseInstance.h>
 #include <MMCZip.h>
+#include <InstanceExportTask.h>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <qfilesystemmodel.h>
@@ -28,6 +29,7 @@
 #include "MMCStrings.h"
 #include "SeparatorPrefixTree.h"
 #include "Launcher.h"
+#include "ProgressDialog.h"
 #include <icons/IconList.h>
 #include <FileSystem.h>
 
@@ -400,12 +402,21 @@ bool ExportInstanceDialog::doExport()
     }
 
     SaveIcon(m_instance);
+    // changes still waiting for the save timer belong in the export
+    m_instance->settings()->flush();
 
     auto & blocked = proxyModel->blockedPaths();
     using std::placeholders::_1;
-    if (!JlCompress::compressDir(output, m_instance->instanceRoot(), name, std::bind(&SeparatorPrefixTree<'/'>::covers, blocked, _1)))
+    InstanceExportTask task(output, m_instance->instanceRoot(), name, std::bind(&SeparatorPrefixTree<'/'>::covers, blocked, _1));
+    ProgressDialog progress(this);
+    progress.execWithTask(&task);
+    if (task.wasAborted())
     {
-        QMessageBox::warning(this, tr("Error"), tr("Unable to export instance"));
+        return false;
+    }
+    if (!task.wasSuccessful())
+    {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to export instance:\n%1").arg(task.failReason()));
         return false;
     }
     return true;
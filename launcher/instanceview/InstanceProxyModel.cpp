@@ -17,7 +17,7 @@
 
 #include "InstanceView.h"
 #include "Launcher.h"
-#include <BaseInstance.h>
+#include <InstanceList.h>
 #include <icons/IconList.h>
 
 #include <QDebug>
@@ -57,15 +57,13 @@ bool InstanceProxyModel::lessThan(const QModelIndex &left, const QModelIndex &ri
 
 bool InstanceProxyModel::subSortLessThan(const QModelIndex &left, const QModelIndex &right) const
 {
-    BaseInstance *pdataLeft = static_cast<BaseInstance *>(left.internalPointer());
-    BaseInstance *pdataRight = static_cast<BaseInstance *>(right.internalPointer());
     QString sortMode = LAUNCHER->settings()->get("InstSortMode").toString();
     if (sortMode == "LastLaunch")
     {
-        return pdataLeft->lastLaunch() > pdataRight->lastLaunch();
+        return left.data(InstanceList::LastLaunchRole).toLongLong() > right.data(InstanceList::LastLaunchRole).toLongLong();
     }
     else
     {
-        return m_naturalSort.compare(pdataLeft->name(), pdataRight->name()) < 0;
+        return m_naturalSort.compare(left.data(Qt::DisplayRole).toString(), right.data(Qt::DisplayRole).toString()) < 0;
     }
 }
@@ -0,0 +1,155 @@
+#include "CensorFilter.h"
+
+#include <QQueue>
+#include <algorithm>
+
+namespace {
+struct Match
+{
+    int start;
+    int secret;
+};
+}
+
+CensorFilter::CensorFilter(const QMap<QString, QString> & replacements)
+{
+    m_nodes.append(Node());
+    for(auto iter = replacements.begin(); iter != replacements.end(); iter++)
+    {
+        if(iter.key().isEmpty())
+        {
+            continue;
+        }
+        int node = 0;
+        for(auto c : iter.key())
+        {
+            int next = child(node, c.unicode());
+            if(next < 0)
+            {
+                next = m_nodes.size();
+                auto & children = m_nodes[node].children;
+                auto pos = std::lower_bound(children.begin(), children.end(), qMakePair(c.unicode(), 0));
+                children.insert(pos, qMakePair(c.unicode(), next));
+                m_nodes.append(Node());
+            }
+            node = next;
+        }
+        m_nodes[node].secret = m_secrets.size();
+        m_secrets.append(iter.key());
+        m_replacements.append(iter.value());
+    }
+
+    // the root gets a full table, so scanning text that doesn't start a secret is one lookup per character
+    ushort maxFirst = 0;
+    for(auto & edge : m_nodes[0].children)
+    {
+        maxFirst = std::max(maxFirst, edge.first);
+    }
+    m_rootNext.fill(0, m_nodes[0].children.isEmpty() ? 0 : maxFirst + 1);
+    for(auto & edge : m_nodes[0].children)
+    {
+        m_rootNext[edge.first] = edge.second;
+    }
+
+    // breadth first, so the fail links of shorter prefixes are there when they're needed
+    QQueue<int> queue;
+    for(auto & edge : m_nodes[0].children)
+    {
+        queue.enqueue(edge.second);
+    }
+    while(!queue.isEmpty())
+    {
+        int node = queue.dequeue();
+        for(auto & edge : m_nodes[node].children)
+        {
+            int next = edge.second;
+            int fail = m_nodes[node].fail;
+            int target;
+            while((target = child(fail, edge.first)) < 0 && fail != 0)
+            {
+                fail = m_nodes[fail].fail;
+            }
+            target = target < 0 ? 0 : target;
+            m_nodes[next].fail = target;
+            m_nodes[next].dictionary = m_nodes[target].secret >= 0 ? target : m_nodes[target].dictionary;
+            queue.enqueue(next);
+        }
+    }
+}
+
+int CensorFilter::child(int node, ushort c) const
+{
+    auto & children = m_nodes[node].children;
+    auto pos = std::lower_bound(children.begin(), children.end(), qMakePair(c, 0));
+    if(pos != children.end() && pos->first == c)
+    {
+        return pos->second;
+    }
+    return -1;
+}
+
+int CensorFilter::step(int node, ushort c) const
+{
+    while(node != 0)
+    {
+        int next = child(node, c);
+        if(next >= 0)
+        {
+            return next;
+        }
+        node = m_nodes[node].fail;
+    }
+    return c < m_rootNext.size() ? m_rootNext[c] : 0;
+}
+
+QString CensorFilter::apply(const QString & in) const
+{
+    if(m_secrets.isEmpty())
+    {
+        return in;
+    }
+    QVector<Match> matches;
+    const QChar * data = in.constData();
+    const int size = in.size();
+    int node = 0;
+    for(int i = 0; i < size; i++)
+    {
+        node = step(node, data[i].unicode());
+        int found = m_nodes[node].secret >= 0 ? node : m_nodes[node].dictionary;
+        while(found >= 0)
+        {
+            int secret = m_nodes[found].secret;
+            matches.append({i + 1 - m_secrets[secret].size(), secret});
+            found = m_nodes[found].dictionary;
+        }
+    }
+    if(matches.isEmpty())
+    {
+        return in;
+    }
+
+    std::sort(matches.begin(), matches.end(), [this](const Match & a, const Match & b) -> bool
+    {
+        if(a.start != b.start)
+        {
+            return a.start < b.start;
+        }
+        return m_secrets[a.secret].size() > m_secrets[b.secret].size();
+    });
+    QString out;
+    out.reserve(size);
+    int copied = 0;
+    for(auto & match : matches)
+    {
+        if(match.start < copied)
+        {
+            // overlaps something already replaced
+            continue;
+        }
+        out.append(data + copied, match.start - copied);
+        out.append(m_replacements[match.secret]);
+        copied = match.start + m_secrets[match.secret].size();
+    }
+    out.append(data + copied, size - copied);
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+
+/**
+ * Replaces secrets (access tokens, session IDs...) in text with placeholders.
+ *
+ * All the secrets are looked for at once: they are built into an Aho-Corasick automaton, so each piece of text is
+ * scanned a single time, however many secrets there are. Text that contains none of them is returned as it is,
+ * without a copy.
+ *
+ * Where secrets overlap, the one starting first wins, and of those starting at the same place, the longest.
+ *
+ * Building the filter is the expensive part, applying it is const and can be done from any thread.
+ */
+class CensorFilter
+{
+public: /* con/des */
+    CensorFilter() = default;
+    /// Maps secrets to what they are replaced with, empty secrets are ignored
+    explicit CensorFilter(const QMap<QString, QString> & replacements);
+
+public: /* methods */
+    QString apply(const QString & in) const;
+
+    bool isEmpty() const
+    {
+        return m_replacements.isEmpty();
+    }
+
+private: /* types */
+    struct Node
+    {
+        /// sorted by character
+        QVector<QPair<ushort, int>> children;
+        int fail = 0;
+        /// the closest node down the fail chain that ends a secret
+        int dictionary = -1;
+        /// the secret ending here, if any
+        int secret = -1;
+    };
+
+private: /* methods */
+    int child(int node, ushort c) const;
+    int step(int node, ushort c) const;
+
+private: /* data */
+    QStringList m_secrets;
+    QStringList m_replacements;
+    QVector<Node> m_nodes;
+    /// transitions out of the root, indexed by character. Most characters don't start a secret, this is the fast path.
+    QVector<int> m_rootNext;
+};
@@ -0,0 +1,135 @@
+#include <QTest>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "launch/CensorFilter.h"
+
+namespace {
+// how censoring used to be done, one replace per secret
+QString replaceEach(const QMap<QString, QString> & filter, QString in)
+{
+    for(auto iter = filter.begin(); iter != filter.end(); iter++)
+    {
+        in.replace(iter.key(), iter.value());
+    }
+    return in;
+}
+
+QMap<QString, QString> sessionFilter()
+{
+    QMap<QString, QString> filter;
+    // about as long as a real access token
+    QString token;
+    for(int i = 0; token.size() < 1200; i++)
+    {
+        token += QString::number(i * 7919, 36);
+    }
+    filter[token] = "<ACCESS TOKEN>";
+    filter["token:" + token.left(32) + ":f3a1c2d4e5b6a7980c1d2e3f4a5b6c7d"] = "<SESSION ID>";
+    filter["f3a1c2d4e5b6a7980c1d2e3f4a5b6c7d"] = "<PROFILE ID>";
+    filter["d1e2f3a4b5c6d7e8f9a0b1c2d3e4f5a6"] = "<CLIENT TOKEN>";
+    return filter;
+}
+}
+
+class CensorFilterTest : public QObject
+{
+    Q_OBJECT
+
+private
+slots:
+    void test_replace()
+    {
+        QMap<QString, QString> filter;
+        filter["secret"] = "<S>";
+        filter["hunter2"] = "<PASSWORD>";
+        filter[""] = "<NOTHING>";
+        CensorFilter censor(filter);
+        QCOMPARE(censor.apply("my secret is hunter2"), QString("my <S> is <PASSWORD>"));
+        QCOMPARE(censor.apply("secretsecret"), QString("<S><S>"));
+        QCOMPARE(censor.apply("hunter2"), QString("<PASSWORD>"));
+        QCOMPARE(censor.apply("secre hunter"), QString("secre hunter"));
+        QCOMPARE(censor.apply(""), QString(""));
+    }
+
+    void test_overlap()
+    {
+        QMap<QString, QString> filter;
+        filter["abc"] = "<ABC>";
+        filter["abcdef"] = "<ABCDEF>";
+        filter["cde"] = "<CDE>";
+        filter["bcd"] = "<BCD>";
+        CensorFilter censor(filter);
+        // the earliest, then the longest
+        QCOMPARE(censor.apply("xabcdefx"), QString("x<ABCDEF>x"));
+        QCOMPARE(censor.apply("xabcdex"), QString("x<ABC>dex"));
+        QCOMPARE(censor.apply("xbcdefx"), QString("x<BCD>efx"));
+        // a secret inside a longer one that failed to match
+        QCOMPARE(censor.apply("abcdeabc"), QString("<ABC>de<ABC>"));
+    }
+
+    void test_untouched()
+    {
+        CensorFilter censor(sessionFilter());
+        QString line("[12:34:56] [main/INFO]: Nothing to see here");
+        auto out = censor.apply(line);
+        QCOMPARE(out, line);
+        QCOMPARE(out.constData(), line.constData());
+
+        CensorFilter empty;
+        QVERIFY(empty.isEmpty());
+        QCOMPARE(empty.apply(line).constData(), line.constData());
+    }
+
+    void test_sameAsBefore()
+    {
+        auto filter = sessionFilter();
+        CensorFilter censor(filter);
+        QString args = "--username Steve --uuid f3a1c2d4e5b6a7980c1d2e3f4a5b6c7d --accessToken " + filter.firstKey();
+        QCOMPARE(censor.apply(args), replaceEach(filter, args));
+    }
+
+    void benchmark_censor_data()
+    {
+        QTest::addColumn<bool>("automaton");
+        QTest::newRow("replace per secret") << false;
+        QTest::newRow("automaton") << true;
+    }
+
+    void benchmark_censor()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, automaton);
+        auto filter = sessionFilter();
+        QStringList lines;
+        for(int i = 0; i < 200000; i++)
+        {
+            if(i % 1000 == 0)
+            {
+                lines.append("Session ID is token:" + filter.lastKey());
+            }
+            else
+            {
+                lines.append(QString("[12:34:56] [Client thread/INFO] [examplemod]: Registered block examplemod:block_%1 with a fairly long description").arg(i));
+            }
+        }
+        QElapsedTimer timer;
+        timer.start();
+        int changed = 0;
+        QBENCHMARK_ONCE
+        {
+            CensorFilter censor(filter);
+            for(auto & line : lines)
+            {
+                auto out = automaton ? censor.apply(line) : replaceEach(filter, line);
+                changed += out.constData() != line.constData();
+            }
+        }
+        auto elapsed = std::max<qint64>(timer.elapsed(), 1);
+        qDebug() << lines.size() * 1000 / elapsed << "lines/s," << changed << "lines copied";
+    }
+};
+
+QTEST_GUILESS_MAIN(CensorFilterTest)
+
+#include "CensorFilter_test.moc"
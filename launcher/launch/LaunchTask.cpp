@@ -127,18 +127,12 @@ void LaunchTask::onProgressReportingRequested()
 
 void LaunchTask::setCensorFilter(QMap<QString, QString> filter)
 {
-    m_censorFilter = filter;
+    m_censorFilter = CensorFilter(filter);
 }
 
-QString LaunchTask::censorPrivateInfo(QString in)
+QString LaunchTask::censorPrivateInfo(const QString &in) const
 {
-    auto iter = m_censorFilter.begin();
-    while (iter != m_censorFilter.end())
-    {
-        in.replace(iter.key(), iter.value());
-        iter++;
-    }
-    return in;
+    return m_censorFilter.apply(in);
 }
 
 void LaunchTask::proceed()
@@ -209,6 +203,11 @@ shared_qobject_ptr<LogModel> LaunchTask::getLogModel()
     if(!m_logModel)
     {
         m_logModel.reset(new LogModel());
+        // keep the whole log on disk, so nothing has to be thrown away to save memory
+        if(!m_logModel->setStorage(QDir("cache/gamelogs").absolutePath()))
+        {
+            qWarning() << "Keeping the game log of" << m_instance->id() << "in memory";
+        }
         m_logModel->setMaxLines(m_instance->getConsoleMaxLines());
         m_logModel->setStopOnOverflow(m_instance->shouldStopOnConsoleOverflow());
         // FIXME: should this really be here?
@@ -221,13 +220,26 @@ shared_qobject_ptr<LogModel> LaunchTask::getLogModel()
 
 void LaunchTask::onLogLines(const QStringList &lines, MessageLevel::Enum defaultLevel)
 {
-    for (auto & line: lines)
+    if(!m_logPipeline)
     {
-        onLogLine(line, defaultLevel);
+        // one classifier per launch, it follows the log line by line
+        auto classifier = std::make_shared<LogClassifier>(m_instance->logClassifierConfig());
+        m_logPipeline.reset(new LogPipeline(getLogModel(), [this, classifier](LogModel::entry & entry)
+        {
+            entry.level = classifyLine(*classifier, entry.line, entry.level);
+            // censor private user info
+            entry.line = censorPrivateInfo(entry.line);
+        }));
     }
+    m_logPipeline->submit(lines, defaultLevel);
 }
 
 void LaunchTask::onLogLine(QString line, MessageLevel::Enum level)
+{
+    onLogLines(QStringList{line}, level);
+}
+
+MessageLevel::Enum LaunchTask::classifyLine(LogClassifier &classifier, QString &line, MessageLevel::Enum level)
 {
     // if the launcher part set a log level, use it
     auto innerLevel = MessageLevel::fromLine(line);
@@ -239,24 +251,27 @@ void LaunchTask::onLogLine(QString line, MessageLevel::Enum level)
     // If the level is still undetermined, guess level
     if (level == MessageLevel::StdErr || level == MessageLevel::StdOut || level == MessageLevel::Unknown)
     {
-        level = m_instance->guessLevel(line, level);
+        level = classifier.classify(line, level);
     }
-
-    // censor private user info
-    line = censorPrivateInfo(line);
-
-    auto &model = *getLogModel();
-    model.append(level, line);
+    return level;
 }
 
 void LaunchTask::emitSucceeded()
 {
+    if(m_logPipeline)
+    {
+        m_logPipeline->flush();
+    }
     m_instance->setRunning(false);
     Task::emitSucceeded();
 }
 
 void LaunchTask::emitFailed(QString reason)
 {
+    if(m_logPipeline)
+    {
+        m_logPipeline->flush();
+    }
     m_instance->setRunning(false);
     m_instance->setCrashed(true);
     Task::emitFailed(reason);
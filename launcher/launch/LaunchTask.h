@@ -19,6 +19,9 @@
 #include <QProcess>
 #include <QObjectPtr.h>
 #include "LogModel.h"
+#include "LogPipeline.h"
+#include "CensorFilter.h"
+#include <memory>
 #include "BaseInstance.h"
 #include "MessageLevel.h"
 #include "LoggedProcess.h"
@@ -86,7 +89,7 @@ public: /* methods */
 
 public:
     QString substituteVariables(const QString &cmd) const;
-    QString censorPrivateInfo(QString in);
+    QString censorPrivateInfo(const QString &in) const;
 
 protected: /* methods */
     virtual void emitFailed(QString reason) override;
@@ -111,13 +114,17 @@ public slots:
 
 private: /*methods */
     void finalizeSteps(bool successful, const QString & error);
+    /// runs on the log worker
+    MessageLevel::Enum classifyLine(LogClassifier &classifier, QString &line, MessageLevel::Enum level);
 
 protected: /* data */
     InstancePtr m_instance;
     shared_qobject_ptr<LogModel> m_logModel;
     QList <shared_qobject_ptr<LaunchStep>> m_steps;
-    QMap<QString, QString> m_censorFilter;
+    CensorFilter m_censorFilter;
     int currentStep = -1;
     State state = NotStarted;
     qint64 m_pid = -1;
+    // last, so it's gone before anything the processing refers to
+    std::unique_ptr<LogPipeline> m_logPipeline;
 };
@@ -0,0 +1,197 @@
+#include "LogClassifier.h"
+
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+//NOTE: this diverges from the real regexp. no unicode, the first section is + instead of *
+const QString javaSymbol = "([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$][a-zA-Z\\d_$]*";
+
+MessageLevel::Enum log4jLevel(const QStringRef & levelStr, MessageLevel::Enum level)
+{
+    if(levelStr == QLatin1String("INFO"))
+        return MessageLevel::Message;
+    if(levelStr == QLatin1String("WARN"))
+        return MessageLevel::Warning;
+    if(levelStr == QLatin1String("ERROR"))
+        return MessageLevel::Error;
+    if(levelStr == QLatin1String("FATAL"))
+        return MessageLevel::Fatal;
+    if(levelStr == QLatin1String("TRACE") || levelStr == QLatin1String("DEBUG"))
+        return MessageLevel::Debug;
+    return level;
+}
+
+// one pass over the bracketed words. When there are several, debug beats warning beats error beats the rest.
+MessageLevel::Enum legacyForgeLevel(const QString & line, MessageLevel::Enum level)
+{
+    int rank = 0;
+    int from = 0;
+    while((from = line.indexOf('[', from)) >= 0)
+    {
+        int end = line.indexOf(']', from + 1);
+        if(end < 0)
+        {
+            break;
+        }
+        auto word = line.midRef(from + 1, end - from - 1);
+        if(word == QLatin1String("DEBUG"))
+        {
+            rank = 4;
+        }
+        else if(word == QLatin1String("WARNING"))
+        {
+            rank = std::max(rank, 3);
+        }
+        else if(word == QLatin1String("SEVERE") || word == QLatin1String("STDERR"))
+        {
+            rank = std::max(rank, 2);
+        }
+        else if(word == QLatin1String("INFO") || word == QLatin1String("CONFIG") || word == QLatin1String("FINE")
+            || word == QLatin1String("FINER") || word == QLatin1String("FINEST"))
+        {
+            rank = std::max(rank, 1);
+        }
+        from++;
+    }
+    switch(rank)
+    {
+        case 4:
+            return MessageLevel::Debug;
+        case 3:
+            return MessageLevel::Warning;
+        case 2:
+            return MessageLevel::Error;
+        case 1:
+            return MessageLevel::Message;
+        default:
+            return level;
+    }
+}
+}
+
+LogClassifier::LogClassifier(const Config & config)
+    : m_config(config),
+      m_log4j("\\[(?<timestamp>[0-9:]+)\\] \\[[^/]+/(?<level>[^\\]]+)\\]"),
+      m_stackFrame("\\s+at " + javaSymbol),
+      m_causedBy("Caused by: " + javaSymbol),
+      m_exception("([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$]?[a-zA-Z\\d_$]*(Exception|Error|Throwable)"),
+      m_more("... \\d+ more$")
+{
+    m_log4j.optimize();
+    m_stackFrame.optimize();
+    m_causedBy.optimize();
+    m_exception.optimize();
+    m_more.optimize();
+}
+
+MessageLevel::Enum LogClassifier::classify(const QString & line, MessageLevel::Enum level)
+{
+    for(auto & rule : m_config.rules)
+    {
+        if(rule.first.match(line).hasMatch())
+        {
+            m_inTrace = false;
+            return remember(false, rule.second);
+        }
+    }
+
+    // the cheap checks decide whether a pattern is worth running at all
+    bool prefixed = false;
+    if(m_config.log4j && line.contains(QLatin1String("] [")))
+    {
+        auto match = m_log4j.match(line);
+        if(match.hasMatch())
+        {
+            prefixed = true;
+            level = log4jLevel(match.capturedRef("level"), level);
+        }
+    }
+    if(!prefixed && m_config.legacyForge && line.contains('['))
+    {
+        level = legacyForgeLevel(line, level);
+    }
+
+    for(auto & marker : m_config.fatalMarkers)
+    {
+        if(line.contains(marker))
+        {
+            m_inTrace = false;
+            return remember(prefixed, MessageLevel::Fatal);
+        }
+    }
+
+    if(m_config.javaExceptions)
+    {
+        if(isTraceContinuation(line))
+        {
+            // frames of a trace we didn't see the start of are errors
+            return remember(prefixed, m_inTrace ? m_traceLevel : MessageLevel::Error);
+        }
+        if(isExceptionHeader(line))
+        {
+            // an exception logged on its own line belongs to the message right before it
+            auto owner = prefixed ? level : (m_lastPrefixed ? m_lastLevel : MessageLevel::Unknown);
+            m_traceLevel = owner >= MessageLevel::Warning ? owner : MessageLevel::Error;
+            m_inTrace = true;
+            return remember(prefixed, m_traceLevel);
+        }
+    }
+    m_inTrace = false;
+    return remember(prefixed, level);
+}
+
+MessageLevel::Enum LogClassifier::remember(bool prefixed, MessageLevel::Enum level)
+{
+    m_lastPrefixed = prefixed;
+    m_lastLevel = level;
+    return level;
+}
+
+bool LogClassifier::isTraceContinuation(const QString & line) const
+{
+    if(line.contains(QLatin1String("at ")) && m_stackFrame.match(line).hasMatch())
+    {
+        return true;
+    }
+    if(line.contains(QLatin1String("Caused by: ")) && m_causedBy.match(line).hasMatch())
+    {
+        return true;
+    }
+    return line.endsWith(QLatin1String(" more")) && m_more.match(line).hasMatch();
+}
+
+bool LogClassifier::isExceptionHeader(const QString & line) const
+{
+    if(line.contains(QLatin1String("Exception in thread")))
+    {
+        return true;
+    }
+    bool candidate = line.contains(QLatin1String("Exception")) || line.contains(QLatin1String("Error"))
+        || line.contains(QLatin1String("Throwable"));
+    return candidate && m_exception.match(line).hasMatch();
+}
+
+QList<QPair<QRegularExpression, MessageLevel::Enum>> LogClassifier::parseRules(const QString & rules)
+{
+    QList<QPair<QRegularExpression, MessageLevel::Enum>> out;
+    for(auto & rule : rules.split('\n', QString::SkipEmptyParts))
+    {
+        int separator = rule.indexOf('=');
+        if(separator <= 0)
+        {
+            qWarning() << "Ignoring log level rule without a level:" << rule;
+            continue;
+        }
+        auto level = MessageLevel::getLevel(rule.left(separator).trimmed());
+        QRegularExpression expression(rule.mid(separator + 1));
+        if(level == MessageLevel::Unknown || !expression.isValid())
+        {
+            qWarning() << "Ignoring broken log level rule:" << rule;
+            continue;
+        }
+        expression.optimize();
+        out.append(qMakePair(expression, level));
+    }
+    return out;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QRegularExpression>
+
+#include "MessageLevel.h"
+
+/**
+ * Guesses the level of game log lines that didn't come with one.
+ *
+ * The patterns are compiled once, and only run on lines that contain what they look for.
+ * Stack traces are followed over lines: the frames of a trace get the level of the exception that started it.
+ * That makes a classifier specific to one log, and lines have to be classified in the order they were logged.
+ */
+class LogClassifier
+{
+public: /* types */
+    struct Config
+    {
+        /// [12:34:56] [thread/LEVEL] style lines
+        bool log4j = false;
+        /// [INFO], [SEVERE] and friends in old Forge logs
+        bool legacyForge = false;
+        /// Java exceptions and their stack traces
+        bool javaExceptions = false;
+        /// lines containing any of these are fatal
+        QStringList fatalMarkers;
+        /// tried before everything else, the first one matching wins
+        QList<QPair<QRegularExpression, MessageLevel::Enum>> rules;
+    };
+
+public: /* con/des */
+    explicit LogClassifier(const Config & config = Config());
+
+public: /* methods */
+    /// Guess the level of the next line, falling back to the given one
+    MessageLevel::Enum classify(const QString & line, MessageLevel::Enum level);
+
+    /**
+     * Parse rules written as one LEVEL=regex per line, LEVEL being one of the MessageLevel names (Warning, Error...).
+     * Lines that don't make sense are skipped.
+     */
+    static QList<QPair<QRegularExpression, MessageLevel::Enum>> parseRules(const QString & rules);
+
+private: /* methods */
+    bool isTraceContinuation(const QString & line) const;
+    bool isExceptionHeader(const QString & line) const;
+    MessageLevel::Enum remember(bool prefixed, MessageLevel::Enum level);
+
+private: /* data */
+    Config m_config;
+    QRegularExpression m_log4j;
+    QRegularExpression m_stackFrame;
+    QRegularExpression m_causedBy;
+    QRegularExpression m_exception;
+    QRegularExpression m_more;
+
+    bool m_inTrace = false;
+    MessageLevel::Enum m_traceLevel = MessageLevel::Error;
+    bool m_lastPrefixed = false;
+    MessageLevel::Enum m_lastLevel = MessageLevel::Unknown;
+};
@@ -0,0 +1,183 @@
+#include <QTest>
+#include <QFile>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "launch/LogClassifier.h"
+
+namespace {
+LogClassifier::Config minecraftConfig()
+{
+    LogClassifier::Config config;
+    config.log4j = true;
+    config.legacyForge = true;
+    config.javaExceptions = true;
+    config.fatalMarkers = QStringList{"overwriting existing"};
+    return config;
+}
+
+// how levels used to be guessed, compiling the patterns for every line
+MessageLevel::Enum guessLevelPerLine(const QString &line, MessageLevel::Enum level)
+{
+    QRegularExpression re("\\[(?<timestamp>[0-9:]+)\\] \\[[^/]+/(?<level>[^\\]]+)\\]");
+    auto match = re.match(line);
+    if(match.hasMatch())
+    {
+        QString levelStr = match.captured("level");
+        if(levelStr == "INFO")
+            level = MessageLevel::Message;
+        if(levelStr == "WARN")
+            level = MessageLevel::Warning;
+        if(levelStr == "ERROR")
+            level = MessageLevel::Error;
+        if(levelStr == "FATAL")
+            level = MessageLevel::Fatal;
+        if(levelStr == "TRACE" || levelStr == "DEBUG")
+            level = MessageLevel::Debug;
+    }
+    else
+    {
+        if (line.contains("[INFO]") || line.contains("[CONFIG]") || line.contains("[FINE]") ||
+            line.contains("[FINER]") || line.contains("[FINEST]"))
+            level = MessageLevel::Message;
+        if (line.contains("[SEVERE]") || line.contains("[STDERR]"))
+            level = MessageLevel::Error;
+        if (line.contains("[WARNING]"))
+            level = MessageLevel::Warning;
+        if (line.contains("[DEBUG]"))
+            level = MessageLevel::Debug;
+    }
+    if (line.contains("overwriting existing"))
+        return MessageLevel::Fatal;
+    static const QString javaSymbol = "([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$][a-zA-Z\\d_$]*";
+    if (line.contains("Exception in thread")
+        || line.contains(QRegularExpression("\\s+at " + javaSymbol))
+        || line.contains(QRegularExpression("Caused by: " + javaSymbol))
+        || line.contains(QRegularExpression("([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$]?[a-zA-Z\\d_$]*(Exception|Error|Throwable)"))
+        || line.contains(QRegularExpression("... \\d+ more$"))
+        )
+        return MessageLevel::Error;
+    return level;
+}
+}
+
+class LogClassifierTest : public QObject
+{
+    Q_OBJECT
+
+    QStringList readLog(const QString & name)
+    {
+        QFile file(QFINDTESTDATA("testdata/" + name));
+        file.open(QIODevice::ReadOnly);
+        return QString::fromUtf8(file.readAll()).split('\n', QString::SkipEmptyParts);
+    }
+
+private
+slots:
+    void test_line_data()
+    {
+        QTest::addColumn<QString>("line");
+        QTest::addColumn<int>("level");
+        QTest::newRow("log4j info") << "[12:00:00] [main/INFO]: Hello" << int(MessageLevel::Message);
+        QTest::newRow("log4j warn") << "[12:00:00] [Render thread/WARN]: Hmm" << int(MessageLevel::Warning);
+        QTest::newRow("log4j debug") << "[12:00:00] [main/DEBUG] [FML]: Details" << int(MessageLevel::Debug);
+        QTest::newRow("legacy severe") << "2013-01-01 12:00:00 [SEVERE] [ForgeModLoader] Oops" << int(MessageLevel::Error);
+        QTest::newRow("legacy debug wins") << "2013-01-01 12:00:00 [INFO] [DEBUG] Mixed" << int(MessageLevel::Debug);
+        QTest::newRow("legacy nested") << "2013-01-01 12:00:00 [[WARNING] Nested" << int(MessageLevel::Warning);
+        QTest::newRow("fatal marker") << "[12:00:00] [main/INFO]: overwriting existing entry" << int(MessageLevel::Fatal);
+        QTest::newRow("lone frame") << "\tat net.minecraft.client.Minecraft.run(Minecraft.java:1)" << int(MessageLevel::Error);
+        QTest::newRow("exception") << "java.lang.NullPointerException: null" << int(MessageLevel::Error);
+        QTest::newRow("thread") << "Exception in thread \"main\" oops" << int(MessageLevel::Error);
+        QTest::newRow("nothing") << "Just some text" << int(MessageLevel::StdOut);
+    }
+
+    void test_line()
+    {
+        QFETCH(QString, line);
+        QFETCH(int, level);
+        LogClassifier classifier(minecraftConfig());
+        QCOMPARE(int(classifier.classify(line, MessageLevel::StdOut)), level);
+    }
+
+    void test_stackTrace()
+    {
+        LogClassifier classifier(minecraftConfig());
+        // the trace of a warning is part of the warning
+        QCOMPARE(classifier.classify("[12:00:00] [main/WARN]: Failed to load texture", MessageLevel::StdOut), MessageLevel::Warning);
+        QCOMPARE(classifier.classify("java.io.FileNotFoundException: missing.png", MessageLevel::StdOut), MessageLevel::Warning);
+        QCOMPARE(classifier.classify("\tat net.minecraft.Foo.bar(Foo.java:1)", MessageLevel::StdOut), MessageLevel::Warning);
+        QCOMPARE(classifier.classify("Caused by: java.io.IOException: nope", MessageLevel::StdOut), MessageLevel::Warning);
+        QCOMPARE(classifier.classify("\t... 20 more", MessageLevel::StdOut), MessageLevel::Warning);
+        // and then it ends
+        QCOMPARE(classifier.classify("[12:00:01] [main/INFO]: Moving on", MessageLevel::StdOut), MessageLevel::Message);
+        // a trace after an info message, or without one, is an error
+        QCOMPARE(classifier.classify("java.lang.IllegalStateException: bad", MessageLevel::StdErr), MessageLevel::Error);
+        QCOMPARE(classifier.classify("\tat net.minecraft.Foo.bar(Foo.java:1)", MessageLevel::StdErr), MessageLevel::Error);
+    }
+
+    void test_rules()
+    {
+        auto config = minecraftConfig();
+        config.rules = LogClassifier::parseRules("Warning=^\\[OptiFine\\]\nnonsense\nBogus=x\nError=([\nDebug=spam$\n");
+        QCOMPARE(config.rules.size(), 2);
+        LogClassifier classifier(config);
+        QCOMPARE(classifier.classify("[OptiFine] Something", MessageLevel::StdOut), MessageLevel::Warning);
+        QCOMPARE(classifier.classify("[12:00:00] [main/ERROR]: spam", MessageLevel::StdOut), MessageLevel::Debug);
+    }
+
+    void test_sameAsBefore()
+    {
+        // lines outside of traces get what they always got
+        LogClassifier classifier(minecraftConfig());
+        for(auto & line : readLog("forge.log") + readLog("fabric.log"))
+        {
+            auto before = guessLevelPerLine(line, MessageLevel::StdOut);
+            auto now = classifier.classify(line, MessageLevel::StdOut);
+            if(before != MessageLevel::Error || now != MessageLevel::Warning)
+            {
+                QCOMPARE(now, before);
+            }
+        }
+    }
+
+    void benchmark_classify_data()
+    {
+        QTest::addColumn<QString>("log");
+        QTest::addColumn<bool>("precompiled");
+        QTest::newRow("forge, per line regex") << "forge.log" << false;
+        QTest::newRow("forge, classifier") << "forge.log" << true;
+        QTest::newRow("fabric, per line regex") << "fabric.log" << false;
+        QTest::newRow("fabric, classifier") << "fabric.log" << true;
+    }
+
+    void benchmark_classify()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(QString, log);
+        QFETCH(bool, precompiled);
+        auto sample = readLog(log);
+        QStringList lines;
+        while(lines.size() < 100000)
+        {
+            lines += sample;
+        }
+        int errors = 0;
+        QElapsedTimer timer;
+        timer.start();
+        QBENCHMARK_ONCE
+        {
+            LogClassifier classifier(minecraftConfig());
+            for(auto & line : lines)
+            {
+                auto level = precompiled ? classifier.classify(line, MessageLevel::StdOut) : guessLevelPerLine(line, MessageLevel::StdOut);
+                errors += level == MessageLevel::Error;
+            }
+        }
+        auto elapsed = std::max<qint64>(timer.elapsed(), 1);
+        qDebug() << lines.size() * 1000 / elapsed << "lines/s," << errors << "errors";
+    }
+};
+
+QTEST_GUILESS_MAIN(LogClassifierTest)
+
+#include "LogClassifier_test.moc"
@@ -1,22 +1,78 @@
 #include "LogModel.h"
 
+#include <QtConcurrent>
+
+namespace {
+int findInLines(const QStringList & lines, const QString & what, int from, bool reverse)
+{
+    const int count = lines.size();
+    int step = reverse ? -1 : 1;
+    for(int i = 1; i <= count; i++)
+    {
+        int row = ((from + i * step) % count + count) % count;
+        if(lines[row].contains(what, Qt::CaseInsensitive))
+        {
+            return row;
+        }
+    }
+    return -1;
+}
+}
+
 LogModel::LogModel(QObject *parent):QAbstractListModel(parent)
 {
     m_content.resize(m_maxLines);
 }
 
+LogModel::~LogModel()
+{
+}
+
+bool LogModel::setStorage(const QString & directory)
+{
+    if(m_store || m_numLines)
+    {
+        return false;
+    }
+    std::unique_ptr<LogStore> store(new LogStore(directory));
+    if(!store->isOpen())
+    {
+        return false;
+    }
+    m_store = std::move(store);
+    m_content.clear();
+    m_content.squeeze();
+    return true;
+}
+
 int LogModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
 
+    if (m_store)
+        return m_store->size();
+
     return m_numLines;
 }
 
 QVariant LogModel::data(const QModelIndex &index, int role) const
 {
-    if (index.row() < 0 || index.row() >= m_numLines)
+    if (index.row() < 0 || index.row() >= rowCount())
+        return QVariant();
+
+    if (m_store)
+    {
+        if (role == Qt::DisplayRole || role == Qt::EditRole)
+        {
+            return m_store->at(index.row()).text;
+        }
+        if (role == LevelRole)
+        {
+            return m_store->at(index.row()).level;
+        }
         return QVariant();
+    }
 
     auto row = index.row();
     auto realRow = (row + m_firstLine) % m_maxLines;
@@ -38,6 +94,11 @@ void LogModel::append(MessageLevel::Enum level, QString line)
     {
         return;
     }
+    if(m_store)
+    {
+        appendToStore({{level, line}});
+        return;
+    }
     int lineNum = (m_firstLine + m_numLines) % m_maxLines;
     // overflow
     if(m_numLines == m_maxLines)
@@ -64,6 +125,101 @@ void LogModel::append(MessageLevel::Enum level, QString line)
     endInsertRows();
 }
 
+void LogModel::append(const QVector<entry> & lines)
+{
+    if(m_suspended || lines.isEmpty())
+    {
+        return;
+    }
+    if(m_store)
+    {
+        appendToStore(lines);
+        return;
+    }
+    int count = lines.size();
+    int skip = 0;
+    bool overflow = false;
+    if(m_stopOnOverflow)
+    {
+        // fill what's left, the last line becomes the overflow message
+        int room = m_maxLines - m_numLines;
+        if(room <= 0)
+        {
+            return;
+        }
+        if(count >= room)
+        {
+            count = room;
+            overflow = true;
+        }
+    }
+    else
+    {
+        // lines that would be pushed out by this very batch are not added at all
+        if(count > m_maxLines)
+        {
+            skip = count - m_maxLines;
+            count = m_maxLines;
+        }
+        int excess = m_numLines + count - m_maxLines;
+        if(excess > 0)
+        {
+            beginRemoveRows(QModelIndex(), 0, excess - 1);
+            m_firstLine = (m_firstLine + excess) % m_maxLines;
+            m_numLines -= excess;
+            endRemoveRows();
+        }
+    }
+    beginInsertRows(QModelIndex(), m_numLines, m_numLines + count - 1);
+    for(int i = 0; i < count; i++)
+    {
+        int lineNum = (m_firstLine + m_numLines + i) % m_maxLines;
+        m_content[lineNum] = lines[skip + i];
+    }
+    if(overflow)
+    {
+        int lineNum = (m_firstLine + m_numLines + count - 1) % m_maxLines;
+        m_content[lineNum].level = MessageLevel::Fatal;
+        m_content[lineNum].line = m_overflowMessage;
+    }
+    m_numLines += count;
+    endInsertRows();
+}
+
+void LogModel::appendToStore(const QVector<entry> & lines)
+{
+    // nothing is ever pushed out, the only limit is the one set to stop on
+    int count = lines.size();
+    bool overflow = false;
+    if(m_stopOnOverflow)
+    {
+        int room = m_maxLines - m_store->size();
+        if(room <= 0)
+        {
+            return;
+        }
+        if(count >= room)
+        {
+            count = room;
+            overflow = true;
+        }
+    }
+    int first = m_store->size();
+    beginInsertRows(QModelIndex(), first, first + count - 1);
+    for(int i = 0; i < count; i++)
+    {
+        if(overflow && i == count - 1)
+        {
+            m_store->append(MessageLevel::Fatal, m_overflowMessage);
+        }
+        else
+        {
+            m_store->append(lines[i].level, lines[i].line);
+        }
+    }
+    endInsertRows();
+}
+
 void LogModel::suspend(bool suspend)
 {
     m_suspended = suspend;
@@ -77,6 +233,10 @@ bool LogModel::suspended()
 void LogModel::clear()
 {
     beginResetModel();
+    if(m_store)
+    {
+        m_store->clear();
+    }
     m_firstLine = 0;
     m_numLines = 0;
     endResetModel();
@@ -84,6 +244,10 @@ void LogModel::clear()
 
 QString LogModel::toPlainText()
 {
+    if(m_store)
+    {
+        return m_store->toPlainText();
+    }
     QString out;
     out.reserve(m_numLines * 80);
     for(int i = 0; i < m_numLines; i++)
@@ -95,6 +259,21 @@ QString LogModel::toPlainText()
     return out;
 }
 
+QFuture<int> LogModel::find(const QString & what, int from, bool reverse) const
+{
+    if(m_store)
+    {
+        return QtConcurrent::run(&LogStore::find, m_store->snapshot(), what, from, reverse);
+    }
+    QStringList lines;
+    lines.reserve(m_numLines);
+    for(int i = 0; i < m_numLines; i++)
+    {
+        lines.append(m_content[(m_firstLine + i) % m_maxLines].line);
+    }
+    return QtConcurrent::run(findInLines, lines, what, from, reverse);
+}
+
 void LogModel::setMaxLines(int maxLines)
 {
     // no-op
@@ -102,6 +281,12 @@ void LogModel::setMaxLines(int maxLines)
     {
         return;
     }
+    // the store has no ring buffer, the limit only matters when stopping on overflow
+    if(m_store)
+    {
+        m_maxLines = maxLines;
+        return;
+    }
     // if it all still fits in the buffer, just resize it
     if(m_firstLine + m_numLines < m_maxLines)
     {
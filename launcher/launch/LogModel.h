@@ -2,18 +2,38 @@
 
 #include <QAbstractListModel>
 #include <QString>
+#include <QFuture>
+#include <memory>
 #include "MessageLevel.h"
+#include "LogStore.h"
 
 class LogModel : public QAbstractListModel
 {
     Q_OBJECT
+public: /* types */
+    struct entry
+    {
+        MessageLevel::Enum level;
+        QString line;
+    };
+
 public:
     explicit LogModel(QObject *parent = 0);
+    virtual ~LogModel();
+
+    /**
+     * Keep the lines in a file in the directory instead of in memory. Only works before anything is appended.
+     *
+     * The log then has no line limit, unless it is set to stop on overflow. Returns false if the file can't be created.
+     */
+    bool setStorage(const QString & directory);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant data(const QModelIndex &index, int role) const;
 
     void append(MessageLevel::Enum, QString line);
+    /// Append many lines at once, with one row insert
+    void append(const QVector<entry> & lines);
     void clear();
 
     void suspend(bool suspend);
@@ -21,6 +41,12 @@ public:
 
     QString toPlainText();
 
+    /**
+     * Look for a line containing what (ignoring case), starting after the row `from` and wrapping around.
+     * Runs on another thread, the result is the row found or -1.
+     */
+    QFuture<int> find(const QString & what, int from, bool reverse) const;
+
     int getMaxLines();
     void setMaxLines(int maxLines);
     void setStopOnOverflow(bool stop);
@@ -34,14 +60,12 @@ public:
         LevelRole = Qt::UserRole
     };
 
-private /* types */:
-    struct entry
-    {
-        MessageLevel::Enum level;
-        QString line;
-    };
+private: /* methods */
+    void appendToStore(const QVector<entry> & lines);
 
 private: /* data */
+    /// when set, the lines live here and the ring buffer below is unused
+    std::unique_ptr<LogStore> m_store;
     QVector <entry> m_content;
     int m_maxLines = 1000;
     // first line in the circular buffer
@@ -0,0 +1,121 @@
+#include "LogPipeline.h"
+
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QDebug>
+
+namespace {
+// how often the model is updated while lines are coming in, in milliseconds
+const int flushInterval = 33;
+// a backlog this large means the game logs faster than the launcher can keep up with
+const int backlogWarning = 250000;
+
+// the log workers are separate, so a chatty game doesn't hold up other work on the global pool
+QThreadPool * logPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+void processLines(QVector<LogModel::entry> * lines, LogPipeline::Processor processor)
+{
+    for (auto & line : *lines)
+    {
+        processor(line);
+    }
+}
+}
+
+LogPipeline::LogPipeline(shared_qobject_ptr<LogModel> model, Processor processor, QObject *parent)
+    : QObject(parent), m_model(model), m_processor(processor)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(flushInterval);
+    connect(&m_flushTimer, &QTimer::timeout, this, &LogPipeline::flushToModel);
+    connect(&m_watcher, &QFutureWatcher<void>::finished, this, &LogPipeline::batchFinished);
+}
+
+LogPipeline::~LogPipeline()
+{
+    // the processor usually refers to the owner of the pipeline
+    m_watcher.waitForFinished();
+}
+
+void LogPipeline::submit(const QStringList &lines, MessageLevel::Enum level)
+{
+    m_incoming.reserve(m_incoming.size() + lines.size());
+    for (auto & line : lines)
+    {
+        m_incoming.append({level, line});
+    }
+    m_backlog += lines.size();
+    if (m_backlog > m_peakBacklog)
+    {
+        m_peakBacklog = m_backlog;
+        if (m_peakBacklog > backlogWarning && !m_warnedAboutBacklog)
+        {
+            m_warnedAboutBacklog = true;
+            qWarning() << "Game log is coming in faster than it can be processed," << m_backlog << "lines waiting";
+        }
+    }
+    if (!m_running)
+    {
+        startBatch();
+    }
+}
+
+void LogPipeline::startBatch()
+{
+    if (m_incoming.isEmpty())
+    {
+        return;
+    }
+    m_processing.swap(m_incoming);
+    m_running = true;
+    m_watcher.setFuture(QtConcurrent::run(logPool(), processLines, &m_processing, m_processor));
+}
+
+void LogPipeline::batchFinished()
+{
+    if (!m_running || !m_watcher.isFinished())
+    {
+        // already picked up by flush()
+        return;
+    }
+    m_running = false;
+    m_processed += m_processing;
+    m_processing.clear();
+    if (!m_flushTimer.isActive())
+    {
+        m_flushTimer.start();
+    }
+    startBatch();
+}
+
+void LogPipeline::flushToModel()
+{
+    if (m_processed.isEmpty())
+    {
+        return;
+    }
+    m_backlog -= m_processed.size();
+    m_model->append(m_processed);
+    m_processed.clear();
+}
+
+void LogPipeline::flush()
+{
+    if (m_running)
+    {
+        m_watcher.waitForFinished();
+        m_running = false;
+        m_processed += m_processing;
+        m_processing.clear();
+    }
+    // whatever is left is done right here
+    processLines(&m_incoming, m_processor);
+    m_processed += m_incoming;
+    m_incoming.clear();
+    m_flushTimer.stop();
+    flushToModel();
+}
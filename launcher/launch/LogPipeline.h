@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+#include "LogModel.h"
+#include "QObjectPtr.h"
+
+/**
+ * Carries log lines from a process to a LogModel without doing the per-line work on the GUI thread.
+ *
+ * Lines are submitted in whatever chunks they come in. They are processed (level detection, censoring) in batches on
+ * a worker thread, one batch at a time so the order is kept. Everything that arrives while a batch is being processed
+ * becomes the next batch. Processed lines reach the model at most once per frame, with one row insert per flush.
+ *
+ * The processor runs on the worker thread, so it must not touch anything the GUI thread changes while lines flow.
+ */
+class LogPipeline : public QObject
+{
+    Q_OBJECT
+public: /* types */
+    typedef std::function<void(LogModel::entry &)> Processor;
+
+public: /* con/des */
+    LogPipeline(shared_qobject_ptr<LogModel> model, Processor processor, QObject *parent = nullptr);
+    virtual ~LogPipeline();
+
+public: /* methods */
+    void submit(const QStringList &lines, MessageLevel::Enum level);
+
+    /// Process what is still waiting and put everything in the model, right now
+    void flush();
+
+    /// Lines submitted, but not in the model yet
+    int backlog() const
+    {
+        return m_backlog;
+    }
+
+    /// The largest backlog so far
+    int peakBacklog() const
+    {
+        return m_peakBacklog;
+    }
+
+private slots:
+    void batchFinished();
+    void flushToModel();
+
+private: /* methods */
+    void startBatch();
+
+private: /* data */
+    shared_qobject_ptr<LogModel> m_model;
+    Processor m_processor;
+    /// waiting for the worker
+    QVector<LogModel::entry> m_incoming;
+    /// owned by the worker while a batch runs
+    QVector<LogModel::entry> m_processing;
+    bool m_running = false;
+    /// waiting for the next flush to the model
+    QVector<LogModel::entry> m_processed;
+    QFutureWatcher<void> m_watcher;
+    QTimer m_flushTimer;
+    int m_backlog = 0;
+    int m_peakBacklog = 0;
+    bool m_warnedAboutBacklog = false;
+};
@@ -0,0 +1,185 @@
+#include <QTest>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QRegularExpression>
+#include "TestUtil.h"
+
+#include "launch/LogPipeline.h"
+
+namespace {
+// about the work LaunchTask does for every line
+void processLine(LogModel::entry & entry)
+{
+    static const QRegularExpression log4j("\\[(?<timestamp>[0-9:]+)\\] \\[[^/]+/(?<level>[^\\]]+)\\]");
+    auto match = log4j.match(entry.line);
+    if(match.hasMatch())
+    {
+        auto level = match.capturedRef("level");
+        if(level == QLatin1String("WARN"))
+            entry.level = MessageLevel::Warning;
+        else if(level == QLatin1String("ERROR"))
+            entry.level = MessageLevel::Error;
+        else
+            entry.level = MessageLevel::Message;
+    }
+    entry.line.replace("secret-token", "<ACCESS TOKEN>");
+}
+}
+
+class LogPipelineTest : public QObject
+{
+    Q_OBJECT
+
+    // what a heavy modpack prints while starting
+    QStringList recordedLog(int count)
+    {
+        QStringList lines;
+        lines.reserve(count);
+        for(int i = 0; i < count; i++)
+        {
+            switch(i % 8)
+            {
+                case 0:
+                    lines.append(QString("[12:34:56] [main/INFO] [FML]: Loading mod %1 from mods/mod%1.jar").arg(i));
+                    break;
+                case 1:
+                    lines.append(QString("[12:34:56] [Client thread/WARN] [examplemod]: Missing texture examplemod:block_%1").arg(i));
+                    break;
+                case 2:
+                    lines.append(QString("[12:34:56] [Client thread/ERROR] [FML]: Exception loading model for variant %1").arg(i));
+                    break;
+                case 3:
+                    lines.append("java.lang.IllegalStateException: Something went wrong");
+                    break;
+                case 4:
+                    lines.append(QString("\tat net.minecraft.client.renderer.block.model.ModelBakery.loadModel(ModelBakery.java:%1)").arg(i % 1000));
+                    break;
+                case 5:
+                    lines.append(QString("[12:34:57] [main/INFO] [STDOUT]: Session token secret-token for line %1").arg(i));
+                    break;
+                default:
+                    lines.append(QString("[12:34:57] [main/DEBUG] [mixin]: Mixing common.MixinClass%1 into net.minecraft.world.World").arg(i));
+                    break;
+            }
+        }
+        return lines;
+    }
+
+private
+slots:
+    void test_order()
+    {
+        shared_qobject_ptr<LogModel> model(new LogModel());
+        model->setMaxLines(1000);
+        LogPipeline pipeline(model, processLine);
+        auto lines = recordedLog(100);
+        for(int i = 0; i < lines.size(); i += 7)
+        {
+            pipeline.submit(lines.mid(i, 7), MessageLevel::StdOut);
+            QCoreApplication::processEvents();
+        }
+        QTRY_COMPARE(model->rowCount(), 100);
+        QCOMPARE(pipeline.backlog(), 0);
+        QVERIFY(pipeline.peakBacklog() >= 7);
+        QCOMPARE(model->data(model->index(1), Qt::DisplayRole).toString(), lines[1]);
+        QCOMPARE(model->data(model->index(1), LogModel::LevelRole).toInt(), int(MessageLevel::Warning));
+        QCOMPARE(model->data(model->index(3), LogModel::LevelRole).toInt(), int(MessageLevel::StdOut));
+        QCOMPARE(model->data(model->index(5), Qt::DisplayRole).toString(), QString("[12:34:57] [main/INFO] [STDOUT]: Session token <ACCESS TOKEN> for line 5"));
+
+        // flushing doesn't wait for the next frame
+        pipeline.submit({"last"}, MessageLevel::Launcher);
+        pipeline.flush();
+        QCOMPARE(model->rowCount(), 101);
+        QCOMPARE(model->data(model->index(100), Qt::DisplayRole).toString(), QString("last"));
+    }
+
+    void test_batchAppend()
+    {
+        LogModel model;
+        model.setMaxLines(10);
+        QVector<LogModel::entry> lines;
+        for(int i = 0; i < 25; i++)
+        {
+            lines.append({MessageLevel::Message, QString::number(i)});
+        }
+        model.append(lines.mid(0, 4));
+        QCOMPARE(model.rowCount(), 4);
+        // the oldest lines go, only the last ten stay
+        model.append(lines.mid(4));
+        QCOMPARE(model.rowCount(), 10);
+        QCOMPARE(model.data(model.index(0), Qt::DisplayRole).toString(), QString("15"));
+        QCOMPARE(model.data(model.index(9), Qt::DisplayRole).toString(), QString("24"));
+
+        LogModel stopping;
+        stopping.setMaxLines(10);
+        stopping.setStopOnOverflow(true);
+        stopping.setOverflowMessage("OVERFLOW");
+        stopping.append(lines.mid(0, 5));
+        stopping.append(lines.mid(5));
+        QCOMPARE(stopping.rowCount(), 10);
+        QCOMPARE(stopping.data(stopping.index(8), Qt::DisplayRole).toString(), QString("8"));
+        QCOMPARE(stopping.data(stopping.index(9), Qt::DisplayRole).toString(), QString("OVERFLOW"));
+        stopping.append(lines.mid(0, 1));
+        QCOMPARE(stopping.rowCount(), 10);
+    }
+
+    void benchmark_replay_data()
+    {
+        QTest::addColumn<bool>("pipeline");
+        QTest::newRow("per line") << false;
+        QTest::newRow("pipeline") << true;
+    }
+
+    // a million lines of startup log, coming in as a game process would send them
+    void benchmark_replay()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, pipeline);
+        auto lines = recordedLog(1000000);
+        const int chunk = 200;
+
+        QBENCHMARK_ONCE
+        {
+            shared_qobject_ptr<LogModel> model(new LogModel());
+            model->setMaxLines(100000);
+            qint64 busy = 0;
+            QElapsedTimer timer;
+            if(pipeline)
+            {
+                LogPipeline logPipeline(model, processLine);
+                for(int i = 0; i < lines.size(); i += chunk)
+                {
+                    timer.start();
+                    logPipeline.submit(lines.mid(i, chunk), MessageLevel::StdOut);
+                    QCoreApplication::processEvents();
+                    busy += timer.nsecsElapsed();
+                }
+                while(logPipeline.backlog())
+                {
+                    QThread::msleep(1);
+                    timer.start();
+                    QCoreApplication::processEvents();
+                    busy += timer.nsecsElapsed();
+                }
+                qDebug() << "Peak backlog:" << logPipeline.peakBacklog() << "lines";
+            }
+            else
+            {
+                timer.start();
+                for(auto & line : lines)
+                {
+                    LogModel::entry entry{MessageLevel::StdOut, line};
+                    processLine(entry);
+                    model->append(entry.level, entry.line);
+                }
+                busy = timer.nsecsElapsed();
+            }
+            QCOMPARE(model->rowCount(), 100000);
+            qDebug() << "Calling thread busy for" << busy / 1000000 << "ms";
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(LogPipelineTest)
+
+#include "LogPipeline_test.moc"
@@ -0,0 +1,234 @@
+#include "LogStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QByteArrayMatcher>
+#include <QDebug>
+#include <algorithm>
+
+#include "MMCStrings.h"
+
+namespace {
+// lines are buffered up to this many bytes before they are written out
+const int pendingLimit = 64 * 1024;
+// lines kept decoded in memory
+const int cacheSize = 4096;
+// lines read at once when one that isn't cached is asked for
+const int readAround = 64;
+// bytes read at once when searching
+const qint64 searchChunk = 1024 * 1024;
+}
+
+int LogStore::removeStale(const QString& directory)
+{
+    int removed = 0;
+    QDir dir(directory);
+    for(auto & name : dir.entryList({"*.log"}, QDir::Files | QDir::Hidden))
+    {
+        if(dir.remove(name))
+        {
+            removed++;
+        }
+        else
+        {
+            qWarning() << "Cannot remove stale game log" << dir.absoluteFilePath(name);
+        }
+    }
+    if(removed)
+    {
+        qDebug() << "Removed" << removed << "game logs left behind in" << directory;
+    }
+    return removed;
+}
+
+LogStore::LogStore(const QString & directory)
+    : m_cache(cacheSize)
+{
+    if(!QDir().mkpath(directory))
+    {
+        qWarning() << "Cannot create game log folder" << directory;
+        return;
+    }
+    m_file.setFileTemplate(QDir(directory).absoluteFilePath("XXXXXX.log"));
+    m_isOpen = m_file.open();
+    if(!m_isOpen)
+    {
+        qWarning() << "Cannot create game log file in" << directory << ":" << m_file.errorString();
+    }
+    m_pending.reserve(pendingLimit);
+}
+
+void LogStore::append(MessageLevel::Enum level, const QString & text)
+{
+    int row = m_index.size();
+    m_index.append(m_written + m_pending.size());
+    m_pending.append(char(level));
+    m_pending.append(text.toUtf8());
+    m_pending.append('\n');
+    // new lines are usually shown right away
+    m_cache.insert(row, new Line{level, text});
+    if(m_pending.size() >= pendingLimit)
+    {
+        writePending();
+    }
+}
+
+void LogStore::writePending() const
+{
+    if(m_pending.isEmpty())
+    {
+        return;
+    }
+    m_file.seek(m_written);
+    if(m_file.write(m_pending) != m_pending.size() || !m_file.flush())
+    {
+        qWarning() << "Failed to write the game log to" << m_file.fileName() << ":" << m_file.errorString();
+    }
+    m_written += m_pending.size();
+    m_pending.resize(0);
+}
+
+qint64 LogStore::lineEnd(int row) const
+{
+    if(row + 1 < m_index.size())
+    {
+        return m_index[row + 1];
+    }
+    return m_written + m_pending.size();
+}
+
+LogStore::Line LogStore::at(int row) const
+{
+    auto cached = m_cache.object(row);
+    if(cached)
+    {
+        return *cached;
+    }
+    int first = std::max(0, row - readAround / 2);
+    int last = std::min(m_index.size(), row + readAround / 2);
+    qint64 begin = m_index[first];
+    qint64 end = lineEnd(last - 1);
+    if(end > m_written)
+    {
+        writePending();
+    }
+    m_file.seek(begin);
+    auto data = m_file.read(end - begin);
+    for(int i = first; i < last; i++)
+    {
+        qint64 offset = m_index[i] - begin;
+        qint64 length = lineEnd(i) - m_index[i];
+        if(offset + length > data.size())
+        {
+            break;
+        }
+        auto bytes = data.constData() + offset;
+        m_cache.insert(i, new Line{MessageLevel::Enum(uchar(bytes[0])), QString::fromUtf8(bytes + 1, int(length) - 2)});
+    }
+    cached = m_cache.object(row);
+    if(cached)
+    {
+        return *cached;
+    }
+    return Line{MessageLevel::Unknown, QString()};
+}
+
+void LogStore::clear()
+{
+    m_index.clear();
+    m_pending.resize(0);
+    m_written = 0;
+    m_cache.clear();
+    m_file.resize(0);
+}
+
+QString LogStore::toPlainText() const
+{
+    writePending();
+    m_file.seek(0);
+    auto data = m_file.read(m_written);
+    QString out;
+    out.reserve(data.size());
+    for(int i = 0; i < m_index.size(); i++)
+    {
+        qint64 length = lineEnd(i) - m_index[i];
+        if(m_index[i] + length > data.size())
+        {
+            break;
+        }
+        out.append(QString::fromUtf8(data.constData() + m_index[i] + 1, int(length) - 2));
+        out.append('\n');
+    }
+    return out;
+}
+
+LogStore::Snapshot LogStore::snapshot() const
+{
+    writePending();
+    Snapshot snapshot;
+    snapshot.fileName = m_file.fileName();
+    snapshot.index = m_index;
+    snapshot.end = m_written;
+    return snapshot;
+}
+
+int LogStore::find(const Snapshot & snapshot, const QString & what, int from, bool reverse)
+{
+    const int count = snapshot.index.size();
+    if(count == 0 || what.isEmpty())
+    {
+        return -1;
+    }
+    QFile file(snapshot.fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Cannot search the game log in" << snapshot.fileName << ":" << file.errorString();
+        return -1;
+    }
+
+    // ASCII is searched for in the raw bytes, anything else needs the lines decoded
+    bool ascii = Strings::isAscii(what);
+    QByteArrayMatcher matcher(what.toLower().toLatin1());
+    QByteArray chunk;
+    qint64 chunkBegin = 0;
+    auto matches = [&](int row) -> bool
+    {
+        qint64 start = snapshot.index[row];
+        qint64 end = row + 1 < count ? snapshot.index[row + 1] : snapshot.end;
+        if(start < chunkBegin || end > chunkBegin + chunk.size())
+        {
+            // read ahead in the direction of the search
+            qint64 readFrom = reverse ? std::min(start, std::max<qint64>(0, end - searchChunk)) : start;
+            qint64 readTo = reverse ? end : std::min(snapshot.end, std::max(end, start + searchChunk));
+            file.seek(readFrom);
+            chunk = file.read(readTo - readFrom);
+            chunkBegin = readFrom;
+            if(ascii)
+            {
+                Strings::toLowerAscii(chunk);
+            }
+            if(end > chunkBegin + chunk.size())
+            {
+                return false;
+            }
+        }
+        auto text = chunk.constData() + (start - chunkBegin) + 1;
+        int length = int(end - start) - 2;
+        if(ascii)
+        {
+            return matcher.indexIn(text, length) >= 0;
+        }
+        return QString::fromUtf8(text, length).contains(what, Qt::CaseInsensitive);
+    };
+
+    int step = reverse ? -1 : 1;
+    for(int i = 1; i <= count; i++)
+    {
+        int row = ((from + i * step) % count + count) % count;
+        if(matches(row))
+        {
+            return row;
+        }
+    }
+    return -1;
+}
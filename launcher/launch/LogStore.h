@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QCache>
+#include <QTemporaryFile>
+
+#include "MessageLevel.h"
+
+/**
+ * Keeps the lines of a game log in a file, so there can be any number of them.
+ *
+ * Every line is appended to the file as its level (one byte) and its UTF-8 text. Only the offset of each line stays in
+ * memory, together with a cache of recently used lines. Lines are read back on demand, a few at a time around the one
+ * asked for, as views tend to ask for neighbouring rows.
+ *
+ * The file is temporary and goes away with the store. After a crash, removeStale() cleans up what was left behind.
+ */
+class LogStore
+{
+public: /* types */
+    struct Line
+    {
+        MessageLevel::Enum level;
+        QString text;
+    };
+
+    /// Everything needed to read the lines stored so far, from any thread
+    struct Snapshot
+    {
+        QString fileName;
+        QVector<qint64> index;
+        qint64 end = 0;
+    };
+
+public: /* con/des */
+    /// Creates a new file in the directory. Check isOpen() to see if that worked.
+    explicit LogStore(const QString & directory);
+
+public: /* methods */
+    bool isOpen() const
+    {
+        return m_isOpen;
+    }
+    int size() const
+    {
+        return m_index.size();
+    }
+
+    void append(MessageLevel::Enum level, const QString & text);
+    Line at(int row) const;
+    void clear();
+    QString toPlainText() const;
+
+    /// Writes out what's buffered and describes the stored lines
+    Snapshot snapshot() const;
+
+    /**
+     * Find the first line containing what (ignoring case) after the row `from`, wrapping around at the end.
+     * Goes backwards when reverse is set. Returns -1 if no line matches.
+     */
+    static int find(const Snapshot & snapshot, const QString & what, int from, bool reverse);
+
+    /// Remove the files of stores that are gone without cleaning up. Only when no store uses the directory.
+    static int removeStale(const QString & directory);
+
+private: /* methods */
+    void writePending() const;
+    qint64 lineEnd(int row) const;
+
+private: /* data */
+    mutable QTemporaryFile m_file;
+    bool m_isOpen = false;
+    /// where each line starts in the file
+    QVector<qint64> m_index;
+    /// lines not written to the file yet, starting at m_written
+    mutable QByteArray m_pending;
+    mutable qint64 m_written = 0;
+    mutable QCache<int, Line> m_cache;
+};
@@ -0,0 +1,188 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include "TestUtil.h"
+
+#include "launch/LogModel.h"
+
+class LogStoreTest : public QObject
+{
+    Q_OBJECT
+
+    QString lineAt(LogModel & model, int row)
+    {
+        return model.data(model.index(row), Qt::DisplayRole).toString();
+    }
+
+private
+slots:
+    void test_roundtrip()
+    {
+        QTemporaryDir dir;
+        LogStore store(dir.path());
+        QVERIFY(store.isOpen());
+        // enough to go past the write buffer and the cache
+        for(int i = 0; i < 20000; i++)
+        {
+            store.append(i % 2 ? MessageLevel::Error : MessageLevel::Message, QString("line %1").arg(i));
+        }
+        store.append(MessageLevel::Warning, QString::fromUtf8("spans\nlines and has \xc5\xbe\xc3\xa1\xc4\x8d\xc3\xad"));
+        store.append(MessageLevel::Launcher, QString());
+        QCOMPARE(store.size(), 20002);
+        QCOMPARE(store.at(0).text, QString("line 0"));
+        QCOMPARE(store.at(0).level, MessageLevel::Message);
+        QCOMPARE(store.at(12345).text, QString("line 12345"));
+        QCOMPARE(store.at(12345).level, MessageLevel::Error);
+        QCOMPARE(store.at(20000).text, QString::fromUtf8("spans\nlines and has \xc5\xbe\xc3\xa1\xc4\x8d\xc3\xad"));
+        QCOMPARE(store.at(20000).level, MessageLevel::Warning);
+        QCOMPARE(store.at(20001).text, QString());
+        QVERIFY(store.toPlainText().startsWith("line 0\nline 1\n"));
+
+        store.clear();
+        QCOMPARE(store.size(), 0);
+        store.append(MessageLevel::Message, "again");
+        QCOMPARE(store.at(0).text, QString("again"));
+    }
+
+    void test_removeStale()
+    {
+        QTemporaryDir dir;
+        {
+            LogStore store(dir.path());
+            QVERIFY(store.isOpen());
+            store.append(MessageLevel::Message, "line");
+            // what a crash leaves behind
+            QVERIFY(QFile::copy(store.snapshot().fileName, dir.filePath("crashed.log")));
+        }
+        QVERIFY(TestsInternal::writeFile(dir.filePath("notes.txt"), "not ours"));
+        QCOMPARE(LogStore::removeStale(dir.path()), 1);
+        QVERIFY(!QFile::exists(dir.filePath("crashed.log")));
+        QVERIFY(QFile::exists(dir.filePath("notes.txt")));
+        QCOMPARE(LogStore::removeStale(dir.filePath("missing")), 0);
+    }
+
+    void test_model()
+    {
+        QTemporaryDir dir;
+        LogModel model;
+        QVERIFY(model.setStorage(dir.path()));
+        // nothing is dropped when the limit is exceeded
+        model.setMaxLines(10);
+        model.setStopOnOverflow(false);
+        QVector<LogModel::entry> lines;
+        for(int i = 0; i < 25; i++)
+        {
+            lines.append({MessageLevel::Message, QString::number(i)});
+        }
+        model.append(lines);
+        model.append(MessageLevel::Error, "25");
+        QCOMPARE(model.rowCount(), 26);
+        QCOMPARE(lineAt(model, 0), QString("0"));
+        QCOMPARE(model.data(model.index(25), LogModel::LevelRole).toInt(), int(MessageLevel::Error));
+
+        // unless it was asked to stop
+        LogModel stopping;
+        QVERIFY(stopping.setStorage(dir.path()));
+        stopping.setMaxLines(10);
+        stopping.setStopOnOverflow(true);
+        stopping.setOverflowMessage("OVERFLOW");
+        stopping.append(lines);
+        QCOMPARE(stopping.rowCount(), 10);
+        QCOMPARE(lineAt(stopping, 8), QString("8"));
+        QCOMPARE(lineAt(stopping, 9), QString("OVERFLOW"));
+        stopping.append(MessageLevel::Message, "more");
+        QCOMPARE(stopping.rowCount(), 10);
+
+        model.clear();
+        QCOMPARE(model.rowCount(), 0);
+
+        // too late to change storage
+        LogModel memory;
+        memory.append(MessageLevel::Message, "x");
+        QVERIFY(!memory.setStorage(dir.path()));
+    }
+
+    void test_find_data()
+    {
+        QTest::addColumn<bool>("onDisk");
+        QTest::newRow("memory") << false;
+        QTest::newRow("disk") << true;
+    }
+
+    void test_find()
+    {
+        QFETCH(bool, onDisk);
+        QTemporaryDir dir;
+        LogModel model;
+        model.setMaxLines(1000);
+        if(onDisk)
+        {
+            QVERIFY(model.setStorage(dir.path()));
+        }
+        for(int i = 0; i < 500; i++)
+        {
+            model.append(MessageLevel::Message, QString("line %1").arg(i));
+        }
+        model.append(MessageLevel::Error, QString::fromUtf8("Crash in \xc5\xbdluva"));
+        model.append(MessageLevel::Error, "java.lang.NullPointerException");
+
+        auto find = [&](const QString & what, int from, bool reverse) -> int
+        {
+            auto future = model.find(what, from, reverse);
+            future.waitForFinished();
+            return future.result();
+        };
+        QCOMPARE(find("LINE 42", -1, false), 42);
+        QCOMPARE(find("line 42", 42, false), 420);
+        QCOMPARE(find("nullpointer", 10, false), 501);
+        // wraps around
+        QCOMPARE(find("line 1", 499, false), 1);
+        QCOMPARE(find("line 49", 10, true), 499);
+        QCOMPARE(find(QString::fromUtf8("\xc5\xbeluva"), 0, true), 500);
+        QCOMPARE(find("not there", 0, false), -1);
+    }
+
+    void benchmark_append_data()
+    {
+        QTest::addColumn<bool>("onDisk");
+        // peak memory only goes up, so the smaller one goes first
+        QTest::newRow("disk") << true;
+        QTest::newRow("memory") << false;
+    }
+
+    // a million lines, all of them kept, with a view reading the newest ones as they come
+    void benchmark_append()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, onDisk);
+        QTemporaryDir dir;
+        const int count = 1000000;
+        const int batchSize = 200;
+        QBENCHMARK_ONCE
+        {
+            LogModel model;
+            model.setMaxLines(count);
+            if(onDisk)
+            {
+                QVERIFY(model.setStorage(dir.path()));
+            }
+            QVector<LogModel::entry> batch;
+            for(int i = 0; i < count; i += batchSize)
+            {
+                batch.clear();
+                for(int j = i; j < i + batchSize; j++)
+                {
+                    batch.append({MessageLevel::Message, QString("[12:34:56] [Client thread/INFO] [examplemod]: Registered block examplemod:block_%1").arg(j)});
+                }
+                model.append(batch);
+                model.data(model.index(model.rowCount() - 1), Qt::DisplayRole);
+            }
+            QCOMPARE(model.rowCount(), count);
+            // jumping back to the start
+            QVERIFY(lineAt(model, 0).endsWith("block_0"));
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(LogStoreTest)
+
+#include "LogStore_test.moc"
@@ -0,0 +1,181 @@
+#include "AssetMaintenance.h"
+#include "InstanceList.h"
+#include "minecraft/update/AssetMaintenanceTask.h"
+#include "FileSystem.h"
+#include "Json.h"
+
+#include <QDebug>
+
+namespace {
+// how long the launcher has to be idle before anything is done
+const int idleDelay = 5 * 60 * 1000;
+const int retryDelay = 60 * 60 * 1000;
+const int runInterval = 24 * 60 * 60 * 1000;
+
+// the asset index named by a Minecraft version file, or nothing if there is none
+MojangAssetIndexInfo::Ptr assetIndexFromFile(const QString & path)
+{
+    if (!QFile::exists(path))
+    {
+        return nullptr;
+    }
+    try
+    {
+        auto obj = Json::requireObject(Json::requireDocument(path, path), path);
+        if (obj.contains("assetIndex"))
+        {
+            auto index = Json::requireObject(obj, "assetIndex");
+            auto out = std::make_shared<MojangAssetIndexInfo>();
+            out->id = Json::requireString(index, "id");
+            out->url = Json::requireString(index, "url");
+            out->sha1 = Json::ensureString(index, "sha1");
+            out->size = Json::ensureInteger(index, "size", 0);
+            out->totalSize = Json::ensureInteger(index, "totalSize", 0);
+            return out;
+        }
+        auto id = Json::ensureString(obj, "assets");
+        if (!id.isEmpty())
+        {
+            return std::make_shared<MojangAssetIndexInfo>(id);
+        }
+    }
+    catch (const Exception & e)
+    {
+        qWarning() << "Couldn't read the asset index from" << path << ":" << e.cause();
+    }
+    return nullptr;
+}
+
+// what an instance uses, going by its files alone. Loading the components of every instance would stall the GUI.
+MojangAssetIndexInfo::Ptr instanceAssetIndex(const QString & instanceRoot)
+{
+    // a customized Minecraft version lives in the instance, the others in the metadata cache
+    auto patch = FS::PathCombine(instanceRoot, "patches", "net.minecraft.json");
+    if (QFile::exists(patch))
+    {
+        return assetIndexFromFile(patch);
+    }
+    auto packFile = FS::PathCombine(instanceRoot, "mmc-pack.json");
+    if (!QFile::exists(packFile))
+    {
+        return nullptr;
+    }
+    try
+    {
+        auto pack = Json::requireObject(Json::requireDocument(packFile, packFile), packFile);
+        for (auto value : Json::ensureArray(pack, "components"))
+        {
+            auto component = Json::ensureObject(value);
+            if (Json::ensureString(component, "uid") == "net.minecraft")
+            {
+                auto version = Json::ensureString(component, "version");
+                return assetIndexFromFile(FS::PathCombine("meta", "net.minecraft", version + ".json"));
+            }
+        }
+    }
+    catch (const Exception & e)
+    {
+        qWarning() << "Couldn't read the components of" << instanceRoot << ":" << e.cause();
+    }
+    return nullptr;
+}
+}
+
+AssetMaintenance::AssetMaintenance(std::shared_ptr<InstanceList> instances, QObject* parent)
+    : QObject(parent), m_instances(instances)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &AssetMaintenance::runNow);
+}
+
+AssetMaintenance::~AssetMaintenance()
+{
+    stop();
+}
+
+void AssetMaintenance::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+    {
+        return;
+    }
+    m_enabled = enabled;
+    if (!enabled)
+    {
+        stop();
+        m_timer.stop();
+        return;
+    }
+    schedule(idleDelay);
+}
+
+void AssetMaintenance::setBusy(bool busy)
+{
+    if (m_busy == busy)
+    {
+        return;
+    }
+    m_busy = busy;
+    if (busy)
+    {
+        stop();
+        m_timer.stop();
+        return;
+    }
+    schedule(idleDelay);
+}
+
+void AssetMaintenance::stop()
+{
+    if (m_task && m_task->isRunning())
+    {
+        m_task->abort();
+    }
+}
+
+void AssetMaintenance::schedule(int msecs)
+{
+    if (!m_enabled || m_busy || (m_task && m_task->isRunning()))
+    {
+        return;
+    }
+    m_timer.start(msecs);
+}
+
+QList<MojangAssetIndexInfo::Ptr> AssetMaintenance::referencedIndexes() const
+{
+    QList<MojangAssetIndexInfo::Ptr> out;
+    // only the files are read, instances that weren't loaded stay that way
+    for (int i = 0; i < m_instances->count(); i++)
+    {
+        auto assets = instanceAssetIndex(m_instances->instanceRoot(i));
+        if (assets)
+        {
+            out.append(assets);
+        }
+    }
+    return out;
+}
+
+void AssetMaintenance::runNow()
+{
+    if (!m_enabled || m_busy)
+    {
+        return;
+    }
+    m_task.reset(new AssetMaintenanceTask(referencedIndexes(), true));
+    connect(m_task.get(), &Task::finished, this, &AssetMaintenance::taskFinished);
+    m_task->start();
+}
+
+void AssetMaintenance::taskFinished()
+{
+    bool success = m_task->wasSuccessful();
+    if (!success)
+    {
+        qWarning() << "Asset maintenance didn't finish:" << m_task->failReason();
+    }
+    m_task.reset();
+    // when it was stopped because an instance launched, it's rescheduled once the launcher is idle again
+    schedule(success ? runInterval : retryDelay);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <memory>
+
+#include "QObjectPtr.h"
+#include "minecraft/MojangDownloadInfo.h"
+
+class InstanceList;
+class AssetMaintenanceTask;
+
+/**
+ * Opt-in background service that keeps the shared assets healthy while the launcher is idle.
+ *
+ * A while after the launcher goes idle (no instances running), it runs an AssetMaintenanceTask: fetch what the
+ * installed instances need, verify everything already there. It stops as soon as an instance is launched and tries
+ * again later. After a successful run, it waits a day before the next one.
+ */
+class AssetMaintenance : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AssetMaintenance(std::shared_ptr<InstanceList> instances, QObject * parent = nullptr);
+    virtual ~AssetMaintenance();
+
+    void setEnabled(bool enabled);
+    /// busy while instances are running. Nothing is done while busy.
+    void setBusy(bool busy);
+
+private slots:
+    void runNow();
+    void taskFinished();
+
+private:
+    void stop();
+    void schedule(int msecs);
+    QList<MojangAssetIndexInfo::Ptr> referencedIndexes() const;
+
+private:
+    std::shared_ptr<InstanceList> m_instances;
+    QTimer m_timer;
+    shared_qobject_ptr<AssetMaintenanceTask> m_task;
+    bool m_enabled = false;
+    bool m_busy = false;
+};
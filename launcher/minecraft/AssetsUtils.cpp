@@ -17,11 +17,10 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QCryptographicHash>
-#include <QJsonParseError>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QVariant>
+#include <QMutex>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QtConcurrent>
 
 #include "AssetsUtils.h"
 #include "FileSystem.h"
@@ -29,138 +28,700 @@
 #include "net/ChecksumValidator.h"
 #include "BuildConfig.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 namespace {
-QSet<QString> collectPathsFromDir(QString dirPath)
+const char * manifestName = ".assets-manifest";
+
+struct ManifestEntry
 {
-    QFileInfo dirInfo(dirPath);
+    QString hash;
+    qint64 size = 0;
+};
 
-    if (!dirInfo.exists())
+/*
+ * The manifest lists what the last reconstruction put in the target folder, one "hash<TAB>size<TAB>path" per line.
+ */
+QHash<QString, ManifestEntry> readManifest(const QString & targetPath)
+{
+    QHash<QString, ManifestEntry> out;
+    QFile file(FS::PathCombine(targetPath, manifestName));
+    if (!file.open(QIODevice::ReadOnly))
     {
-        return {};
+        return out;
     }
-
-    QSet<QString> out;
-
-    QDirIterator iter(dirPath, QDirIterator::Subdirectories);
-    while (iter.hasNext())
+    auto lines = file.readAll().split('\n');
+    for (auto & line : lines)
     {
-        QString value = iter.next();
-        QFileInfo info(value);
-        if(info.isFile())
+        auto parts = line.split('\t');
+        if (parts.size() != 3)
         {
-            out.insert(value);
-            qDebug() << value;
+            continue;
         }
+        ManifestEntry entry;
+        entry.hash = QString::fromLatin1(parts[0]);
+        entry.size = parts[1].toLongLong();
+        out.insert(QString::fromUtf8(parts[2]), entry);
     }
     return out;
 }
+
+bool writeManifest(const QString & targetPath, const QHash<QString, ManifestEntry> & entries)
+{
+    QByteArray data;
+    for (auto iter = entries.begin(); iter != entries.end(); iter++)
+    {
+        data.append(iter->hash.toLatin1());
+        data.append('\t');
+        data.append(QByteArray::number(iter->size));
+        data.append('\t');
+        data.append(iter.key().toUtf8());
+        data.append('\n');
+    }
+    try
+    {
+        FS::write(FS::PathCombine(targetPath, manifestName), data);
+    }
+    catch (const FS::FileSystemException & e)
+    {
+        qWarning() << "Failed to write assets manifest:" << e.cause();
+        return false;
+    }
+    return true;
 }
 
+struct MaterializeJob
+{
+    QString source;
+    QString target;
+};
 
-namespace AssetsUtils
+// asset names come from downloaded indexes. Ones like "../../x" would reach out of the target folder.
+bool resolveAssetPath(const QString & targetPath, QString name, QString & target)
 {
+#ifdef Q_OS_WIN32
+    // windows takes these as separators too
+    name.replace('\\', '/');
+#endif
+    QDir root(targetPath);
+    auto rootPath = QDir::cleanPath(root.absolutePath());
+    target = QDir::cleanPath(root.absoluteFilePath(name));
+    return target.startsWith(rootPath + '/');
+}
+
+bool materializeFile(const MaterializeJob & job)
+{
+    // whatever is there is wrong
+    QFile::remove(job.target);
+    // the game and resource packs can change files in resources/, so they never share an inode with the objects
+    return FS::cloneFile(job.source, job.target);
+}
 
 /*
- * Returns true on success, with index populated
- * index is undefined otherwise
+ * Reads an asset index in one pass over the bytes, without building a document first:
+ *
+ * {
+ *   "virtual": true,
+ *   "objects": {
+ *     "icons/icon_16x16.png": {
+ *       "hash": "bdf48ef6b5d0d23bbb02e17d04865216179f510a",
+ *       "size": 3665
+ *     },
+ *     ...
+ *   }
+ * }
+ *
+ * Anything else in the file is skipped.
  */
-bool loadAssetsIndexJson(const QString &assetsId, const QString &path, AssetsIndex& index)
+class IndexParser
 {
-    /*
+public:
+    IndexParser(const char * data, qint64 size, AssetsIndex & index)
+        : m_begin(data), m_pos(data), m_end(data + size), m_index(index)
+    {
+    }
+
+    bool parse()
     {
-      "objects": {
-        "icons/icon_16x16.png": {
-          "hash": "bdf48ef6b5d0d23bbb02e17d04865216179f510a",
-          "size": 3665
-        },
-        ...
+        if (!expect('{'))
+        {
+            return fail("Root should be an object");
+        }
+        if (consume('}'))
+        {
+            return true;
         }
-      }
+        do
+        {
+            QByteArray key;
+            if (!parseString(key) || !expect(':'))
+            {
+                return fail("Expected a key");
+            }
+            bool ok;
+            if (key == "objects")
+            {
+                ok = parseObjects();
+            }
+            else if (key == "virtual")
+            {
+                ok = parseBool(m_index.isVirtual);
+            }
+            else if (key == "map_to_resources")
+            {
+                ok = parseBool(m_index.mapToResources);
+            }
+            else
+            {
+                ok = skipValue(0);
+            }
+            if (!ok)
+            {
+                return false;
+            }
+        } while (consume(','));
+        if (!expect('}'))
+        {
+            return fail("Expected the end of the root object");
+        }
+        skipSpace();
+        return m_pos == m_end || fail("Garbage after the root object");
     }
-    */
 
-    QFile file(path);
+    QString error() const
+    {
+        return m_error;
+    }
 
-    // Try to open the file and fail if we can't.
-    // TODO: We should probably report this error to the user.
-    if (!file.open(QIODevice::ReadOnly))
+private:
+    bool fail(const char * what)
     {
-        qCritical() << "Failed to read assets index file" << path;
+        if (m_error.isEmpty())
+        {
+            m_error = QString("%1 at offset %2").arg(what).arg(m_pos - m_begin);
+        }
         return false;
     }
-    index.id = assetsId;
-
-    // Read the file and close it.
-    QByteArray jsonData = file.readAll();
-    file.close();
 
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData, &parseError);
+    void skipSpace()
+    {
+        while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t'))
+        {
+            m_pos++;
+        }
+    }
 
-    // Fail if the JSON is invalid.
-    if (parseError.error != QJsonParseError::NoError)
+    bool consume(char c)
     {
-        qCritical() << "Failed to parse assets index file:" << parseError.errorString()
-                     << "at offset " << QString::number(parseError.offset);
+        skipSpace();
+        if (m_pos < m_end && *m_pos == c)
+        {
+            m_pos++;
+            return true;
+        }
         return false;
     }
 
-    // Make sure the root is an object.
-    if (!jsonDoc.isObject())
+    bool expect(char c)
     {
-        qCritical() << "Invalid assets index JSON: Root should be an array.";
-        return false;
+        return consume(c);
     }
 
-    QJsonObject root = jsonDoc.object();
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
 
-    QJsonValue isVirtual = root.value("virtual");
-    if (!isVirtual.isUndefined())
+    bool parseHex4(uint & out)
     {
-        index.isVirtual = isVirtual.toBool(false);
+        if (m_end - m_pos < 4)
+        {
+            return false;
+        }
+        out = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int value = hexValue(*m_pos++);
+            if (value < 0)
+            {
+                return false;
+            }
+            out = (out << 4) | uint(value);
+        }
+        return true;
     }
 
-    QJsonValue mapToResources = root.value("map_to_resources");
-    if (!mapToResources.isUndefined())
+    static void appendUtf8(QByteArray & out, uint codepoint)
     {
-        index.mapToResources = mapToResources.toBool(false);
+        if (codepoint < 0x80)
+        {
+            out.append(char(codepoint));
+        }
+        else if (codepoint < 0x800)
+        {
+            out.append(char(0xC0 | (codepoint >> 6)));
+            out.append(char(0x80 | (codepoint & 0x3F)));
+        }
+        else if (codepoint < 0x10000)
+        {
+            out.append(char(0xE0 | (codepoint >> 12)));
+            out.append(char(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.append(char(0x80 | (codepoint & 0x3F)));
+        }
+        else
+        {
+            out.append(char(0xF0 | (codepoint >> 18)));
+            out.append(char(0x80 | ((codepoint >> 12) & 0x3F)));
+            out.append(char(0x80 | ((codepoint >> 6) & 0x3F)));
+            out.append(char(0x80 | (codepoint & 0x3F)));
+        }
     }
 
-    QJsonValue objects = root.value("objects");
-    QVariantMap map = objects.toVariant().toMap();
+    // append the string's contents to out, as UTF-8
+    bool parseString(QByteArray & out)
+    {
+        if (!expect('"'))
+        {
+            return fail("Expected a string");
+        }
+        while (m_pos < m_end)
+        {
+            // copy everything up to the next quote or escape in one go
+            const char * run = m_pos;
+            while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\')
+            {
+                m_pos++;
+            }
+            out.append(run, int(m_pos - run));
+            if (m_pos == m_end)
+            {
+                break;
+            }
+            if (*m_pos++ == '"')
+            {
+                return true;
+            }
+            if (m_pos == m_end)
+            {
+                break;
+            }
+            char escaped = *m_pos++;
+            switch (escaped)
+            {
+                case '"':
+                case '\\':
+                case '/':
+                    out.append(escaped);
+                    break;
+                case 'b':
+                    out.append('\b');
+                    break;
+                case 'f':
+                    out.append('\f');
+                    break;
+                case 'n':
+                    out.append('\n');
+                    break;
+                case 'r':
+                    out.append('\r');
+                    break;
+                case 't':
+                    out.append('\t');
+                    break;
+                case 'u':
+                {
+                    uint codepoint;
+                    if (!parseHex4(codepoint))
+                    {
+                        return fail("Bad unicode escape");
+                    }
+                    // surrogate pair
+                    if (codepoint >= 0xD800 && codepoint < 0xDC00 && m_end - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u')
+                    {
+                        m_pos += 2;
+                        uint low;
+                        if (!parseHex4(low) || low < 0xDC00 || low >= 0xE000)
+                        {
+                            return fail("Bad surrogate pair");
+                        }
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, codepoint);
+                    break;
+                }
+                default:
+                    return fail("Bad escape");
+            }
+        }
+        return fail("Unterminated string");
+    }
 
-    for (QVariantMap::const_iterator iter = map.begin(); iter != map.end(); ++iter)
+    bool parseNumber(qint64 & out)
     {
-        // qDebug() << iter.key();
+        skipSpace();
+        const char * start = m_pos;
+        bool negative = m_pos < m_end && *m_pos == '-';
+        if (negative)
+        {
+            m_pos++;
+        }
+        qint64 value = 0;
+        const char * digits = m_pos;
+        while (m_pos < m_end && *m_pos >= '0' && *m_pos <= '9')
+        {
+            int digit = *m_pos++ - '0';
+            if (value > (std::numeric_limits<qint64>::max() - digit) / 10)
+            {
+                return fail("Number too big");
+            }
+            value = value * 10 + digit;
+        }
+        if (m_pos == digits)
+        {
+            return fail("Expected a number");
+        }
+        if (m_pos < m_end && (*m_pos == '.' || *m_pos == 'e' || *m_pos == 'E'))
+        {
+            // not an integer, let Qt deal with it
+            while (m_pos < m_end && *m_pos && strchr("0123456789.eE+-", *m_pos) != nullptr)
+            {
+                m_pos++;
+            }
+            bool ok;
+            double number = QByteArray::fromRawData(start, int(m_pos - start)).toDouble(&ok);
+            if (!ok)
+            {
+                return fail("Bad number");
+            }
+            // anything outside of this doesn't convert
+            if (!(number > -9.2e18 && number < 9.2e18))
+            {
+                return fail("Number too big");
+            }
+            out = qint64(number);
+            return true;
+        }
+        out = negative ? -value : value;
+        return true;
+    }
 
-        QVariant variant = iter.value();
-        QVariantMap nested_objects = variant.toMap();
+    bool parseBool(bool & out)
+    {
+        skipSpace();
+        if (m_end - m_pos >= 4 && memcmp(m_pos, "true", 4) == 0)
+        {
+            m_pos += 4;
+            out = true;
+            return true;
+        }
+        if (m_end - m_pos >= 5 && memcmp(m_pos, "false", 5) == 0)
+        {
+            m_pos += 5;
+            out = false;
+            return true;
+        }
+        // what QJsonValue::toBool(false) did
+        out = false;
+        return skipValue(0);
+    }
 
-        AssetObject object;
+    bool skipValue(int depth)
+    {
+        if (depth > 64)
+        {
+            return fail("Nested too deep");
+        }
+        skipSpace();
+        if (m_pos == m_end)
+        {
+            return fail("Expected a value");
+        }
+        switch (*m_pos)
+        {
+            case '"':
+            {
+                QByteArray ignored;
+                return parseString(ignored);
+            }
+            case '{':
+            case '[':
+            {
+                char close = *m_pos == '{' ? '}' : ']';
+                bool isObject = *m_pos == '{';
+                m_pos++;
+                if (consume(close))
+                {
+                    return true;
+                }
+                do
+                {
+                    if (isObject)
+                    {
+                        QByteArray ignored;
+                        if (!parseString(ignored) || !expect(':'))
+                        {
+                            return fail("Expected a key");
+                        }
+                    }
+                    if (!skipValue(depth + 1))
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+                return expect(close) || fail("Unterminated object or array");
+            }
+            case 't':
+            case 'f':
+            {
+                bool ignored;
+                return parseBool(ignored);
+            }
+            case 'n':
+                if (m_end - m_pos >= 4 && memcmp(m_pos, "null", 4) == 0)
+                {
+                    m_pos += 4;
+                    return true;
+                }
+                return fail("Bad value");
+            default:
+            {
+                // not converted, so numbers of any size can be skipped
+                const char * start = m_pos;
+                while (m_pos < m_end && *m_pos && strchr("0123456789.eE+-", *m_pos) != nullptr)
+                {
+                    m_pos++;
+                }
+                if (m_pos == start || !std::any_of(start, m_pos, [](char c) { return c >= '0' && c <= '9'; }))
+                {
+                    return fail("Expected a number");
+                }
+                return true;
+            }
+        }
+    }
 
-        for (QVariantMap::const_iterator nested_iter = nested_objects.begin();
-             nested_iter != nested_objects.end(); ++nested_iter)
+    bool parseHash(quint8 * hash, bool & valid)
+    {
+        QByteArray hex;
+        if (!parseString(hex))
         {
-            // qDebug() << nested_iter.key() << nested_iter.value().toString();
-            QString key = nested_iter.key();
-            QVariant value = nested_iter.value();
+            return false;
+        }
+        valid = hex.size() == 40;
+        for (int i = 0; valid && i < 20; i++)
+        {
+            int high = hexValue(hex[2 * i]);
+            int low = hexValue(hex[2 * i + 1]);
+            valid = high >= 0 && low >= 0;
+            hash[i] = quint8((high << 4) | low);
+        }
+        return true;
+    }
 
-            if (key == "hash")
+    bool parseObjects()
+    {
+        if (!expect('{'))
+        {
+            return fail("Expected the objects to be an object");
+        }
+        if (consume('}'))
+        {
+            return true;
+        }
+        do
+        {
+            AssetObject object;
+            object.nameOffset = quint32(m_index.names.size());
+            if (!parseString(m_index.names) || !expect(':') || !expect('{'))
+            {
+                return fail("Expected an object");
+            }
+            object.nameLength = quint32(m_index.names.size()) - object.nameOffset;
+            bool hasHash = false;
+            if (!consume('}'))
+            {
+                do
+                {
+                    QByteArray key;
+                    if (!parseString(key) || !expect(':'))
+                    {
+                        return fail("Expected a key");
+                    }
+                    bool ok;
+                    if (key == "hash")
+                    {
+                        ok = parseHash(object.hash, hasHash);
+                    }
+                    else if (key == "size")
+                    {
+                        ok = parseNumber(object.size);
+                    }
+                    else
+                    {
+                        ok = skipValue(0);
+                    }
+                    if (!ok)
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+                if (!expect('}'))
+                {
+                    return fail("Expected the end of an object");
+                }
+            }
+            if (hasHash)
             {
-                object.hash = value.toString();
+                m_index.objects.append(object);
             }
-            else if (key == "size")
+            else
             {
-                object.size = value.toDouble();
+                qWarning() << "Asset" << QString::fromUtf8(m_index.names.constData() + object.nameOffset, object.nameLength)
+                           << "has no valid hash, ignoring it";
             }
+        } while (consume(','));
+        return expect('}') || fail("Expected the end of the objects");
+    }
+
+private:
+    const char * m_begin;
+    const char * m_pos;
+    const char * m_end;
+    AssetsIndex & m_index;
+    QString m_error;
+};
+
+struct NameLess
+{
+    const QByteArray & names;
+    bool operator()(const AssetObject & a, const AssetObject & b) const
+    {
+        return compare(a, names.constData() + b.nameOffset, b.nameLength) < 0;
+    }
+    int compare(const AssetObject & a, const char * name, quint32 length) const
+    {
+        int result = memcmp(names.constData() + a.nameOffset, name, qMin(a.nameLength, length));
+        if (result != 0)
+        {
+            return result;
         }
+        return a.nameLength < length ? -1 : (a.nameLength > length ? 1 : 0);
+    }
+};
+
+struct MemoizedIndex
+{
+    QString path;
+    qint64 size = -1;
+    qint64 lastModified = 0;
+    AssetsIndex::Ptr index;
+};
+
+// assetsId -> the last index loaded for it
+QMutex memoMutex;
+QHash<QString, MemoizedIndex> memo;
+}
+
+namespace AssetsUtils
+{
 
-        index.objects.insert(iter.key(), object);
+/*
+ * Returns true on success, with index populated
+ * index is undefined otherwise
+ */
+bool loadAssetsIndexJson(const QString &assetsId, const QString &path, AssetsIndex& index)
+{
+    QFile file(path);
+
+    // Try to open the file and fail if we can't.
+    // TODO: We should probably report this error to the user.
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qCritical() << "Failed to read assets index file" << path;
+        return false;
+    }
+    index.id = assetsId;
+
+    // the parser doesn't care where the bytes are, so avoid copying them if possible
+    QByteArray jsonData;
+    const char * data = nullptr;
+    qint64 size = file.size();
+    if (size > 0)
+    {
+        data = reinterpret_cast<const char *>(file.map(0, size));
     }
+    if (!data)
+    {
+        jsonData = file.readAll();
+        data = jsonData.constData();
+        size = jsonData.size();
+    }
+
+    // roughly 100 bytes of JSON per object, a third of that is the name
+    index.objects.reserve(int(size / 100));
+    index.names.reserve(int(size / 3));
+    IndexParser parser(data, size, index);
+    if (!parser.parse())
+    {
+        qCritical() << "Failed to parse assets index file:" << parser.error();
+        return false;
+    }
+    file.close();
 
+    // sorted by name for lookups. When a name is there more than once, the last one wins.
+    NameLess less{index.names};
+    std::stable_sort(index.objects.begin(), index.objects.end(), less);
+    auto last = std::unique(index.objects.rbegin(), index.objects.rend(), [&less, &index](const AssetObject & a, const AssetObject & b) -> bool
+    {
+        return less.compare(a, index.names.constData() + b.nameOffset, b.nameLength) == 0;
+    });
+    index.objects.erase(index.objects.begin(), last.base());
+    index.objects.squeeze();
+    index.names.squeeze();
     return true;
 }
 
+AssetsIndex::Ptr loadAssetsIndex(const QString &assetsId, const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.isFile())
+    {
+        return nullptr;
+    }
+    qint64 size = info.size();
+    qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&memoMutex);
+        auto iter = memo.find(assetsId);
+        if (iter != memo.end() && iter->path == path && iter->size == size && iter->lastModified == lastModified)
+        {
+            return iter->index;
+        }
+    }
+
+    std::shared_ptr<AssetsIndex> index(new AssetsIndex());
+    if (!loadAssetsIndexJson(assetsId, path, *index))
+    {
+        return nullptr;
+    }
+
+    QMutexLocker locker(&memoMutex);
+    MemoizedIndex & entry = memo[assetsId];
+    entry.path = path;
+    entry.size = size;
+    entry.lastModified = lastModified;
+    entry.index = index;
+    return index;
+}
+
 // FIXME: ugly code duplication
 QDir getAssetsDir(const QString &assetsId, const QString &resourcesFolder)
 {
@@ -179,25 +740,127 @@ QDir getAssetsDir(const QString &assetsId, const QString &resourcesFolder)
         return virtualRoot;
     }
 
-    AssetsIndex index;
-    if(!AssetsUtils::loadAssetsIndexJson(assetsId, indexPath, index))
+    auto index = loadAssetsIndex(assetsId, indexPath);
+    if(!index)
     {
         qCritical() << "Failed to load asset index file" << indexPath << "; can't determine assets path!";
         return virtualRoot;
     }
 
-    QString targetPath;
-    if(index.isVirtual)
+    if(index->isVirtual)
     {
         return virtualRoot;
     }
-    else if(index.mapToResources)
+    else if(index->mapToResources)
     {
         return QDir(resourcesFolder);
     }
     return virtualRoot;
 }
 
+bool materializeAssets(const AssetsIndex& index, const QString& objectDir, const QString& targetPath, bool removeLeftovers)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto previous = readManifest(targetPath);
+    bool haveManifest = !previous.isEmpty();
+    QHash<QString, ManifestEntry> current;
+    QList<MaterializeJob> jobs;
+    QSet<QString> folders;
+    for (auto & object : index.objects)
+    {
+        auto name = index.name(object);
+        ManifestEntry entry;
+        entry.hash = object.hashString();
+        entry.size = object.size;
+
+        QString target;
+        if (!resolveAssetPath(targetPath, name, target))
+        {
+            qWarning() << "Refusing to put asset" << name << "outside of" << targetPath;
+            continue;
+        }
+        // unchanged since the last time if it's still there. Files we didn't put there are kept if they look right.
+        auto old = previous.find(name);
+        if (old == previous.end() || old->hash == entry.hash)
+        {
+            QFileInfo info(target);
+            if (info.isFile() && info.size() == object.size)
+            {
+                current.insert(name, entry);
+                continue;
+            }
+        }
+
+        QString source = FS::PathCombine(objectDir, object.getRelPath());
+        if (!QFileInfo::exists(source))
+        {
+            continue;
+        }
+        jobs.append({source, target});
+        folders.insert(QFileInfo(target).path());
+        current.insert(name, entry);
+    }
+
+    for (auto & folder : folders)
+    {
+        FS::ensureFolderPathExists(folder);
+    }
+    auto results = QtConcurrent::blockingMapped<QList<bool>>(jobs, materializeFile);
+    int failed = 0;
+    for (int i = 0; i < results.size(); i++)
+    {
+        if (!results[i])
+        {
+            qWarning() << "Failed to put asset" << jobs[i].source << "at" << jobs[i].target;
+            failed++;
+        }
+    }
+
+    int removed = 0;
+    // things we put there before that are not part of the index anymore
+    for (auto iter = previous.begin(); iter != previous.end(); iter++)
+    {
+        QString target;
+        if (current.contains(iter.key()) || !resolveAssetPath(targetPath, iter.key(), target))
+        {
+            continue;
+        }
+        if (QFile::remove(target))
+        {
+            removed++;
+        }
+    }
+    // the first time, the folder can have anything in it
+    if (removeLeftovers && !haveManifest)
+    {
+        QDir root(targetPath);
+        QDirIterator iter(targetPath, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+        {
+            auto path = iter.next();
+            auto relative = root.relativeFilePath(path);
+            if (relative == manifestName || current.contains(relative))
+            {
+                continue;
+            }
+            if (QFile::remove(path))
+            {
+                removed++;
+            }
+        }
+    }
+
+    if (!jobs.isEmpty() || removed || current.size() != previous.size())
+    {
+        writeManifest(targetPath, current);
+    }
+    qDebug() << "Assets at" << targetPath << ":" << jobs.size() - failed << "placed," << failed << "failed,"
+             << removed << "removed," << current.size() - jobs.size() << "unchanged in" << timer.elapsed() << "ms";
+    return failed == 0;
+}
+
 // FIXME: ugly code duplication
 bool reconstructAssets(QString assetsId, QString resourcesFolder)
 {
@@ -218,8 +881,8 @@ bool reconstructAssets(QString assetsId, QString resourcesFolder)
 
     qDebug() << "reconstructAssets" << assetsDir.path() << indexDir.path() << objectDir.path() << virtualDir.path() << virtualRoot.path();
 
-    AssetsIndex index;
-    if(!AssetsUtils::loadAssetsIndexJson(assetsId, indexPath, index))
+    auto index = loadAssetsIndex(assetsId, indexPath);
+    if(!index)
     {
         qCritical() << "Failed to load asset index file" << indexPath << "; can't reconstruct assets!";
         return false;
@@ -227,13 +890,13 @@ bool reconstructAssets(QString assetsId, QString resourcesFolder)
 
     QString targetPath;
     bool removeLeftovers = false;
-    if(index.isVirtual)
+    if(index->isVirtual)
     {
         targetPath = virtualRoot.path();
         removeLeftovers = true;
         qDebug() << "Reconstructing virtual assets folder at" << targetPath;
     }
-    else if(index.mapToResources)
+    else if(index->mapToResources)
     {
         targetPath = resourcesFolder;
         qDebug() << "Reconstructing resources folder at" << targetPath;
@@ -241,85 +904,75 @@ bool reconstructAssets(QString assetsId, QString resourcesFolder)
 
     if (!targetPath.isNull())
     {
-        auto presentFiles = collectPathsFromDir(targetPath);
-        for (QString map : index.objects.keys())
-        {
-            AssetObject asset_object = index.objects.value(map);
-            QString target_path = FS::PathCombine(targetPath, map);
-            QFile target(target_path);
-
-            QString tlk = asset_object.hash.left(2);
-
-            QString original_path = FS::PathCombine(objectDir.path(), tlk, asset_object.hash);
-            QFile original(original_path);
-            if (!original.exists())
-                continue;
-
-            presentFiles.remove(target_path);
-
-            if (!target.exists())
-            {
-                QFileInfo info(target_path);
-                QDir target_dir = info.dir();
-
-                qDebug() << target_dir.path();
-                FS::ensureFolderPathExists(target_dir.path());
-
-                bool couldCopy = original.copy(target_path);
-                qDebug() << " Copying" << original_path << "to" << target_path << QString::number(couldCopy);
-            }
-        }
-
-        // TODO: Write last used time to virtualRoot/.lastused
-        if(removeLeftovers)
-        {
-            for(auto & file: presentFiles)
-            {
-                qDebug() << "Would remove" << file;
-            }
-        }
+        return materializeAssets(*index, objectDir.path(), targetPath, removeLeftovers);
     }
     return true;
 }
 
 }
 
-NetActionPtr AssetObject::getDownloadAction()
+NetActionPtr AssetObject::getDownloadAction() const
 {
     QFileInfo objectFile(getLocalPath());
     if ((!objectFile.isFile()) || (objectFile.size() != size))
     {
-        auto objectDL = Net::Download::makeFile(getUrl(), objectFile.filePath());
-        if(hash.size())
-        {
-            auto rawHash = QByteArray::fromHex(hash.toLatin1());
-            objectDL->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, rawHash));
-        }
+        // objects are missing or broken at this point, so there is nothing to keep safe from a failed download
+        auto objectDL = Net::Download::makeFile(getUrl(), objectFile.filePath(), Net::Download::Option::WriteDirectly | Net::Download::Option::StoreContent);
+        auto rawHash = QByteArray(reinterpret_cast<const char *>(hash), sizeof(hash));
+        objectDL->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, rawHash));
         objectDL->m_total_progress = size;
         return objectDL;
     }
     return nullptr;
 }
 
-QString AssetObject::getLocalPath()
+QString AssetObject::hashString() const
+{
+    return QString::fromLatin1(QByteArray::fromRawData(reinterpret_cast<const char *>(hash), sizeof(hash)).toHex());
+}
+
+QString AssetObject::getLocalPath() const
 {
     return "assets/objects/" + getRelPath();
 }
 
-QUrl AssetObject::getUrl()
+QUrl AssetObject::getUrl() const
 {
     return BuildConfig.RESOURCE_BASE + getRelPath();
 }
 
-QString AssetObject::getRelPath()
+QString AssetObject::getRelPath() const
 {
-    return hash.left(2) + "/" + hash;
+    auto hex = hashString();
+    return hex.left(2) + "/" + hex;
+}
+
+QString AssetsIndex::name(const AssetObject& object) const
+{
+    return QString::fromUtf8(names.constData() + object.nameOffset, object.nameLength);
+}
+
+const AssetObject * AssetsIndex::find(const QString& name) const
+{
+    auto utf8 = name.toUtf8();
+    NameLess less{names};
+    auto iter = std::lower_bound(objects.begin(), objects.end(), utf8, [&less](const AssetObject & object, const QByteArray & key) -> bool
+    {
+        return less.compare(object, key.constData(), quint32(key.size())) < 0;
+    });
+    if (iter == objects.end() || less.compare(*iter, utf8.constData(), quint32(utf8.size())) != 0)
+    {
+        return nullptr;
+    }
+    return &*iter;
 }
 
-NetJobPtr AssetsIndex::getDownloadJob()
+NetJobPtr AssetsIndex::getDownloadJob() const
 {
     auto job = new NetJob(QObject::tr("Assets for %1").arg(id));
-    for (auto &object : objects.values())
+    // thousands of small objects - don't let them starve the libraries
+    job->setPriority(Net::Priority::Background);
+    for (auto &object : objects)
     {
         auto dl = object.getDownloadAction();
         if(dl)
@@ -16,27 +16,45 @@
 #pragma once
 
 #include <QString>
-#include <QMap>
+#include <QVector>
+#include <memory>
 #include "net/NetAction.h"
 #include "net/NetJob.h"
 
 struct AssetObject
 {
-    QString getRelPath();
-    QUrl getUrl();
-    QString getLocalPath();
-    NetActionPtr getDownloadAction();
+    QString getRelPath() const;
+    QUrl getUrl() const;
+    QString getLocalPath() const;
+    NetActionPtr getDownloadAction() const;
+    /// the hash as 40 hex digits
+    QString hashString() const;
 
-    QString hash;
-    qint64 size;
+    /// raw SHA1 of the object
+    quint8 hash[20] = {};
+    qint64 size = 0;
+    /// where the name is in AssetsIndex::names
+    quint32 nameOffset = 0;
+    quint32 nameLength = 0;
 };
 
+/**
+ * A parsed asset index. Objects are kept in one flat array sorted by name, the names are stored back to back
+ * in one UTF-8 buffer. Indexes have thousands of objects and are read often, this keeps them small and quick to walk.
+ */
 struct AssetsIndex
 {
-    NetJobPtr getDownloadJob();
+    typedef std::shared_ptr<const AssetsIndex> Ptr;
+
+    NetJobPtr getDownloadJob() const;
+    /// the path of the object in the virtual assets folder
+    QString name(const AssetObject & object) const;
+    /// the object with the given path or null
+    const AssetObject * find(const QString & name) const;
 
     QString id;
-    QMap<QString, AssetObject> objects;
+    QVector<AssetObject> objects;
+    QByteArray names;
     bool isVirtual = false;
     bool mapToResources = false;
 };
@@ -44,10 +62,21 @@ struct AssetsIndex
 /// FIXME: this is absolutely horrendous. REDO!!!!
 namespace AssetsUtils
 {
+/// Parse the index file. Returns true on success, with index populated
 bool loadAssetsIndexJson(const QString &id, const QString &file, AssetsIndex& index);
 
+/// The parsed index file, shared by everyone asking for it until the file changes. null if it can't be loaded.
+AssetsIndex::Ptr loadAssetsIndex(const QString &id, const QString &file);
+
 QDir getAssetsDir(const QString &assetsId, const QString &resourcesFolder);
 
+/**
+ * Put the objects of the index in targetPath, under their names. Objects are linked from objectDir where possible.
+ * What was put there is remembered in a manifest, so doing it again for an unchanged index only checks the files.
+ * Files from a previous index that aren't in this one are removed. With removeLeftovers, so is anything else.
+ */
+bool materializeAssets(const AssetsIndex& index, const QString& objectDir, const QString& targetPath, bool removeLeftovers);
+
 /// Reconstruct a virtual assets folder for the given assets ID and return the folder
 bool reconstructAssets(QString assetsId, QString resourcesFolder);
 }
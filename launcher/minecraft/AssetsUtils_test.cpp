@@ -0,0 +1,272 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include "TestUtil.h"
+
+#include "minecraft/AssetsUtils.h"
+#include "FileSystem.h"
+
+class AssetsUtilsTest : public QObject
+{
+    Q_OBJECT
+
+    QString nameFor(int i)
+    {
+        return QString("sounds/group%1/sound%2.ogg").arg(i % 50).arg(i);
+    }
+
+    // a legacy (virtual) index with count objects, stored in <root>/assets like the launcher does
+    void writeLegacyAssets(const QString & root, const QString & id, int count, int size)
+    {
+        QJsonObject objects;
+        for(int i = 0; i < count; i++)
+        {
+            QByteArray data(size, char('a' + i % 26));
+            data.append(QByteArray::number(i));
+            QString hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+            FS::write(FS::PathCombine(root, "assets", "objects", hash.left(2), hash), data);
+
+            QJsonObject object;
+            object.insert("hash", hash);
+            object.insert("size", data.size());
+            objects.insert(nameFor(i), object);
+        }
+        QJsonObject index;
+        index.insert("virtual", true);
+        index.insert("objects", objects);
+        FS::write(FS::PathCombine(root, "assets", "indexes", id + ".json"), QJsonDocument(index).toJson());
+    }
+
+    AssetsIndex loadIndex(const QString & root, const QString & id)
+    {
+        AssetsIndex index;
+        AssetsUtils::loadAssetsIndexJson(id, FS::PathCombine(root, "assets", "indexes", id + ".json"), index);
+        return index;
+    }
+
+    // the index as the launcher used to read it, for comparison
+    int loadWithDocument(const QString & file)
+    {
+        QFile input(file);
+        input.open(QIODevice::ReadOnly);
+        auto objects = QJsonDocument::fromJson(input.readAll()).object().value("objects").toVariant().toMap();
+        int count = 0;
+        for(auto iter = objects.begin(); iter != objects.end(); iter++)
+        {
+            auto nested = iter.value().toMap();
+            count += nested.value("hash").toString().size() == 40 && nested.value("size").toDouble() > 0;
+        }
+        return count;
+    }
+
+private
+slots:
+    void test_parse()
+    {
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "index.json");
+        FS::write(file, R"({
+            "unknown": [1, 2.5e3, {"a": null}, "\"}", 99999999999999999999],
+            "map_to_resources": true,
+            "objects": {
+                "b/second.ogg": {"size": 20, "hash": "BDF48EF6B5D0D23BBB02E17D04865216179F510A", "extra": {}},
+                "a/first \"quoted\" \u00e9\ud83d\ude00.ogg": {"hash": "0000000000000000000000000000000000000001", "size": 1.0e1},
+                "b/second.ogg": {"hash": "bdf48ef6b5d0d23bbb02e17d04865216179f510b", "size": 30},
+                "no hash.ogg": {"size": 5}
+            }
+        })");
+
+        AssetsIndex index;
+        QVERIFY(AssetsUtils::loadAssetsIndexJson("test", file, index));
+        QCOMPARE(index.id, QString("test"));
+        QVERIFY(!index.isVirtual);
+        QVERIFY(index.mapToResources);
+        // sorted, without the broken one, and the last duplicate wins
+        QCOMPARE(index.objects.size(), 2);
+        QCOMPARE(index.name(index.objects[0]), QString::fromUtf8("a/first \"quoted\" \xc3\xa9\xf0\x9f\x98\x80.ogg"));
+        QCOMPARE(index.objects[0].size, qint64(10));
+        QCOMPARE(index.objects[0].getRelPath(), QString("00/0000000000000000000000000000000000000001"));
+        auto second = index.find("b/second.ogg");
+        QVERIFY(second);
+        QCOMPARE(second->size, qint64(30));
+        QCOMPARE(second->hashString(), QString("bdf48ef6b5d0d23bbb02e17d04865216179f510b"));
+        QVERIFY(!index.find("no hash.ogg"));
+        QVERIFY(!index.find("b/second"));
+
+        FS::write(file, R"({"objects": {"a": {"hash": "00")");
+        AssetsIndex broken;
+        QVERIFY(!AssetsUtils::loadAssetsIndexJson("test", file, broken));
+
+        // sizes that don't fit
+        FS::write(file, R"({"objects": {"a": {"hash": "0000000000000000000000000000000000000001", "size": 99999999999999999999}}})");
+        AssetsIndex overflowing;
+        QVERIFY(!AssetsUtils::loadAssetsIndexJson("test", file, overflowing));
+        FS::write(file, R"({"objects": {"a": {"hash": "0000000000000000000000000000000000000001", "size": 1e30}}})");
+        QVERIFY(!AssetsUtils::loadAssetsIndexJson("test", file, overflowing));
+    }
+
+    void test_memoize()
+    {
+        QTemporaryDir dir;
+        writeLegacyAssets(dir.path(), "memo", 10, 10);
+        auto file = FS::PathCombine(dir.path(), "assets", "indexes", "memo.json");
+        auto first = AssetsUtils::loadAssetsIndex("memo", file);
+        QVERIFY(first);
+        QCOMPARE(first->objects.size(), 10);
+        QCOMPARE(AssetsUtils::loadAssetsIndex("memo", file), first);
+
+        // a new file is read again
+        writeLegacyAssets(dir.path(), "memo", 20, 10);
+        auto second = AssetsUtils::loadAssetsIndex("memo", file);
+        QVERIFY(second != first);
+        QCOMPARE(second->objects.size(), 20);
+    }
+
+    void benchmark_parse_data()
+    {
+        QTest::addColumn<bool>("streaming");
+        // peak RSS only goes up, so the one expected to use less goes first
+        QTest::newRow("streaming") << true;
+        QTest::newRow("QJsonDocument") << false;
+    }
+
+    // an index the size of the current ones
+    void benchmark_parse()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, streaming);
+        QTemporaryDir dir;
+        writeLegacyAssets(dir.path(), "large", 5000, 1);
+        auto file = FS::PathCombine(dir.path(), "assets", "indexes", "large.json");
+
+        QBENCHMARK
+        {
+            if(streaming)
+            {
+                AssetsIndex index;
+                QVERIFY(AssetsUtils::loadAssetsIndexJson("large", file, index));
+                QCOMPARE(index.objects.size(), 5000);
+            }
+            else
+            {
+                QCOMPARE(loadWithDocument(file), 5000);
+            }
+        }
+    }
+
+    void test_materialize()
+    {
+        QTemporaryDir dir;
+        writeLegacyAssets(dir.path(), "legacy", 100, 100);
+        auto index = loadIndex(dir.path(), "legacy");
+        auto objects = FS::PathCombine(dir.path(), "assets", "objects");
+        auto target = FS::PathCombine(dir.path(), "virtual");
+
+        // something that doesn't belong there
+        FS::write(FS::PathCombine(target, "stray", "file.txt"), "stray");
+
+        QVERIFY(AssetsUtils::materializeAssets(index, objects, target, true));
+        for(int i = 0; i < 100; i++)
+        {
+            auto object = index.find(nameFor(i));
+            QVERIFY(object);
+            QCOMPARE(QFileInfo(FS::PathCombine(target, nameFor(i))).size(), object->size);
+            // copies of their own, changing them can't break the objects
+            QCOMPARE(FS::linkCount(FS::PathCombine(target, nameFor(i))), 1);
+        }
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "stray", "file.txt")));
+
+        // nothing changed, nothing is touched
+        auto manifest = FS::PathCombine(target, ".assets-manifest");
+        auto manifestTime = QFileInfo(manifest).lastModified();
+        auto identity = FS::fileIdentity(FS::PathCombine(target, nameFor(7)));
+        QVERIFY(AssetsUtils::materializeAssets(index, objects, target, true));
+        QCOMPARE(QFileInfo(manifest).lastModified(), manifestTime);
+        QCOMPARE(FS::fileIdentity(FS::PathCombine(target, nameFor(7))), identity);
+
+        // a deleted file comes back
+        QVERIFY(QFile::remove(FS::PathCombine(target, nameFor(3))));
+        QVERIFY(AssetsUtils::materializeAssets(index, objects, target, true));
+        QVERIFY(QFile::exists(FS::PathCombine(target, nameFor(3))));
+
+        // files that are not in the index anymore go away
+        index.objects.remove(int(index.find(nameFor(5)) - index.objects.constData()));
+        QVERIFY(AssetsUtils::materializeAssets(index, objects, target, false));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, nameFor(5))));
+        QVERIFY(QFile::exists(FS::PathCombine(target, nameFor(6))));
+    }
+
+    void test_materializeOutside()
+    {
+        QTemporaryDir dir;
+        QByteArray data("evil");
+        QString hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+        auto objects = FS::PathCombine(dir.path(), "assets", "objects");
+        FS::write(FS::PathCombine(objects, hash.left(2), hash), data);
+        QJsonObject object;
+        object.insert("hash", hash);
+        object.insert("size", data.size());
+        QJsonObject entries;
+        entries.insert("../outside.txt", object);
+        entries.insert("inside/../../outside2.txt", object);
+        entries.insert("fine.txt", object);
+        QJsonObject json;
+        json.insert("virtual", true);
+        json.insert("objects", entries);
+        FS::write(FS::PathCombine(dir.path(), "assets", "indexes", "evil.json"), QJsonDocument(json).toJson());
+        auto index = loadIndex(dir.path(), "evil");
+        QCOMPARE(index.objects.size(), 3);
+
+        auto target = FS::PathCombine(dir.path(), "virtual");
+        // a manifest that claims a file outside of the target was put there before
+        auto victim = FS::PathCombine(dir.path(), "victim.txt");
+        FS::write(victim, "keep me");
+        FS::write(FS::PathCombine(target, ".assets-manifest"), QString("%1\t4\t../victim.txt\n").arg(hash).toUtf8());
+
+        QVERIFY(AssetsUtils::materializeAssets(index, objects, target, true));
+        QCOMPARE(FS::read(FS::PathCombine(target, "fine.txt")), data);
+        QVERIFY(!QFile::exists(FS::PathCombine(dir.path(), "outside.txt")));
+        QVERIFY(!QFile::exists(FS::PathCombine(dir.path(), "outside2.txt")));
+        QCOMPARE(FS::read(victim), QByteArray("keep me"));
+    }
+
+    void benchmark_reconstruct_data()
+    {
+        QTest::addColumn<bool>("unchanged");
+        QTest::newRow("first launch") << false;
+        QTest::newRow("unchanged") << true;
+    }
+
+    // what the ReconstructAssets launch step does for a legacy index the size of the 1.6 one
+    void benchmark_reconstruct()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, unchanged);
+        QTemporaryDir dir;
+        writeLegacyAssets(dir.path(), "legacy", 3000, 20000);
+        auto oldCurrent = QDir::currentPath();
+        QDir::setCurrent(dir.path());
+        auto virtualRoot = FS::PathCombine(dir.path(), "assets", "virtual", "legacy");
+        if(unchanged)
+        {
+            QVERIFY(AssetsUtils::reconstructAssets("legacy", QString()));
+        }
+
+        QBENCHMARK
+        {
+            if(!unchanged)
+            {
+                QVERIFY(FS::deletePath(virtualRoot));
+            }
+            QVERIFY(AssetsUtils::reconstructAssets("legacy", QString()));
+        }
+        QVERIFY(QFile::exists(FS::PathCombine(virtualRoot, nameFor(2999))));
+        QDir::setCurrent(oldCurrent);
+    }
+};
+
+QTEST_GUILESS_MAIN(AssetsUtilsTest)
+
+#include "AssetsUtils_test.moc"
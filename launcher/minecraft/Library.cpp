@@ -92,7 +92,8 @@ QList< std::shared_ptr< NetAction > > Library::getDownloads(
         if(sha1.size())
         {
             auto rawSha1 = QByteArray::fromHex(sha1.toLatin1());
-            auto dl = Net::Download::makeCached(url, entry, options);
+            // libraries are only ever replaced as a whole, so they can share their data with the content store
+            auto dl = Net::Download::makeCached(url, entry, options | Net::Download::Option::StoreContent);
             dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, rawSha1));
             qDebug() << "Checksummed Download for:" << rawName().serialize() << "storage:" << storage << "url:" << url;
             out.append(dl);
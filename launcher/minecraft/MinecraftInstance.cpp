@@ -120,6 +120,9 @@ MinecraftInstance::MinecraftInstance(SettingsObjectPtr globalSettings, SettingsO
     m_settings->registerSetting("JoinServerOnLaunch", false);
     m_settings->registerSetting("JoinServerOnLaunchAddress", "");
 
+    // Extra log level rules, one LEVEL=regex per line
+    m_settings->registerSetting("LogLevelRules", "");
+
     // DEPRECATED: Read what versions the user configuration thinks should be used
     m_settings->registerSetting({"IntendedVersion", "MinecraftVersion"}, "");
     m_settings->registerSetting("LWJGLVersion", "");
@@ -705,51 +708,15 @@ QMap<QString, QString> MinecraftInstance::createCensorFilterFromSession(AuthSess
     return filter;
 }
 
-MessageLevel::Enum MinecraftInstance::guessLevel(const QString &line, MessageLevel::Enum level)
+LogClassifier::Config MinecraftInstance::logClassifierConfig()
 {
-    QRegularExpression re("\\[(?<timestamp>[0-9:]+)\\] \\[[^/]+/(?<level>[^\\]]+)\\]");
-    auto match = re.match(line);
-    if(match.hasMatch())
-    {
-        // New style logs from log4j
-        QString timestamp = match.captured("timestamp");
-        QString levelStr = match.captured("level");
-        if(levelStr == "INFO")
-            level = MessageLevel::Message;
-        if(levelStr == "WARN")
-            level = MessageLevel::Warning;
-        if(levelStr == "ERROR")
-            level = MessageLevel::Error;
-        if(levelStr == "FATAL")
-            level = MessageLevel::Fatal;
-        if(levelStr == "TRACE" || levelStr == "DEBUG")
-            level = MessageLevel::Debug;
-    }
-    else
-    {
-        // Old style forge logs
-        if (line.contains("[INFO]") || line.contains("[CONFIG]") || line.contains("[FINE]") ||
-            line.contains("[FINER]") || line.contains("[FINEST]"))
-            level = MessageLevel::Message;
-        if (line.contains("[SEVERE]") || line.contains("[STDERR]"))
-            level = MessageLevel::Error;
-        if (line.contains("[WARNING]"))
-            level = MessageLevel::Warning;
-        if (line.contains("[DEBUG]"))
-            level = MessageLevel::Debug;
-    }
-    if (line.contains("overwriting existing"))
-        return MessageLevel::Fatal;
-    //NOTE: this diverges from the real regexp. no unicode, the first section is + instead of *
-    static const QString javaSymbol = "([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$][a-zA-Z\\d_$]*";
-    if (line.contains("Exception in thread")
-        || line.contains(QRegularExpression("\\s+at " + javaSymbol))
-        || line.contains(QRegularExpression("Caused by: " + javaSymbol))
-        || line.contains(QRegularExpression("([a-zA-Z_$][a-zA-Z\\d_$]*\\.)+[a-zA-Z_$]?[a-zA-Z\\d_$]*(Exception|Error|Throwable)"))
-        || line.contains(QRegularExpression("... \\d+ more$"))
-        )
-        return MessageLevel::Error;
-    return level;
+    LogClassifier::Config config;
+    config.log4j = true;
+    config.legacyForge = true;
+    config.javaExceptions = true;
+    config.fatalMarkers = QStringList{"overwriting existing"};
+    config.rules = LogClassifier::parseRules(settings()->get("LogLevelRules").toString());
+    return config;
 }
 
 IPathMatcher::Ptr MinecraftInstance::getLogFileMatcher()
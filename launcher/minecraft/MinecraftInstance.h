@@ -92,8 +92,8 @@ public:
     /// create an environment for launching processes
     QProcessEnvironment createEnvironment() override;
 
-    /// guess log level from a line of minecraft log
-    MessageLevel::Enum guessLevel(const QString &line, MessageLevel::Enum level) override;
+    /// how to guess log levels from lines of minecraft log
+    LogClassifier::Config logClassifierConfig() override;
 
     IPathMatcher::Ptr getLogFileMatcher() override;
 
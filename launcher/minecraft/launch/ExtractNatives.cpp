@@ -14,64 +14,13 @@
  */
 
 #include "ExtractNatives.h"
+#include "NativesCache.h"
 #include <minecraft/MinecraftInstance.h>
 #include <launch/LaunchTask.h>
 
-#include <quazip.h>
-#include <quazipdir.h>
-#include "MMCZip.h"
 #include "FileSystem.h"
 #include <QDir>
-
-static QString replaceSuffix (QString target, const QString &suffix, const QString &replacement)
-{
-    if (!target.endsWith(suffix))
-    {
-        return target;
-    }
-    target.resize(target.length() - suffix.length());
-    return target + replacement;
-}
-
-static bool unzipNatives(QString source, QString targetFolder, bool applyJnilibHack, bool nativeOpenAL, bool nativeGLFW)
-{
-    QuaZip zip(source);
-    if(!zip.open(QuaZip::mdUnzip))
-    {
-        return false;
-    }
-    QDir directory(targetFolder);
-    if (!zip.goToFirstFile())
-    {
-        return false;
-    }
-    do
-    {
-        QString name = zip.getCurrentFileName();
-        auto lowercase = name.toLower();
-        if (nativeGLFW && name.contains("glfw")) {
-            continue;
-        }
-        if (nativeOpenAL && name.contains("openal")) {
-            continue;
-        }
-        if(applyJnilibHack)
-        {
-            name = replaceSuffix(name, ".jnilib", ".dylib");
-        }
-        QString absFilePath = directory.absoluteFilePath(name);
-        if (!JlCompress::extractFile(&zip, "", absFilePath))
-        {
-            return false;
-        }
-    } while (zip.goToNextFile());
-    zip.close();
-    if(zip.getZipError()!=0)
-    {
-        return false;
-    }
-    return true;
-}
+#include <QtConcurrent>
 
 void ExtractNatives::executeTask()
 {
@@ -84,22 +33,37 @@ void ExtractNatives::executeTask()
         return;
     }
     auto settings = minecraftInstance->settings();
-    bool nativeOpenAL = settings->get("UseNativeOpenAL").toBool();
-    bool nativeGLFW = settings->get("UseNativeGLFW").toBool();
+    NativesCache::Options options;
+    options.skipOpenAL = settings->get("UseNativeOpenAL").toBool();
+    options.skipGLFW = settings->get("UseNativeGLFW").toBool();
 
     auto outputPath  = minecraftInstance->getNativePath();
     auto javaVersion = minecraftInstance->getJavaVersion();
-    bool jniHackEnabled = javaVersion.major() >= 8;
-    for(const auto &source: toExtract)
+    options.jnilibHack = javaVersion.major() >= 8;
+
+    // natives are extracted once into the cache and only linked into the instance on later launches
+    connect(&m_watcher, &QFutureWatcher<QString>::finished, this, [this, outputPath]()
     {
-        if(!unzipNatives(source, outputPath, jniHackEnabled, nativeOpenAL, nativeGLFW))
+        auto failedJar = m_watcher.result();
+        if(!failedJar.isEmpty())
         {
             const char *reason = QT_TR_NOOP("Couldn't extract native jar '%1' to destination '%2'");
-            emit logLine(QString(reason).arg(source, outputPath), MessageLevel::Fatal);
-            emitFailed(tr(reason).arg(source, outputPath));
+            emit logLine(QString(reason).arg(failedJar, outputPath), MessageLevel::Fatal);
+            emitFailed(tr(reason).arg(failedJar, outputPath));
+            return;
         }
-    }
-    emitSucceeded();
+        emitSucceeded();
+    });
+    m_watcher.setFuture(QtConcurrent::run([toExtract, options, outputPath]() -> QString
+    {
+        NativesCache cache(QDir("cache/natives").absolutePath());
+        QString failedJar;
+        if(!cache.materialize(toExtract, options, outputPath, failedJar))
+        {
+            return failedJar;
+        }
+        return QString();
+    }));
 }
 
 void ExtractNatives::finalize()
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <launch/LaunchStep.h>
+#include <QFutureWatcher>
 #include <memory>
 #include "minecraft/auth/AuthSession.h"
 
@@ -33,6 +34,10 @@ public:
         return false;
     }
     void finalize() override;
+
+private:
+    // the jar that failed to extract, empty on success
+    QFutureWatcher<QString> m_watcher;
 };
 
 
@@ -21,6 +21,8 @@
 #include "minecraft/MinecraftInstance.h"
 #include "minecraft/PackProfile.h"
 
+#include <QDebug>
+
 void ModMinecraftJar::executeTask()
 {
     auto m_inst = std::dynamic_pointer_cast<MinecraftInstance>(m_parent->instance());
@@ -34,12 +36,14 @@ void ModMinecraftJar::executeTask()
     if(!FS::ensureFolderPathExists(m_inst->binRoot()))
     {
         emitFailed(tr("Couldn't create the bin folder for Minecraft.jar"));
+        return;
     }
 
     auto finalJarPath = QDir(m_inst->binRoot()).absoluteFilePath("minecraft.jar");
     if(!removeJar())
     {
         emitFailed(tr("Couldn't remove stale jar file: %1").arg(finalJarPath));
+        return;
     }
 
     // create temporary modded jar, if needed
@@ -52,7 +56,7 @@ void ModMinecraftJar::executeTask()
         QStringList jars, temp1, temp2, temp3, temp4;
         mainJar->getApplicableFiles(currentSystem, jars, temp1, temp2, temp3, m_inst->getLocalLibraryPath());
         auto sourceJarPath = jars[0];
-        if(!MMCZip::createModdedJar(sourceJarPath, finalJarPath, jarMods))
+        if(!makeJar(sourceJarPath, finalJarPath, jarMods))
         {
             emitFailed(tr("Failed to create the custom Minecraft jar file."));
             return;
@@ -61,6 +65,54 @@ void ModMinecraftJar::executeTask()
     emitSucceeded();
 }
 
+bool ModMinecraftJar::makeJar(const QString& sourceJarPath, const QString& finalJarPath, const QList<Mod>& jarMods)
+{
+    // the same inputs make the same jar, so keep the last few around instead of building them on every launch
+    auto key = MMCZip::moddedJarKey(sourceJarPath, jarMods);
+    if(key.isEmpty())
+    {
+        return MMCZip::createModdedJar(sourceJarPath, finalJarPath, jarMods);
+    }
+    QDir cacheDir("cache/jars");
+    auto cachedJarPath = cacheDir.absoluteFilePath(QString::fromLatin1(key.toHex()) + ".jar");
+    if(QFile::exists(cachedJarPath))
+    {
+        emit logLine(tr("Using the cached custom Minecraft jar."), MessageLevel::Launcher);
+        // remember it was used, pruning keeps the most recently used ones
+        if(!FS::updateTimestamp(cachedJarPath))
+        {
+            qWarning() << "Couldn't update the timestamp of" << cachedJarPath << ", it may be pruned early";
+        }
+    }
+    else
+    {
+        auto tempPath = cachedJarPath + ".part";
+        if(!FS::ensureFilePathExists(tempPath) || !MMCZip::createModdedJar(sourceJarPath, tempPath, jarMods))
+        {
+            return false;
+        }
+        QFile::remove(cachedJarPath);
+        if(!QFile::rename(tempPath, cachedJarPath))
+        {
+            QFile::remove(tempPath);
+            return MMCZip::createModdedJar(sourceJarPath, finalJarPath, jarMods);
+        }
+        pruneCache(cacheDir);
+    }
+    // the cached jar is never modified, the instance can share it
+    return FS::shareFile(cachedJarPath, finalJarPath);
+}
+
+void ModMinecraftJar::pruneCache(const QDir& cacheDir)
+{
+    const int keep = 10;
+    auto jars = cacheDir.entryInfoList({"*.jar"}, QDir::Files, QDir::Time);
+    for(int i = keep; i < jars.size(); i++)
+    {
+        QFile::remove(jars[i].absoluteFilePath());
+    }
+}
+
 void ModMinecraftJar::finalize()
 {
     removeJar();
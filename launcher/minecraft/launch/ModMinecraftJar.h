@@ -16,8 +16,11 @@
 #pragma once
 
 #include <launch/LaunchStep.h>
+#include <QDir>
 #include <memory>
 
+#include "minecraft/mod/Mod.h"
+
 class ModMinecraftJar: public LaunchStep
 {
     Q_OBJECT
@@ -33,4 +36,8 @@ public:
     void finalize() override;
 private:
     bool removeJar();
+    /// make the jar at finalJarPath, from the cache if possible
+    bool makeJar(const QString & sourceJarPath, const QString & finalJarPath, const QList<Mod> & jarMods);
+    /// drop the least recently used jars from the cache
+    void pruneCache(const QDir & cacheDir);
 };
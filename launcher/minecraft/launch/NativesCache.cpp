@@ -0,0 +1,213 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NativesCache.h"
+#include "FileSystem.h"
+
+#include <quazip.h>
+#include <JlCompress.h>
+#include <QDir>
+#include <QFile>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QUuid>
+#include <QtConcurrent>
+#include <QDebug>
+
+namespace {
+// entries no launch used for this long are removed
+const int unusedDays = 30;
+// the time of the last use. Directories can't have their times set everywhere (_wutime64 refuses them).
+const char * usedMarker = ".last-used";
+
+bool markUsed(const QString & entry)
+{
+    auto marker = FS::PathCombine(entry, usedMarker);
+    if (FS::updateTimestamp(marker))
+    {
+        return true;
+    }
+    QFile file(marker);
+    return file.open(QIODevice::WriteOnly);
+}
+
+QString replaceSuffix (QString target, const QString &suffix, const QString &replacement)
+{
+    if (!target.endsWith(suffix))
+    {
+        return target;
+    }
+    target.resize(target.length() - suffix.length());
+    return target + replacement;
+}
+}
+
+NativesCache::NativesCache(const QString& root) : m_root(root)
+{
+}
+
+bool NativesCache::extract(const QString& jar, const QString& targetFolder, const Options& options)
+{
+    QuaZip zip(jar);
+    if(!zip.open(QuaZip::mdUnzip))
+    {
+        return false;
+    }
+    QDir directory(targetFolder);
+    if (!zip.goToFirstFile())
+    {
+        return false;
+    }
+    do
+    {
+        QString name = zip.getCurrentFileName();
+        if (options.skipGLFW && name.contains("glfw")) {
+            continue;
+        }
+        if (options.skipOpenAL && name.contains("openal")) {
+            continue;
+        }
+        if(options.jnilibHack)
+        {
+            name = replaceSuffix(name, ".jnilib", ".dylib");
+        }
+        QString absFilePath = directory.absoluteFilePath(name);
+        if (!JlCompress::extractFile(&zip, "", absFilePath))
+        {
+            return false;
+        }
+    } while (zip.goToNextFile());
+    zip.close();
+    if(zip.getZipError()!=0)
+    {
+        return false;
+    }
+    return true;
+}
+
+QString NativesCache::entryPath(const QByteArray& sha1, const Options& options) const
+{
+    QString flags = QString("%1%2%3").arg(options.jnilibHack ? 'j' : '-').arg(options.skipOpenAL ? 'o' : '-').arg(options.skipGLFW ? 'g' : '-');
+    return FS::PathCombine(m_root, QString::fromLatin1(sha1.toHex()) + "-" + flags);
+}
+
+QString NativesCache::ensureEntry(const QString& jar, const Options& options) const
+{
+    auto sha1 = FS::hashFile(jar, QCryptographicHash::Sha1);
+    if (sha1.isEmpty())
+    {
+        return QString();
+    }
+    auto entry = entryPath(sha1, options);
+    if (QFileInfo(entry).isDir())
+    {
+        // remember it was used, for pruning
+        if (!markUsed(entry))
+        {
+            qWarning() << "Couldn't mark natives cache entry" << entry << "as used";
+        }
+        return entry;
+    }
+
+    // extract next to it and move it in place when complete, so a half extracted entry is never used
+    auto temp = entry + ".part-" + QUuid::createUuid().toString().mid(1, 8);
+    if (!FS::ensureFolderPathExists(temp) || !extract(jar, temp, options) || !markUsed(temp))
+    {
+        FS::deletePath(temp);
+        return QString();
+    }
+    if (!QDir().rename(temp, entry))
+    {
+        // someone else was faster
+        FS::deletePath(temp);
+        if (!QFileInfo(entry).isDir())
+        {
+            return QString();
+        }
+    }
+    return entry;
+}
+
+struct NativesCache::EnsureEntry
+{
+    typedef QString result_type;
+
+    const NativesCache * cache;
+    Options options;
+
+    QString operator()(const QString & jar) const
+    {
+        return cache->ensureEntry(jar, options);
+    }
+};
+
+bool NativesCache::materialize(const QStringList& jars, const Options& options, const QString& target, QString& failedJar)
+{
+    auto entries = QtConcurrent::blockingMapped<QStringList>(jars, EnsureEntry{this, options});
+
+    for (int i = 0; i < jars.size(); i++)
+    {
+        if (entries[i].isEmpty())
+        {
+            failedJar = jars[i];
+            return false;
+        }
+        QDir entryDir(entries[i]);
+        QDirIterator iter(entries[i], QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+        {
+            auto source = iter.next();
+            auto relative = entryDir.relativeFilePath(source);
+            if (relative == usedMarker)
+            {
+                continue;
+            }
+            auto destination = FS::PathCombine(target, relative);
+            QFile::remove(destination);
+            if (!FS::ensureFilePathExists(destination) || !FS::shareFile(source, destination))
+            {
+                failedJar = jars[i];
+                return false;
+            }
+        }
+    }
+    prune(QDateTime::currentDateTime().addDays(-unusedDays));
+    return true;
+}
+
+int NativesCache::prune(const QDateTime& unusedSince)
+{
+    int removed = 0;
+    QDir root(m_root);
+    for (auto & info : root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        // leftovers of extractions that never finished have no marker, the folder time is all there is
+        QFileInfo marker(FS::PathCombine(info.absoluteFilePath(), usedMarker));
+        auto lastUsed = marker.exists() ? marker.lastModified() : info.lastModified();
+        if (lastUsed >= unusedSince)
+        {
+            continue;
+        }
+        if (FS::deletePath(info.absoluteFilePath()))
+        {
+            removed++;
+        }
+    }
+    if (removed)
+    {
+        qDebug() << "Removed" << removed << "unused natives cache entries";
+    }
+    return removed;
+}
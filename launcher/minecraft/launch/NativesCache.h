@@ -0,0 +1,68 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+
+/**
+ * Extracted native libraries, shared between launches and instances.
+ *
+ * Every native jar is extracted once per combination of its contents (SHA1) and the extraction options, into
+ * <root>/<sha1>-<options>/. Launches only link (or copy) the extracted files into the instance. Jars that aren't in
+ * the cache yet are extracted in parallel. Entries no launch has used for a month are removed.
+ */
+class NativesCache
+{
+public: /* types */
+    struct Options
+    {
+        /// rename .jnilib to .dylib
+        bool jnilibHack = false;
+        /// leave out OpenAL, the system one is used
+        bool skipOpenAL = false;
+        /// leave out GLFW, the system one is used
+        bool skipGLFW = false;
+    };
+
+public: /* con/des */
+    explicit NativesCache(const QString & root);
+
+public: /* methods */
+    /**
+     * Put the natives of all the jars into target, later jars overwriting files of earlier ones.
+     * On failure, failedJar is the jar that couldn't be extracted.
+     */
+    bool materialize(const QStringList & jars, const Options & options, const QString & target, QString & failedJar);
+
+    /// Where the natives of the jar with the given SHA1 are kept for the given options
+    QString entryPath(const QByteArray & sha1, const Options & options) const;
+
+    /// Remove the entries that weren't used since the given time. Returns how many were removed.
+    int prune(const QDateTime & unusedSince);
+
+    /// Extract the natives from the jar into the folder, without any caching
+    static bool extract(const QString & jar, const QString & targetFolder, const Options & options);
+
+private: /* methods */
+    struct EnsureEntry;
+    /// make sure the jar is in the cache, returns the entry or an empty string
+    QString ensureEntry(const QString & jar, const Options & options) const;
+
+private: /* data */
+    QString m_root;
+};
@@ -0,0 +1,184 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QDirIterator>
+#include <JlCompress.h>
+#include "TestUtil.h"
+
+#include "minecraft/launch/NativesCache.h"
+#include "FileSystem.h"
+
+class NativesCacheTest : public QObject
+{
+    Q_OBJECT
+
+    // a native jar with count libraries of the given size, and the usual extras
+    QString makeJar(const QString & root, const QString & name, int count, int size)
+    {
+        auto contents = FS::PathCombine(root, name + "-contents");
+        for(int i = 0; i < count; i++)
+        {
+            QByteArray data;
+            data.reserve(size);
+            quint32 value = qHash(name) + i;
+            while(data.size() < size)
+            {
+                // something that doesn't compress to nothing
+                value = value * 1103515245 + 12345;
+                data.append(char(value >> 16));
+            }
+            FS::write(FS::PathCombine(contents, QString("lib%1-%2.so").arg(name).arg(i)), data);
+        }
+        FS::write(FS::PathCombine(contents, "libopenal.so"), "openal");
+        FS::write(FS::PathCombine(contents, "liblwjgl.jnilib"), "jnilib");
+        FS::write(FS::PathCombine(contents, "META-INF", "MANIFEST.MF"), name.toUtf8());
+        auto jar = FS::PathCombine(root, name + ".jar");
+        JlCompress::compressDir(jar, contents);
+        return jar;
+    }
+
+    int countFiles(const QString & path)
+    {
+        int count = 0;
+        QDirIterator iter(path, QDir::Files, QDirIterator::Subdirectories);
+        while(iter.hasNext())
+        {
+            iter.next();
+            count++;
+        }
+        return count;
+    }
+
+private
+slots:
+    void test_materialize()
+    {
+        QTemporaryDir dir;
+        auto first = makeJar(dir.path(), "first", 3, 1000);
+        auto second = makeJar(dir.path(), "second", 2, 1000);
+        NativesCache cache(FS::PathCombine(dir.path(), "cache"));
+
+        NativesCache::Options options;
+        options.jnilibHack = true;
+        options.skipOpenAL = true;
+        auto target = FS::PathCombine(dir.path(), "natives");
+        QString failed;
+        QVERIFY(cache.materialize({first, second}, options, target, failed));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "libfirst-2.so")));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "libsecond-1.so")));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "liblwjgl.dylib")));
+        // the cache's own bookkeeping stays in the cache
+        QVERIFY(!QFile::exists(FS::PathCombine(target, ".last-used")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "liblwjgl.jnilib")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "libopenal.so")));
+        // the later jar wins
+        QCOMPARE(FS::read(FS::PathCombine(target, "META-INF", "MANIFEST.MF")), QByteArray("second"));
+
+        // one entry per jar and options
+        QCOMPARE(QDir(FS::PathCombine(dir.path(), "cache")).entryList(QDir::Dirs | QDir::NoDotAndDotDot).size(), 2);
+        auto entry = cache.entryPath(FS::hashFile(first, QCryptographicHash::Sha1), options);
+        QVERIFY(QFileInfo(entry).isDir());
+
+        // a cached entry is used as is, without looking at the jar contents again
+        FS::write(FS::PathCombine(entry, "marker"), "cached");
+        FS::deletePath(target);
+        QVERIFY(cache.materialize({first}, options, target, failed));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "marker")));
+
+        // other options get their own entry
+        options.skipOpenAL = false;
+        FS::deletePath(target);
+        QVERIFY(cache.materialize({first}, options, target, failed));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "libopenal.so")));
+        QVERIFY(!QFile::exists(FS::PathCombine(target, "marker")));
+
+        // broken jars are reported
+        auto broken = FS::PathCombine(dir.path(), "broken.jar");
+        FS::write(broken, "not a zip");
+        QVERIFY(!cache.materialize({first, broken}, options, target, failed));
+        QCOMPARE(failed, broken);
+
+        // using an entry marks it as used, an entry nobody used for long goes away
+        auto makeUnused = [&]()
+        {
+            QFile used(FS::PathCombine(entry, ".last-used"));
+            QVERIFY(used.open(QIODevice::ReadWrite));
+            QVERIFY(used.setFileTime(QDateTime::currentDateTime().addDays(-60), QFileDevice::FileModificationTime));
+        };
+        makeUnused();
+        NativesCache::Options firstOptions;
+        firstOptions.jnilibHack = true;
+        firstOptions.skipOpenAL = true;
+        FS::deletePath(target);
+        QVERIFY(cache.materialize({first}, firstOptions, target, failed));
+        QVERIFY(QFileInfo(entry).isDir());
+        makeUnused();
+        QCOMPARE(cache.prune(QDateTime::currentDateTime().addDays(-30)), 1);
+        QVERIFY(!QFileInfo(entry).exists());
+
+        // entries that were used recently are kept, the others go away
+        auto cacheDir = QDir(FS::PathCombine(dir.path(), "cache"));
+        QCOMPARE(cache.prune(QDateTime::currentDateTime().addDays(-1)), 0);
+        QCOMPARE(cache.prune(QDateTime::currentDateTime().addSecs(60)), 2);
+        QVERIFY(cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).isEmpty());
+        FS::deletePath(target);
+        QVERIFY(cache.materialize({first}, options, target, failed));
+        QVERIFY(QFile::exists(FS::PathCombine(target, "libopenal.so")));
+    }
+
+    void benchmark_extract_data()
+    {
+        QTest::addColumn<int>("mode");
+        QTest::newRow("serial, uncached") << 0;
+        QTest::newRow("parallel, cold cache") << 1;
+        QTest::newRow("warm cache") << 2;
+    }
+
+    // the ExtractNatives launch step for an LWJGL 3 like set of native jars
+    void benchmark_extract()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, mode);
+        QTemporaryDir dir;
+        QStringList jars;
+        for(int i = 0; i < 8; i++)
+        {
+            jars.append(makeJar(dir.path(), QString("lwjgl%1").arg(i), 2, 512 * 1024));
+        }
+        auto cacheRoot = FS::PathCombine(dir.path(), "cache");
+        auto target = FS::PathCombine(dir.path(), "natives");
+        NativesCache cache(cacheRoot);
+        NativesCache::Options options;
+        QString failed;
+        if(mode == 2)
+        {
+            QVERIFY(cache.materialize(jars, options, target, failed));
+        }
+
+        QBENCHMARK
+        {
+            // what the launch leaves behind is always removed
+            FS::deletePath(target);
+            if(mode == 0)
+            {
+                for(auto & jar: jars)
+                {
+                    QVERIFY(NativesCache::extract(jar, target, options));
+                }
+            }
+            else
+            {
+                if(mode == 1)
+                {
+                    FS::deletePath(cacheRoot);
+                }
+                QVERIFY(cache.materialize(jars, options, target, failed));
+            }
+        }
+        // two libraries, OpenAL and the jnilib from each, one manifest
+        QCOMPARE(countFiles(target), 8 * 4 + 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(NativesCacheTest)
+
+#include "NativesCache_test.moc"
@@ -19,6 +19,9 @@
 #include "minecraft/AssetsUtils.h"
 #include "launch/LaunchTask.h"
 
+#include <QtConcurrent>
+#include <QDebug>
+
 void ReconstructAssets::executeTask()
 {
     auto instance = m_parent->instance();
@@ -27,10 +30,18 @@ void ReconstructAssets::executeTask()
     auto profile = components->getProfile();
     auto assets = profile->getMinecraftAssets();
 
-    if(!AssetsUtils::reconstructAssets(assets->id, minecraftInstance->resourcesDir()))
+    // this can mean thousands of files, keep it off the GUI thread
+    m_timer.start();
+    connect(&m_watcher, &QFutureWatcher<bool>::finished, this, &ReconstructAssets::reconstructionFinished);
+    m_watcher.setFuture(QtConcurrent::run(AssetsUtils::reconstructAssets, assets->id, minecraftInstance->resourcesDir()));
+}
+
+void ReconstructAssets::reconstructionFinished()
+{
+    if(!m_watcher.result())
     {
         emit logLine("Failed to reconstruct Minecraft assets.", MessageLevel::Error);
     }
-
+    qDebug() << "Reconstructing assets took" << m_timer.elapsed() << "ms";
     emitSucceeded();
 }
@@ -16,6 +16,8 @@
 #pragma once
 
 #include <launch/LaunchStep.h>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
 #include <memory>
 
 class ReconstructAssets: public LaunchStep
@@ -30,4 +32,11 @@ public:
     {
         return false;
     }
+
+private slots:
+    void reconstructionFinished();
+
+private:
+    QFutureWatcher<bool> m_watcher;
+    QElapsedTimer m_timer;
 };
@@ -19,13 +19,35 @@ void LegacyUpgradeTask::executeTask()
 {
     setStatus(tr("Copying instance %1").arg(m_origInstance->name()));
 
-    FS::copy folderCopy(m_origInstance->instanceRoot(), m_stagingPath);
-    folderCopy.followSymlinks(true);
+    m_copy.reset(new FS::copy(m_origInstance->instanceRoot(), m_stagingPath));
+    m_copy->followSymlinks(true);
 
-    m_copyFuture = QtConcurrent::run(QThreadPool::globalInstance(), folderCopy);
+    m_copyFuture = QtConcurrent::run(QThreadPool::globalInstance(), *m_copy);
     connect(&m_copyFutureWatcher, &QFutureWatcher<bool>::finished, this, &LegacyUpgradeTask::copyFinished);
     connect(&m_copyFutureWatcher, &QFutureWatcher<bool>::canceled, this, &LegacyUpgradeTask::copyAborted);
     m_copyFutureWatcher.setFuture(m_copyFuture);
+    connect(&m_progressTimer, &QTimer::timeout, this, &LegacyUpgradeTask::copyProgress);
+    m_progressTimer.start(100);
+}
+
+void LegacyUpgradeTask::copyProgress()
+{
+    setByteProgress(m_copy->bytesCopied(), m_copy->bytesTotal());
+}
+
+bool LegacyUpgradeTask::canAbort() const
+{
+    return true;
+}
+
+bool LegacyUpgradeTask::abort()
+{
+    if(!m_copy)
+    {
+        return false;
+    }
+    m_copy->cancel();
+    return true;
 }
 
 static QString decideVersion(const QString& currentVersion, const QString& intendedVersion)
@@ -53,6 +75,12 @@ static QString decideVersion(const QString& currentVersion, const QString& inten
 
 void LegacyUpgradeTask::copyFinished()
 {
+    m_progressTimer.stop();
+    if(m_copy->wasCanceled())
+    {
+        emitAborted();
+        return;
+    }
     auto successful = m_copyFuture.result();
     if(!successful)
     {
@@ -127,6 +155,8 @@ void LegacyUpgradeTask::copyFinished()
         removeAll(inst.instanceRoot(), rootRemovables);
         removeAll(inst.gameRoot(), mcRemovables);
     }
+    // the staging folder is moved into place as soon as this succeeds
+    instanceSettings->flush();
     emitSucceeded();
 }
 
@@ -5,7 +5,9 @@
 #include <QUrl>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QTimer>
 #include "settings/SettingsObject.h"
+#include "FileSystem.h"
 #include "BaseVersion.h"
 #include "BaseInstance.h"
 
@@ -21,9 +23,18 @@ protected:
     virtual void executeTask() override;
     void copyFinished();
     void copyAborted();
+    void copyProgress();
+
+public:
+    bool canAbort() const override;
+
+public slots:
+    bool abort() override;
 
 private: /* data */
     InstancePtr m_origInstance;
     QFuture<bool> m_copyFuture;
     QFutureWatcher<bool> m_copyFutureWatcher;
+    std::unique_ptr<FS::copy> m_copy;
+    QTimer m_progressTimer;
 };
@@ -4,6 +4,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include <QRegularExpression>
 #include <quazip.h>
 #include <quazipfile.h>
 #include <toml.h>
@@ -310,169 +311,268 @@ std::shared_ptr<ModDetails> ReadLiteModInfo(QByteArray contents)
     return details;
 }
 
+// https://minecraft.gamepedia.com/Resource_Pack#Contents
+// the description is a text component: a string, an object with text and extra parts, or a list of those
+QString ReadTextComponent(const QJsonValue & value)
+{
+    if (value.isString())
+    {
+        return value.toString();
+    }
+    QString text;
+    if (value.isArray())
+    {
+        for (auto part: value.toArray())
+        {
+            text += ReadTextComponent(part);
+        }
+    }
+    else if (value.isObject())
+    {
+        auto object = value.toObject();
+        text = object.value("text").toString();
+        for (auto part: object.value("extra").toArray())
+        {
+            text += ReadTextComponent(part);
+        }
+    }
+    return text;
 }
 
-LocalModParseTask::LocalModParseTask(int token, Mod::ModType type, const QFileInfo& modFile):
-    m_token(token),
-    m_type(type),
-    m_modFile(modFile),
-    m_result(new Result())
+std::shared_ptr<ModDetails> ReadPackMeta(QByteArray contents)
 {
+    auto pack = QJsonDocument::fromJson(contents).object().value("pack");
+    if (!pack.isObject())
+    {
+        return nullptr;
+    }
+    std::shared_ptr<ModDetails> details = std::make_shared<ModDetails>();
+    // formatting codes are of no use outside of the game
+    details->description = ReadTextComponent(pack.toObject().value("description")).remove(QRegularExpression(QString(QChar(0xa7)) + "."));
+    return details;
 }
 
-void LocalModParseTask::processAsZip()
+// old texture packs just have a line or two of text
+std::shared_ptr<ModDetails> ReadPackTxt(QByteArray contents)
 {
-    QuaZip zip(m_modFile.filePath());
-    if (!zip.open(QuaZip::mdUnzip))
-        return;
-
-    QuaZipFile file(&zip);
+    std::shared_ptr<ModDetails> details = std::make_shared<ModDetails>();
+    details->description = QString::fromUtf8(contents).trimmed();
+    return details;
+}
 
-    if (zip.setCurrentFile("META-INF/mods.toml"))
+QString ReadManifestVersion(QByteArray contents)
+{
+    // quick and dirty line-by-line parser
+    QString manifestVersion = "";
+    for (auto &line : contents.split('\n'))
     {
-        if (!file.open(QIODevice::ReadOnly))
+        if (line.startsWith("Implementation-Version: "))
         {
-            zip.close();
-            return;
+            manifestVersion = QString::fromUtf8(line.mid(24)).trimmed();
+            break;
         }
+    }
 
-        m_result->details = ReadMCModTOML(file.readAll());
-        file.close();
+    // some mods use ${projectversion} in their build.gradle, causing this mess to show up in MANIFEST.MF
+    // also keep with forge's behavior of setting the version to "NONE" if none is found
+    if (manifestVersion.contains("task ':jar' property 'archiveVersion'") || manifestVersion == "")
+    {
+        manifestVersion = "NONE";
+    }
+    return manifestVersion;
+}
 
-        // to replace ${file.jarVersion} with the actual version, as needed
-        if (m_result->details && m_result->details->version == "${file.jarVersion}")
-        {
-            if (zip.setCurrentFile("META-INF/MANIFEST.MF"))
-            {
-                if (!file.open(QIODevice::ReadOnly))
-                {
-                    zip.close();
-                    return;
-                }
-
-                // quick and dirty line-by-line parser
-                auto manifestLines = file.readAll().split('\n');
-                QString manifestVersion = "";
-                for (auto &line : manifestLines)
-                {
-                    if (QString(line).startsWith("Implementation-Version: "))
-                    {
-                        manifestVersion = QString(line).remove("Implementation-Version: ");
-                        break;
-                    }
-                }
-
-                // some mods use ${projectversion} in their build.gradle, causing this mess to show up in MANIFEST.MF
-                // also keep with forge's behavior of setting the version to "NONE" if none is found
-                if (manifestVersion.contains("task ':jar' property 'archiveVersion'") || manifestVersion == "")
-                {
-                    manifestVersion = "NONE";
-                }
-
-                m_result->details->version = manifestVersion;
-
-                file.close();
-            }
-        }
+// every file that can tell us something about a mod or pack
+enum Descriptor
+{
+    ModsToml,
+    Manifest,
+    McModInfo,
+    FabricModJson,
+    ForgeVersion,
+    LiteModJson,
+    PackMcmeta,
+    PackTxt,
+    DescriptorCount
+};
+
+const char * descriptorPaths[DescriptorCount] = {
+    "META-INF/mods.toml",
+    "META-INF/MANIFEST.MF",
+    "mcmod.info",
+    "fabric.mod.json",
+    "forgeversion.properties",
+    "litemod.json",
+    "pack.mcmeta",
+    "pack.txt"
+};
+
+// descriptors are small, anything bigger than this is not one
+const qint64 maxDescriptorSize = 1024 * 1024;
+
+struct Descriptors
+{
+    QByteArray contents[DescriptorCount];
+    bool found[DescriptorCount] = {};
+};
 
-        zip.close();
-        return;
-    }
-    else if (zip.setCurrentFile("mcmod.info"))
+int descriptorIndex(const QString & path)
+{
+    for (int i = 0; i < DescriptorCount; i++)
     {
-        if (!file.open(QIODevice::ReadOnly))
+        // zip tools that upper case names are out there
+        if (path.compare(QLatin1String(descriptorPaths[i]), Qt::CaseInsensitive) == 0)
         {
-            zip.close();
-            return;
+            return i;
         }
-
-        m_result->details = ReadMCModInfo(file.readAll());
-        file.close();
-        zip.close();
-        return;
     }
-    else if (zip.setCurrentFile("fabric.mod.json"))
+    return -1;
+}
+
+// one pass over the central directory, reading the descriptors as they come by
+bool ReadZipDescriptors(const QString & path, Descriptors & out, const QAtomicInt & cancelled)
+{
+    QuaZip zip(path);
+    if (!zip.open(QuaZip::mdUnzip))
+        return false;
+
+    QuaZipFile file(&zip);
+    QuaZipFileInfo64 info;
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile())
     {
-        if (!file.open(QIODevice::ReadOnly))
+        if (cancelled.loadAcquire())
         {
             zip.close();
-            return;
+            return false;
+        }
+        if (!zip.getCurrentFileInfo(&info))
+        {
+            continue;
+        }
+        int index = descriptorIndex(info.name);
+        if (index < 0 || info.uncompressedSize > quint64(maxDescriptorSize))
+        {
+            continue;
         }
-
-        m_result->details = ReadFabricModInfo(file.readAll());
-        file.close();
-        zip.close();
-        return;
-    }
-    else if (zip.setCurrentFile("forgeversion.properties"))
-    {
         if (!file.open(QIODevice::ReadOnly))
         {
-            zip.close();
-            return;
+            continue;
         }
-
-        m_result->details = ReadForgeInfo(file.readAll());
+        auto data = file.read(maxDescriptorSize + 1);
         file.close();
-        zip.close();
-        return;
+        if (data.size() > maxDescriptorSize)
+        {
+            continue;
+        }
+        out.contents[index] = data;
+        out.found[index] = true;
+        // nothing else can beat these
+        if (out.found[ModsToml] && out.found[Manifest])
+        {
+            break;
+        }
     }
-
     zip.close();
+    return true;
 }
 
-void LocalModParseTask::processAsFolder()
+bool ReadFolderDescriptors(const QString & path, Descriptors & out)
 {
-    QFileInfo mcmod_info(FS::PathCombine(m_modFile.filePath(), "mcmod.info"));
-    if (mcmod_info.isFile())
+    for (int i = 0; i < DescriptorCount; i++)
     {
-        QFile mcmod(mcmod_info.filePath());
-        if (!mcmod.open(QIODevice::ReadOnly))
-            return;
-        auto data = mcmod.readAll();
-        if (data.isEmpty() || data.isNull())
-            return;
-        m_result->details = ReadMCModInfo(data);
+        QFileInfo info(FS::PathCombine(path, descriptorPaths[i]));
+        if (!info.isFile() || info.size() > maxDescriptorSize)
+        {
+            continue;
+        }
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            continue;
+        }
+        out.contents[i] = file.read(maxDescriptorSize);
+        out.found[i] = true;
     }
+    return true;
 }
 
-void LocalModParseTask::processAsLitemod()
+std::shared_ptr<ModDetails> ReadDescriptors(const Descriptors & in, Mod::ModType type)
 {
-    QuaZip zip(m_modFile.filePath());
-    if (!zip.open(QuaZip::mdUnzip))
-        return;
-
-    QuaZipFile file(&zip);
-
-    if (zip.setCurrentFile("litemod.json"))
+    if (type == Mod::MOD_LITEMOD && in.found[LiteModJson])
     {
-        if (!file.open(QIODevice::ReadOnly))
+        return ReadLiteModInfo(in.contents[LiteModJson]);
+    }
+    if (in.found[ModsToml])
+    {
+        auto details = ReadMCModTOML(in.contents[ModsToml]);
+        // to replace ${file.jarVersion} with the actual version, as needed
+        if (details && details->version == "${file.jarVersion}" && in.found[Manifest])
         {
-            zip.close();
-            return;
+            details->version = ReadManifestVersion(in.contents[Manifest]);
         }
-
-        m_result->details = ReadLiteModInfo(file.readAll());
-        file.close();
+        return details;
     }
-    zip.close();
+    if (in.found[McModInfo])
+    {
+        return ReadMCModInfo(in.contents[McModInfo]);
+    }
+    if (in.found[FabricModJson])
+    {
+        return ReadFabricModInfo(in.contents[FabricModJson]);
+    }
+    if (in.found[ForgeVersion])
+    {
+        return ReadForgeInfo(in.contents[ForgeVersion]);
+    }
+    if (in.found[LiteModJson])
+    {
+        return ReadLiteModInfo(in.contents[LiteModJson]);
+    }
+    if (in.found[PackMcmeta])
+    {
+        return ReadPackMeta(in.contents[PackMcmeta]);
+    }
+    if (in.found[PackTxt])
+    {
+        return ReadPackTxt(in.contents[PackTxt]);
+    }
+    return nullptr;
+}
+
+}
+
+LocalModParseTask::LocalModParseTask(int token, Mod::ModType type, const QFileInfo& modFile):
+    m_token(token),
+    m_type(type),
+    m_modFile(modFile),
+    m_result(new Result())
+{
 }
 
 void LocalModParseTask::run()
 {
+    if (m_result->cancelled.loadAcquire())
+    {
+        emit finished(m_token);
+        return;
+    }
+    Descriptors descriptors;
+    bool readable = false;
     switch(m_type)
     {
         case Mod::MOD_ZIPFILE:
-            processAsZip();
+        case Mod::MOD_LITEMOD:
+            readable = ReadZipDescriptors(m_modFile.filePath(), descriptors, m_result->cancelled);
             break;
         case Mod::MOD_FOLDER:
-            processAsFolder();
-            break;
-        case Mod::MOD_LITEMOD:
-            processAsLitemod();
+            readable = ReadFolderDescriptors(m_modFile.filePath(), descriptors);
             break;
         default:
             break;
     }
+    if (readable)
+    {
+        m_result->details = ReadDescriptors(descriptors, m_type);
+    }
     emit finished(m_token);
 }
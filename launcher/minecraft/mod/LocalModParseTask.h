@@ -2,6 +2,7 @@
 #include <QRunnable>
 #include <QDebug>
 #include <QObject>
+#include <QAtomicInt>
 #include "Mod.h"
 #include "ModDetails.h"
 
@@ -12,6 +13,8 @@ public:
     struct Result {
         QString id;
         std::shared_ptr<ModDetails> details;
+        /// set when nobody is interested in the result anymore
+        QAtomicInt cancelled;
     };
     using ResultPtr = std::shared_ptr<Result>;
     ResultPtr result() const {
@@ -21,14 +24,13 @@ public:
     LocalModParseTask(int token, Mod::ModType type, const QFileInfo & modFile);
     void run();
 
+    int token() const {
+        return m_token;
+    }
+
 signals:
     void finished(int token);
 
-private:
-    void processAsZip();
-    void processAsFolder();
-    void processAsLitemod();
-
 private:
     int m_token;
     Mod::ModType m_type;
@@ -0,0 +1,203 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <quazip.h>
+#include <quazipfile.h>
+#include "TestUtil.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "FileSystem.h"
+#include "minecraft/mod/LocalModParseTask.h"
+
+class LocalModParseTaskTest : public QObject
+{
+    Q_OBJECT
+
+    // a jar with some class files and then the given files
+    QString makeJar(const QString & path, int classes, const QMap<QString, QByteArray> & files)
+    {
+        QuaZip zip(path);
+        zip.open(QuaZip::mdCreate);
+        for(int i = 0; i < classes; i++)
+        {
+            QuaZipFile file(&zip);
+            file.open(QIODevice::WriteOnly, QuaZipNewInfo(QString("net/example/c%1.class").arg(i)));
+            file.write(QByteArray(64, char(i)));
+            file.close();
+        }
+        for(auto iter = files.begin(); iter != files.end(); iter++)
+        {
+            QuaZipFile file(&zip);
+            file.open(QIODevice::WriteOnly, QuaZipNewInfo(iter.key()));
+            file.write(iter.value());
+            file.close();
+        }
+        zip.close();
+        return path;
+    }
+
+    std::shared_ptr<ModDetails> parse(Mod::ModType type, const QString & path)
+    {
+        LocalModParseTask task(0, type, QFileInfo(path));
+        task.run();
+        return task.result()->details;
+    }
+
+    // what finding the fabric metadata took before: a search by name for every kind of descriptor
+    QByteArray lookupByName(const QString & path)
+    {
+        QuaZip zip(path);
+        zip.open(QuaZip::mdUnzip);
+        QuaZipFile file(&zip);
+        for(auto name: {"META-INF/mods.toml", "mcmod.info", "fabric.mod.json", "forgeversion.properties"})
+        {
+            if(zip.setCurrentFile(name))
+            {
+                file.open(QIODevice::ReadOnly);
+                auto data = file.readAll();
+                file.close();
+                return data;
+            }
+        }
+        return QByteArray();
+    }
+
+private
+slots:
+    void test_forge()
+    {
+        QTemporaryDir dir;
+        auto jar = makeJar(FS::PathCombine(dir.path(), "forge.jar"), 10, {
+            {"META-INF/mods.toml", "modLoader=\"javafml\"\n[[mods]]\nmodId=\"example\"\nversion=\"${file.jarVersion}\"\ndisplayName=\"Example\"\n"},
+            {"META-INF/MANIFEST.MF", "Manifest-Version: 1.0\r\nImplementation-Version: 1.2.3\r\n"},
+            // mods.toml wins
+            {"mcmod.info", "[{\"modid\": \"old\", \"name\": \"Old\"}]"}
+        });
+        auto details = parse(Mod::MOD_ZIPFILE, jar);
+        QVERIFY(details);
+        QCOMPARE(details->mod_id, QString("example"));
+        QCOMPARE(details->name, QString("Example"));
+        QCOMPARE(details->version, QString("1.2.3"));
+
+        // names are matched ignoring case
+        auto upper = makeJar(FS::PathCombine(dir.path(), "upper.jar"), 2, {
+            {"MCMOD.INFO", "[{\"modid\": \"upper\", \"name\": \"Upper\"}]"}
+        });
+        details = parse(Mod::MOD_ZIPFILE, upper);
+        QVERIFY(details);
+        QCOMPARE(details->mod_id, QString("upper"));
+    }
+
+    void test_fabric()
+    {
+        QTemporaryDir dir;
+        auto jar = makeJar(FS::PathCombine(dir.path(), "fabric.jar"), 10, {
+            {"fabric.mod.json", R"({"schemaVersion": 1, "id": "example", "version": "2.0", "authors": ["Someone", {"name": "Else"}]})"}
+        });
+        auto details = parse(Mod::MOD_ZIPFILE, jar);
+        QVERIFY(details);
+        QCOMPARE(details->name, QString("example"));
+        QCOMPARE(details->version, QString("2.0"));
+        QCOMPARE(details->authors, QStringList({"Someone", "Else"}));
+
+        QVERIFY(!parse(Mod::MOD_ZIPFILE, makeJar(FS::PathCombine(dir.path(), "nothing.jar"), 10, {})));
+    }
+
+    void test_litemod()
+    {
+        QTemporaryDir dir;
+        auto jar = makeJar(FS::PathCombine(dir.path(), "example.litemod"), 2, {
+            {"litemod.json", R"({"name": "LiteExample", "revision": "5", "mcversion": "1.12.2"})"}
+        });
+        auto details = parse(Mod::MOD_LITEMOD, jar);
+        QVERIFY(details);
+        QCOMPARE(details->name, QString("LiteExample"));
+        QCOMPARE(details->version, QString("5"));
+        QCOMPARE(details->mcversion, QString("1.12.2"));
+    }
+
+    void test_folder()
+    {
+        QTemporaryDir dir;
+        auto folder = FS::PathCombine(dir.path(), "folder");
+        FS::write(FS::PathCombine(folder, "mcmod.info"), R"({"modListVersion": 2, "modList": [{"modid": "folder", "name": "Folder Mod"}]})");
+        auto details = parse(Mod::MOD_FOLDER, folder);
+        QVERIFY(details);
+        QCOMPARE(details->mod_id, QString("folder"));
+        QCOMPARE(details->name, QString("Folder Mod"));
+    }
+
+    void test_packs()
+    {
+        QTemporaryDir dir;
+        auto pack = makeJar(FS::PathCombine(dir.path(), "pack.zip"), 0, {
+            {"pack.mcmeta", QString(R"({"pack": {"pack_format": 6, "description": ["", {"text": "%1aShiny", "extra": [" textures"]}]}})").arg(QChar(0xa7)).toUtf8()}
+        });
+        auto details = parse(Mod::MOD_ZIPFILE, pack);
+        QVERIFY(details);
+        QCOMPARE(details->description, QString("Shiny textures"));
+
+        auto folder = FS::PathCombine(dir.path(), "texturepack");
+        FS::write(FS::PathCombine(folder, "pack.txt"), "An old texture pack\n");
+        details = parse(Mod::MOD_FOLDER, folder);
+        QVERIFY(details);
+        QCOMPARE(details->description, QString("An old texture pack"));
+    }
+
+    void test_tooLarge()
+    {
+        QTemporaryDir dir;
+        auto jar = makeJar(FS::PathCombine(dir.path(), "large.jar"), 0, {
+            {"fabric.mod.json", QByteArray(2 * 1024 * 1024, ' ') + R"({"id": "large"})"}
+        });
+        QVERIFY(!parse(Mod::MOD_ZIPFILE, jar));
+    }
+
+    void benchmark_probe_data()
+    {
+        QTest::addColumn<bool>("singlePass");
+        // peak RSS only goes up, so the one expected to use less goes first
+        QTest::newRow("single pass") << true;
+        QTest::newRow("lookup by name") << false;
+    }
+
+    // a big fabric mod, where everything else had to be looked for first
+    void benchmark_probe()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, singlePass);
+        QTemporaryDir dir;
+        auto jar = makeJar(FS::PathCombine(dir.path(), "large.jar"), 20000, {
+            {"fabric.mod.json", R"({"schemaVersion": 1, "id": "large", "version": "1.0"})"}
+        });
+
+        QBENCHMARK
+        {
+            if(singlePass)
+            {
+                auto details = parse(Mod::MOD_ZIPFILE, jar);
+                QVERIFY(details);
+                QCOMPARE(details->mod_id, QString("large"));
+            }
+            else
+            {
+                QVERIFY(!lookupByName(jar).isEmpty());
+            }
+        }
+#if defined(Q_OS_UNIX)
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MACOS)
+        qDebug() << "Peak RSS:" << usage.ru_maxrss / 1024 << "KiB";
+#else
+        qDebug() << "Peak RSS:" << usage.ru_maxrss << "KiB";
+#endif
+#endif
+    }
+};
+
+QTEST_GUILESS_MAIN(LocalModParseTaskTest)
+
+#include "LocalModParseTask_test.moc"
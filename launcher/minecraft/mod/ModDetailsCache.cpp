@@ -0,0 +1,154 @@
+#include "ModDetailsCache.h"
+
+#include <QDataStream>
+#include <QBuffer>
+#include <QDate>
+#include <QDateTime>
+#include <QFile>
+#include <QDebug>
+
+#include "FileSystem.h"
+
+namespace {
+const quint32 CACHE_MAGIC = 0x4D4F4444;
+// bump this when LocalModParseTask learns something new, so everything is looked at again
+const quint32 CACHE_VERSION = 2;
+// entries of mods nobody looked at for this many days are dropped
+const qint64 CACHE_MAX_AGE = 60;
+
+QDataStream & operator<<(QDataStream & out, const ModDetails & details)
+{
+    out << details.mod_id << details.name << details.version << details.mcversion << details.homeurl
+        << details.updateurl << details.description << details.authors << details.credits;
+    return out;
+}
+
+QDataStream & operator>>(QDataStream & in, ModDetails & details)
+{
+    in >> details.mod_id >> details.name >> details.version >> details.mcversion >> details.homeurl
+       >> details.updateurl >> details.description >> details.authors >> details.credits;
+    return in;
+}
+}
+
+ModDetailsCache::ModDetailsCache(const QString & path) : m_path(path)
+{
+    m_today = QDate::currentDate().toJulianDay();
+    load();
+}
+
+void ModDetailsCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_6);
+    quint32 magic = 0, version = 0;
+    in >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+    {
+        qWarning() << "Ignoring mod details cache" << m_path << "with an unknown format";
+        return;
+    }
+    QHash<QString, Entry> entries;
+    while (!in.atEnd() && in.status() == QDataStream::Ok)
+    {
+        QString path;
+        Entry entry;
+        bool hasDetails = false;
+        in >> path >> entry.size >> entry.modified >> entry.lastUsed >> hasDetails;
+        if (hasDetails)
+        {
+            entry.details = std::make_shared<ModDetails>();
+            in >> *entry.details;
+        }
+        entries.insert(path, entry);
+    }
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "Ignoring truncated mod details cache" << m_path;
+        return;
+    }
+    m_entries.swap(entries);
+}
+
+bool ModDetailsCache::find(const QFileInfo & file, std::shared_ptr<ModDetails> & details)
+{
+    auto iter = m_entries.find(file.absoluteFilePath());
+    if (iter == m_entries.end())
+    {
+        return false;
+    }
+    if (iter->size != file.size() || iter->modified != file.lastModified().toMSecsSinceEpoch())
+    {
+        return false;
+    }
+    if (iter->lastUsed != m_today)
+    {
+        iter->lastUsed = m_today;
+        m_dirty = true;
+    }
+    details = iter->details;
+    return true;
+}
+
+void ModDetailsCache::insert(const QFileInfo & file, std::shared_ptr<ModDetails> details)
+{
+    Entry entry;
+    entry.size = file.size();
+    entry.modified = file.lastModified().toMSecsSinceEpoch();
+    entry.lastUsed = m_today;
+    entry.details = details;
+    m_entries.insert(file.absoluteFilePath(), entry);
+    m_dirty = true;
+}
+
+void ModDetailsCache::remove(const QFileInfo & file)
+{
+    if (m_entries.remove(file.absoluteFilePath()))
+    {
+        m_dirty = true;
+    }
+}
+
+bool ModDetailsCache::save()
+{
+    if (!m_dirty)
+    {
+        return true;
+    }
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream out(&buffer);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << CACHE_MAGIC << CACHE_VERSION;
+    for (auto iter = m_entries.begin(); iter != m_entries.end();)
+    {
+        if (m_today - iter->lastUsed > CACHE_MAX_AGE)
+        {
+            iter = m_entries.erase(iter);
+            continue;
+        }
+        out << iter.key() << iter->size << iter->modified << iter->lastUsed << bool(iter->details);
+        if (iter->details)
+        {
+            out << *iter->details;
+        }
+        iter++;
+    }
+    try
+    {
+        FS::write(m_path, data);
+    }
+    catch (const Exception & e)
+    {
+        qWarning() << "Couldn't save the mod details cache:" << e.cause();
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QFileInfo>
+#include <memory>
+
+#include "ModDetails.h"
+
+/**
+ * Remembers what LocalModParseTask found in mod files, so unchanged mods don't have to be opened again.
+ *
+ * Entries are keyed by the absolute path of the file and only used while its size and modification time stay the
+ * same. A changed file simply gets a new entry. Entries that were not used for a while are dropped on save().
+ *
+ * Meant to be used from the GUI thread, like the mod models that use it.
+ */
+class ModDetailsCache
+{
+public: /* con/des */
+    explicit ModDetailsCache(const QString & path);
+
+public: /* methods */
+    /**
+     * Look up the details of a file.
+     * Returns false when the file is not known or changed since. Details may be null on a hit: the file was looked at,
+     * but there was nothing to find.
+     */
+    bool find(const QFileInfo & file, std::shared_ptr<ModDetails> & details);
+
+    /// Remember the details of a file as it is now
+    void insert(const QFileInfo & file, std::shared_ptr<ModDetails> details);
+
+    /// Forget about a file
+    void remove(const QFileInfo & file);
+
+    /// Write the cache file, if anything changed since it was read
+    bool save();
+
+    int size() const
+    {
+        return m_entries.size();
+    }
+
+private: /* types */
+    struct Entry
+    {
+        qint64 size = 0;
+        qint64 modified = 0;
+        qint64 lastUsed = 0;
+        std::shared_ptr<ModDetails> details;
+    };
+
+private: /* methods */
+    void load();
+
+private: /* data */
+    QString m_path;
+    QHash<QString, Entry> m_entries;
+    qint64 m_today = 0;
+    bool m_dirty = false;
+};
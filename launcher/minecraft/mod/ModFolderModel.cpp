@@ -23,11 +23,32 @@
 #include <QDebug>
 #include "ModFolderLoadTask.h"
 #include <QThreadPool>
+#include <QThread>
 #include <algorithm>
 #include "LocalModParseTask.h"
+#include "ModDetailsCache.h"
+#include "Env.h"
+
+namespace {
+// mods are looked at on their own threads, so a big mods folder doesn't hold up imports and other work on the global pool
+QThreadPool * parsePool()
+{
+    static QThreadPool pool;
+    static bool initialized = false;
+    if(!initialized) {
+        pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+        initialized = true;
+    }
+    return &pool;
+}
+}
 
 ModFolderModel::ModFolderModel(const QString &dir) : QAbstractListModel(), m_dir(dir)
 {
+    // finished mods are announced in batches, not one by one
+    m_parsedTimer.setSingleShot(true);
+    m_parsedTimer.setInterval(100);
+    connect(&m_parsedTimer, &QTimer::timeout, this, &ModFolderModel::flushParsedMods);
     FS::ensureFolderPathExists(m_dir.absolutePath());
     m_dir.setFilter(QDir::Readable | QDir::NoDotAndDotDot | QDir::Files | QDir::Dirs);
     m_dir.setSorting(QDir::Name | QDir::IgnoreCase | QDir::LocaleAware);
@@ -35,6 +56,14 @@ ModFolderModel::ModFolderModel(const QString &dir) : QAbstractListModel(), m_dir
     connect(m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
 }
 
+ModFolderModel::~ModFolderModel()
+{
+    for(auto & result: activeTickets) {
+        result->cancelled.storeRelease(1);
+    }
+    qDeleteAll(m_parseQueue);
+}
+
 void ModFolderModel::startWatching()
 {
     if(is_watching)
@@ -89,6 +118,7 @@ bool ModFolderModel::update()
 
 void ModFolderModel::finishUpdate()
 {
+    auto cache = ENV.modDetailsCache();
     QSet<QString> currentSet = modsIndex.keys().toSet();
     auto & newMods = m_update->mods;
     QSet<QString> newSet = newMods.keys().toSet();
@@ -107,7 +137,7 @@ void ModFolderModel::finishUpdate()
             }
             auto & oldMod = mods[row];
             if(oldMod.isResolving()) {
-                activeTickets.remove(oldMod.resolutionTicket());
+                cancelResolution(oldMod.resolutionTicket());
             }
             oldMod = newMod;
             resolveMod(mods[row]);
@@ -129,7 +159,10 @@ void ModFolderModel::finishUpdate()
             beginRemoveRows(QModelIndex(), removedIndex, removedIndex);
             auto removedIter = mods.begin() + removedIndex;
             if(removedIter->isResolving()) {
-                activeTickets.remove(removedIter->resolutionTicket());
+                cancelResolution(removedIter->resolutionTicket());
+            }
+            if(cache) {
+                cache->remove(removedIter->filename());
             }
             mods.erase(removedIter);
             endRemoveRows();
@@ -160,6 +193,12 @@ void ModFolderModel::finishUpdate()
 
     m_update.reset();
 
+    startParsing();
+
+    if(cache && activeTickets.isEmpty()) {
+        cache->save();
+    }
+
     emit updateFinished();
 
     if(scheduled_update) {
@@ -174,19 +213,76 @@ void ModFolderModel::resolveMod(Mod& m)
         return;
     }
 
+    // folders can change without their modification time changing, so only files are cached
+    auto cache = ENV.modDetailsCache();
+    bool cacheable = m.type() == Mod::MOD_ZIPFILE || m.type() == Mod::MOD_LITEMOD;
+    std::shared_ptr<ModDetails> details;
+    if(cache && cacheable && cache->find(m.filename(), details)) {
+        m.finishResolvingWithDetails(details);
+        return;
+    }
+
     auto task = new LocalModParseTask(nextResolutionTicket, m.type(), m.filename());
     auto result = task->result();
     result->id = m.mmc_id();
     activeTickets.insert(nextResolutionTicket, result);
     m.setResolving(true, nextResolutionTicket);
     nextResolutionTicket++;
-    QThreadPool *threadPool = QThreadPool::globalInstance();
     connect(task, &LocalModParseTask::finished, this, &ModFolderModel::finishModParse);
-    threadPool->start(task);
+    m_parseQueue.append(task);
+}
+
+void ModFolderModel::cancelResolution(int ticket)
+{
+    auto result = activeTickets.take(ticket);
+    if(result) {
+        // a running task stops at the next entry it looks at
+        result->cancelled.storeRelease(1);
+    }
+    for(auto iter = m_parseQueue.begin(); iter != m_parseQueue.end(); iter++) {
+        if((*iter)->token() == ticket) {
+            delete *iter;
+            m_parseQueue.erase(iter);
+            break;
+        }
+    }
+}
+
+void ModFolderModel::startParsing()
+{
+    // only as many at once as there are workers, so the rest can still be reordered or cancelled
+    auto pool = parsePool();
+    while(!m_parseQueue.isEmpty() && m_parsing < pool->maxThreadCount()) {
+        m_parsing++;
+        pool->start(m_parseQueue.takeFirst());
+    }
+}
+
+void ModFolderModel::prioritize(const QModelIndexList &indexes)
+{
+    QSet<int> tickets;
+    for(auto & modIndex: indexes) {
+        if(!modIndex.isValid() || modIndex.row() >= mods.size()) {
+            continue;
+        }
+        auto & mod = mods[modIndex.row()];
+        if(mod.isResolving()) {
+            tickets.insert(mod.resolutionTicket());
+        }
+    }
+    if(tickets.isEmpty()) {
+        return;
+    }
+    std::stable_partition(m_parseQueue.begin(), m_parseQueue.end(), [&](LocalModParseTask * task) {
+        return tickets.contains(task->token());
+    });
 }
 
 void ModFolderModel::finishModParse(int token)
 {
+    m_parsing--;
+    startParsing();
+
     auto iter = activeTickets.find(token);
     if(iter == activeTickets.end()) {
         return;
@@ -196,7 +292,38 @@ void ModFolderModel::finishModParse(int token)
     int row = modsIndex[result->id];
     auto & mod = mods[row];
     mod.finishResolvingWithDetails(result->details);
-    emit dataChanged(index(row), index(row, columnCount(QModelIndex()) - 1));
+    m_parsedIds.insert(result->id);
+    if(!m_parsedTimer.isActive()) {
+        m_parsedTimer.start();
+    }
+
+    auto cache = ENV.modDetailsCache();
+    if(cache) {
+        if(mod.type() == Mod::MOD_ZIPFILE || mod.type() == Mod::MOD_LITEMOD) {
+            cache->insert(mod.filename(), result->details);
+        }
+        if(activeTickets.isEmpty()) {
+            cache->save();
+        }
+    }
+}
+
+void ModFolderModel::flushParsedMods()
+{
+    int first = mods.size();
+    int last = -1;
+    for(auto & id: m_parsedIds) {
+        auto iter = modsIndex.find(id);
+        if(iter == modsIndex.end()) {
+            continue;
+        }
+        first = std::min(first, *iter);
+        last = std::max(last, *iter);
+    }
+    m_parsedIds.clear();
+    if(last >= 0) {
+        emit dataChanged(index(first, 0), index(last, columnCount(QModelIndex()) - 1));
+    }
 }
 
 void ModFolderModel::disableInteraction(bool disabled)
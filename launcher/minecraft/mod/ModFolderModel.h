@@ -21,6 +21,7 @@
 #include <QString>
 #include <QDir>
 #include <QAbstractListModel>
+#include <QTimer>
 
 #include "Mod.h"
 
@@ -53,6 +54,7 @@ public:
         Toggle
     };
     ModFolderModel(const QString &dir);
+    virtual ~ModFolderModel();
 
     virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
@@ -103,6 +105,9 @@ public:
     /// Enable or disable listed mods
     bool setModStatus(const QModelIndexList &indexes, ModStatusAction action);
 
+    /// Look into the given mods before the others still waiting, for example because they are visible
+    void prioritize(const QModelIndexList &indexes);
+
     void startWatching();
     void stopWatching();
 
@@ -126,12 +131,15 @@ slots:
     void directoryChanged(QString path);
     void finishUpdate();
     void finishModParse(int token);
+    void flushParsedMods();
 
 signals:
     void updateFinished();
 
 private:
     void resolveMod(Mod& m);
+    void cancelResolution(int ticket);
+    void startParsing();
     bool setModStatus(int index, ModStatusAction action);
 
 protected:
@@ -143,6 +151,12 @@ protected:
     QDir m_dir;
     QMap<QString, int> modsIndex;
     QMap<int, LocalModParseTask::ResultPtr> activeTickets;
+    /// tasks waiting for a worker, the next one first
+    QList<LocalModParseTask *> m_parseQueue;
+    int m_parsing = 0;
+    /// mods that were resolved since the last dataChanged
+    QSet<QString> m_parsedIds;
+    QTimer m_parsedTimer;
     int nextResolutionTicket = 0;
     QList<Mod> mods;
 };
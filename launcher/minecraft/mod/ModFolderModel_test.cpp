@@ -1,15 +1,79 @@
 
 #include <QTest>
 #include <QTemporaryDir>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include <quazip.h>
+#include <quazipfile.h>
 #include "TestUtil.h"
 
+#include "Env.h"
 #include "FileSystem.h"
 #include "minecraft/mod/ModFolderModel.h"
+#include "minecraft/mod/ModDetailsCache.h"
 
 class ModFolderModelTest : public QObject
 {
     Q_OBJECT
 
+    // a fabric mod with some class files next to its metadata
+    void makeMod(const QString & path, const QString & name, int classes)
+    {
+        QuaZip zip(path);
+        zip.open(QuaZip::mdCreate);
+        for(int i = 0; i < classes; i++)
+        {
+            QuaZipFile file(&zip);
+            file.open(QIODevice::WriteOnly, QuaZipNewInfo(QString("%1/c%2.class").arg(name).arg(i)));
+            file.write(QByteArray(512, char(i)));
+            file.close();
+        }
+        QuaZipFile metadata(&zip);
+        metadata.open(QIODevice::WriteOnly, QuaZipNewInfo("fabric.mod.json"));
+        metadata.write(QString(R"({"schemaVersion": 1, "id": "%1", "name": "%1", "version": "1.0"})").arg(name).toUtf8());
+        metadata.close();
+        zip.close();
+    }
+
+    // update the model and wait until it knows everything about the mods
+    void scan(ModFolderModel & model)
+    {
+        QSignalSpy spy(&model, &ModFolderModel::updateFinished);
+        QVERIFY(model.update());
+        QVERIFY(spy.wait(60000));
+        QElapsedTimer timer;
+        timer.start();
+        while(anyResolving(model) && timer.elapsed() < 60000)
+        {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+        QVERIFY(!anyResolving(model));
+    }
+
+    bool anyResolving(ModFolderModel & model)
+    {
+        for(size_t i = 0; i < model.size(); i++)
+        {
+            if(model[i].isResolving())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    QString nameOf(ModFolderModel & model, const QString & fileName)
+    {
+        for(size_t i = 0; i < model.size(); i++)
+        {
+            if(model[i].filename().fileName() == fileName)
+            {
+                return model[i].name();
+            }
+        }
+        return QString();
+    }
+
 private
 slots:
     // test for GH-1178 - install a folder with files to a mod list
@@ -46,6 +110,131 @@ slots:
             verify(tempDir.path());
         }
     }
+
+    void test_detailsCache()
+    {
+        QTemporaryDir tempDir;
+        auto modsDir = FS::PathCombine(tempDir.path(), "mods");
+        auto cachePath = FS::PathCombine(tempDir.path(), "moddetails.dat");
+        FS::ensureFolderPathExists(modsDir);
+        for(int i = 0; i < 5; i++)
+        {
+            makeMod(FS::PathCombine(modsDir, QString("mod%1.jar").arg(i)), QString("mod%1").arg(i), 2);
+        }
+
+        ENV.initModDetailsCache(cachePath);
+        {
+            ModFolderModel model(modsDir);
+            scan(model);
+            QCOMPARE(int(model.size()), 5);
+            QCOMPARE(nameOf(model, "mod0.jar"), QString("mod0"));
+        }
+        QVERIFY(QFile::exists(cachePath));
+
+        // after a restart, everything is known without looking into the jars
+        ENV.initModDetailsCache(cachePath);
+        QCOMPARE(ENV.modDetailsCache()->size(), 5);
+        {
+            ModFolderModel model(modsDir);
+            QSignalSpy spy(&model, &ModFolderModel::updateFinished);
+            QVERIFY(model.update());
+            QVERIFY(spy.wait(60000));
+            QVERIFY(!anyResolving(model));
+            QCOMPARE(nameOf(model, "mod3.jar"), QString("mod3"));
+
+            // changed files are looked at again, removed ones are forgotten
+            makeMod(FS::PathCombine(modsDir, "mod1.jar"), "changed", 4);
+            QVERIFY(QFile::remove(FS::PathCombine(modsDir, "mod4.jar")));
+            scan(model);
+            QCOMPARE(int(model.size()), 4);
+            QCOMPARE(nameOf(model, "mod1.jar"), QString("changed"));
+        }
+
+        ENV.initModDetailsCache(cachePath);
+        QCOMPARE(ENV.modDetailsCache()->size(), 4);
+        std::shared_ptr<ModDetails> details;
+        QVERIFY(ENV.modDetailsCache()->find(QFileInfo(FS::PathCombine(modsDir, "mod1.jar")), details));
+        QVERIFY(details);
+        QCOMPARE(details->name, QString("changed"));
+        QVERIFY(!ENV.modDetailsCache()->find(QFileInfo(FS::PathCombine(modsDir, "mod4.jar")), details));
+    }
+
+    void test_batchedUpdates()
+    {
+        QTemporaryDir tempDir;
+        auto modsDir = FS::PathCombine(tempDir.path(), "mods");
+        FS::ensureFolderPathExists(modsDir);
+        for(int i = 0; i < 100; i++)
+        {
+            makeMod(FS::PathCombine(modsDir, QString("mod%1.jar").arg(i)), QString("mod%1").arg(i), 2);
+        }
+        ENV.initModDetailsCache(FS::PathCombine(tempDir.path(), "moddetails.dat"));
+
+        ModFolderModel model(modsDir);
+        QSignalSpy changed(&model, &ModFolderModel::dataChanged);
+        scan(model);
+        QCOMPARE(int(model.size()), 100);
+        QCOMPARE(nameOf(model, "mod42.jar"), QString("mod42"));
+        // the last batch is still to come
+        QTRY_VERIFY(changed.count() > 0);
+        QVERIFY(changed.count() < 100);
+
+        // mods that go away before they are looked at are not looked at
+        for(int i = 0; i < 100; i++)
+        {
+            makeMod(FS::PathCombine(modsDir, QString("mod%1.jar").arg(i)), QString("new%1").arg(i), 3);
+        }
+        QSignalSpy updated(&model, &ModFolderModel::updateFinished);
+        QVERIFY(model.update());
+        QVERIFY(updated.wait(60000));
+        for(int i = 0; i < 100; i++)
+        {
+            QVERIFY(QFile::remove(FS::PathCombine(modsDir, QString("mod%1.jar").arg(i))));
+        }
+        scan(model);
+        QCOMPARE(int(model.size()), 0);
+    }
+
+    void benchmark_scan_data()
+    {
+        QTest::addColumn<bool>("warm");
+        QTest::newRow("cold") << false;
+        QTest::newRow("warm") << true;
+    }
+
+    // opening the mods page of a big pack after a restart
+    void benchmark_scan()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, warm);
+        QTemporaryDir tempDir;
+        auto modsDir = FS::PathCombine(tempDir.path(), "mods");
+        auto cachePath = FS::PathCombine(tempDir.path(), "moddetails.dat");
+        FS::ensureFolderPathExists(modsDir);
+        for(int i = 0; i < 500; i++)
+        {
+            makeMod(FS::PathCombine(modsDir, QString("mod%1.jar").arg(i, 3, 10, QChar('0'))), QString("mod%1").arg(i), 50);
+        }
+        if(warm)
+        {
+            ENV.initModDetailsCache(cachePath);
+            ModFolderModel model(modsDir);
+            scan(model);
+        }
+
+        QBENCHMARK
+        {
+            if(!warm)
+            {
+                QFile::remove(cachePath);
+            }
+            ENV.initModDetailsCache(cachePath);
+            ModFolderModel model(modsDir);
+            scan(model);
+            QCOMPARE(int(model.size()), 500);
+            QCOMPARE(nameOf(model, "mod499.jar"), QString("mod499"));
+        }
+    }
 };
 
 QTEST_GUILESS_MAIN(ModFolderModelTest)
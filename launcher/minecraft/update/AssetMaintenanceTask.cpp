@@ -0,0 +1,287 @@
+#include "AssetMaintenanceTask.h"
+#include "Env.h"
+#include "net/Download.h"
+#include "net/ChecksumValidator.h"
+#include "net/FileSink.h"
+#include "FileSystem.h"
+
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QDirIterator>
+
+namespace {
+struct VerifyObject
+{
+    typedef AssetMaintenanceTask::Verdict result_type;
+
+    QAtomicInt * aborted;
+
+    AssetMaintenanceTask::Verdict operator()(const AssetObject & object) const
+    {
+        if (aborted->loadAcquire())
+        {
+            return AssetMaintenanceTask::Verdict::Skipped;
+        }
+        auto path = object.getLocalPath();
+        // a launch is downloading it right now, it's only incomplete
+        if (Net::FileSink::isBeingWritten(path))
+        {
+            return AssetMaintenanceTask::Verdict::Skipped;
+        }
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            return AssetMaintenanceTask::Verdict::Missing;
+        }
+        auto identity = FS::fileIdentity(path);
+        if (file.size() != object.size)
+        {
+            file.close();
+            return removeCorrupt(path, identity);
+        }
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        char buffer[64 * 1024];
+        qint64 read;
+        while ((read = file.read(buffer, sizeof(buffer))) > 0)
+        {
+            hash.addData(buffer, int(read));
+            if (aborted->loadAcquire())
+            {
+                return AssetMaintenanceTask::Verdict::Skipped;
+            }
+        }
+        auto expected = QByteArray::fromRawData(reinterpret_cast<const char *>(object.hash), sizeof(object.hash));
+        if (read < 0 || hash.result() != expected)
+        {
+            file.close();
+            return removeCorrupt(path, identity);
+        }
+        return AssetMaintenanceTask::Verdict::Good;
+    }
+
+    AssetMaintenanceTask::Verdict removeCorrupt(const QString & path, quint64 identity) const
+    {
+        // a download may have started replacing it in the meantime. That one is left alone.
+        if (!Net::FileSink::removeIfIdle(path, identity))
+        {
+            return AssetMaintenanceTask::Verdict::Skipped;
+        }
+        qWarning() << "Asset object" << path << "was corrupt, removed it";
+        return AssetMaintenanceTask::Verdict::Corrupt;
+    }
+};
+}
+
+AssetMaintenanceTask::AssetMaintenanceTask(QList<MojangAssetIndexInfo::Ptr> referenced, bool prefetch)
+    : Task(), m_referenced(referenced), m_prefetch(prefetch)
+{
+    m_batchDelay.setSingleShot(true);
+    connect(&m_batchDelay, &QTimer::timeout, this, &AssetMaintenanceTask::startBatch);
+    connect(&m_watcher, &QFutureWatcher<Verdict>::finished, this, &AssetMaintenanceTask::batchFinished);
+}
+
+void AssetMaintenanceTask::executeTask()
+{
+    m_aborted.storeRelease(0);
+    setStatus(tr("Getting asset indexes..."));
+    auto job = new NetJob(tr("Asset indexes"));
+    job->setPriority(Net::Priority::Background);
+    QSet<QString> seen;
+    for (auto & assets : m_referenced)
+    {
+        if (!m_prefetch || seen.contains(assets->id) || QFile::exists("assets/indexes/" + assets->id + ".json"))
+        {
+            continue;
+        }
+        seen.insert(assets->id);
+        auto entry = ENV.metacache()->resolveEntry("asset_indexes", assets->id + ".json");
+        entry->setStale(true);
+        auto dl = Net::Download::makeCached(assets->url, entry);
+        if (!assets->sha1.isEmpty())
+        {
+            dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, QByteArray::fromHex(assets->sha1.toLatin1())));
+        }
+        job->addNetAction(dl);
+    }
+    m_job.reset(job);
+    if (!m_job->size())
+    {
+        indexesFinished();
+        return;
+    }
+    // an index that can't be fetched only means its objects can't be fetched either
+    connect(m_job.get(), &NetJob::finished, this, &AssetMaintenanceTask::indexesFinished);
+    m_job->start();
+}
+
+void AssetMaintenanceTask::indexesFinished()
+{
+    m_job.reset();
+    if (m_aborted.loadAcquire())
+    {
+        emitAborted();
+        return;
+    }
+
+    // every object of every index we know, once
+    m_objects.clear();
+    QSet<QString> seen;
+    QDirIterator iter("assets/indexes", {"*.json"}, QDir::Files);
+    while (iter.hasNext())
+    {
+        auto path = iter.next();
+        auto index = AssetsUtils::loadAssetsIndex(iter.fileInfo().completeBaseName(), path);
+        if (!index)
+        {
+            continue;
+        }
+        for (auto & object : index->objects)
+        {
+            auto hash = object.hashString();
+            if (!seen.contains(hash))
+            {
+                seen.insert(hash);
+                m_objects.append(object);
+            }
+        }
+    }
+
+    setStatus(tr("Verifying %n asset(s)...", "", m_objects.size()));
+    m_verdicts.clear();
+    m_verdicts.reserve(m_objects.size());
+    m_next = 0;
+    startBatch();
+}
+
+void AssetMaintenanceTask::startBatch()
+{
+    if (m_aborted.loadAcquire())
+    {
+        emitAborted();
+        return;
+    }
+    if (m_next >= m_objects.size())
+    {
+        verifyFinished();
+        return;
+    }
+    // about a second worth of reading. Between batches, the pool is left alone until the rate allows more.
+    int end = m_next;
+    m_batchBytes = 0;
+    while (end < m_objects.size())
+    {
+        bool fits = m_bytesPerSecond <= 0 || m_batchBytes + m_objects[end].size <= m_bytesPerSecond;
+        if (end > m_next && !fits)
+        {
+            break;
+        }
+        m_batchBytes += m_objects[end].size;
+        end++;
+    }
+    m_batchTime.start();
+    m_future = QtConcurrent::mapped(m_objects.mid(m_next, end - m_next), VerifyObject{&m_aborted});
+    m_next = end;
+    m_watcher.setFuture(m_future);
+}
+
+void AssetMaintenanceTask::batchFinished()
+{
+    if (m_aborted.loadAcquire() || m_future.isCanceled())
+    {
+        emitAborted();
+        return;
+    }
+    for (auto verdict : m_future.results())
+    {
+        m_verdicts.append(verdict);
+    }
+    setProgress(m_next, m_objects.size());
+    qint64 wait = 0;
+    if (m_bytesPerSecond > 0 && m_next < m_objects.size())
+    {
+        wait = m_batchBytes * 1000 / m_bytesPerSecond - m_batchTime.elapsed();
+    }
+    m_batchDelay.start(int(qMax<qint64>(wait, 0)));
+}
+
+void AssetMaintenanceTask::verifyFinished()
+{
+    m_verified = m_missing = m_corrupt = 0;
+    auto job = new NetJob(tr("Assets"));
+    job->setPriority(Net::Priority::Background);
+    for (int i = 0; i < m_objects.size(); i++)
+    {
+        auto verdict = m_verdicts[i];
+        if (verdict == Verdict::Good)
+        {
+            m_verified++;
+            continue;
+        }
+        if (verdict == Verdict::Skipped)
+        {
+            // somebody else is downloading it
+            continue;
+        }
+        if (verdict == Verdict::Missing)
+        {
+            m_missing++;
+        }
+        else if (verdict == Verdict::Corrupt)
+        {
+            m_corrupt++;
+        }
+        if (m_prefetch)
+        {
+            auto dl = m_objects[i].getDownloadAction();
+            if (dl)
+            {
+                job->addNetAction(dl);
+            }
+        }
+    }
+    m_objects.clear();
+    m_verdicts.clear();
+    qDebug() << "Asset maintenance:" << m_verified << "good," << m_missing << "missing," << m_corrupt << "corrupt";
+
+    m_job.reset(job);
+    if (!m_job->size())
+    {
+        m_job.reset();
+        emitSucceeded();
+        return;
+    }
+    setStatus(tr("Downloading %n asset(s)...", "", m_job->size()));
+    connect(m_job.get(), &NetJob::succeeded, this, &AssetMaintenanceTask::emitSucceeded);
+    connect(m_job.get(), &NetJob::failed, this, [this](QString reason)
+    {
+        if (m_aborted.loadAcquire())
+        {
+            emitAborted();
+            return;
+        }
+        emitFailed(reason);
+    });
+    connect(m_job.get(), &NetJob::progress, this, &AssetMaintenanceTask::setProgress);
+    m_job->start();
+}
+
+bool AssetMaintenanceTask::abort()
+{
+    m_aborted.storeRelease(1);
+    if (m_future.isRunning())
+    {
+        m_future.cancel();
+    }
+    else if (m_batchDelay.isActive())
+    {
+        // waiting for the next batch, nothing else is going on
+        m_batchDelay.stop();
+        emitAborted();
+        return true;
+    }
+    if (m_job)
+    {
+        return m_job->abort();
+    }
+    return true;
+}
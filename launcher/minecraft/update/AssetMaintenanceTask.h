@@ -0,0 +1,98 @@
+#pragma once
+
+#include "tasks/Task.h"
+#include "net/NetJob.h"
+#include "minecraft/MojangDownloadInfo.h"
+#include "minecraft/AssetsUtils.h"
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <memory>
+
+/**
+ * Keeps the shared assets store healthy, so launches don't have to wait for it.
+ *
+ * Fetches the asset indexes that are referenced but not on disk yet, then checks every object of every known index
+ * against its SHA1. Corrupt objects are removed. With prefetching, missing and removed objects are downloaded.
+ *
+ * Hashing happens on the global thread pool in batches. Each batch waits until the ones before it are within a number
+ * of bytes per second, so it doesn't get in the way.
+ */
+class AssetMaintenanceTask : public Task
+{
+    Q_OBJECT
+public: /* types */
+    enum class Verdict
+    {
+        Good,
+        Missing,
+        Corrupt,
+        Skipped
+    };
+
+public: /* con/des */
+    AssetMaintenanceTask(QList<MojangAssetIndexInfo::Ptr> referenced, bool prefetch);
+    virtual ~AssetMaintenanceTask() {};
+
+public: /* methods */
+    bool canAbort() const override
+    {
+        return true;
+    }
+
+    /// Limit hashing to this many bytes per second. 0 means no limit.
+    void setBytesPerSecond(qint64 bytesPerSecond)
+    {
+        m_bytesPerSecond = bytesPerSecond;
+    }
+
+    /// Number of objects checked, missing and found corrupt by the last run
+    int verified() const
+    {
+        return m_verified;
+    }
+    int missing() const
+    {
+        return m_missing;
+    }
+    int corrupt() const
+    {
+        return m_corrupt;
+    }
+
+public slots:
+    bool abort() override;
+
+protected:
+    void executeTask() override;
+
+private slots:
+    void indexesFinished();
+    void startBatch();
+    void batchFinished();
+
+private:
+    void verifyFinished();
+
+private: /* data */
+    QList<MojangAssetIndexInfo::Ptr> m_referenced;
+    bool m_prefetch;
+    qint64 m_bytesPerSecond = 16 * 1024 * 1024;
+    QVector<AssetObject> m_objects;
+    QVector<Verdict> m_verdicts;
+    /// first object of the next batch
+    int m_next = 0;
+    qint64 m_batchBytes = 0;
+    QElapsedTimer m_batchTime;
+    QTimer m_batchDelay;
+    QFuture<Verdict> m_future;
+    QFutureWatcher<Verdict> m_watcher;
+    QAtomicInt m_aborted;
+    NetJobPtr m_job;
+    int m_verified = 0;
+    int m_missing = 0;
+    int m_corrupt = 0;
+};
@@ -0,0 +1,111 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include "TestUtil.h"
+
+#include "minecraft/update/AssetMaintenanceTask.h"
+#include "FileSystem.h"
+#include "net/FileSink.h"
+
+class AssetMaintenanceTaskTest : public QObject
+{
+    Q_OBJECT
+
+    QString writeObject(const QByteArray & data)
+    {
+        QString hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+        FS::write(FS::PathCombine("assets", "objects", hash.left(2), hash), data);
+        return hash;
+    }
+
+    void runTask(AssetMaintenanceTask & task)
+    {
+        QEventLoop loop;
+        connect(&task, &Task::finished, &loop, &QEventLoop::quit);
+        task.start();
+        if(!task.isFinished())
+        {
+            loop.exec();
+        }
+    }
+
+private
+slots:
+    void test_verify_data()
+    {
+        QTest::addColumn<qint64>("bytesPerSecond");
+        QTest::newRow("unlimited") << qint64(0);
+        // about two batches
+        QTest::newRow("limited") << qint64(200000);
+    }
+
+    void test_verify()
+    {
+        QFETCH(qint64, bytesPerSecond);
+        QTemporaryDir dir;
+        auto oldCurrent = QDir::currentPath();
+        QDir::setCurrent(dir.path());
+
+        QJsonObject objects;
+        QStringList hashes;
+        for(int i = 0; i < 30; i++)
+        {
+            QByteArray data(10000 + i, char('a' + i % 26));
+            auto hash = writeObject(data);
+            hashes.append(hash);
+            QJsonObject object;
+            object.insert("hash", hash);
+            object.insert("size", data.size());
+            objects.insert(QString("object%1").arg(i), object);
+        }
+        QJsonObject index;
+        index.insert("objects", objects);
+        FS::write("assets/indexes/one.json", QJsonDocument(index).toJson());
+        // a second index sharing the objects doesn't make them checked twice
+        FS::write("assets/indexes/two.json", QJsonDocument(index).toJson());
+
+        // flipped contents with the same size, a truncated file and a missing one
+        auto flipped = FS::PathCombine("assets", "objects", hashes[3].left(2), hashes[3]);
+        FS::write(flipped, QByteArray(10003, 'z'));
+        auto truncated = FS::PathCombine("assets", "objects", hashes[4].left(2), hashes[4]);
+        FS::write(truncated, QByteArray(10, 'e'));
+        QVERIFY(QFile::remove(FS::PathCombine("assets", "objects", hashes[5].left(2), hashes[5])));
+        // and one a download is still writing
+        auto downloading = FS::PathCombine("assets", "objects", hashes[6].left(2), hashes[6]);
+        FS::write(downloading, QByteArray(100, 'd'));
+        Net::FileSink sink(downloading, true);
+        QNetworkRequest request;
+        QCOMPARE(sink.init(request), Job_InProgress);
+
+        AssetMaintenanceTask task({}, false);
+        task.setBytesPerSecond(bytesPerSecond);
+        QElapsedTimer timer;
+        timer.start();
+        runTask(task);
+        QVERIFY(task.wasSuccessful());
+        if(bytesPerSecond)
+        {
+            // the second batch had to wait for the first to be within the limit
+            QVERIFY(timer.elapsed() >= 900);
+        }
+        QCOMPARE(task.verified(), 26);
+        QCOMPARE(task.corrupt(), 2);
+        QCOMPARE(task.missing(), 1);
+        // corrupt objects are removed, so they get downloaded again
+        QVERIFY(!QFile::exists(flipped));
+        QVERIFY(!QFile::exists(truncated));
+        // the download is left to finish
+        QVERIFY(QFile::exists(downloading));
+        sink.abort();
+
+        QDir::setCurrent(oldCurrent);
+    }
+};
+
+QTEST_GUILESS_MAIN(AssetMaintenanceTaskTest)
+
+#include "AssetMaintenanceTask_test.moc"
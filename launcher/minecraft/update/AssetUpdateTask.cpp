@@ -51,7 +51,6 @@ bool AssetUpdateTask::canAbort() const
 
 void AssetUpdateTask::assetIndexFinished()
 {
-    AssetsIndex index;
     qDebug() << m_inst->name() << ": Finished asset index download";
 
     auto components = m_inst->getPackProfile();
@@ -60,15 +59,17 @@ void AssetUpdateTask::assetIndexFinished()
 
     QString asset_fname = "assets/indexes/" + assets->id + ".json";
     // FIXME: this looks like a job for a generic validator based on json schema?
-    if (!AssetsUtils::loadAssetsIndexJson(assets->id, asset_fname, index))
+    auto index = AssetsUtils::loadAssetsIndex(assets->id, asset_fname);
+    if (!index)
     {
         auto metacache = ENV.metacache();
         auto entry = metacache->resolveEntry("asset_indexes", assets->id + ".json");
         metacache->evictEntry(entry);
         emitFailed(tr("Failed to read the assets index!"));
+        return;
     }
 
-    auto job = index.getDownloadJob();
+    auto job = index->getDownloadJob();
     if(job)
     {
         setStatus(tr("Getting the assets files from Mojang..."));
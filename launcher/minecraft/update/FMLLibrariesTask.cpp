@@ -60,6 +60,7 @@ void FMLLibrariesTask::executeTask()
     // download missing libs to our place
     setStatus(tr("Downloading FML libraries..."));
     auto dljob = new NetJob("FML libraries");
+    dljob->setPriority(Net::Priority::Blocking);
     auto metacache = ENV.metacache();
     for (auto &lib : fmlLibsToProcess)
     {
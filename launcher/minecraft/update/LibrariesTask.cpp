@@ -12,6 +12,40 @@ void LibrariesTask::executeTask()
 {
     setStatus(tr("Getting the library files from Mojang..."));
     qDebug() << m_inst->name() << ": downloading libraries";
+
+    // Resolve everything without hashing on this thread. Files that look changed are checked in bulk afterwards.
+    auto metacache = ENV.metacache();
+    metacache->setDeferVerification(true);
+    bool built = buildDownloadJob();
+    metacache->setDeferVerification(false);
+    auto unverified = metacache->takeUnverifiedEntries();
+    if(!built)
+    {
+        return;
+    }
+    if(unverified.isEmpty())
+    {
+        startDownloadJob();
+        return;
+    }
+
+    qDebug() << m_inst->name() << ": verifying" << unverified.size() << "changed library files";
+    verifyTask = metacache->verifyEntries(unverified);
+    connect(verifyTask.get(), &Task::succeeded, this, [this]()
+    {
+        // the files that didn't match are stale now, and will get downloaded
+        if(buildDownloadJob())
+        {
+            startDownloadJob();
+        }
+    });
+    connect(verifyTask.get(), &Task::failed, this, &LibrariesTask::emitFailed);
+    connect(verifyTask.get(), &Task::progress, this, &LibrariesTask::progress);
+    verifyTask->start();
+}
+
+bool LibrariesTask::buildDownloadJob()
+{
     MinecraftInstance *inst = (MinecraftInstance *)m_inst;
 
     // Build a list of URLs that will need to be downloaded.
@@ -19,6 +53,8 @@ void LibrariesTask::executeTask()
     auto profile = components->getProfile();
 
     auto job = new NetJob(tr("Libraries for instance %1").arg(inst->name()));
+    // the launch can't go on without these
+    job->setPriority(Net::Priority::Blocking);
     downloadJob.reset(job);
 
     auto metacache = ENV.metacache();
@@ -57,9 +93,14 @@ void LibrariesTask::executeTask()
         downloadJob.reset();
         QString failed_all = (failedLocalLibraries + failedLocalJarMods).join("\n");
         emitFailed(tr("Some artifacts marked as 'local' are missing their files:\n%1\n\nYou need to either add the files, or removed the packages that require them.\nYou'll have to correct this problem manually.").arg(failed_all));
-        return;
+        return false;
     }
+    return true;
+}
 
+void LibrariesTask::startDownloadJob()
+{
+    setStatus(tr("Getting the library files from Mojang..."));
     connect(downloadJob.get(), &NetJob::succeeded, this, &LibrariesTask::emitSucceeded);
     connect(downloadJob.get(), &NetJob::failed, this, &LibrariesTask::jarlibFailed);
     connect(downloadJob.get(), &NetJob::progress, this, &LibrariesTask::progress);
@@ -78,6 +119,10 @@ void LibrariesTask::jarlibFailed(QString reason)
 
 bool LibrariesTask::abort()
 {
+    if(verifyTask && verifyTask->isRunning())
+    {
+        return verifyTask->abort();
+    }
     if(downloadJob)
     {
         return downloadJob->abort();
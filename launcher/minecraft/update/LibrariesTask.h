@@ -17,10 +17,15 @@ public:
 private slots:
     void jarlibFailed(QString reason);
 
+private:
+    bool buildDownloadJob();
+    void startDownloadJob();
+
 public slots:
     bool abort() override;
 
 private:
     MinecraftInstance *m_inst;
     NetJobPtr downloadJob;
+    shared_qobject_ptr<Task> verifyTask;
 };
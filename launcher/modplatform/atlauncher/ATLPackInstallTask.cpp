@@ -32,6 +32,11 @@ bool PackInstallTask::abort()
     {
         return jobPtr->abort();
     }
+    if(m_extractFutureWatcher.isRunning())
+    {
+        m_extractProgress->canceled = true;
+        return true;
+    }
     return false;
 }
 
@@ -455,9 +460,26 @@ void PackInstallTask::extractConfigs()
         return;
     }
 
-    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractDir, archivePath, extractDir.absolutePath() + "/minecraft");
+    m_extractProgress = std::make_shared<MMCZip::ExtractProgress>();
+    auto progress = m_extractProgress;
+    auto zipPath = archivePath;
+    auto target = extractDir.absolutePath() + "/minecraft";
+    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), [progress, zipPath, target]()
+    {
+        return MMCZip::extractDir(zipPath, target, progress);
+    });
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::finished, this, [&]()
     {
+        if(!m_extractFuture.result())
+        {
+            if(m_extractProgress->canceled)
+            {
+                emitAborted();
+                return;
+            }
+            emitFailed(tr("Failed to extract pack configs"));
+            return;
+        }
         downloadMods();
     });
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::canceled, this, [&]()
@@ -5,6 +5,7 @@
 
 #include "InstanceTask.h"
 #include "net/NetJob.h"
+#include "MMCZip.h"
 #include "settings/INISettingsObject.h"
 #include "minecraft/MinecraftInstance.h"
 #include "minecraft/PackProfile.h"
@@ -92,6 +93,7 @@ private:
 
     QFuture<nonstd::optional<QStringList>> m_extractFuture;
     QFutureWatcher<nonstd::optional<QStringList>> m_extractFutureWatcher;
+    MMCZip::ExtractProgressPtr m_extractProgress;
 
     QFuture<bool> m_modExtractFuture;
     QFutureWatcher<bool> m_modExtractFutureWatcher;
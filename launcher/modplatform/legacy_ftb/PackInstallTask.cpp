@@ -88,7 +88,14 @@ void PackInstallTask::unzip()
         return;
     }
 
-    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractDir, archivePath, extractDir.absolutePath() + "/unzip");
+    m_extractProgress = std::make_shared<MMCZip::ExtractProgress>();
+    auto progress = m_extractProgress;
+    auto zipPath = archivePath;
+    auto target = extractDir.absolutePath() + "/unzip";
+    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), [progress, zipPath, target]()
+    {
+        return MMCZip::extractDir(zipPath, target, progress);
+    });
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::finished, this, &PackInstallTask::onUnzipFinished);
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::canceled, this, &PackInstallTask::onUnzipCanceled);
     m_extractFutureWatcher.setFuture(m_extractFuture);
@@ -96,6 +103,16 @@ void PackInstallTask::unzip()
 
 void PackInstallTask::onUnzipFinished()
 {
+    if(!m_extractFuture.result())
+    {
+        if(m_extractProgress->canceled)
+        {
+            emitAborted();
+            return;
+        }
+        emitFailed(tr("Failed to extract modpack"));
+        return;
+    }
     install();
 }
 
@@ -208,6 +225,11 @@ bool PackInstallTask::abort()
     {
         return netJobContainer->abort();
     }
+    if(m_extractFutureWatcher.isRunning())
+    {
+        m_extractProgress->canceled = true;
+        return true;
+    }
     return false;
 }
 
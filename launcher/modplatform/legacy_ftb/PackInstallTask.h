@@ -7,6 +7,7 @@
 #include "meta/Version.h"
 #include "meta/VersionList.h"
 #include "PackHelpers.h"
+#include "MMCZip.h"
 
 #include <nonstd/optional>
 
@@ -45,6 +46,7 @@ private: /* data */
     std::unique_ptr<QuaZip> m_packZip;
     QFuture<nonstd::optional<QStringList>> m_extractFuture;
     QFutureWatcher<nonstd::optional<QStringList>> m_extractFutureWatcher;
+    MMCZip::ExtractProgressPtr m_extractProgress;
     NetJobPtr netJobContainer;
     QString archivePath;
 
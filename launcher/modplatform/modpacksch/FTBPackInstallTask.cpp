@@ -115,7 +115,12 @@ void PackInstallTask::downloadPack()
         qDebug() << "Will download" << file.url << "to" << path;
         filesToCopy[path] = entry->getFullPath();
 
-        auto dl = Net::Download::makeCached(file.url, entry);
+        Net::Download::Options options;
+        if (!file.sha1.isEmpty()) {
+            // the cached jar is never touched again, the instance gets a copy of it
+            options |= Net::Download::Option::StoreContent;
+        }
+        auto dl = Net::Download::makeCached(file.url, entry, options);
         if (!file.sha1.isEmpty()) {
             auto rawSha1 = QByteArray::fromHex(file.sha1.toLatin1());
             dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, rawSha1));
@@ -26,6 +26,7 @@ Technic::SingleZipPackInstallTask::SingleZipPackInstallTask(const QUrl &sourceUr
 {
     m_sourceUrl = sourceUrl;
     m_minecraftVersion = minecraftVersion;
+    connect(&m_extractProgressTimer, &QTimer::timeout, this, &Technic::SingleZipPackInstallTask::extractProgress);
 }
 
 bool Technic::SingleZipPackInstallTask::abort() {
@@ -33,6 +34,11 @@ bool Technic::SingleZipPackInstallTask::abort() {
     {
         return m_filesNetJob->abort();
     }
+    if(m_extractFutureWatcher.isRunning())
+    {
+        m_extractProgress->canceled = true;
+        return true;
+    }
     return false;
 }
 
@@ -68,10 +74,12 @@ void Technic::SingleZipPackInstallTask::downloadSucceeded()
         emitFailed(tr("Unable to open supplied modpack zip file."));
         return;
     }
-    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractSubDir, m_packZip.get(), QString(""), extractDir.absolutePath());
+    m_extractProgress = std::make_shared<MMCZip::ExtractProgress>();
+    m_extractFuture = QtConcurrent::run(QThreadPool::globalInstance(), MMCZip::extractSubDir, m_packZip.get(), QString(""), extractDir.absolutePath(), m_extractProgress);
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::finished, this, &Technic::SingleZipPackInstallTask::extractFinished);
     connect(&m_extractFutureWatcher, &QFutureWatcher<QStringList>::canceled, this, &Technic::SingleZipPackInstallTask::extractAborted);
     m_extractFutureWatcher.setFuture(m_extractFuture);
+    m_extractProgressTimer.start(100);
     m_filesNetJob.reset();
 }
 
@@ -90,9 +98,15 @@ void Technic::SingleZipPackInstallTask::downloadProgressChanged(qint64 current,
 
 void Technic::SingleZipPackInstallTask::extractFinished()
 {
+    m_extractProgressTimer.stop();
     m_packZip.reset();
     if (!m_extractFuture.result())
     {
+        if (m_extractProgress->canceled)
+        {
+            emitAborted();
+            return;
+        }
         emitFailed(tr("Failed to extract modpack"));
         return;
     }
@@ -135,6 +149,11 @@ void Technic::SingleZipPackInstallTask::extractFinished()
     packProcessor->run(m_globalSettings, m_instName, m_instIcon, m_stagingPath, m_minecraftVersion);
 }
 
+void Technic::SingleZipPackInstallTask::extractProgress()
+{
+    setByteProgress(m_extractProgress->done, m_extractProgress->total);
+}
+
 void Technic::SingleZipPackInstallTask::extractAborted()
 {
     emitFailed(tr("Instance import has been aborted."));
@@ -17,10 +17,12 @@
 
 #include "InstanceTask.h"
 #include "net/NetJob.h"
+#include "MMCZip.h"
 
 #include "quazip.h"
 
 #include <QFutureWatcher>
+#include <QTimer>
 #include <QStringList>
 #include <QUrl>
 
@@ -48,6 +50,7 @@ private slots:
     void downloadProgressChanged(qint64 current, qint64 total);
     void extractFinished();
     void extractAborted();
+    void extractProgress();
 
 private:
     bool m_abortable = false;
@@ -59,6 +62,8 @@ private:
     std::unique_ptr<QuaZip> m_packZip;
     QFuture<nonstd::optional<QStringList>> m_extractFuture;
     QFutureWatcher<nonstd::optional<QStringList>> m_extractFutureWatcher;
+    MMCZip::ExtractProgressPtr m_extractProgress;
+    QTimer m_extractProgressTimer;
 };
 
 } // namespace Technic
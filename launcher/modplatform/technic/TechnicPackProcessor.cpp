@@ -127,6 +127,8 @@ void Technic::TechnicPackProcessor::run(SettingsObjectPtr globalSettings, const
             }
 
             components->saveNow();
+            // the staging folder is moved into place as soon as this succeeds
+            instanceSettings->flush();
             emit succeeded();
             return;
         }
@@ -204,5 +206,6 @@ void Technic::TechnicPackProcessor::run(SettingsObjectPtr globalSettings, const
     }
 
     components->saveNow();
+    instanceSettings->flush();
     emit succeeded();
 }
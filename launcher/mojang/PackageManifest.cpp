@@ -3,8 +3,13 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QCryptographicHash>
+#include <QThreadPool>
+#include <QHash>
+#include <QtConcurrent>
 #include <QDebug>
 
+#include "FileSystem.h"
+
 #ifndef Q_OS_WIN32
 #include <unistd.h>
 #include <sys/types.h>
@@ -105,6 +110,7 @@ void fromJson(QJsonDocument & doc, Package & out) {
         }
         else if(type == "file") {
             FileSource bestSource;
+            QString rawUrl;
             File file;
             file.executable = Json::ensureBoolean(fileObject, QString("executable"), false);
             auto downloads = Json::requireObject(fileObject, "downloads");
@@ -120,6 +126,7 @@ void fromJson(QJsonDocument & doc, Package & out) {
                 if(compression == "raw") {
                     file.hash = source.hash;
                     file.size = source.size;
+                    rawUrl = source.url;
                     source.compression = Compression::Raw;
                 }
                 else if (compression == "lzma") {
@@ -133,8 +140,13 @@ void fromJson(QJsonDocument & doc, Package & out) {
             if(bestSource.isBad()) {
                 throw JSONValidationError("No valid compression method for file " + iter.key());
             }
+            if(rawUrl.isEmpty()) {
+                throw JSONValidationError("No raw download for file " + iter.key());
+            }
+            bestSource.rawUrl = rawUrl;
             out.addFile(objectPath, file);
-            out.addSource(bestSource);
+            // sources are looked up by the hash of the file, not of whatever the source delivers
+            out.sources[file.hash] = bestSource;
         }
         else if(type == "link") {
             auto target = Json::requireString(fileObject, "target");
@@ -226,12 +238,104 @@ bool actually_read_symlink_target(const QString & filepath, Path & out)
 }
 #endif
 
+namespace {
+// what a file looked like when it was hashed
+struct CachedHash
+{
+    qint64 size = 0;
+    qint64 modified = 0;
+    Hash hash;
+};
+using HashCache = QHash<QString, CachedHash>;
+
+const int HASH_CACHE_FORMAT_VERSION = 1;
+
+HashCache loadHashCache(const QString & filename)
+{
+    HashCache out;
+    if(!QFile::exists(filename))
+    {
+        return out;
+    }
+    try
+    {
+        auto root = Json::requireObject(Json::requireDocument(filename, "Hash cache"));
+        if(Json::ensureInteger(root, "formatVersion", 0) != HASH_CACHE_FORMAT_VERSION)
+        {
+            return out;
+        }
+        auto files = Json::requireObject(root, "files");
+        for(auto iter = files.begin(); iter != files.end(); iter++)
+        {
+            auto entry = Json::requireObject(iter.value());
+            CachedHash cached;
+            cached.size = qint64(Json::requireDouble(entry, "size"));
+            cached.modified = qint64(Json::requireDouble(entry, "modified"));
+            cached.hash = Json::requireString(entry, "sha1");
+            out.insert(iter.key(), cached);
+        }
+    }
+    catch (const Exception &e)
+    {
+        qWarning() << "Folder inspection: Ignoring broken hash cache" << filename << ":" << e.cause();
+        out.clear();
+    }
+    return out;
+}
+
+void saveHashCache(const QString & filename, const HashCache & cache)
+{
+    QJsonObject files;
+    for(auto iter = cache.begin(); iter != cache.end(); iter++)
+    {
+        QJsonObject entry;
+        entry.insert("size", double(iter->size));
+        entry.insert("modified", double(iter->modified));
+        entry.insert("sha1", iter->hash);
+        files.insert(iter.key(), entry);
+    }
+    QJsonObject root;
+    root.insert("formatVersion", HASH_CACHE_FORMAT_VERSION);
+    root.insert("files", files);
+    try
+    {
+        FS::write(filename, QJsonDocument(root).toJson(QJsonDocument::Compact));
+    }
+    catch (const Exception &e)
+    {
+        qWarning() << "Folder inspection: Failed to save hash cache" << filename << ":" << e.cause();
+    }
+}
+
+// a file waiting for its hash
+struct PendingFile
+{
+    Path path;
+    QString filePath;
+    File file;
+    qint64 modified = 0;
+    QFuture<QByteArray> hash;
+};
+}
+
 // FIXME: Qt filesystem abstraction is bad, but ... let's hope it doesn't break too much?
 // FIXME: The error handling is just DEFICIENT
-Package Package::fromInspectedFolder(const QString& folderPath)
+Package Package::fromInspectedFolder(const QString& folderPath, const QString& hashCacheFile)
 {
     QDir root(folderPath);
 
+    HashCache cache;
+    HashCache newCache;
+    if(!hashCacheFile.isEmpty())
+    {
+        cache = loadHashCache(hashCacheFile);
+    }
+
+    // each hashing thread reads through a small fixed buffer, it's the disk that's the limit here
+    QThreadPool pool;
+    pool.setMaxThreadCount(FS::ioThreadCount());
+    std::vector<PendingFile> pending;
+
     Package out;
     QDirIterator iterator(folderPath, QDir::NoDotAndDotDot | QDir::AllEntries | QDir::System | QDir::Hidden, QDirIterator::Subdirectories);
     while(iterator.hasNext()) {
@@ -261,15 +365,21 @@ Package Package::fromInspectedFolder(const QString& folderPath)
             File f;
             f.executable = fileInfo.isExecutable();
             f.size = fileInfo.size();
-            // FIXME: async / optimize the hashing
-            QFile input(fileInfo.absoluteFilePath());
-            if(!input.open(QIODevice::ReadOnly)) {
-                qCritical() << "Folder inspection: Failed to open file:" << fileInfo.absoluteFilePath();
-                out.valid = false;
-                break;
+            qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+            auto cached = cache.constFind(relPath);
+            if(cached != cache.constEnd() && cached->size == qint64(f.size) && cached->modified == modified) {
+                f.hash = cached->hash;
+                out.addFile(relPath, f);
+                newCache.insert(relPath, *cached);
+                continue;
             }
-            f.hash = QCryptographicHash::hash(input.readAll(), QCryptographicHash::Sha1).toHex().constData();
-            out.addFile(relPath, f);
+            PendingFile file;
+            file.path = relPath;
+            file.filePath = fileInfo.absoluteFilePath();
+            file.file = f;
+            file.modified = modified;
+            file.hash = QtConcurrent::run(&pool, FS::hashFile, file.filePath, QCryptographicHash::Sha1);
+            pending.push_back(file);
         }
         else {
             // Something else... oh my
@@ -278,11 +388,34 @@ Package Package::fromInspectedFolder(const QString& folderPath)
             break;
         }
     }
+
+    for(auto & file: pending) {
+        auto hash = file.hash.result();
+        if(hash.isEmpty()) {
+            qCritical() << "Folder inspection: Failed to read file:" << file.filePath;
+            out.valid = false;
+            continue;
+        }
+        file.file.hash = hash.toHex().constData();
+        out.addFile(file.path, file.file);
+        CachedHash cached;
+        cached.size = file.file.size;
+        cached.modified = file.modified;
+        cached.hash = file.file.hash;
+        newCache.insert(file.path.toString(), cached);
+    }
     out.folders.insert(Path("."));
-    out.valid = true;
+    if(!hashCacheFile.isEmpty() && out.valid) {
+        saveHashCache(hashCacheFile, newCache);
+    }
     return out;
 }
 
+QFuture<Package> Package::inspectFolder(const QString& folderPath, const QString& hashCacheFile)
+{
+    return QtConcurrent::run(&Package::fromInspectedFolder, folderPath, hashCacheFile);
+}
+
 namespace {
 struct shallow_first_sort
 {
@@ -355,7 +488,7 @@ UpdateOperations UpdateOperations::resolve(const Package& from, const Package& t
             out.downloads.emplace(
                 std::pair<Path, FileDownload>{
                     path,
-                    FileDownload(to.sources.at(iter2->second.hash), iter2->second.executable)
+                    FileDownload(to.sources.at(iter2->second.hash), iter2->second)
                 }
             );
         }
@@ -369,7 +502,7 @@ UpdateOperations UpdateOperations::resolve(const Package& from, const Package& t
             out.downloads.emplace(
                 std::pair<Path, FileDownload>{
                     path,
-                    FileDownload(to.sources.at(iter->second.hash), iter->second.executable)
+                    FileDownload(to.sources.at(iter->second.hash), iter->second)
                 }
             );
         }
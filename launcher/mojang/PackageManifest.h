@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QFuture>
 #include <map>
 #include <set>
 #include <QStringList>
@@ -109,6 +110,8 @@ struct FileSource
     Compression compression = Compression::Unknown;
     Hash hash;
     QString url;
+    /// where the same file can be downloaded uncompressed
+    QString rawUrl;
     std::size_t size = 0;
     void upgrade(const FileSource & other) {
         if(compression == Compression::Unknown || other.size < size) {
@@ -128,7 +131,14 @@ struct File
 };
 
 struct Package {
-    static Package fromInspectedFolder(const QString &folderPath);
+    /**
+     * Describe what's in a folder, hashing every file in it.
+     * Files are hashed in parallel while the folder is still being walked.
+     * With a hash cache file, files with the same size and modification time as the last time are not hashed again.
+     */
+    static Package fromInspectedFolder(const QString &folderPath, const QString &hashCacheFile = QString());
+    /// fromInspectedFolder, on another thread
+    static QFuture<Package> inspectFolder(const QString &folderPath, const QString &hashCacheFile = QString());
     static Package fromManifestFile(const QString &path);
     static Package fromManifestContents(const QByteArray& contents);
 
@@ -154,7 +164,12 @@ struct FileDownload : FileSource
         static_cast<FileSource &> (*this) = source;
         this->executable = executable;
     }
+    FileDownload(const FileSource& source, const File& file) : FileDownload(source, file.executable) {
+        fileHash = file.hash;
+    }
     bool executable = false;
+    /// hash of the downloaded file, after decompression
+    Hash fileHash;
 };
 
 struct UpdateOperations {
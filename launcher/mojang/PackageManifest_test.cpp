@@ -1,8 +1,10 @@
 #include <QTest>
 #include <QDebug>
+#include <QTemporaryDir>
 #include "TestUtil.h"
 
 #include "mojang/PackageManifest.h"
+#include "FileSystem.h"
 
 using namespace mojang_files;
 
@@ -23,6 +25,9 @@ private slots:
 #ifndef Q_OS_WIN32
     void test_inspect_symlinks();
 #endif
+    void test_inspect_hash_cache();
+    void benchmark_inspect_data();
+    void benchmark_inspect();
     void mkdir_deep();
     void rmdir_deep();
 
@@ -30,6 +35,7 @@ private slots:
     void changed_file();
     void added_file();
     void removed_file();
+    void compressed_file();
 };
 
 namespace {
@@ -133,6 +139,73 @@ void PackageManifestTest::test_inspect_symlinks() {
 }
 #endif
 
+namespace {
+// a folder with files spread over a few levels of subfolders
+void make_tree(const QString & root, int count) {
+    for(int i = 0; i < count; i++) {
+        auto path = FS::PathCombine(root, QString("dir%1/sub%2/file%3.txt").arg(i % 10).arg(i % 100).arg(i));
+        FS::write(path, QString("contents of file %1\n").arg(i).repeated(1 + i % 50).toUtf8(), false);
+    }
+}
+}
+
+void PackageManifestTest::test_inspect_hash_cache() {
+    QTemporaryDir dir;
+    auto root = FS::PathCombine(dir.path(), "root");
+    auto cacheFile = FS::PathCombine(dir.path(), "hashes.json");
+    make_tree(root, 200);
+
+    auto plain = Package::fromInspectedFolder(root);
+    QVERIFY(plain.valid == true);
+    QVERIFY(plain.files.size() == 200);
+    auto &file = plain.files[Path("dir3/sub13/file13.txt")];
+    auto expected = QCryptographicHash::hash(FS::read(FS::PathCombine(root, "dir3/sub13/file13.txt")), QCryptographicHash::Sha1).toHex();
+    QCOMPARE(file.hash, QString(expected));
+
+    // the first run fills the cache and gives the same result
+    auto first = Package::inspectFolder(root, cacheFile).result();
+    QVERIFY(QFile::exists(cacheFile));
+    QVERIFY(first.files.size() == 200);
+    QCOMPARE(first.files[Path("dir3/sub13/file13.txt")].hash, file.hash);
+
+    // unchanged files come from the cache...
+    auto cache = FS::read(cacheFile);
+    cache.replace(expected, "0000000000000000000000000000000000000000");
+    FS::write(cacheFile, cache);
+    // ...and changed ones are hashed again
+    FS::write(FS::PathCombine(root, "dir4/sub4/file4.txt"), "changed");
+    auto second = Package::fromInspectedFolder(root, cacheFile);
+    QVERIFY(second.valid == true);
+    QCOMPARE(second.files[Path("dir3/sub13/file13.txt")].hash, QString("0000000000000000000000000000000000000000"));
+    QCOMPARE(second.files[Path("dir4/sub4/file4.txt")].hash, QString(QCryptographicHash::hash("changed", QCryptographicHash::Sha1).toHex()));
+    QCOMPARE(second.files[Path("dir4/sub4/file4.txt")].size, std::uint64_t(7));
+}
+
+void PackageManifestTest::benchmark_inspect_data() {
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("cold") << false;
+    QTest::newRow("cached") << true;
+}
+
+// ten thousand files, hashed from scratch and with every hash still in the cache
+void PackageManifestTest::benchmark_inspect() {
+    SKIP_UNLESS_BENCHMARKING();
+    QFETCH(bool, cached);
+    QTemporaryDir dir;
+    auto root = FS::PathCombine(dir.path(), "root");
+    auto cacheFile = FS::PathCombine(dir.path(), "hashes.json");
+    const int count = 10000;
+    make_tree(root, count);
+    if(cached) {
+        Package::fromInspectedFolder(root, cacheFile);
+    }
+    QBENCHMARK_ONCE {
+        auto package = Package::fromInspectedFolder(root, cached ? cacheFile : QString());
+        QVERIFY(package.valid == true);
+        QVERIFY(package.files.size() == std::size_t(count));
+    }
+}
+
 void PackageManifestTest::mkdir_deep() {
 
     Package from;
@@ -338,6 +411,46 @@ void PackageManifestTest::removed_file() {
     QVERIFY(operations.executable_fixes.size() == 0);
 }
 
+void PackageManifestTest::compressed_file() {
+    auto from = Package::fromManifestContents(R"END(
+{
+    "files": {}
+}
+)END");
+    auto to = Package::fromManifestContents(R"END(
+{
+    "files": {
+        "lib/modules": {
+            "type": "file",
+            "downloads": {
+                "lzma": {
+                    "url": "http://dethware.org/modules.lzma",
+                    "sha1": "0f0d5a2ef2a5c9e1e9a8f3fd0b4a5d4dbb6ad1c0",
+                    "size": 10
+                },
+                "raw": {
+                    "url": "http://dethware.org/modules",
+                    "sha1": "dd122581c8cd44d0227f9c305581ffcb4b6f1b46",
+                    "size": 100
+                }
+            },
+            "executable": true
+        }
+    }
+}
+)END");
+    QVERIFY(to.valid);
+    auto operations = UpdateOperations::resolve(from, to);
+    QVERIFY(operations.downloads.size() == 1);
+    auto & download = operations.downloads.at(Path("lib/modules"));
+    // the smaller source is used, but the file is what gets checked
+    QVERIFY(download.compression == Compression::Lzma);
+    QCOMPARE(download.url, QString("http://dethware.org/modules.lzma"));
+    QCOMPARE(download.rawUrl, QString("http://dethware.org/modules"));
+    QCOMPARE(download.fileHash, QString("dd122581c8cd44d0227f9c305581ffcb4b6f1b46"));
+    QVERIFY(download.executable);
+}
+
 QTEST_GUILESS_MAIN(PackageManifestTest)
 
 #include "PackageManifest_test.moc"
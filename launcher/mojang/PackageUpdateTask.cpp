@@ -0,0 +1,289 @@
+#include "PackageUpdateTask.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QDebug>
+
+#include "FileSystem.h"
+#include "net/ChecksumValidator.h"
+
+#ifndef Q_OS_WIN32
+#include <unistd.h>
+#endif
+
+namespace mojang_files {
+
+namespace {
+bool removeFile(const QString & path)
+{
+    if(QFile::remove(path))
+    {
+        return true;
+    }
+    // already gone is just as good
+    QFileInfo info(path);
+    return !info.exists() && !info.isSymLink();
+}
+
+bool setExecutable(const QString & path, bool executable)
+{
+    // permissions belong to the inode. A file shared with others (like an older content store link) gets its own.
+    if(FS::linkCount(path) > 1)
+    {
+        auto temp = path + ".unshare";
+        QFile::remove(temp);
+        if(!FS::cloneFile(path, temp) || !FS::replaceFile(temp, path))
+        {
+            QFile::remove(temp);
+            return false;
+        }
+    }
+    const auto exec = QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther;
+    auto permissions = QFile::permissions(path);
+    permissions = executable ? (permissions | exec) : (permissions & ~exec);
+    return QFile::setPermissions(path, permissions);
+}
+
+// deletes, then the folders that are gone (deepest first), then the new folders (shallowest first)
+QString prepareFolder(const QString & root, const UpdateOperations & operations)
+{
+    if(!QDir().mkpath(root))
+    {
+        return QObject::tr("Could not create folder %1").arg(root);
+    }
+
+    // every delete is independent of the others, so they go wide. It's the disk that's the limit here.
+    QThreadPool pool;
+    pool.setMaxThreadCount(FS::ioThreadCount());
+    std::vector<QFuture<bool>> removals;
+    removals.reserve(operations.deletes.size());
+    for(auto & path: operations.deletes)
+    {
+        removals.push_back(QtConcurrent::run(&pool, removeFile, FS::PathCombine(root, path.toString())));
+    }
+    QStringList failed;
+    for(std::size_t i = 0; i < removals.size(); i++)
+    {
+        if(!removals[i].result())
+        {
+            failed.append(operations.deletes[i].toString());
+        }
+    }
+    if(!failed.isEmpty())
+    {
+        return QObject::tr("Could not remove:\n%1").arg(failed.join("\n"));
+    }
+
+    QDir dir(root);
+    for(auto & path: operations.rmdirs)
+    {
+        if(!dir.rmdir(path.toString()) && dir.exists(path.toString()))
+        {
+            return QObject::tr("Could not remove folder %1").arg(path.toString());
+        }
+    }
+    for(auto & path: operations.mkdirs)
+    {
+        if(!dir.mkpath(path.toString()))
+        {
+            return QObject::tr("Could not create folder %1").arg(path.toString());
+        }
+    }
+    for(auto iter = operations.executable_fixes.begin(); iter != operations.executable_fixes.end(); iter++)
+    {
+        if(!setExecutable(FS::PathCombine(root, iter->first.toString()), iter->second))
+        {
+            return QObject::tr("Could not change permissions of %1").arg(iter->first.toString());
+        }
+    }
+    return QString();
+}
+
+// links can point at anything in the package, so they are made when everything else is in place
+QString finishFolder(const QString & root, const UpdateOperations & operations)
+{
+    for(auto iter = operations.downloads.begin(); iter != operations.downloads.end(); iter++)
+    {
+        if(iter->second.executable && !setExecutable(FS::PathCombine(root, iter->first.toString()), true))
+        {
+            return QObject::tr("Could not change permissions of %1").arg(iter->first.toString());
+        }
+    }
+#ifndef Q_OS_WIN32
+    for(auto iter = operations.mklinks.begin(); iter != operations.mklinks.end(); iter++)
+    {
+        // FIXME: here, we assume the native filesystem encoding, same as the folder inspection does
+        QByteArray nativePath = FS::PathCombine(root, iter->first.toString()).toUtf8();
+        QByteArray nativeTarget = iter->second.toString().toUtf8();
+        if(::symlink(nativeTarget.constData(), nativePath.constData()) != 0)
+        {
+            return QObject::tr("Could not create link %1").arg(iter->first.toString());
+        }
+    }
+#else
+    if(!operations.mklinks.empty())
+    {
+        qWarning() << "Package update: Links are not supported on Windows, skipped" << operations.mklinks.size();
+    }
+#endif
+    return QString();
+}
+}
+
+PackageUpdateTask::PackageUpdateTask(const QString& root, const Package& target, const QString& hashCacheFile)
+    : m_root(root), m_target(target), m_hashCacheFile(hashCacheFile)
+{
+    connect(&m_inspectWatcher, &QFutureWatcher<Package>::finished, this, &PackageUpdateTask::inspectionFinished);
+}
+
+PackageUpdateTask::~PackageUpdateTask()
+{
+    // whatever runs in the background has copies of everything it needs, but we wait for it anyway
+    m_inspectWatcher.waitForFinished();
+    m_fsWatcher.waitForFinished();
+}
+
+void PackageUpdateTask::executeTask()
+{
+    if(!m_target)
+    {
+        emitFailed(tr("The package manifest is not valid."));
+        return;
+    }
+    m_aborted = false;
+    setStatus(tr("Checking files..."));
+    m_inspectWatcher.setFuture(Package::inspectFolder(m_root, m_hashCacheFile));
+}
+
+void PackageUpdateTask::inspectionFinished()
+{
+    if(m_aborted)
+    {
+        emitAborted();
+        return;
+    }
+    auto current = m_inspectWatcher.result();
+    if(!current)
+    {
+        emitFailed(tr("Could not check the files in %1").arg(m_root));
+        return;
+    }
+    m_operations = UpdateOperations::resolve(current, m_target);
+    if(!m_operations.valid)
+    {
+        emitFailed(tr("Could not work out how to update %1").arg(m_root));
+        return;
+    }
+    qDebug() << "Package update:" << m_root << ":" << m_operations.deletes.size() << "deletes," << m_operations.downloads.size()
+             << "downloads," << m_operations.mklinks.size() << "links";
+    setStatus(tr("Removing old files..."));
+    disconnect(&m_fsWatcher, nullptr, this, nullptr);
+    connect(&m_fsWatcher, &QFutureWatcher<QString>::finished, this, &PackageUpdateTask::prepareFinished);
+    m_fsWatcher.setFuture(QtConcurrent::run(prepareFolder, m_root, m_operations));
+}
+
+void PackageUpdateTask::prepareFinished()
+{
+    if(m_aborted)
+    {
+        emitAborted();
+        return;
+    }
+    auto error = m_fsWatcher.result();
+    if(!error.isEmpty())
+    {
+        emitFailed(error);
+        return;
+    }
+    if(m_operations.downloads.empty())
+    {
+        startLinks();
+        return;
+    }
+    startDownloads();
+}
+
+void PackageUpdateTask::startDownloads()
+{
+    setStatus(tr("Downloading files..."));
+    m_job.reset(new NetJob(tr("Package update for %1").arg(m_root)));
+    for(auto iter = m_operations.downloads.begin(); iter != m_operations.downloads.end(); iter++)
+    {
+        auto & source = iter->second;
+        auto target = FS::PathCombine(m_root, iter->first.toString());
+        // an incomplete file is useless anyway, so there's no point in a temporary file.
+        // no StoreContent: permissions are changed in place afterwards, they would change the stored object too.
+        // the lzma sources are LZMA-alone streams, which we have no decoder for. The raw source is always there.
+        auto dl = Net::Download::makeFile(QUrl(source.rawUrl), target, Net::Download::Option::WriteDirectly);
+        dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, QByteArray::fromHex(source.fileHash.toLatin1())));
+        m_job->addNetAction(dl);
+    }
+    connect(m_job.get(), &NetJob::succeeded, this, &PackageUpdateTask::downloadsSucceeded);
+    connect(m_job.get(), &NetJob::failed, this, &PackageUpdateTask::downloadsFailed);
+    connect(m_job.get(), &NetJob::progress, this, &PackageUpdateTask::setProgress);
+    m_job->start();
+}
+
+void PackageUpdateTask::downloadsSucceeded()
+{
+    m_job.reset();
+    startLinks();
+}
+
+void PackageUpdateTask::downloadsFailed(QString reason)
+{
+    m_job.reset();
+    if(m_aborted)
+    {
+        emitAborted();
+        return;
+    }
+    emitFailed(reason);
+}
+
+void PackageUpdateTask::startLinks()
+{
+    setStatus(tr("Finishing up..."));
+    disconnect(&m_fsWatcher, nullptr, this, nullptr);
+    connect(&m_fsWatcher, &QFutureWatcher<QString>::finished, this, &PackageUpdateTask::linksFinished);
+    m_fsWatcher.setFuture(QtConcurrent::run(finishFolder, m_root, m_operations));
+}
+
+void PackageUpdateTask::linksFinished()
+{
+    if(m_aborted)
+    {
+        emitAborted();
+        return;
+    }
+    auto error = m_fsWatcher.result();
+    if(!error.isEmpty())
+    {
+        emitFailed(error);
+        return;
+    }
+    emitSucceeded();
+}
+
+bool PackageUpdateTask::canAbort() const
+{
+    return true;
+}
+
+bool PackageUpdateTask::abort()
+{
+    if(!isRunning())
+    {
+        return false;
+    }
+    m_aborted = true;
+    if(m_job)
+    {
+        return m_job->abort();
+    }
+    // the filesystem work can't be interrupted, we stop once the current step is done
+    return true;
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QFutureWatcher>
+#include "PackageManifest.h"
+#include "net/NetJob.h"
+#include "tasks/Task.h"
+
+namespace mojang_files {
+
+/**
+ * Brings a folder up to date with a package, touching only what changed.
+ *
+ * The folder is inspected and compared with the package. Removed files and folders go away and new folders are made
+ * on a worker thread, then the changed files are downloaded, in parallel as far as the network scheduler allows.
+ * Downloads always use the uncompressed source. Links and executable bits are fixed up last, when everything they
+ * refer to is there.
+ */
+class PackageUpdateTask : public Task
+{
+    Q_OBJECT
+public:
+    /// With a hash cache file, files that didn't change since the last update are not hashed again
+    PackageUpdateTask(const QString & root, const Package & target, const QString & hashCacheFile = QString());
+    virtual ~PackageUpdateTask();
+
+    /// What had to be done to the folder. Valid once the folder has been inspected.
+    const UpdateOperations & operations() const
+    {
+        return m_operations;
+    }
+
+    bool canAbort() const override;
+
+public slots:
+    bool abort() override;
+
+protected:
+    void executeTask() override;
+
+private slots:
+    void inspectionFinished();
+    void prepareFinished();
+    void downloadsSucceeded();
+    void downloadsFailed(QString reason);
+    void linksFinished();
+
+private:
+    void startDownloads();
+    void startLinks();
+
+private:
+    QString m_root;
+    Package m_target;
+    QString m_hashCacheFile;
+    UpdateOperations m_operations;
+    QFutureWatcher<Package> m_inspectWatcher;
+    /// runs the filesystem work, giving back an error message when something failed
+    QFutureWatcher<QString> m_fsWatcher;
+    NetJobPtr m_job;
+    bool m_aborted = false;
+};
+
+}
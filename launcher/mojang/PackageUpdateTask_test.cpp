@@ -0,0 +1,302 @@
+#include <QTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCryptographicHash>
+#include "TestUtil.h"
+
+#include "mojang/PackageUpdateTask.h"
+#include "FileSystem.h"
+
+using namespace mojang_files;
+
+/*
+ * A minimal HTTP/1.1 stand-in for the package servers. Serves whatever it was given, by path, and remembers what was asked for.
+ */
+class PackageServer
+{
+public:
+    PackageServer()
+    {
+        QObject::connect(&m_server, &QTcpServer::newConnection, [this]()
+        {
+            while(auto socket = m_server.nextPendingConnection())
+            {
+                QObject::connect(socket, &QTcpSocket::readyRead, [this, socket]()
+                {
+                    handle(socket);
+                });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+        m_server.listen(QHostAddress::LocalHost);
+    }
+    QString serve(const QString & path, const QByteArray & body)
+    {
+        m_bodies.insert(path, body);
+        return QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path);
+    }
+    QStringList requests() const
+    {
+        return m_requests;
+    }
+    void clearRequests()
+    {
+        m_requests.clear();
+    }
+    bool isListening() const
+    {
+        return m_server.isListening();
+    }
+
+private:
+    void handle(QTcpSocket * socket)
+    {
+        auto & buffer = m_buffers[socket];
+        buffer.append(socket->readAll());
+        int end;
+        while((end = buffer.indexOf("\r\n\r\n")) != -1)
+        {
+            auto requestLine = buffer.left(buffer.indexOf("\r\n")).split(' ');
+            buffer.remove(0, end + 4);
+            QString path = requestLine.size() > 1 ? QString::fromUtf8(requestLine[1]) : QString();
+            m_requests.append(path);
+            QByteArray response;
+            if(m_bodies.contains(path))
+            {
+                auto & body = m_bodies[path];
+                response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: ";
+                response.append(QByteArray::number(body.size()));
+                response.append("\r\n\r\n");
+                response.append(body);
+            }
+            else
+            {
+                response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+            }
+            socket->write(response);
+        }
+    }
+
+private:
+    QTcpServer m_server;
+    QHash<QString, QByteArray> m_bodies;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+    QStringList m_requests;
+};
+
+class PackageUpdateTaskTest : public QObject
+{
+    Q_OBJECT
+
+    static QString sha1(const QByteArray & data)
+    {
+        return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    }
+
+    QJsonObject download(const QString & url, const QByteArray & data)
+    {
+        QJsonObject out;
+        out.insert("url", url);
+        out.insert("sha1", sha1(data));
+        out.insert("size", data.size());
+        return out;
+    }
+
+    // a file the server has uncompressed, and compressed too when there's something compressed to serve
+    QJsonObject file(PackageServer & server, const QByteArray & data, bool executable = false, const QByteArray & lzma = QByteArray())
+    {
+        QJsonObject downloads;
+        downloads.insert("raw", download(server.serve("/raw/" + sha1(data), data), data));
+        if(!lzma.isEmpty())
+        {
+            downloads.insert("lzma", download(server.serve("/lzma/" + sha1(lzma), lzma), lzma));
+        }
+        QJsonObject out;
+        out.insert("type", QString("file"));
+        out.insert("downloads", downloads);
+        out.insert("executable", executable);
+        return out;
+    }
+
+    QJsonObject entry(const QString & type, const QString & target = QString())
+    {
+        QJsonObject out;
+        out.insert("type", type);
+        if(!target.isEmpty())
+        {
+            out.insert("target", target);
+        }
+        return out;
+    }
+
+    Package makePackage(const QJsonObject & files)
+    {
+        QJsonObject root;
+        root.insert("files", files);
+        return Package::fromManifestContents(QJsonDocument(root).toJson());
+    }
+
+    QByteArray payload()
+    {
+        QByteArray out;
+        for(int i = 0; i < 20000; i++)
+        {
+            out.append(QString("runtime file line %1\n").arg(i).toUtf8());
+        }
+        return out;
+    }
+
+    QByteArray readTestData(const QString & name)
+    {
+        QFile file(QFINDTESTDATA("testdata/update/" + name));
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            return QByteArray();
+        }
+        return file.readAll();
+    }
+
+    bool update(const QString & root, const Package & target, const QString & hashCache = QString())
+    {
+        PackageUpdateTask task(root, target, hashCache);
+        return TestsInternal::runTask(&task);
+    }
+
+    // something shaped like a runtime: many small files in a few folders
+    QJsonObject makeRuntime(PackageServer & server, int count, int version)
+    {
+        QJsonObject files;
+        for(int i = 0; i < count; i++)
+        {
+            // only every hundredth file changes between versions
+            QByteArray data(16 * 1024, char('a' + i % 26));
+            data.append(QString("file %1 version %2").arg(i).arg(i % 100 == 0 ? version : 0).toUtf8());
+            files.insert(QString("lib/part%1/file%2").arg(i % 20).arg(i), file(server, data, i % 50 == 0));
+        }
+        return files;
+    }
+
+private
+slots:
+    void initTestCase()
+    {
+        // every download logs a couple lines, which would drown out the results
+        QLoggingCategory::setFilterRules("*.debug=false");
+    }
+
+    void test_update()
+    {
+        PackageServer server;
+        QVERIFY(server.isListening());
+        QTemporaryDir dir;
+        QString root = dir.filePath("runtime");
+
+        auto data = payload();
+        auto alone = readTestData("payload.lzma");
+        QVERIFY(!alone.isEmpty());
+
+        QJsonObject files;
+        files.insert("bin/java", file(server, "#!/bin/sh\n", true));
+        // the lzma source is smaller, but it's LZMA-alone, which we can't read. The uncompressed one is used.
+        files.insert("lib/modules", file(server, data, false, alone));
+        files.insert("conf/empty", entry("directory"));
+        files.insert("old/gone.txt", file(server, "going away"));
+        files.insert("bin/link", entry("link", "java"));
+        auto first = makePackage(files);
+        QVERIFY(first);
+
+        QVERIFY(update(root, first));
+        QCOMPARE(FS::read(FS::PathCombine(root, "lib/modules")), data);
+        QVERIFY(QFileInfo(FS::PathCombine(root, "conf/empty")).isDir());
+        auto requests = server.requests();
+        QVERIFY(requests.contains("/raw/" + sha1(data)));
+        QVERIFY(!requests.contains("/lzma/" + sha1(alone)));
+#ifndef Q_OS_WIN32
+        QVERIFY(QFileInfo(FS::PathCombine(root, "bin/java")).isExecutable());
+        QVERIFY(!QFileInfo(FS::PathCombine(root, "lib/modules")).isExecutable());
+        QFileInfo link(FS::PathCombine(root, "bin/link"));
+        QVERIFY(link.isSymLink());
+        QCOMPARE(link.symLinkTarget(), QFileInfo(FS::PathCombine(root, "bin/java")).absoluteFilePath());
+#endif
+
+        // nothing to do when nothing changed
+        server.clearRequests();
+        QVERIFY(update(root, first));
+        QVERIFY(server.requests().isEmpty());
+
+#ifndef Q_OS_WIN32
+        // a file that shares its inode with something else gets its own before its permissions change
+        auto shared = dir.filePath("shared");
+        QVERIFY(FS::hardlink(FS::PathCombine(root, "lib/modules"), shared));
+#endif
+
+        // only what changed is touched
+        files.remove("old/gone.txt");
+        files.insert("bin/java", file(server, "#!/bin/sh\nexec true\n", true));
+        files.insert("lib/modules", file(server, data, true, alone));
+        QVERIFY(update(root, makePackage(files)));
+        QCOMPARE(server.requests(), QStringList() << "/raw/" + sha1("#!/bin/sh\nexec true\n"));
+        QVERIFY(!QFileInfo::exists(FS::PathCombine(root, "old")));
+        QCOMPARE(FS::read(FS::PathCombine(root, "bin/java")), QByteArray("#!/bin/sh\nexec true\n"));
+#ifndef Q_OS_WIN32
+        QVERIFY(QFileInfo(FS::PathCombine(root, "lib/modules")).isExecutable());
+        QVERIFY(!QFileInfo(shared).isExecutable());
+        QCOMPARE(FS::linkCount(shared), 1);
+        QCOMPARE(FS::read(shared), data);
+#endif
+    }
+
+    void test_bad_download()
+    {
+        PackageServer server;
+        QTemporaryDir dir;
+        QString root = dir.filePath("runtime");
+        QJsonObject files;
+        auto good = file(server, "good");
+        // the server has something else than the manifest says
+        server.serve("/raw/" + sha1("good"), "bad");
+        files.insert("file", good);
+        PackageUpdateTask task(root, makePackage(files));
+        QVERIFY(!TestsInternal::runTask(&task));
+        QVERIFY(!QFileInfo::exists(FS::PathCombine(root, "file")));
+    }
+
+    void benchmark_install_data()
+    {
+        QTest::addColumn<bool>("incremental");
+        QTest::newRow("full") << false;
+        QTest::newRow("incremental") << true;
+    }
+
+    // two thousand files, from nothing and as an update where one in a hundred files changed
+    void benchmark_install()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, incremental);
+        PackageServer server;
+        QTemporaryDir dir;
+        QString root = dir.filePath("runtime");
+        QString hashCache = dir.filePath("runtime.hashes.json");
+        const int count = 2000;
+        if(incremental)
+        {
+            QVERIFY(update(root, makePackage(makeRuntime(server, count, 1)), hashCache));
+        }
+        auto target = makePackage(makeRuntime(server, count, 2));
+        server.clearRequests();
+        QBENCHMARK_ONCE
+        {
+            QVERIFY(update(root, target, hashCache));
+        }
+        qDebug() << "Downloads:" << server.requests().size();
+        QCOMPARE(server.requests().size(), incremental ? count / 100 : count);
+    }
+};
+
+QTEST_GUILESS_MAIN(PackageUpdateTaskTest)
+
+#include "PackageUpdateTask_test.moc"
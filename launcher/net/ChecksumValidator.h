@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Validator.h"
+#include "MultiHash.h"
 #include <QCryptographicHash>
 #include <memory>
 #include <QFile>
@@ -10,7 +11,7 @@ class ChecksumValidator: public Validator
 {
 public: /* con/des */
     ChecksumValidator(QCryptographicHash::Algorithm algorithm, QByteArray expected = QByteArray())
-        :m_checksum(algorithm), m_expected(expected)
+        :m_algorithm(algorithm), m_checksum(algorithm), m_expected(expected)
     {
     };
     virtual ~ChecksumValidator() {};
@@ -23,9 +24,18 @@ public: /* methods */
     }
     bool write(QByteArray & data) override
     {
-        m_checksum.addData(data);
+        if(!m_shared)
+        {
+            m_checksum.addData(data);
+        }
         return true;
     }
+    void attach(MultiHash & hasher) override
+    {
+        // the sink hashes the data for us, together with everything else that needs hashing
+        hasher.addAlgorithm(m_algorithm);
+        m_shared = &hasher;
+    }
     bool abort() override
     {
         return true;
@@ -41,6 +51,10 @@ public: /* methods */
     }
     QByteArray hash()
     {
+        if(m_shared)
+        {
+            return m_shared->result(m_algorithm);
+        }
         return m_checksum.result();
     }
     void setExpected(QByteArray expected)
@@ -49,7 +63,9 @@ public: /* methods */
     }
 
 private: /* data */
+    QCryptographicHash::Algorithm m_algorithm;
     QCryptographicHash m_checksum;
+    MultiHash * m_shared = nullptr;
     QByteArray m_expected;
 };
 }
\ No newline at end of file
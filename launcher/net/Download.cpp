@@ -25,6 +25,41 @@
 #include "MetaCacheSink.h"
 #include "ByteArraySink.h"
 
+namespace {
+/*
+ * Downloads read their data into these instead of allocating a new array for every readyRead.
+ * All downloads live on the GUI thread, so the pool doesn't need any locking.
+ */
+const int chunkSize = 256 * 1024;
+const int maxPooledBuffers = 32;
+
+QList<QByteArray> & bufferPool()
+{
+    static QList<QByteArray> pool;
+    return pool;
+}
+
+QByteArray takeBuffer()
+{
+    auto & pool = bufferPool();
+    if(!pool.isEmpty())
+    {
+        return pool.takeLast();
+    }
+    return QByteArray(chunkSize, Qt::Uninitialized);
+}
+
+void returnBuffer(QByteArray & buffer)
+{
+    auto & pool = bufferPool();
+    if(buffer.size() == chunkSize && pool.size() < maxPooledBuffers)
+    {
+        pool.append(buffer);
+    }
+    buffer = QByteArray();
+}
+}
+
 namespace Net {
 
 Download::Download():NetAction()
@@ -32,6 +67,11 @@ Download::Download():NetAction()
     m_status = Job_NotStarted;
 }
 
+Download::~Download()
+{
+    releaseBuffer();
+}
+
 Download::Ptr Download::makeCached(QUrl url, MetaEntryPtr entry, Options options)
 {
     Download * dl = new Download();
@@ -39,6 +79,7 @@ Download::Ptr Download::makeCached(QUrl url, MetaEntryPtr entry, Options options
     dl->m_options = options;
     auto md5Node = new ChecksumValidator(QCryptographicHash::Md5);
     auto cachedNode = new MetaCacheSink(entry, md5Node);
+    cachedNode->setStoreContent(options.testFlag(Option::StoreContent));
     dl->m_sink.reset(cachedNode);
     dl->m_target_path = entry->getFullPath();
     return std::shared_ptr<Download>(dl);
@@ -58,7 +99,9 @@ Download::Ptr Download::makeFile(QUrl url, QString path, Options options)
     Download * dl = new Download();
     dl->m_url = url;
     dl->m_options = options;
-    dl->m_sink.reset(new FileSink(path));
+    auto fileNode = new FileSink(path, options.testFlag(Option::WriteDirectly));
+    fileNode->setStoreContent(options.testFlag(Option::StoreContent));
+    dl->m_sink.reset(fileNode);
     return std::shared_ptr<Download>(dl);
 }
 
@@ -76,6 +119,8 @@ void Download::start()
         return;
     }
     QNetworkRequest request(m_url);
+    m_reserved = false;
+    m_networkError = QNetworkReply::NoError;
     m_status = m_sink->init(request);
     switch(m_status)
     {
@@ -98,6 +143,7 @@ void Download::start()
     request.setHeader(QNetworkRequest::UserAgentHeader, BuildConfig.USER_AGENT);
 
     QNetworkReply *rep =  ENV.qnam().get(request);
+    emit started(m_index_within_job);
 
     m_reply.reset(rep);
     connect(rep, SIGNAL(downloadProgress(qint64, qint64)), SLOT(downloadProgress(qint64, qint64)));
@@ -116,6 +162,7 @@ void Download::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 
 void Download::downloadError(QNetworkReply::NetworkError error)
 {
+    m_networkError = error;
     if(error == QNetworkReply::OperationCanceledError)
     {
         qCritical() << "Aborted " << m_url.toString();
@@ -227,6 +274,7 @@ void Download::downloadFinished()
         qDebug() << "Download failed but we are allowed to proceed:" << m_url.toString();
         m_sink->abort();
         m_reply.reset();
+        releaseBuffer();
         emit succeeded(m_index_within_job);
         return;
     }
@@ -235,6 +283,7 @@ void Download::downloadFinished()
         qDebug() << "Download failed in previous step:" << m_url.toString();
         m_sink->abort();
         m_reply.reset();
+        releaseBuffer();
         emit failed(m_index_within_job);
         return;
     }
@@ -243,20 +292,24 @@ void Download::downloadFinished()
         qDebug() << "Download aborted in previous step:" << m_url.toString();
         m_sink->abort();
         m_reply.reset();
+        releaseBuffer();
         emit aborted(m_index_within_job);
         return;
     }
 
     // make sure we got all the remaining data, if any
-    auto data = m_reply->readAll();
-    if(data.size())
+    if(m_reply->bytesAvailable() > 0)
     {
-        qDebug() << "Writing extra" << data.size() << "bytes to" << m_target_path;
-        m_status = m_sink->write(data);
+        qDebug() << "Writing extra" << m_reply->bytesAvailable() << "bytes to" << m_target_path;
+        readChunks();
     }
+    releaseBuffer();
 
     // otherwise, finalize the whole graph
-    m_status = m_sink->finalize(*m_reply.get());
+    if(m_status != Job_Failed)
+    {
+        m_status = m_sink->finalize(*m_reply.get());
+    }
     if (m_status != Job_Finished)
     {
         qDebug() << "Download failed to finalize:" << m_url.toString();
@@ -274,17 +327,54 @@ void Download::downloadReadyRead()
 {
     if(m_status == Job_InProgress)
     {
-        auto data = m_reply->readAll();
-        m_status = m_sink->write(data);
+        readChunks();
+    }
+    else
+    {
+        qCritical() << "Cannot write to " << m_target_path << ", illegal status" << m_status;
+    }
+}
+
+void Download::readChunks()
+{
+    if(!m_reserved)
+    {
+        // let the sink make room for the whole thing, if we know how big it is
+        m_reserved = true;
+        auto statusCode = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        bool ok = false;
+        auto length = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+        if(statusCode == 200 && ok && length > 0)
+        {
+            m_sink->reserve(length);
+        }
+    }
+    if(m_buffer.isEmpty())
+    {
+        m_buffer = takeBuffer();
+    }
+    while(m_status == Job_InProgress && m_reply->bytesAvailable() > 0)
+    {
+        qint64 read = m_reply->read(m_buffer.data(), m_buffer.size());
+        if(read <= 0)
+        {
+            break;
+        }
+        // no copy, the sink sees the pooled buffer directly
+        auto chunk = QByteArray::fromRawData(m_buffer.constData(), read);
+        m_status = m_sink->write(chunk);
         if(m_status == Job_Failed)
         {
             qCritical() << "Failed to process response chunk for " << m_target_path;
         }
-        // qDebug() << "Download" << m_url.toString() << "gained" << data.size() << "bytes";
     }
-    else
+}
+
+void Download::releaseBuffer()
+{
+    if(!m_buffer.isEmpty())
     {
-        qCritical() << "Cannot write to " << m_target_path << ", illegal status" << m_status;
+        returnBuffer(m_buffer);
     }
 }
 
@@ -30,14 +30,20 @@ public: /* types */
     enum class Option
     {
         NoOptions = 0,
-        AcceptLocalFiles = 1
+        AcceptLocalFiles = 1,
+        /// Write to the target file as the data comes in, instead of a temporary file that replaces it at the end.
+        /// A failed download removes the target. Only for files that are useless when incomplete anyway.
+        WriteDirectly = 2,
+        /// Add the file to the content store once its SHA1 is checked. The file may become a hard link to the stored
+        /// object, so this is only for files nothing modifies in place: libraries, asset objects, cached mod jars.
+        StoreContent = 4
     };
     Q_DECLARE_FLAGS(Options, Option)
 
 protected: /* con/des */
     explicit Download();
 public:
-    virtual ~Download(){};
+    virtual ~Download();
     static Download::Ptr makeCached(QUrl url, MetaEntryPtr entry, Options options = Option::NoOptions);
     static Download::Ptr makeByteArray(QUrl url, QByteArray *output, Options options = Option::NoOptions);
     static Download::Ptr makeFile(QUrl url, QString path, Options options = Option::NoOptions);
@@ -53,6 +59,9 @@ public: /* methods */
 
 private: /* methods */
     bool handleRedirect();
+    /// Feed everything the reply has buffered to the sink, one pooled chunk at a time
+    void readChunks();
+    void releaseBuffer();
 
 protected slots:
     void downloadProgress(qint64 bytesReceived, qint64 bytesTotal) override;
@@ -69,6 +78,9 @@ private: /* data */
     QString m_target_path;
     std::unique_ptr<Sink> m_sink;
     Options m_options;
+    /// reused for every chunk, taken from a pool of buffers shared by all downloads
+    QByteArray m_buffer;
+    bool m_reserved = false;
 };
 }
 
@@ -1,20 +1,69 @@
 #include "FileSink.h"
 #include <QFile>
 #include <QFileInfo>
+#include <QMutex>
+#include <QSet>
 #include "Env.h"
 #include "FileSystem.h"
+#include "ContentStore.h"
 
 namespace Net {
 
-FileSink::FileSink(QString filename)
-    :m_filename(filename)
+namespace {
+// files direct downloads are writing to right now, by absolute path
+QMutex writingMutex;
+QSet<QString> writing;
+}
+
+FileSink::FileSink(QString filename, bool writeDirectly)
+    :m_filename(filename), m_writeDirectly(writeDirectly)
 {
     // nil
 }
 
 FileSink::~FileSink()
 {
-    // nil
+    setWriting(false);
+}
+
+bool FileSink::isBeingWritten(const QString& path)
+{
+    QMutexLocker locker(&writingMutex);
+    return writing.contains(QFileInfo(path).absoluteFilePath());
+}
+
+bool FileSink::removeIfIdle(const QString& path, quint64 identity)
+{
+    QMutexLocker locker(&writingMutex);
+    if(writing.contains(QFileInfo(path).absoluteFilePath()))
+    {
+        return false;
+    }
+    if(identity != 0 && FS::fileIdentity(path) != identity)
+    {
+        // replaced since it was looked at
+        return false;
+    }
+    return QFile::remove(path);
+}
+
+void FileSink::setWriting(bool isWriting)
+{
+    if(m_writing == isWriting)
+    {
+        return;
+    }
+    m_writing = isWriting;
+    QMutexLocker locker(&writingMutex);
+    auto path = QFileInfo(m_filename).absoluteFilePath();
+    if(isWriting)
+    {
+        writing.insert(path);
+    }
+    else
+    {
+        writing.remove(path);
+    }
 }
 
 JobStatus FileSink::init(QNetworkRequest& request)
@@ -31,11 +80,21 @@ JobStatus FileSink::init(QNetworkRequest& request)
         return Job_Failed;
     }
     wroteAnyData = false;
-    m_output_file.reset(new QSaveFile(m_filename));
-    if (!m_output_file->open(QIODevice::WriteOnly))
+    m_expectedSize = -1;
+    if(m_writeDirectly)
     {
-        qCritical() << "Could not open " + m_filename + " for writing";
-        return Job_Failed;
+        // don't touch the target until there is something to put in it
+        m_output_file.reset();
+        setWriting(true);
+    }
+    else
+    {
+        m_output_file.reset(new QSaveFile(m_filename));
+        if (!m_output_file->open(QIODevice::WriteOnly))
+        {
+            qCritical() << "Could not open " + m_filename + " for writing";
+            return Job_Failed;
+        }
     }
 
     if(initAllValidators(request))
@@ -48,13 +107,63 @@ JobStatus FileSink::initCache(QNetworkRequest &)
     return Job_InProgress;
 }
 
+bool FileSink::openDirectly()
+{
+    // never write into the old file, it may be a hard link to something else (like a content store object)
+    QFile::remove(m_filename);
+    m_output_file.reset(new QFile(m_filename));
+    if (!m_output_file->open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical() << "Could not open " + m_filename + " for writing";
+        m_output_file.reset();
+        return false;
+    }
+    if(m_expectedSize > 0)
+    {
+        FS::preallocate(*m_output_file, m_expectedSize);
+    }
+    return true;
+}
+
+void FileSink::discardOutput()
+{
+    if(!m_output_file)
+    {
+        return;
+    }
+    if(m_writeDirectly)
+    {
+        // whatever we wrote so far is not the file we wanted
+        m_output_file->close();
+        QFile::remove(m_filename);
+    }
+    else
+    {
+        static_cast<QSaveFile *>(m_output_file.get())->cancelWriting();
+    }
+    m_output_file.reset();
+}
+
+void FileSink::reserve(qint64 size)
+{
+    m_expectedSize = size;
+    if(m_output_file)
+    {
+        FS::preallocate(*m_output_file, size);
+    }
+}
+
 JobStatus FileSink::write(QByteArray& data)
 {
+    if(!m_output_file && (!m_writeDirectly || !openDirectly()))
+    {
+        wroteAnyData = false;
+        return Job_Failed;
+    }
     if (!writeAllValidators(data) || m_output_file->write(data) != data.size())
     {
         qCritical() << "Failed writing into " + m_filename;
-        m_output_file->cancelWriting();
-        m_output_file.reset();
+        discardOutput();
         wroteAnyData = false;
         return Job_Failed;
     }
@@ -64,7 +173,8 @@ JobStatus FileSink::write(QByteArray& data)
 
 JobStatus FileSink::abort()
 {
-    m_output_file->cancelWriting();
+    discardOutput();
+    setWriting(false);
     failAllValidators();
     return Job_Failed;
 }
@@ -89,15 +199,39 @@ JobStatus FileSink::finalize(QNetworkReply& reply)
         if(!finalizeAllValidators(reply))
             return Job_Failed;
         // nothing went wrong...
-        if (!m_output_file->commit())
+        if(m_writeDirectly)
+        {
+            // an empty file still has to be created
+            if (!m_output_file && !openDirectly())
+            {
+                return Job_Failed;
+            }
+            if (!m_output_file->flush())
+            {
+                qCritical() << "Failed to write changes to " << m_filename;
+                discardOutput();
+                return Job_Failed;
+            }
+            m_output_file->close();
+        }
+        else if (!static_cast<QSaveFile *>(m_output_file.get())->commit())
         {
             qCritical() << "Failed to commit changes to " << m_filename;
-            m_output_file->cancelWriting();
+            discardOutput();
             return Job_Failed;
         }
+        m_output_file.reset();
+        // immutable files with a checked SHA1 go to the content store, so nothing has to be downloaded or stored twice
+        auto store = m_storeContent ? ENV.contentStore() : nullptr;
+        auto sha1 = hasher.result(QCryptographicHash::Sha1);
+        if(store && !sha1.isEmpty())
+        {
+            store->insert(m_filename, QCryptographicHash::Sha1, sha1);
+        }
     }
     // then get rid of the save file
     m_output_file.reset();
+    setWriting(false);
 
     return finalizeCache(reply);
 }
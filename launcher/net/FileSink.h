@@ -6,7 +6,7 @@ namespace Net {
 class FileSink : public Sink
 {
 public: /* con/des */
-    FileSink(QString filename);
+    FileSink(QString filename, bool writeDirectly = false);
     virtual ~FileSink();
 
 public: /* methods */
@@ -15,14 +15,39 @@ public: /* methods */
     JobStatus abort() override;
     JobStatus finalize(QNetworkReply & reply) override;
     bool hasLocalData() override;
+    void reserve(qint64 size) override;
+    /// Whether a direct download is writing to the file right now. Whatever is there is incomplete then.
+    static bool isBeingWritten(const QString & path);
+    /**
+     * Remove a file, unless a direct download is writing to it. Downloads can't start writing while this runs.
+     * With an identity (FS::fileIdentity), the file is also left alone if it's not the same file anymore.
+     */
+    static bool removeIfIdle(const QString & path, quint64 identity = 0);
+
+    /// Add the finished file to the content store, if it has a checked SHA1
+    void setStoreContent(bool store)
+    {
+        m_storeContent = store;
+    }
 
 protected: /* methods */
     virtual JobStatus initCache(QNetworkRequest &);
     virtual JobStatus finalizeCache(QNetworkReply &reply);
 
+private: /* methods */
+    bool openDirectly();
+    void discardOutput();
+    void setWriting(bool writing);
+
 protected: /* data */
     QString m_filename;
     bool wroteAnyData = false;
-    std::unique_ptr<QSaveFile> m_output_file;
+    // when writing directly, this is a plain QFile on the target, opened on the first write
+    std::unique_ptr<QFileDevice> m_output_file;
+    bool m_writeDirectly = false;
+    bool m_storeContent = false;
+    /// registered as being written by a direct download
+    bool m_writing = false;
+    qint64 m_expectedSize = -1;
 };
 }
@@ -15,6 +15,7 @@
 
 #include "Env.h"
 #include "HttpMetaCache.h"
+#include "MetaCacheVerifyTask.h"
 #include "FileSystem.h"
 
 #include <QFileInfo>
@@ -28,6 +29,8 @@
 #include <QJsonArray>
 #include <QJsonObject>
 
+#include <algorithm>
+
 QString MetaEntry::getFullPath()
 {
     // FIXME: make local?
@@ -37,6 +40,10 @@ QString MetaEntry::getFullPath()
 HttpMetaCache::HttpMetaCache(QString path) : QObject()
 {
     m_index_file = path;
+    if(!m_index_file.isNull())
+    {
+        m_index.reset(new MetaCacheIndex(m_index_file));
+    }
     saveBatchingTimer.setSingleShot(true);
     saveBatchingTimer.setTimerType(Qt::VeryCoarseTimer);
     connect(&saveBatchingTimer, SIGNAL(timeout()), SLOT(SaveNow()));
@@ -57,11 +64,21 @@ MetaEntryPtr HttpMetaCache::getEntry(QString base, QString resource_path)
         return MetaEntryPtr();
     }
     EntryMap &map = m_entries[base];
-    if (map.entry_list.contains(resource_path))
+    auto iter = map.entry_list.find(resource_path);
+    if (iter != map.entry_list.end())
     {
-        return map.entry_list[resource_path];
+        // NOTE: this is null for removed entries
+        return *iter;
     }
-    return MetaEntryPtr();
+    // not touched yet, look in the snapshot
+    MetaCacheIndex::Record record;
+    if (!m_index || !m_index->lookup(base, resource_path, record))
+    {
+        return MetaEntryPtr();
+    }
+    auto entry = fromRecord(record);
+    map.entry_list.insert(resource_path, entry);
+    return entry;
 }
 
 MetaEntryPtr HttpMetaCache::resolveEntry(QString base, QString resource_path, QString expected_etag)
@@ -81,33 +98,55 @@ MetaEntryPtr HttpMetaCache::resolveEntry(QString base, QString resource_path, QS
     if (!finfo.isFile() || !finfo.isReadable())
     {
         // if the file doesn't exist, we disown the entry
-        selected_base.entry_list.remove(resource_path);
+        removeEntry(base, resource_path);
         return staleEntry(base, resource_path);
     }
 
     if (!expected_etag.isEmpty() && expected_etag != entry->etag)
     {
         // if the etag doesn't match expected, we disown the entry
-        selected_base.entry_list.remove(resource_path);
+        removeEntry(base, resource_path);
+        return staleEntry(base, resource_path);
+    }
+
+    // a different size means a different file, no need to hash it
+    qint64 file_size = finfo.size();
+    if (entry->local_size >= 0 && entry->local_size != file_size)
+    {
+        removeEntry(base, resource_path);
         return staleEntry(base, resource_path);
     }
 
     // if the file changed, check md5sum
     qint64 file_last_changed = finfo.lastModified().toUTC().toMSecsSinceEpoch();
+    quint64 file_inode = FS::fileIdentity(real_path);
     if (file_last_changed != entry->local_changed_timestamp)
     {
-        QFile input(real_path);
-        input.open(QIODevice::ReadOnly);
-        QString md5sum = QCryptographicHash::hash(input.readAll(), QCryptographicHash::Md5)
-                             .toHex()
-                             .constData();
-        if (entry->md5sum != md5sum)
+        if (m_deferVerification)
         {
-            selected_base.entry_list.remove(resource_path);
-            return staleEntry(base, resource_path);
+            // somebody will check it in bulk later
+            if (!m_unverifiedSet.contains(entry.get()))
+            {
+                m_unverifiedSet.insert(entry.get());
+                m_unverified.append(entry);
+            }
         }
-        // md5sums matched... keep entry and save the new state to file
-        entry->local_changed_timestamp = file_last_changed;
+        else
+        {
+            QString md5sum = FS::hashFile(real_path, QCryptographicHash::Md5).toHex();
+            if (!applyVerification(entry, md5sum, file_last_changed, file_size, file_inode))
+            {
+                return staleEntry(base, resource_path);
+            }
+        }
+    }
+    else if (entry->local_size < 0 || entry->local_inode != file_inode)
+    {
+        // same timestamp and size as when we checked it last. A new inode only means it was copied or restored
+        // with its timestamp intact, so there is no need to hash it. Just remember the new fingerprint.
+        entry->local_size = file_size;
+        entry->local_inode = file_inode;
+        markDirty(base, resource_path);
         SaveEventually();
     }
 
@@ -130,6 +169,7 @@ bool HttpMetaCache::updateEntry(MetaEntryPtr stale_entry)
         return false;
     }
     m_entries[stale_entry->baseId].entry_list[stale_entry->relativePath] = stale_entry;
+    markDirty(stale_entry->baseId, stale_entry->relativePath);
     SaveEventually();
     return true;
 }
@@ -139,12 +179,54 @@ bool HttpMetaCache::evictEntry(MetaEntryPtr entry)
     if(entry)
     {
         entry->stale = true;
+        markDirty(entry->baseId, entry->relativePath);
         SaveEventually();
         return true;
     }
     return false;
 }
 
+void HttpMetaCache::setDeferVerification(bool defer)
+{
+    m_deferVerification = defer;
+}
+
+QList<MetaEntryPtr> HttpMetaCache::takeUnverifiedEntries()
+{
+    QList<MetaEntryPtr> out;
+    std::swap(out, m_unverified);
+    m_unverifiedSet.clear();
+    return out;
+}
+
+shared_qobject_ptr<Task> HttpMetaCache::verifyEntries(QList<MetaEntryPtr> entries)
+{
+    return shared_qobject_ptr<Task>(new MetaCacheVerifyTask(this, entries));
+}
+
+bool HttpMetaCache::applyVerification(MetaEntryPtr entry, const QString& md5sum, qint64 last_changed, qint64 size, quint64 inode)
+{
+    auto current = getEntry(entry->baseId, entry->relativePath);
+    if (current != entry)
+    {
+        // replaced or removed while it was being checked, the result is meaningless
+        return current && !current->stale;
+    }
+    if (md5sum.isEmpty() || entry->md5sum != md5sum)
+    {
+        removeEntry(entry->baseId, entry->relativePath);
+        entry->stale = true;
+        return false;
+    }
+    // md5sums matched... keep entry and save the new state to file
+    entry->local_changed_timestamp = last_changed;
+    entry->local_size = size;
+    entry->local_inode = inode;
+    markDirty(entry->baseId, entry->relativePath);
+    SaveEventually();
+    return true;
+}
+
 MetaEntryPtr HttpMetaCache::staleEntry(QString base, QString resource_path)
 {
     auto foo = new MetaEntry();
@@ -155,6 +237,49 @@ MetaEntryPtr HttpMetaCache::staleEntry(QString base, QString resource_path)
     return MetaEntryPtr(foo);
 }
 
+void HttpMetaCache::removeEntry(QString base, QString resource_path)
+{
+    m_entries[base].entry_list[resource_path] = MetaEntryPtr();
+    markDirty(base, resource_path);
+    SaveEventually();
+}
+
+void HttpMetaCache::markDirty(const QString& base, const QString& resource_path)
+{
+    m_dirty[base].insert(resource_path);
+}
+
+MetaEntryPtr HttpMetaCache::fromRecord(const MetaCacheIndex::Record& record)
+{
+    auto foo = new MetaEntry();
+    foo->baseId = record.base;
+    foo->basePath = getBasePath(record.base);
+    foo->relativePath = record.path;
+    foo->md5sum = record.md5sum;
+    foo->etag = record.etag;
+    foo->local_changed_timestamp = record.localChanged;
+    foo->local_size = record.localSize;
+    foo->local_inode = record.localInode;
+    foo->remote_changed_timestamp = record.remoteChanged;
+    // presumed innocent until closer examination
+    foo->stale = false;
+    return MetaEntryPtr(foo);
+}
+
+MetaCacheIndex::Record HttpMetaCache::toRecord(const MetaEntryPtr& entry)
+{
+    MetaCacheIndex::Record record;
+    record.base = entry->baseId;
+    record.path = entry->relativePath;
+    record.md5sum = entry->md5sum;
+    record.etag = entry->etag;
+    record.localChanged = entry->local_changed_timestamp;
+    record.localSize = entry->local_size;
+    record.localInode = entry->local_inode;
+    record.remoteChanged = entry->remote_changed_timestamp;
+    return record;
+}
+
 void HttpMetaCache::addBase(QString base, QString base_root)
 {
     // TODO: report error
@@ -177,33 +302,63 @@ QString HttpMetaCache::getBasePath(QString base)
 
 void HttpMetaCache::Load()
 {
-    if(m_index_file.isNull())
+    if(!m_index)
         return;
 
+    bool haveSnapshot = m_index->open();
+    if(!haveSnapshot)
+    {
+        // no usable snapshot yet. Migrate the old JSON index, if there is one.
+        LoadJson();
+    }
+    m_index->replayJournal([this](const MetaCacheIndex::Change & change)
+    {
+        // entries of bases we don't know about are dropped
+        if (!m_entries.contains(change.record.base))
+            return;
+        auto &entrymap = m_entries[change.record.base];
+        if (change.removed)
+        {
+            entrymap.entry_list[change.record.path] = MetaEntryPtr();
+        }
+        else
+        {
+            entrymap.entry_list[change.record.path] = fromRecord(change.record);
+        }
+    });
+    // new snapshot for migrated indexes, and for ones written by older versions
+    if(!haveSnapshot || m_index->needsUpgrade())
+    {
+        Compact();
+    }
+}
+
+bool HttpMetaCache::LoadJson()
+{
     QFile index(m_index_file);
     if (!index.open(QIODevice::ReadOnly))
-        return;
+        return false;
 
     QJsonDocument json = QJsonDocument::fromJson(index.readAll());
     if (!json.isObject())
-        return;
+        return false;
     auto root = json.object();
     // check file version first
     auto version_val = root.value("version");
     if (!version_val.isString())
-        return;
+        return false;
     if (version_val.toString() != "1")
-        return;
+        return false;
 
     // read the entry array
     auto entries_val = root.value("entries");
     if (!entries_val.isArray())
-        return;
+        return false;
     QJsonArray array = entries_val.toArray();
     for (auto element : array)
     {
         if (!element.isObject())
-            return;
+            return false;
         auto element_obj = element.toObject();
         QString base = element_obj.value("base").toString();
         if (!m_entries.contains(base))
@@ -221,6 +376,8 @@ void HttpMetaCache::Load()
         foo->stale = false;
         entrymap.entry_list[path] = MetaEntryPtr(foo);
     }
+    qDebug() << "Migrating metacache index" << m_index_file << "with" << array.size() << "entries";
+    return true;
 }
 
 void HttpMetaCache::SaveEventually()
@@ -232,42 +389,74 @@ void HttpMetaCache::SaveEventually()
 
 void HttpMetaCache::SaveNow()
 {
-    if(m_index_file.isNull())
+    if(!m_index)
         return;
-    QJsonObject toplevel;
-    toplevel.insert("version", QJsonValue(QString("1")));
-    QJsonArray entriesArr;
-    for (auto group : m_entries)
+    QList<MetaCacheIndex::Change> changes;
+    for (auto iter = m_dirty.begin(); iter != m_dirty.end(); iter++)
     {
-        for (auto entry : group.entry_list)
+        auto &entrymap = m_entries[iter.key()];
+        for (auto & path : iter.value())
         {
+            MetaCacheIndex::Change change;
+            auto entry = entrymap.entry_list.value(path);
             // do not save stale entries. they are dead.
-            if(entry->stale)
+            if (!entry || entry->stale)
             {
-                continue;
+                change.removed = true;
+                change.record.base = iter.key();
+                change.record.path = path;
             }
-            QJsonObject entryObj;
-            entryObj.insert("base", QJsonValue(entry->baseId));
-            entryObj.insert("path", QJsonValue(entry->relativePath));
-            entryObj.insert("md5sum", QJsonValue(entry->md5sum));
-            entryObj.insert("etag", QJsonValue(entry->etag));
-            entryObj.insert("last_changed_timestamp",
-                            QJsonValue(double(entry->local_changed_timestamp)));
-            if (!entry->remote_changed_timestamp.isEmpty())
-                entryObj.insert("remote_changed_timestamp",
-                                QJsonValue(entry->remote_changed_timestamp));
-            entriesArr.append(entryObj);
+            else
+            {
+                change.record = toRecord(entry);
+            }
+            changes.append(change);
         }
     }
-    toplevel.insert("entries", entriesArr);
+    m_dirty.clear();
+    if (!m_index->appendJournal(changes))
+    {
+        // can't append, try to at least get a consistent snapshot out
+        Compact();
+        return;
+    }
+    // the journal is only supposed to be a short list of recent changes
+    if (m_index->journalSize() > std::max(1024, m_index->size() / 4))
+    {
+        Compact();
+    }
+}
 
-    QJsonDocument doc(toplevel);
-    try
+bool HttpMetaCache::Compact()
+{
+    if(!m_index)
+        return false;
+    QList<MetaCacheIndex::Record> records;
+    // everything from the snapshot we didn't touch
+    for (int i = 0; i < m_index->size(); i++)
     {
-        FS::write(m_index_file, doc.toJson());
+        auto record = m_index->at(i);
+        auto base = m_entries.find(record.base);
+        if (base == m_entries.end())
+            continue;
+        if (base->entry_list.contains(record.path))
+            continue;
+        records.append(record);
     }
-    catch (const Exception &e)
+    // and everything we have in memory
+    for (auto & group : m_entries)
     {
-        qWarning() << e.what();
+        for (auto & entry : group.entry_list)
+        {
+            // do not save stale entries. they are dead.
+            if (!entry || entry->stale)
+                continue;
+            records.append(toRecord(entry));
+        }
     }
+    if (!m_index->writeSnapshot(records))
+        return false;
+    // everything is in the snapshot now
+    m_dirty.clear();
+    return true;
 }
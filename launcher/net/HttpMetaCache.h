@@ -16,10 +16,15 @@
 #pragma once
 #include <QString>
 #include <QMap>
+#include <QSet>
 #include <qtimer.h>
 #include <memory>
 
+#include "MetaCacheIndex.h"
+#include "QObjectPtr.h"
+
 class HttpMetaCache;
+class Task;
 
 class MetaEntry
 {
@@ -48,6 +53,14 @@ public:
     {
         local_changed_timestamp = timestamp;
     }
+    void setLocalSize(qint64 size)
+    {
+        local_size = size;
+    }
+    void setLocalInode(quint64 inode)
+    {
+        local_inode = inode;
+    }
     QString getETag()
     {
         return etag;
@@ -71,12 +84,24 @@ protected:
     QString md5sum;
     QString etag;
     qint64 local_changed_timestamp = 0;
+    // size and inode of the file when it was last known good. -1 and 0 if unknown
+    qint64 local_size = -1;
+    quint64 local_inode = 0;
     QString remote_changed_timestamp; // QString for now, RFC 2822 encoded time
     bool stale = true;
 };
 
 typedef std::shared_ptr<MetaEntry> MetaEntryPtr;
 
+/**
+ * Cache of downloaded files, with enough metadata to do conditional requests.
+ *
+ * The index is stored in a memory mapped binary snapshot with a journal of changes (see MetaCacheIndex).
+ * Entries are only decoded from the snapshot when they are asked for.
+ *
+ * Files are checked by their size, timestamp and inode. They are only hashed when the timestamp changed but the size
+ * didn't, and that hashing can be deferred and done in bulk off the GUI thread (see setDeferVerification).
+ */
 class HttpMetaCache : public QObject
 {
     Q_OBJECT
@@ -99,6 +124,14 @@ public:
     // evict selected entry from cache
     bool evictEntry(MetaEntryPtr entry);
 
+    // while deferred, resolveEntry doesn't hash files with a changed timestamp. They are trusted for now and
+    // collected, to be checked with verifyEntries.
+    void setDeferVerification(bool defer);
+    // get the entries collected while verification was deferred and forget about them
+    QList<MetaEntryPtr> takeUnverifiedEntries();
+    // make a task that hashes the files of the entries off the GUI thread and drops the ones that don't match
+    shared_qobject_ptr<Task> verifyEntries(QList<MetaEntryPtr> entries);
+
     void addBase(QString base, QString base_root);
 
     // (re)start a timer that calls SaveNow later.
@@ -110,14 +143,34 @@ slots:
     void SaveNow();
 
 private:
+    friend class MetaCacheVerifyTask;
     // create a new stale entry, given the parameters
     MetaEntryPtr staleEntry(QString base, QString resource_path);
+    // drop the entry from the index
+    void removeEntry(QString base, QString resource_path);
+    void markDirty(const QString & base, const QString & resource_path);
+    // store the result of a deferred check. Returns false if the file didn't match the entry.
+    bool applyVerification(MetaEntryPtr entry, const QString & md5sum, qint64 last_changed, qint64 size, quint64 inode);
+    MetaEntryPtr fromRecord(const MetaCacheIndex::Record & record);
+    static MetaCacheIndex::Record toRecord(const MetaEntryPtr & entry);
+    // read the old JSON index, for migration
+    bool LoadJson();
+    // write a new snapshot with everything in it
+    bool Compact();
     struct EntryMap
     {
         QString base_path;
+        // entries loaded from the snapshot or changed since. null entries are removed ones.
         QMap<QString, MetaEntryPtr> entry_list;
     };
     QMap<QString, EntryMap> m_entries;
+    // changes not written to the journal yet: base -> paths
+    QMap<QString, QSet<QString>> m_dirty;
     QString m_index_file;
+    std::unique_ptr<MetaCacheIndex> m_index;
     QTimer saveBatchingTimer;
+    bool m_deferVerification = false;
+    QList<MetaEntryPtr> m_unverified;
+    // what is in m_unverified already, lookups happen for every entry of a big batch
+    QSet<const MetaEntry *> m_unverifiedSet;
 };
@@ -0,0 +1,308 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QEventLoop>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include "TestUtil.h"
+
+#include "net/HttpMetaCache.h"
+#include "tasks/Task.h"
+#include "FileSystem.h"
+
+class HttpMetaCacheTest : public QObject
+{
+    Q_OBJECT
+
+    QString pathFor(int i)
+    {
+        return QString("com/example/lib%1/1.0/lib%1-1.0.jar").arg(i);
+    }
+
+    void writeJsonIndex(const QString & file, int count)
+    {
+        QJsonArray entries;
+        for(int i = 0; i < count; i++)
+        {
+            QJsonObject entry;
+            entry.insert("base", QString("libraries"));
+            entry.insert("path", pathFor(i));
+            entry.insert("md5sum", QString("%1").arg(i, 32, 16, QChar('0')));
+            entry.insert("etag", QString("\"etag-%1\"").arg(i));
+            entry.insert("last_changed_timestamp", double(1600000000000LL + i));
+            entry.insert("remote_changed_timestamp", QString("Tue, 01 Jun 2021 00:00:00 GMT"));
+            entries.append(entry);
+        }
+        QJsonObject root;
+        root.insert("version", QString("1"));
+        root.insert("entries", entries);
+        FS::write(file, QJsonDocument(root).toJson());
+    }
+
+    std::unique_ptr<HttpMetaCache> makeCache(const QString & file)
+    {
+        std::unique_ptr<HttpMetaCache> cache(new HttpMetaCache(file));
+        cache->addBase("libraries", "libraries");
+        cache->addBase("meta", "meta");
+        cache->Load();
+        return cache;
+    }
+
+    void addEntry(HttpMetaCache & cache, const QString & base, const QString & path, const QString & md5)
+    {
+        auto entry = cache.resolveEntry(base, path);
+        entry->setMD5Sum(md5);
+        entry->setETag("\"" + md5 + "\"");
+        entry->setStale(false);
+        cache.updateEntry(entry);
+    }
+
+    MetaEntryPtr addFile(HttpMetaCache & cache, const QString & root, const QString & path, const QByteArray & data)
+    {
+        auto fullPath = FS::PathCombine(root, path);
+        FS::write(fullPath, data);
+        QFileInfo finfo(fullPath);
+        auto entry = cache.resolveEntry("files", path);
+        entry->setMD5Sum(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+        entry->setLocalChangedTimestamp(finfo.lastModified().toUTC().toMSecsSinceEpoch());
+        entry->setLocalSize(finfo.size());
+        entry->setLocalInode(FS::fileIdentity(fullPath));
+        entry->setStale(false);
+        cache.updateEntry(entry);
+        return entry;
+    }
+
+    void setTimestamp(const QString & file, qint64 msecs)
+    {
+        QFile handle(file);
+        QVERIFY(handle.open(QIODevice::ReadWrite));
+        QVERIFY(handle.setFileTime(QDateTime::fromMSecsSinceEpoch(msecs), QFileDevice::FileModificationTime));
+    }
+
+private
+slots:
+    void test_migrateJson()
+    {
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "metacache");
+        writeJsonIndex(file, 100);
+
+        auto cache = makeCache(file);
+        QVERIFY(QFile::exists(file + ".idx"));
+        auto entry = cache->getEntry("libraries", pathFor(42));
+        QVERIFY(entry);
+        QCOMPARE(entry->getETag(), QString("\"etag-42\""));
+        cache.reset();
+
+        // the snapshot is used from now on, even without the old index
+        QFile::remove(file);
+        cache = makeCache(file);
+        entry = cache->getEntry("libraries", pathFor(99));
+        QVERIFY(entry);
+        QCOMPARE(entry->getMD5Sum(), QString("%1").arg(99, 32, 16, QChar('0')));
+        QVERIFY(!cache->getEntry("libraries", pathFor(100)));
+        QVERIFY(!cache->getEntry("meta", pathFor(1)));
+    }
+
+    void test_journal()
+    {
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "metacache");
+        writeJsonIndex(file, 10);
+
+        auto cache = makeCache(file);
+        addEntry(*cache, "meta", "index.json", "aaaa");
+        cache->evictEntry(cache->getEntry("libraries", pathFor(3)));
+        cache->SaveNow();
+        QVERIFY(QFileInfo(file + ".journal").size() > 8);
+        cache.reset();
+
+        cache = makeCache(file);
+        auto entry = cache->getEntry("meta", "index.json");
+        QVERIFY(entry);
+        QCOMPARE(entry->getMD5Sum(), QString("aaaa"));
+        QVERIFY(!cache->getEntry("libraries", pathFor(3)));
+        QVERIFY(cache->getEntry("libraries", pathFor(4)));
+
+        // a torn write at the end of the journal doesn't take the rest down with it
+        cache.reset();
+        {
+            QFile journal(file + ".journal");
+            QVERIFY(journal.open(QIODevice::Append));
+            journal.write("\x40\x00\x00\x00\x00garbage", 12);
+        }
+        cache = makeCache(file);
+        QVERIFY(cache->getEntry("meta", "index.json"));
+    }
+
+    void test_compaction()
+    {
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "metacache");
+
+        auto cache = makeCache(file);
+        for(int i = 0; i < 3000; i++)
+        {
+            addEntry(*cache, "libraries", pathFor(i), QString::number(i));
+            if(i % 100 == 0)
+            {
+                cache->SaveNow();
+            }
+        }
+        cache->SaveNow();
+        cache.reset();
+
+        // the journal got long enough to be folded into the snapshot
+        QVERIFY(QFileInfo(file + ".journal").size() < QFileInfo(file + ".idx").size());
+        cache = makeCache(file);
+        for(int i = 0; i < 3000; i++)
+        {
+            auto entry = cache->getEntry("libraries", pathFor(i));
+            QVERIFY(entry);
+            QCOMPARE(entry->getMD5Sum(), QString::number(i));
+        }
+    }
+
+    void test_fingerprints()
+    {
+        QTemporaryDir dir;
+        auto root = FS::PathCombine(dir.path(), "files");
+        HttpMetaCache cache(FS::PathCombine(dir.path(), "metacache"));
+        cache.addBase("files", root);
+        cache.Load();
+
+        addFile(cache, root, "same.bin", QByteArray(1000, 'a'));
+        addFile(cache, root, "resized.bin", QByteArray(1000, 'a'));
+        addFile(cache, root, "changed.bin", QByteArray(1000, 'a'));
+        addFile(cache, root, "restored.bin", QByteArray(1000, 'a'));
+
+        // untouched
+        QVERIFY(!cache.resolveEntry("files", "same.bin")->isStale());
+
+        // a different size is caught without hashing anything
+        FS::write(FS::PathCombine(root, "resized.bin"), QByteArray(999, 'a'));
+        QVERIFY(cache.resolveEntry("files", "resized.bin")->isStale());
+
+        // same size, new timestamp: hashed
+        auto changedPath = FS::PathCombine(root, "changed.bin");
+        FS::write(changedPath, QByteArray(1000, 'b'));
+        setTimestamp(changedPath, 1500000000000LL);
+        QVERIFY(cache.resolveEntry("files", "changed.bin")->isStale());
+
+        // copied over with the timestamp kept (new inode, same size and timestamp): trusted as is
+        auto restoredPath = FS::PathCombine(root, "restored.bin");
+        auto timestamp = QFileInfo(restoredPath).lastModified().toMSecsSinceEpoch();
+        QVERIFY(QFile::remove(restoredPath));
+        FS::write(restoredPath, QByteArray(1000, 'a'));
+        setTimestamp(restoredPath, timestamp);
+        QVERIFY(!cache.resolveEntry("files", "restored.bin")->isStale());
+    }
+
+    void test_deferredVerification()
+    {
+        QTemporaryDir dir;
+        auto root = FS::PathCombine(dir.path(), "files");
+        HttpMetaCache cache(FS::PathCombine(dir.path(), "metacache"));
+        cache.addBase("files", root);
+        cache.Load();
+
+        for(int i = 0; i < 20; i++)
+        {
+            auto path = QString("file%1.bin").arg(i);
+            addFile(cache, root, path, QByteArray(100000, 'a' + i));
+            // every other file gets different contents of the same size
+            if(i % 2)
+            {
+                FS::write(FS::PathCombine(root, path), QByteArray(100000, 'z'));
+            }
+            setTimestamp(FS::PathCombine(root, path), 1500000000000LL + i);
+        }
+
+        cache.setDeferVerification(true);
+        for(int i = 0; i < 20; i++)
+        {
+            QVERIFY(!cache.resolveEntry("files", QString("file%1.bin").arg(i))->isStale());
+        }
+        cache.setDeferVerification(false);
+        auto unverified = cache.takeUnverifiedEntries();
+        QCOMPARE(unverified.size(), 20);
+        QVERIFY(cache.takeUnverifiedEntries().isEmpty());
+
+        auto task = cache.verifyEntries(unverified);
+        QEventLoop loop;
+        connect(task.get(), &Task::finished, &loop, &QEventLoop::quit);
+        task->start();
+        if(!task->isFinished())
+        {
+            loop.exec();
+        }
+        QVERIFY(task->wasSuccessful());
+
+        for(int i = 0; i < 20; i++)
+        {
+            auto entry = cache.resolveEntry("files", QString("file%1.bin").arg(i));
+            QCOMPARE(entry->isStale(), i % 2 == 1);
+        }
+        // the good ones don't need to be checked again
+        cache.setDeferVerification(true);
+        for(int i = 0; i < 20; i += 2)
+        {
+            cache.resolveEntry("files", QString("file%1.bin").arg(i));
+        }
+        cache.setDeferVerification(false);
+        QVERIFY(cache.takeUnverifiedEntries().isEmpty());
+    }
+
+    void benchmark_load_data()
+    {
+        QTest::addColumn<bool>("binary");
+        QTest::newRow("json") << false;
+        QTest::newRow("binary") << true;
+    }
+
+    void benchmark_load()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, binary);
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "metacache");
+        writeJsonIndex(file, 50000);
+        // migrate once
+        makeCache(file).reset();
+
+        QBENCHMARK
+        {
+            if(!binary)
+            {
+                // force the old path: parse the whole JSON index
+                QFile::remove(file + ".idx");
+            }
+            auto cache = makeCache(file);
+            QVERIFY(cache->getEntry("libraries", pathFor(12345)));
+        }
+    }
+
+    void benchmark_lookup()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QTemporaryDir dir;
+        auto file = FS::PathCombine(dir.path(), "metacache");
+        writeJsonIndex(file, 50000);
+        auto cache = makeCache(file);
+
+        int i = 0;
+        QBENCHMARK
+        {
+            QVERIFY(cache->getEntry("libraries", pathFor(int((i * 7919LL) % 50000))));
+            QVERIFY(!cache->getEntry("libraries", "does/not/exist.jar"));
+            i++;
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(HttpMetaCacheTest)
+
+#include "HttpMetaCache_test.moc"
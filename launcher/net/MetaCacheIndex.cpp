@@ -0,0 +1,532 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MetaCacheIndex.h"
+
+#include <QSaveFile>
+#include <QHash>
+#include <QtEndian>
+#include <QDebug>
+
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+/*
+ * Snapshot layout, all integers little endian:
+ *
+ * header (32 bytes):
+ *   char[4] magic "MMCX", u32 version, u32 record count, u32 reserved, u64 pool offset, u64 pool size
+ * records (64 bytes each, sorted by UTF-8 base, then UTF-8 path):
+ *   5x (u32 offset, u32 size) into the pool for base, path, md5sum, etag, remote timestamp
+ *   i64 local changed timestamp, i64 local size, u64 local inode
+ *   (version 1 records are 48 bytes and stop after the timestamp)
+ * pool:
+ *   UTF-8 strings, not terminated
+ *
+ * Journal layout:
+ *   char[4] magic "MMCJ", u32 version
+ *   records: u32 payload size, payload = u8 removed, 5x (u32 size, UTF-8 bytes), i64 local changed timestamp,
+ *   i64 local size, u64 local inode (version 1 records stop after the timestamp)
+ */
+
+namespace {
+const char snapshotMagic[4] = {'M', 'M', 'C', 'X'};
+const quint32 snapshotVersion = 2;
+const qint64 headerSize = 32;
+const qint64 recordSizeV1 = 48;
+const qint64 recordSize = 64;
+const int stringFields = 5;
+
+const char journalMagic[4] = {'M', 'M', 'C', 'J'};
+const quint32 journalVersion = 2;
+const int journalHeaderSize = 8;
+
+enum StringField
+{
+    BaseField = 0,
+    PathField = 1,
+    Md5Field = 2,
+    EtagField = 3,
+    RemoteField = 4
+};
+
+void putU32(QByteArray & out, quint32 value)
+{
+    uchar buffer[4];
+    qToLittleEndian<quint32>(value, buffer);
+    out.append((const char *) buffer, 4);
+}
+
+void putI64(QByteArray & out, qint64 value)
+{
+    uchar buffer[8];
+    qToLittleEndian<qint64>(value, buffer);
+    out.append((const char *) buffer, 8);
+}
+
+quint32 getU32(const uchar * data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+quint64 getU64(const uchar * data)
+{
+    return qFromLittleEndian<quint64>(data);
+}
+
+qint64 getI64(const uchar * data)
+{
+    return qFromLittleEndian<qint64>(data);
+}
+
+int compareBytes(const uchar * data, quint32 size, const QByteArray & other)
+{
+    int common = std::min<int>(size, other.size());
+    int result = memcmp(data, other.constData(), common);
+    if(result != 0)
+    {
+        return result;
+    }
+    if((int) size == other.size())
+    {
+        return 0;
+    }
+    return (int) size < other.size() ? -1 : 1;
+}
+
+QByteArray sortKey(const MetaCacheIndex::Record & record)
+{
+    // '\0' sorts before everything, so this orders by base first and path second
+    return record.base.toUtf8() + '\0' + record.path.toUtf8();
+}
+
+void putJournalString(QByteArray & out, const QString & value)
+{
+    auto utf8 = value.toUtf8();
+    putU32(out, utf8.size());
+    out.append(utf8);
+}
+
+bool getJournalString(const uchar *& data, const uchar * end, QString & value)
+{
+    if(end - data < 4)
+    {
+        return false;
+    }
+    quint32 size = getU32(data);
+    data += 4;
+    if(quint64(end - data) < size)
+    {
+        return false;
+    }
+    value = QString::fromUtf8((const char *) data, size);
+    data += size;
+    return true;
+}
+}
+
+MetaCacheIndex::MetaCacheIndex(const QString& path) : m_path(path)
+{
+}
+
+MetaCacheIndex::~MetaCacheIndex()
+{
+    close();
+}
+
+QString MetaCacheIndex::snapshotPath() const
+{
+    return m_path + ".idx";
+}
+
+QString MetaCacheIndex::journalPath() const
+{
+    return m_path + ".journal";
+}
+
+bool MetaCacheIndex::open()
+{
+    close();
+    m_file.setFileName(snapshotPath());
+    if(!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    qint64 fileSize = m_file.size();
+    if(fileSize < headerSize)
+    {
+        qWarning() << "Metacache snapshot" << snapshotPath() << "is truncated";
+        close();
+        return false;
+    }
+    const uchar * data = m_file.map(0, fileSize);
+    if(!data)
+    {
+        qWarning() << "Failed to map metacache snapshot" << snapshotPath() << ":" << m_file.errorString();
+        close();
+        return false;
+    }
+    m_data = data;
+    m_dataSize = fileSize;
+
+    quint32 version = getU32(data + 4);
+    if(memcmp(data, snapshotMagic, 4) != 0 || version < 1 || version > snapshotVersion)
+    {
+        qWarning() << "Metacache snapshot" << snapshotPath() << "has an unknown format";
+        close();
+        return false;
+    }
+    quint32 count = getU32(data + 8);
+    quint64 poolOffset = getU64(data + 16);
+    quint64 poolSize = getU64(data + 24);
+    m_recordSize = version == 1 ? recordSizeV1 : recordSize;
+    if(quint64(headerSize + count * m_recordSize) > poolOffset || poolOffset > quint64(fileSize) || poolSize > quint64(fileSize) - poolOffset)
+    {
+        qWarning() << "Metacache snapshot" << snapshotPath() << "is corrupted";
+        close();
+        return false;
+    }
+    m_count = count;
+    m_records = data + headerSize;
+    m_pool = data + poolOffset;
+    m_poolSize = poolSize;
+    if(version != snapshotVersion)
+    {
+        m_outdated = true;
+    }
+    return true;
+}
+
+void MetaCacheIndex::close()
+{
+    if(m_data)
+    {
+        m_file.unmap((uchar *) m_data);
+    }
+    m_file.close();
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_records = nullptr;
+    m_pool = nullptr;
+    m_poolSize = 0;
+    m_count = 0;
+    m_recordSize = 0;
+}
+
+bool MetaCacheIndex::lookup(const QString& base, const QString& path, Record& out) const
+{
+    if(!m_data)
+    {
+        return false;
+    }
+    auto baseUtf8 = base.toUtf8();
+    auto pathUtf8 = path.toUtf8();
+
+    auto stringAt = [&](const uchar * record, int field, const uchar *& str, quint32 & size) -> bool
+    {
+        quint32 offset = getU32(record + field * 8);
+        size = getU32(record + field * 8 + 4);
+        if(quint64(offset) + size > quint64(m_poolSize))
+        {
+            return false;
+        }
+        str = m_pool + offset;
+        return true;
+    };
+
+    int low = 0;
+    int high = m_count - 1;
+    while(low <= high)
+    {
+        int middle = low + (high - low) / 2;
+        const uchar * record = m_records + middle * m_recordSize;
+        const uchar * str;
+        quint32 size;
+        if(!stringAt(record, BaseField, str, size))
+        {
+            return false;
+        }
+        int result = compareBytes(str, size, baseUtf8);
+        if(result == 0)
+        {
+            if(!stringAt(record, PathField, str, size))
+            {
+                return false;
+            }
+            result = compareBytes(str, size, pathUtf8);
+        }
+        if(result == 0)
+        {
+            out = at(middle);
+            return true;
+        }
+        if(result < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+    return false;
+}
+
+MetaCacheIndex::Record MetaCacheIndex::at(int index) const
+{
+    Record out;
+    if(index < 0 || index >= m_count)
+    {
+        return out;
+    }
+    const uchar * record = m_records + index * m_recordSize;
+    QString * fields[stringFields] = { &out.base, &out.path, &out.md5sum, &out.etag, &out.remoteChanged };
+    for(int i = 0; i < stringFields; i++)
+    {
+        quint32 offset = getU32(record + i * 8);
+        quint32 size = getU32(record + i * 8 + 4);
+        if(quint64(offset) + size > quint64(m_poolSize))
+        {
+            return Record();
+        }
+        *fields[i] = QString::fromUtf8((const char *) m_pool + offset, size);
+    }
+    out.localChanged = getI64(record + stringFields * 8);
+    if(m_recordSize >= recordSize)
+    {
+        out.localSize = getI64(record + stringFields * 8 + 8);
+        out.localInode = getU64(record + stringFields * 8 + 16);
+    }
+    return out;
+}
+
+bool MetaCacheIndex::writeSnapshot(QList<Record> records)
+{
+    // sort by key, last one wins for duplicates
+    std::vector<std::pair<QByteArray, int>> keys;
+    keys.reserve(records.size());
+    for(int i = 0; i < records.size(); i++)
+    {
+        keys.emplace_back(sortKey(records[i]), i);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<QByteArray, int> & a, const std::pair<QByteArray, int> & b)
+    {
+        return a.first < b.first;
+    });
+
+    QByteArray recordData;
+    QByteArray pool;
+    // bases repeat a lot, store them once
+    QHash<QString, quint32> baseOffsets;
+    int written = 0;
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        if(i + 1 < keys.size() && keys[i + 1].first == keys[i].first)
+        {
+            continue;
+        }
+        const auto & record = records[keys[i].second];
+        const QString * fields[stringFields] = { &record.base, &record.path, &record.md5sum, &record.etag, &record.remoteChanged };
+        for(int field = 0; field < stringFields; field++)
+        {
+            auto utf8 = fields[field]->toUtf8();
+            if(field == BaseField && baseOffsets.contains(record.base))
+            {
+                putU32(recordData, baseOffsets[record.base]);
+                putU32(recordData, utf8.size());
+                continue;
+            }
+            if(field == BaseField)
+            {
+                baseOffsets[record.base] = pool.size();
+            }
+            putU32(recordData, pool.size());
+            putU32(recordData, utf8.size());
+            pool.append(utf8);
+        }
+        putI64(recordData, record.localChanged);
+        putI64(recordData, record.localSize);
+        putI64(recordData, record.localInode);
+        written++;
+    }
+
+    QByteArray data;
+    data.reserve(headerSize + recordData.size() + pool.size());
+    data.append(snapshotMagic, 4);
+    putU32(data, snapshotVersion);
+    putU32(data, written);
+    putU32(data, 0);
+    putI64(data, headerSize + recordData.size());
+    putI64(data, pool.size());
+    data.append(recordData);
+    data.append(pool);
+
+    QSaveFile out(snapshotPath());
+    if(!out.open(QIODevice::WriteOnly) || out.write(data) != data.size())
+    {
+        qWarning() << "Failed to write metacache snapshot" << snapshotPath() << ":" << out.errorString();
+        out.cancelWriting();
+        return false;
+    }
+    // the old snapshot can't be replaced while it's mapped on some platforms
+    close();
+    if(!out.commit())
+    {
+        qWarning() << "Failed to commit metacache snapshot" << snapshotPath() << ":" << out.errorString();
+        open();
+        return false;
+    }
+    // everything in the journal is in the snapshot now, and both are in the current format
+    resetJournal();
+    m_outdated = false;
+    return open();
+}
+
+bool MetaCacheIndex::resetJournal()
+{
+    m_journalRecords = 0;
+    m_journalVersion = journalVersion;
+    QFile journal(journalPath());
+    if(!journal.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Failed to reset metacache journal" << journalPath() << ":" << journal.errorString();
+        return false;
+    }
+    QByteArray header;
+    header.append(journalMagic, 4);
+    putU32(header, journalVersion);
+    return journal.write(header) == header.size();
+}
+
+bool MetaCacheIndex::replayJournal(std::function<void(const Change &)> apply)
+{
+    m_journalRecords = 0;
+    QFile journal(journalPath());
+    if(!journal.open(QIODevice::ReadWrite))
+    {
+        return false;
+    }
+    auto contents = journal.readAll();
+    quint32 version = contents.size() < journalHeaderSize ? 0 : getU32((const uchar *) contents.constData() + 4);
+    if(contents.size() < journalHeaderSize || memcmp(contents.constData(), journalMagic, 4) != 0 || version < 1 || version > journalVersion)
+    {
+        qWarning() << "Metacache journal" << journalPath() << "has an unknown format, ignoring it";
+        journal.close();
+        resetJournal();
+        return false;
+    }
+    m_journalVersion = version;
+    if(version != journalVersion)
+    {
+        m_outdated = true;
+    }
+    const qint64 fixedTail = version == 1 ? 8 : 24;
+    const uchar * begin = (const uchar *) contents.constData();
+    const uchar * data = begin + journalHeaderSize;
+    const uchar * end = begin + contents.size();
+    while(data != end)
+    {
+        if(end - data < 4)
+        {
+            break;
+        }
+        quint32 payloadSize = getU32(data);
+        if(quint64(end - data - 4) < payloadSize || payloadSize < 1 + stringFields * 4 + fixedTail)
+        {
+            break;
+        }
+        const uchar * payload = data + 4;
+        const uchar * payloadEnd = payload + payloadSize;
+        Change change;
+        change.removed = *payload++ != 0;
+        auto & record = change.record;
+        if(!getJournalString(payload, payloadEnd, record.base) ||
+           !getJournalString(payload, payloadEnd, record.path) ||
+           !getJournalString(payload, payloadEnd, record.md5sum) ||
+           !getJournalString(payload, payloadEnd, record.etag) ||
+           !getJournalString(payload, payloadEnd, record.remoteChanged) ||
+           payloadEnd - payload != fixedTail)
+        {
+            break;
+        }
+        record.localChanged = getI64(payload);
+        if(version != 1)
+        {
+            record.localSize = getI64(payload + 8);
+            record.localInode = getU64(payload + 16);
+        }
+        apply(change);
+        m_journalRecords++;
+        data = payloadEnd;
+    }
+    if(data != end)
+    {
+        // the launcher died while writing the last change. drop it.
+        qWarning() << "Dropping torn record at the end of metacache journal" << journalPath();
+        journal.resize(data - begin);
+    }
+    return true;
+}
+
+bool MetaCacheIndex::appendJournal(const QList<Change>& changes)
+{
+    if(changes.isEmpty())
+    {
+        return true;
+    }
+    QFile journal(journalPath());
+    if(!journal.exists() || journal.size() < journalHeaderSize)
+    {
+        if(!resetJournal())
+        {
+            return false;
+        }
+    }
+    else if(m_journalVersion != 0 && m_journalVersion != journalVersion)
+    {
+        // never mix record formats in one journal. The owner has to compact first.
+        qWarning() << "Metacache journal" << journalPath() << "is in an old format, not appending to it";
+        return false;
+    }
+    QByteArray data;
+    for(auto & change: changes)
+    {
+        QByteArray payload;
+        payload.append(change.removed ? '\1' : '\0');
+        putJournalString(payload, change.record.base);
+        putJournalString(payload, change.record.path);
+        putJournalString(payload, change.record.md5sum);
+        putJournalString(payload, change.record.etag);
+        putJournalString(payload, change.record.remoteChanged);
+        putI64(payload, change.record.localChanged);
+        putI64(payload, change.record.localSize);
+        putI64(payload, change.record.localInode);
+        putU32(data, payload.size());
+        data.append(payload);
+    }
+    if(!journal.open(QIODevice::Append))
+    {
+        qWarning() << "Failed to open metacache journal" << journalPath() << ":" << journal.errorString();
+        return false;
+    }
+    if(journal.write(data) != data.size())
+    {
+        qWarning() << "Failed to append to metacache journal" << journalPath() << ":" << journal.errorString();
+        return false;
+    }
+    m_journalRecords += changes.size();
+    return true;
+}
@@ -0,0 +1,112 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QString>
+#include <QFile>
+#include <QList>
+#include <functional>
+
+/**
+ * On-disk storage for the HttpMetaCache index.
+ *
+ * The index is made of two files:
+ *  - <path>.idx is a snapshot: a header, an array of fixed size records sorted by (base, path) and a pool of UTF-8
+ *    strings. It is memory mapped and searched in place, so nothing has to be parsed to look up an entry.
+ *  - <path>.journal is an append-only list of changes made since the snapshot was written.
+ *
+ * When the journal gets too long, the owner writes a new snapshot (compaction) and the journal is truncated.
+ */
+class MetaCacheIndex
+{
+public: /* types */
+    struct Record
+    {
+        QString base;
+        QString path;
+        QString md5sum;
+        QString etag;
+        QString remoteChanged;
+        qint64 localChanged = 0;
+        /// size and file system identity of the file when it was last known good. -1 and 0 when unknown.
+        qint64 localSize = -1;
+        quint64 localInode = 0;
+    };
+    struct Change
+    {
+        bool removed = false;
+        Record record;
+    };
+
+public: /* con/des */
+    explicit MetaCacheIndex(const QString & path);
+    ~MetaCacheIndex();
+
+public: /* methods */
+    /// Map the snapshot. Returns false if there is none, or it's not usable.
+    bool open();
+    void close();
+    bool isOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    /// Number of records in the snapshot
+    int size() const
+    {
+        return m_count;
+    }
+    /// Binary search the snapshot for an entry
+    bool lookup(const QString & base, const QString & path, Record & out) const;
+    /// Decode the record at index (for compaction)
+    Record at(int index) const;
+    /// True if the snapshot or journal were written in an older format and should be rewritten
+    bool needsUpgrade() const
+    {
+        return m_outdated;
+    }
+
+    /// Apply all the changes stored in the journal, in order. Drops a torn record at the end, if any.
+    bool replayJournal(std::function<void(const Change &)> apply);
+    bool appendJournal(const QList<Change> & changes);
+    int journalSize() const
+    {
+        return m_journalRecords;
+    }
+
+    /// Replace the snapshot with the records (in any order) and clear the journal
+    bool writeSnapshot(QList<Record> records);
+
+    QString snapshotPath() const;
+    QString journalPath() const;
+
+private: /* methods */
+    bool resetJournal();
+
+private: /* data */
+    QString m_path;
+    QFile m_file;
+    const uchar * m_data = nullptr;
+    qint64 m_dataSize = 0;
+    const uchar * m_records = nullptr;
+    const uchar * m_pool = nullptr;
+    qint64 m_poolSize = 0;
+    int m_count = 0;
+    qint64 m_recordSize = 0;
+    int m_journalRecords = 0;
+    quint32 m_journalVersion = 0;
+    bool m_outdated = false;
+};
@@ -52,6 +52,8 @@ JobStatus MetaCacheSink::finalizeCache(QNetworkReply & reply)
         m_entry->setRemoteChangedTimestamp(reply.rawHeader("Last-Modified").constData());
     }
     m_entry->setLocalChangedTimestamp(output_file_info.lastModified().toUTC().toMSecsSinceEpoch());
+    m_entry->setLocalSize(output_file_info.size());
+    m_entry->setLocalInode(FS::fileIdentity(m_filename));
     m_entry->setStale(false);
     ENV.metacache()->updateEntry(m_entry);
     return Job_Finished;
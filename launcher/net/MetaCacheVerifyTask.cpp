@@ -0,0 +1,87 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MetaCacheVerifyTask.h"
+#include "FileSystem.h"
+
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <QDateTime>
+
+namespace {
+MetaCacheVerifyTask::Result verifyFile(const QString & path)
+{
+    MetaCacheVerifyTask::Result result;
+    // take the fingerprint first, so a change while we hash makes it mismatch next time instead of being missed
+    QFileInfo finfo(path);
+    result.lastChanged = finfo.lastModified().toUTC().toMSecsSinceEpoch();
+    result.size = finfo.size();
+    result.inode = FS::fileIdentity(path);
+    result.md5sum = FS::hashFile(path, QCryptographicHash::Md5).toHex();
+    return result;
+}
+}
+
+MetaCacheVerifyTask::MetaCacheVerifyTask(HttpMetaCache* cache, QList<MetaEntryPtr> entries)
+    : Task(), m_cache(cache), m_entries(entries)
+{
+}
+
+void MetaCacheVerifyTask::executeTask()
+{
+    setStatus(tr("Verifying %n cached file(s)...", "", m_entries.size()));
+    QStringList paths;
+    for(auto & entry: m_entries)
+    {
+        paths.append(entry->getFullPath());
+    }
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &MetaCacheVerifyTask::hashingFinished);
+    connect(&m_watcher, &QFutureWatcher<Result>::progressValueChanged, this, [this](int value)
+    {
+        setProgress(value, m_entries.size());
+    });
+    m_future = QtConcurrent::mapped(paths, verifyFile);
+    m_watcher.setFuture(m_future);
+}
+
+void MetaCacheVerifyTask::hashingFinished()
+{
+    if(m_future.isCanceled())
+    {
+        emitAborted();
+        return;
+    }
+    m_mismatched = 0;
+    for(int i = 0; i < m_entries.size(); i++)
+    {
+        auto result = m_future.resultAt(i);
+        if(!m_cache->applyVerification(m_entries[i], result.md5sum, result.lastChanged, result.size, result.inode))
+        {
+            m_mismatched++;
+        }
+    }
+    emitSucceeded();
+}
+
+bool MetaCacheVerifyTask::abort()
+{
+    if(!m_future.isRunning())
+    {
+        // nothing to stop
+        return m_future.isFinished();
+    }
+    m_future.cancel();
+    return true;
+}
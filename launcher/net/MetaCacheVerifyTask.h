@@ -0,0 +1,73 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tasks/Task.h"
+#include "HttpMetaCache.h"
+
+#include <QFuture>
+#include <QFutureWatcher>
+
+/**
+ * Checks the files of metacache entries against their stored MD5 sums.
+ *
+ * The files are hashed on the global thread pool, a few at a time, in small chunks. The results are applied to the
+ * cache on the thread that owns the task: entries that still match get a fresh fingerprint, the rest are dropped.
+ */
+class MetaCacheVerifyTask : public Task
+{
+    Q_OBJECT
+public: /* types */
+    struct Result
+    {
+        QString md5sum;
+        qint64 lastChanged = 0;
+        qint64 size = -1;
+        quint64 inode = 0;
+    };
+
+public: /* con/des */
+    MetaCacheVerifyTask(HttpMetaCache * cache, QList<MetaEntryPtr> entries);
+    virtual ~MetaCacheVerifyTask() {};
+
+public: /* methods */
+    bool canAbort() const override
+    {
+        return true;
+    }
+
+    /// Number of entries that didn't match their files, after the task succeeded
+    int mismatched() const
+    {
+        return m_mismatched;
+    }
+
+public slots:
+    bool abort() override;
+
+protected:
+    void executeTask() override;
+
+private slots:
+    void hashingFinished();
+
+private: /* data */
+    HttpMetaCache * m_cache;
+    QList<MetaEntryPtr> m_entries;
+    QFuture<Result> m_future;
+    QFutureWatcher<Result> m_watcher;
+    int m_mismatched = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QCryptographicHash>
+#include <QByteArray>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+namespace Net {
+/*
+ * Computes several hashes of the same data in one pass.
+ *
+ * The data is fed to all the hashes in small blocks, so every block is still in the CPU cache when the next hash
+ * reads it, instead of going over the whole chunk once per hash.
+ */
+class MultiHash
+{
+public: /* methods */
+    void addAlgorithm(QCryptographicHash::Algorithm algorithm)
+    {
+        if(find(algorithm))
+        {
+            return;
+        }
+        m_hashes.emplace_back(algorithm, std::unique_ptr<QCryptographicHash>(new QCryptographicHash(algorithm)));
+    }
+    bool isEmpty() const
+    {
+        return m_hashes.empty();
+    }
+    void reset()
+    {
+        for(auto & hash: m_hashes)
+        {
+            hash.second->reset();
+        }
+    }
+    void addData(const char * data, qint64 size)
+    {
+        if(m_hashes.empty())
+        {
+            return;
+        }
+        const qint64 blockSize = 16 * 1024;
+        for(qint64 offset = 0; offset < size; offset += blockSize)
+        {
+            int length = int(std::min(blockSize, size - offset));
+            for(auto & hash: m_hashes)
+            {
+                hash.second->addData(data + offset, length);
+            }
+        }
+    }
+    QByteArray result(QCryptographicHash::Algorithm algorithm) const
+    {
+        auto hash = find(algorithm);
+        if(!hash)
+        {
+            return QByteArray();
+        }
+        return hash->result();
+    }
+
+private: /* methods */
+    QCryptographicHash * find(QCryptographicHash::Algorithm algorithm) const
+    {
+        for(auto & hash: m_hashes)
+        {
+            if(hash.first == algorithm)
+            {
+                return hash.second.get();
+            }
+        }
+        return nullptr;
+    }
+
+private: /* data */
+    std::vector<std::pair<QCryptographicHash::Algorithm, std::unique_ptr<QCryptographicHash>>> m_hashes;
+};
+}
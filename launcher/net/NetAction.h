@@ -78,6 +78,17 @@ public:
     {
         return m_url;
     }
+    /// The request failed on its way to the host (connection, DNS, timeout), not because of what the host answered
+    bool failedInTransport() const
+    {
+        if(m_networkError == QNetworkReply::ProxyTimeoutError)
+        {
+            return true;
+        }
+        // errors below 100 are network layer errors. Cancelling is something we do ourselves.
+        return m_networkError != QNetworkReply::NoError && m_networkError != QNetworkReply::OperationCanceledError
+            && m_networkError < QNetworkReply::ProxyConnectionRefusedError;
+    }
 
 signals:
     void started(int index);
@@ -110,4 +121,5 @@ public:
 
 protected:
     JobStatus m_status = Job_NotStarted;
+    QNetworkReply::NetworkError m_networkError = QNetworkReply::NoError;
 };
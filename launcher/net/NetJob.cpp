@@ -15,23 +15,39 @@
 
 #include "NetJob.h"
 #include "Download.h"
+#include "Env.h"
 
 #include <QDebug>
 
+NetJob::NetJob(QString job_name) : Task()
+{
+    setObjectName(job_name);
+    m_scheduler = ENV.netScheduler();
+}
+
 void NetJob::partSucceeded(int index)
 {
     // do progress. all slots are 1 in size at least
     auto &slot = parts_progress[index];
     partProgress(index, slot.total_progress, slot.total_progress);
 
+    releaseSlot(index, Net::Scheduler::Outcome::Success);
     m_doing.remove(index);
     m_done.insert(index);
     downloads[index].get()->disconnect(this);
     startMoreParts();
 }
 
+void NetJob::partStarted(int index)
+{
+    // latency is measured from here, not from when the part was handed its slot and still had its sink to set up
+    parts_progress[index].timer.start();
+}
+
 void NetJob::partFailed(int index)
 {
+    auto outcome = downloads[index]->failedInTransport() ? Net::Scheduler::Outcome::TransportError : Net::Scheduler::Outcome::Failed;
+    releaseSlot(index, outcome);
     m_doing.remove(index);
     auto &slot = parts_progress[index];
     if (slot.failures == 3)
@@ -41,7 +57,7 @@ void NetJob::partFailed(int index)
     else
     {
         slot.failures++;
-        m_todo.enqueue(index);
+        m_todo[downloads[index]->url().host()].enqueue(index);
     }
     downloads[index].get()->disconnect(this);
     startMoreParts();
@@ -50,6 +66,7 @@ void NetJob::partFailed(int index)
 void NetJob::partAborted(int index)
 {
     m_aborted = true;
+    cancelSlot(index);
     m_doing.remove(index);
     m_failed.insert(index);
     downloads[index].get()->disconnect(this);
@@ -109,9 +126,24 @@ void NetJob::startMoreParts()
         // this actually makes sense. You can put running downloads into a NetJob and then not start it until much later.
         return;
     }
+    // Parts can finish synchronously when started (cache hits...), which calls this again.
+    // Let the outermost call do the work instead of recursing once per part.
+    if(m_startingParts)
+    {
+        m_restartParts = true;
+        return;
+    }
+    m_startingParts = true;
+    do
+    {
+        m_restartParts = false;
+        startQueuedParts();
+    } while (m_restartParts);
+    m_startingParts = false;
+
     // OK. We are actively processing tasks, proceed.
     // Check for final conditions if there's nothing in the queue.
-    if(!m_todo.size())
+    if(!todoCount())
     {
         if(!m_doing.size())
         {
@@ -130,24 +162,94 @@ void NetJob::startMoreParts()
         }
         return;
     }
-    // There's work to do, try to start more parts.
-    while (m_doing.size() < 6)
+    // There's work left that the scheduler didn't let us start. Get notified when a slot frees up.
+    m_scheduler->waitForSlot(this, m_priority);
+}
+
+void NetJob::startQueuedParts()
+{
+    // go over the hosts, starting parts for each until the scheduler says it's busy
+    auto hosts = m_todo.keys();
+    for(auto & host: hosts)
     {
-        if(!m_todo.size())
-            return;
-        int doThis = m_todo.dequeue();
-        m_doing.insert(doThis);
-        auto part = downloads[doThis];
-        // connect signals :D
-        connect(part.get(), SIGNAL(succeeded(int)), SLOT(partSucceeded(int)));
-        connect(part.get(), SIGNAL(failed(int)), SLOT(partFailed(int)));
-        connect(part.get(), SIGNAL(aborted(int)), SLOT(partAborted(int)));
-        connect(part.get(), SIGNAL(netActionProgress(int, qint64, qint64)),
-                SLOT(partProgress(int, qint64, qint64)));
-        part->start();
+        while(true)
+        {
+            // NOTE: starting a part can modify the queues, so don't hold on to iterators
+            auto queue = m_todo.find(host);
+            if(queue == m_todo.end())
+            {
+                break;
+            }
+            if(queue->isEmpty())
+            {
+                m_todo.erase(queue);
+                break;
+            }
+            auto grant = m_scheduler->acquire(host, m_priority);
+            if(grant == Net::Scheduler::Grant::GlobalBusy)
+            {
+                return;
+            }
+            if(grant == Net::Scheduler::Grant::HostBusy)
+            {
+                break;
+            }
+            int doThis = queue->dequeue();
+            auto &slot = parts_progress[doThis];
+            slot.host = host;
+            slot.holds_slot = true;
+            startPart(doThis);
+        }
     }
 }
 
+void NetJob::startPart(int index)
+{
+    m_doing.insert(index);
+    auto part = downloads[index];
+    parts_progress[index].timer.invalidate();
+    // connect signals :D
+    connect(part.get(), SIGNAL(started(int)), SLOT(partStarted(int)));
+    connect(part.get(), SIGNAL(succeeded(int)), SLOT(partSucceeded(int)));
+    connect(part.get(), SIGNAL(failed(int)), SLOT(partFailed(int)));
+    connect(part.get(), SIGNAL(aborted(int)), SLOT(partAborted(int)));
+    connect(part.get(), SIGNAL(netActionProgress(int, qint64, qint64)),
+            SLOT(partProgress(int, qint64, qint64)));
+    part->start();
+}
+
+void NetJob::releaseSlot(int index, Net::Scheduler::Outcome outcome)
+{
+    auto &slot = parts_progress[index];
+    if(!slot.holds_slot)
+    {
+        return;
+    }
+    slot.holds_slot = false;
+    qint64 elapsed = slot.timer.isValid() ? slot.timer.elapsed() : -1;
+    m_scheduler->release(slot.host, outcome, slot.current_progress, elapsed);
+}
+
+void NetJob::cancelSlot(int index)
+{
+    auto &slot = parts_progress[index];
+    if(!slot.holds_slot)
+    {
+        return;
+    }
+    slot.holds_slot = false;
+    m_scheduler->cancel(slot.host);
+}
+
+int NetJob::todoCount() const
+{
+    int count = 0;
+    for(auto & queue: m_todo)
+    {
+        count += queue.size();
+    }
+    return count;
+}
 
 QStringList NetJob::getFailedFiles()
 {
@@ -164,10 +266,13 @@ bool NetJob::canAbort() const
 {
     bool canFullyAbort = true;
     // can abort the waiting?
-    for(auto index: m_todo)
+    for(auto & queue: m_todo)
     {
-        auto part = downloads[index];
-        canFullyAbort &= part->canAbort();
+        for(auto index: queue)
+        {
+            auto part = downloads[index];
+            canFullyAbort &= part->canAbort();
+        }
     }
     // can abort the active?
     for(auto index: m_doing)
@@ -182,7 +287,13 @@ bool NetJob::abort()
 {
     bool fullyAborted = true;
     // fail all waiting
-    m_failed.unite(m_todo.toSet());
+    for(auto & queue: m_todo)
+    {
+        for(auto index: queue)
+        {
+            m_failed.insert(index);
+        }
+    }
     m_todo.clear();
     // abort active
     auto toKill = m_doing.toList();
@@ -210,9 +321,17 @@ bool NetJob::addNetAction(NetActionPtr action)
     }
     else
     {
-        m_todo.append(parts_progress.size() - 1);
+        m_todo[action->url().host()].enqueue(parts_progress.size() - 1);
     }
     return true;
 }
 
-NetJob::~NetJob() = default;
+NetJob::~NetJob()
+{
+    m_scheduler->forget(this);
+    // give back the slots of anything still running, otherwise they would be lost for good
+    for(int index = 0; index < parts_progress.size(); index++)
+    {
+        cancelSlot(index);
+    }
+}
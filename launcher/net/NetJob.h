@@ -18,6 +18,7 @@
 #include "NetAction.h"
 #include "Download.h"
 #include "HttpMetaCache.h"
+#include "Scheduler.h"
 #include "tasks/Task.h"
 #include "QObjectPtr.h"
 
@@ -28,14 +29,27 @@ class NetJob : public Task
 {
     Q_OBJECT
 public:
-    explicit NetJob(QString job_name) : Task()
-    {
-        setObjectName(job_name);
-    }
+    explicit NetJob(QString job_name);
     virtual ~NetJob();
 
     bool addNetAction(NetActionPtr action);
 
+    /// Set how urgently the parts are needed, relative to other running jobs
+    void setPriority(Net::Priority priority)
+    {
+        m_priority = priority;
+    }
+    Net::Priority priority() const
+    {
+        return m_priority;
+    }
+
+    /// Use a different scheduler than the global one. Must be done before the job starts.
+    void setScheduler(Net::Scheduler::Ptr scheduler)
+    {
+        m_scheduler = scheduler;
+    }
+
     NetActionPtr operator[](int index)
     {
         return downloads[index];
@@ -61,12 +75,21 @@ public:
 private slots:
     void startMoreParts();
 
+private:
+    /// Start as many queued parts as the scheduler allows
+    void startQueuedParts();
+    void startPart(int index);
+    void releaseSlot(int index, Net::Scheduler::Outcome outcome);
+    void cancelSlot(int index);
+    int todoCount() const;
+
 public slots:
     virtual void executeTask() override;
     virtual bool abort() override;
 
 private slots:
     void partProgress(int index, qint64 bytesReceived, qint64 bytesTotal);
+    void partStarted(int index);
     void partSucceeded(int index);
     void partFailed(int index);
     void partAborted(int index);
@@ -77,13 +100,23 @@ private:
         qint64 current_progress = 0;
         qint64 total_progress = 1;
         int failures = 0;
+        /// the host the scheduler slot was taken for, if any
+        QString host;
+        bool holds_slot = false;
+        /// started when the request is actually sent, invalid before that
+        QElapsedTimer timer;
     };
     QList<NetActionPtr> downloads;
     QList<part_info> parts_progress;
-    QQueue<int> m_todo;
+    /// parts waiting to be started, per host
+    QHash<QString, QQueue<int>> m_todo;
     QSet<int> m_doing;
     QSet<int> m_done;
     QSet<int> m_failed;
     qint64 m_current_progress = 0;
     bool m_aborted = false;
+    bool m_startingParts = false;
+    bool m_restartParts = false;
+    Net::Priority m_priority = Net::Priority::Normal;
+    Net::Scheduler::Ptr m_scheduler;
 };
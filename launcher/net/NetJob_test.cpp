@@ -0,0 +1,379 @@
+#include <QTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QEventLoop>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QTemporaryDir>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include "TestUtil.h"
+
+#include "net/NetJob.h"
+#include "net/Download.h"
+#include "net/ChecksumValidator.h"
+#include "net/Scheduler.h"
+#include "Env.h"
+#include "FileSystem.h"
+
+#include <vector>
+#include <algorithm>
+#include <ctime>
+
+/*
+ * A minimal HTTP/1.1 stand-in. Answers every GET with a fixed size body and keeps connections alive.
+ */
+class LocalHttpServer
+{
+public:
+    explicit LocalHttpServer(int objectSize) : m_body(objectSize, 'x')
+    {
+        QObject::connect(&m_server, &QTcpServer::newConnection, [this]()
+        {
+            while(auto socket = m_server.nextPendingConnection())
+            {
+                QObject::connect(socket, &QTcpSocket::readyRead, [this, socket]()
+                {
+                    handle(socket);
+                });
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            }
+        });
+        m_server.listen(QHostAddress::LocalHost);
+    }
+    QUrl url(int index) const
+    {
+        return QUrl(QString("http://127.0.0.1:%1/%2").arg(m_server.serverPort()).arg(index));
+    }
+    bool isListening() const
+    {
+        return m_server.isListening();
+    }
+
+private:
+    void handle(QTcpSocket * socket)
+    {
+        auto & buffer = m_buffers[socket];
+        buffer.append(socket->readAll());
+        int end;
+        while((end = buffer.indexOf("\r\n\r\n")) != -1)
+        {
+            buffer.remove(0, end + 4);
+            QByteArray response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: ";
+            response.append(QByteArray::number(m_body.size()));
+            response.append("\r\n\r\n");
+            response.append(m_body);
+            socket->write(response);
+        }
+    }
+
+private:
+    QTcpServer m_server;
+    QByteArray m_body;
+    QHash<QTcpSocket *, QByteArray> m_buffers;
+};
+
+class NetJobTest : public QObject
+{
+    Q_OBJECT
+
+    bool runJob(NetJob * job)
+    {
+        QEventLoop loop;
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        connect(job, &NetJob::finished, &loop, &QEventLoop::quit);
+        timeout.start(120000);
+        job->start();
+        loop.exec();
+        return job->wasSuccessful();
+    }
+
+    // what downloads used to do: a new array for every readyRead, a separate pass for every hash and a save file
+    bool fetchUnpooled(const QUrl & url, const QString & path)
+    {
+        QSaveFile output(path);
+        if(!output.open(QIODevice::WriteOnly))
+        {
+            return false;
+        }
+        QCryptographicHash sha1(QCryptographicHash::Sha1);
+        QCryptographicHash md5(QCryptographicHash::Md5);
+        auto reply = ENV.qnam().get(QNetworkRequest(url));
+        auto consume = [&]()
+        {
+            auto data = reply->readAll();
+            sha1.addData(data);
+            md5.addData(data);
+            output.write(data);
+        };
+        QEventLoop loop;
+        connect(reply, &QNetworkReply::readyRead, consume);
+        connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+        consume();
+        bool ok = reply->error() == QNetworkReply::NoError && !sha1.result().isEmpty() && !md5.result().isEmpty();
+        reply->deleteLater();
+        return ok && output.commit();
+    }
+
+private
+slots:
+    void initTestCase()
+    {
+        // every download logs a couple lines, which would drown out the results
+        QLoggingCategory::setFilterRules("*.debug=false");
+    }
+
+    void test_limits()
+    {
+        Net::SchedulerLimits limits;
+        limits.globalLimit = 4;
+        limits.reservedForForeground = 1;
+        limits.initialPerHost = 2;
+        Net::Scheduler scheduler(limits);
+
+        QCOMPARE(scheduler.acquire("a", Net::Priority::Normal), Net::Scheduler::Grant::Granted);
+        QCOMPARE(scheduler.acquire("a", Net::Priority::Normal), Net::Scheduler::Grant::Granted);
+        QCOMPARE(scheduler.acquire("a", Net::Priority::Normal), Net::Scheduler::Grant::HostBusy);
+        QCOMPARE(scheduler.acquire("b", Net::Priority::Normal), Net::Scheduler::Grant::Granted);
+        // the last slot is reserved for the foreground
+        QCOMPARE(scheduler.acquire("b", Net::Priority::Background), Net::Scheduler::Grant::GlobalBusy);
+        QCOMPARE(scheduler.acquire("b", Net::Priority::Blocking), Net::Scheduler::Grant::Granted);
+        QCOMPARE(scheduler.acquire("c", Net::Priority::Blocking), Net::Scheduler::Grant::GlobalBusy);
+        QCOMPARE(scheduler.active(), 4);
+
+        scheduler.cancel("a");
+        QCOMPARE(scheduler.activeForHost("a"), 1);
+        QCOMPARE(scheduler.acquire("c", Net::Priority::Normal), Net::Scheduler::Grant::Granted);
+    }
+
+    void test_adaptive()
+    {
+        Net::SchedulerLimits limits;
+        limits.initialPerHost = 4;
+        limits.minPerHost = 2;
+        limits.maxPerHost = 24;
+        Net::Scheduler scheduler(limits);
+        // more than QNetworkAccessManager would open
+        QCOMPARE(scheduler.limits().maxPerHost, 6);
+
+        // a host that keeps answering quickly while saturated gets more slots
+        for(int round = 0; round < 100; round++)
+        {
+            while(scheduler.acquire("fast", Net::Priority::Normal) == Net::Scheduler::Grant::Granted)
+            {
+            }
+            scheduler.release("fast", Net::Scheduler::Outcome::Success, 1024, 10);
+        }
+        QCOMPARE(scheduler.hostLimit("fast"), 6);
+
+        // answers we don't like and cache hits don't say anything about the host's load
+        scheduler.release("fast", Net::Scheduler::Outcome::Failed, 0, 10);
+        scheduler.release("fast", Net::Scheduler::Outcome::Success, 0, -1);
+        QCOMPARE(scheduler.hostLimit("fast"), 6);
+
+        // transport errors cut it down, but never below the minimum
+        scheduler.release("fast", Net::Scheduler::Outcome::TransportError, 0, 10);
+        QCOMPARE(scheduler.hostLimit("fast"), 3);
+        scheduler.release("fast", Net::Scheduler::Outcome::TransportError, 0, 10);
+        scheduler.release("fast", Net::Scheduler::Outcome::TransportError, 0, 10);
+        QCOMPARE(scheduler.hostLimit("fast"), 2);
+
+        // a fixed scheduler never changes
+        limits.adaptive = false;
+        Net::Scheduler fixed(limits);
+        for(int round = 0; round < 100; round++)
+        {
+            while(fixed.acquire("fast", Net::Priority::Normal) == Net::Scheduler::Grant::Granted)
+            {
+            }
+            fixed.release("fast", Net::Scheduler::Outcome::Success, 1024, 10);
+        }
+        QCOMPARE(fixed.hostLimit("fast"), 4);
+    }
+
+    void test_sharedAcrossJobs()
+    {
+        LocalHttpServer server(512);
+        QVERIFY(server.isListening());
+
+        Net::SchedulerLimits limits;
+        limits.globalLimit = 3;
+        limits.reservedForForeground = 1;
+        limits.initialPerHost = 3;
+        limits.adaptive = false;
+        auto scheduler = std::make_shared<Net::Scheduler>(limits);
+
+        std::vector<QByteArray> outputs(40);
+        NetJobPtr background(new NetJob("Background"));
+        NetJobPtr blocking(new NetJob("Blocking"));
+        background->setScheduler(scheduler);
+        background->setPriority(Net::Priority::Background);
+        blocking->setScheduler(scheduler);
+        blocking->setPriority(Net::Priority::Blocking);
+        for(int i = 0; i < 20; i++)
+        {
+            background->addNetAction(Net::Download::makeByteArray(server.url(i), &outputs[i]));
+            blocking->addNetAction(Net::Download::makeByteArray(server.url(20 + i), &outputs[20 + i]));
+        }
+
+        int maxActive = 0;
+        auto check = [&]()
+        {
+            maxActive = std::max(maxActive, scheduler->active());
+        };
+        connect(background.get(), &NetJob::progress, check);
+        connect(blocking.get(), &NetJob::progress, check);
+
+        background->start();
+        QVERIFY(runJob(blocking.get()));
+        if(!background->isFinished())
+        {
+            QEventLoop loop;
+            connect(background.get(), &NetJob::finished, &loop, &QEventLoop::quit);
+            loop.exec();
+        }
+        QVERIFY(background->wasSuccessful());
+        QVERIFY(maxActive <= 3);
+        QCOMPARE(scheduler->active(), 0);
+        for(auto & output: outputs)
+        {
+            QCOMPARE(output.size(), 512);
+        }
+    }
+
+    void test_fusedValidators_data()
+    {
+        QTest::addColumn<bool>("direct");
+        QTest::newRow("save file") << false;
+        QTest::newRow("direct") << true;
+    }
+
+    void test_fusedValidators()
+    {
+        QFETCH(bool, direct);
+        // bigger than a few chunks
+        LocalHttpServer server(3 * 1024 * 1024 + 17);
+        QVERIFY(server.isListening());
+        QByteArray body(3 * 1024 * 1024 + 17, 'x');
+        auto sha1 = QCryptographicHash::hash(body, QCryptographicHash::Sha1);
+        auto md5 = QCryptographicHash::hash(body, QCryptographicHash::Md5);
+
+        QTemporaryDir dir;
+        auto path = FS::PathCombine(dir.path(), "good.bin");
+        Net::Download::Options options = direct ? Net::Download::Option::WriteDirectly : Net::Download::Option::NoOptions;
+        auto sha1Node = new Net::ChecksumValidator(QCryptographicHash::Sha1, sha1);
+        auto md5Node = new Net::ChecksumValidator(QCryptographicHash::Md5, md5);
+        auto dl = Net::Download::makeFile(server.url(0), path, options);
+        dl->addValidator(sha1Node);
+        dl->addValidator(md5Node);
+        NetJobPtr job(new NetJob("Good"));
+        job->addNetAction(dl);
+        QVERIFY(runJob(job.get()));
+        QCOMPARE(sha1Node->hash(), sha1);
+        QCOMPARE(md5Node->hash(), md5);
+        QCOMPARE(FS::read(path), body);
+
+        // a bad checksum leaves nothing behind
+        auto badPath = FS::PathCombine(dir.path(), "bad.bin");
+        auto bad = Net::Download::makeFile(server.url(1), badPath, options);
+        bad->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1, sha1));
+        bad->addValidator(new Net::ChecksumValidator(QCryptographicHash::Md5, QByteArray(16, '\0')));
+        NetJobPtr badJob(new NetJob("Bad"));
+        auto scheduler = std::make_shared<Net::Scheduler>();
+        badJob->setScheduler(scheduler);
+        badJob->addNetAction(bad);
+        QVERIFY(!runJob(badJob.get()));
+        QVERIFY(!QFile::exists(badPath));
+        // the host is fine, it's the file that is wrong
+        QCOMPARE(scheduler->hostLimit(server.url(1).host()), scheduler->limits().initialPerHost);
+    }
+
+    void benchmark_throughput_data()
+    {
+        QTest::addColumn<int>("mode");
+        QTest::newRow("unpooled, separate hashes") << 0;
+        QTest::newRow("pooled, fused hashes") << 1;
+        QTest::newRow("pooled, fused hashes, direct") << 2;
+    }
+
+    void benchmark_throughput()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, mode);
+        static const int size = 64 * 1024 * 1024;
+        static const int rounds = 8;
+        LocalHttpServer server(size);
+        QVERIFY(server.isListening());
+        QTemporaryDir dir;
+        auto path = FS::PathCombine(dir.path(), "output.bin");
+
+        // NOTE: the server runs on the same thread, so its share of the CPU time is included in every row
+        QElapsedTimer timer;
+        std::clock_t cpuStart = std::clock();
+        timer.start();
+        QBENCHMARK_ONCE
+        {
+            for(int i = 0; i < rounds; i++)
+            {
+                if(mode == 0)
+                {
+                    QVERIFY(fetchUnpooled(server.url(i), path));
+                    continue;
+                }
+                auto options = mode == 2 ? Net::Download::Option::WriteDirectly : Net::Download::Option::NoOptions;
+                auto dl = Net::Download::makeFile(server.url(i), path, options);
+                dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Sha1));
+                dl->addValidator(new Net::ChecksumValidator(QCryptographicHash::Md5));
+                NetJobPtr job(new NetJob("Throughput"));
+                job->addNetAction(dl);
+                QVERIFY(runJob(job.get()));
+            }
+        }
+        double seconds = timer.nsecsElapsed() / 1e9;
+        double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        double megabytes = double(size) * rounds / (1024 * 1024);
+        qWarning() << "Throughput:" << megabytes / seconds << "MB/s," << cpuSeconds / (megabytes / 1024) << "CPU s/GB";
+    }
+
+    void benchmark_smallObjects_data()
+    {
+        QTest::addColumn<bool>("adaptive");
+        QTest::newRow("fixed") << false;
+        QTest::newRow("adaptive") << true;
+    }
+
+    void benchmark_smallObjects()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(bool, adaptive);
+        static const int count = 5000;
+
+        LocalHttpServer server(2048);
+        QVERIFY(server.isListening());
+
+        Net::SchedulerLimits limits;
+        limits.adaptive = adaptive;
+        auto scheduler = std::make_shared<Net::Scheduler>(limits);
+
+        std::vector<QByteArray> outputs(count);
+        NetJobPtr job(new NetJob("Small objects"));
+        job->setScheduler(scheduler);
+        for(int i = 0; i < count; i++)
+        {
+            job->addNetAction(Net::Download::makeByteArray(server.url(i), &outputs[i]));
+        }
+        QBENCHMARK_ONCE
+        {
+            QVERIFY(runJob(job.get()));
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(NetJobTest)
+
+#include "NetJob_test.moc"
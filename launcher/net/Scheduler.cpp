@@ -0,0 +1,265 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Scheduler.h"
+#include "NetJob.h"
+
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+// how long a throughput measurement window is, in ms
+const qint64 throughputWindow = 500;
+// latency above baseline * this factor (plus some slack for jitter) means the host is congested
+const double congestionFactor = 2.5;
+const double latencySlack = 50.0;
+// QNetworkAccessManager queues anything past this many requests to one host
+const int maxConnectionsPerHost = 6;
+}
+
+namespace Net {
+
+Scheduler::Scheduler(const SchedulerLimits& limits) : m_limits(limits)
+{
+    // anything above that would only wait inside QNetworkAccessManager, where we can't see it
+    m_limits.maxPerHost = std::max(1, std::min(m_limits.maxPerHost, maxConnectionsPerHost));
+    m_limits.minPerHost = std::max(1, std::min(m_limits.minPerHost, m_limits.maxPerHost));
+    m_limits.initialPerHost = std::max(m_limits.minPerHost, std::min(m_limits.initialPerHost, m_limits.maxPerHost));
+}
+
+Scheduler::Scheduler() : Scheduler(SchedulerLimits())
+{
+}
+
+Scheduler::~Scheduler() = default;
+
+Scheduler::HostState & Scheduler::hostState(const QString& host)
+{
+    auto iter = m_hosts.find(host);
+    if(iter == m_hosts.end())
+    {
+        HostState state;
+        state.limit = m_limits.initialPerHost;
+        iter = m_hosts.insert(host, state);
+    }
+    return *iter;
+}
+
+int Scheduler::hostLimit(const QString& host) const
+{
+    auto iter = m_hosts.find(host);
+    if(iter == m_hosts.end())
+    {
+        return m_limits.initialPerHost;
+    }
+    return iter->limit;
+}
+
+int Scheduler::activeForHost(const QString& host) const
+{
+    auto iter = m_hosts.find(host);
+    if(iter == m_hosts.end())
+    {
+        return 0;
+    }
+    return iter->active;
+}
+
+Scheduler::Grant Scheduler::acquire(const QString& host, Priority priority)
+{
+    if(m_active >= m_limits.globalLimit)
+    {
+        return Grant::GlobalBusy;
+    }
+    if(priority == Priority::Background && m_active >= m_limits.globalLimit - m_limits.reservedForForeground)
+    {
+        return Grant::GlobalBusy;
+    }
+    auto & state = hostState(host);
+    if(state.active >= state.limit)
+    {
+        return Grant::HostBusy;
+    }
+    if(!state.window.isValid())
+    {
+        state.window.start();
+    }
+    state.active++;
+    m_active++;
+    return Grant::Granted;
+}
+
+void Scheduler::release(const QString& host, Outcome outcome, qint64 bytes, qint64 elapsedMs)
+{
+    auto & state = hostState(host);
+    if(state.active <= 0)
+    {
+        qWarning() << "Net::Scheduler: released a slot for" << host << "that was never acquired";
+        return;
+    }
+    // the host was saturated if this request held one of the last slots
+    bool wasSaturated = state.active >= state.limit;
+    state.active--;
+    m_active--;
+    if(m_limits.adaptive)
+    {
+        if(wasSaturated && outcome == Outcome::Success)
+        {
+            state.saturatedSuccesses++;
+        }
+        adapt(state, outcome, bytes, elapsedMs);
+    }
+    wakeWaiting();
+}
+
+void Scheduler::cancel(const QString& host)
+{
+    auto & state = hostState(host);
+    if(state.active <= 0)
+    {
+        qWarning() << "Net::Scheduler: cancelled a slot for" << host << "that was never acquired";
+        return;
+    }
+    state.active--;
+    m_active--;
+    wakeWaiting();
+}
+
+void Scheduler::adapt(HostState& state, Outcome outcome, qint64 bytes, qint64 elapsedMs)
+{
+    auto & limits = m_limits;
+    if(outcome == Outcome::TransportError)
+    {
+        // multiplicative decrease. failing to get through usually means the host (or the path to it) is overloaded
+        state.limit = std::max(limits.minPerHost, state.limit / 2);
+        state.saturatedSuccesses = 0;
+        state.throughputBeforeRaise = -1;
+        return;
+    }
+    if(outcome == Outcome::Failed || elapsedMs < 0)
+    {
+        // an answer we didn't like, or no request at all. Nothing to learn about the host's load from it.
+        return;
+    }
+
+    double latency = elapsedMs;
+    if(state.avgLatency < 0)
+    {
+        state.avgLatency = latency;
+        state.baseLatency = latency;
+    }
+    else
+    {
+        state.avgLatency = 0.8 * state.avgLatency + 0.2 * latency;
+        // let the baseline drift up slowly, so a single lucky request doesn't define it forever
+        state.baseLatency = std::min(state.baseLatency * 1.01, latency);
+    }
+
+    state.windowBytes += bytes;
+    qint64 windowElapsed = state.window.elapsed();
+    if(windowElapsed >= throughputWindow)
+    {
+        double measured = double(state.windowBytes) / double(windowElapsed);
+        state.throughput = state.throughput < 0 ? measured : 0.5 * state.throughput + 0.5 * measured;
+        state.windowBytes = 0;
+        state.window.restart();
+
+        // we are probing a raised limit. If it didn't help, go back and remember not to try it again.
+        if(state.throughputBeforeRaise > 0)
+        {
+            if(state.throughput < state.throughputBeforeRaise * 1.05)
+            {
+                state.ceiling = state.limit;
+                state.limit = std::max(limits.minPerHost, state.limit - 1);
+            }
+            state.throughputBeforeRaise = -1;
+        }
+    }
+
+    if(state.avgLatency > state.baseLatency * congestionFactor + latencySlack)
+    {
+        // requests are piling up on the server side. back off a bit.
+        if(state.limit > limits.minPerHost)
+        {
+            state.limit--;
+        }
+        state.saturatedSuccesses = 0;
+        state.throughputBeforeRaise = -1;
+        return;
+    }
+
+    // additive increase - once per 'limit' successful requests done while all the slots were in use
+    int upperLimit = state.ceiling > 0 ? std::min(state.ceiling - 1, limits.maxPerHost) : limits.maxPerHost;
+    if(state.saturatedSuccesses >= state.limit && state.limit < upperLimit)
+    {
+        state.saturatedSuccesses = 0;
+        state.throughputBeforeRaise = state.throughput;
+        state.limit++;
+    }
+}
+
+void Scheduler::waitForSlot(NetJob* job, Priority priority)
+{
+    for(auto & waiting: m_waiting)
+    {
+        if(waiting.job == job)
+        {
+            waiting.priority = std::max(waiting.priority, priority);
+            return;
+        }
+    }
+    Waiting waiting;
+    waiting.job = job;
+    waiting.priority = priority;
+    m_waiting.append(waiting);
+}
+
+void Scheduler::forget(NetJob* job)
+{
+    for(auto iter = m_waiting.begin(); iter != m_waiting.end();)
+    {
+        if(iter->job.isNull() || iter->job == job)
+        {
+            iter = m_waiting.erase(iter);
+        }
+        else
+        {
+            iter++;
+        }
+    }
+}
+
+void Scheduler::wakeWaiting()
+{
+    if(m_waiting.isEmpty())
+    {
+        return;
+    }
+    // wake the most important jobs first. queued calls are processed in order, so they also get the slots first.
+    auto waiting = m_waiting;
+    m_waiting.clear();
+    std::stable_sort(waiting.begin(), waiting.end(), [](const Waiting & a, const Waiting & b)
+    {
+        return a.priority > b.priority;
+    });
+    for(auto & entry: waiting)
+    {
+        if(entry.job)
+        {
+            QMetaObject::invokeMethod(entry.job.data(), "startMoreParts", Qt::QueuedConnection);
+        }
+    }
+}
+}
@@ -0,0 +1,155 @@
+/* Copyright 2013-2021 MultiMC Contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <memory>
+
+class NetJob;
+
+namespace Net {
+
+/// How urgently a NetJob needs its parts. Higher priorities get woken up first when slots free up.
+enum class Priority
+{
+    /// Things nobody is actively waiting for, like asset objects. These never take the last slots.
+    Background = 0,
+    Normal = 1,
+    /// Things a launch is blocked on, like libraries and the main jar.
+    Blocking = 2
+};
+
+struct SchedulerLimits
+{
+    /// Maximum number of requests in flight across all jobs
+    int globalLimit = 48;
+    /// Part of the global limit that Background jobs are not allowed to use
+    int reservedForForeground = 12;
+    /// Per-host limits - a host starts at the initial limit and moves between min and max.
+    /// QNetworkAccessManager never opens more than 6 connections to a host, so the max is capped at that.
+    /// Hosts start at the max, the same as before there were limits. Errors and slowdowns bring them down.
+    int initialPerHost = 6;
+    int minPerHost = 2;
+    int maxPerHost = 6;
+    /// When false, every host keeps the initial limit forever
+    bool adaptive = true;
+};
+
+/**
+ * Hands out connection slots to NetJobs.
+ *
+ * One scheduler is shared by all running jobs (see Env::netScheduler()), so the limits apply to the whole launcher
+ * and not to every job separately. The per-host limits grow while a host keeps up (stable latency, throughput that
+ * still improves with more parallel requests) and shrink when it starts failing or slowing down.
+ */
+class Scheduler
+{
+public: /* types */
+    typedef std::shared_ptr<Scheduler> Ptr;
+    enum class Grant
+    {
+        Granted,
+        HostBusy,
+        GlobalBusy
+    };
+    /// How a request that held a slot ended
+    enum class Outcome
+    {
+        Success,
+        /// the host answered, but not with what we wanted (404, bad checksum...). Says nothing about its load.
+        Failed,
+        /// the request didn't make it (connection errors, timeouts). The host or the path to it may be overloaded.
+        TransportError
+    };
+
+public: /* con/des */
+    explicit Scheduler(const SchedulerLimits & limits);
+    Scheduler();
+    ~Scheduler();
+
+public: /* methods */
+    /// Try to take a slot for a request to host. Every Granted result has to be matched by a release()
+    Grant acquire(const QString & host, Priority priority);
+
+    /**
+     * Give back a slot, reporting how the request went so the host limit can adapt.
+     * elapsedMs is counted from when the request was sent, or -1 if none was (cache hits).
+     */
+    void release(const QString & host, Outcome outcome, qint64 bytes, qint64 elapsedMs);
+
+    /// Give back a slot without learning anything from it (the request was aborted by us, not by the host)
+    void cancel(const QString & host);
+
+    /// Ask to have startMoreParts() called on the job once some slot is released
+    void waitForSlot(NetJob * job, Priority priority);
+
+    /// Remove the job from the waiting list
+    void forget(NetJob * job);
+
+    int hostLimit(const QString & host) const;
+    int activeForHost(const QString & host) const;
+    int active() const
+    {
+        return m_active;
+    }
+    const SchedulerLimits & limits() const
+    {
+        return m_limits;
+    }
+
+private: /* types */
+    struct HostState
+    {
+        int limit = 0;
+        int active = 0;
+        /// how many successful requests were finished while the host was saturated since the last limit change
+        int saturatedSuccesses = 0;
+
+        /// latency in ms - moving average and the best observed baseline
+        double avgLatency = -1;
+        double baseLatency = -1;
+
+        /// throughput in bytes/ms, measured over windows of finished requests
+        QElapsedTimer window;
+        qint64 windowBytes = 0;
+        double throughput = -1;
+        /// throughput at the moment we last raised the limit, or -1 if we are not probing
+        double throughputBeforeRaise = -1;
+        /// the limit that turned out to not improve throughput. We don't probe past it again.
+        int ceiling = 0;
+    };
+    struct Waiting
+    {
+        QPointer<NetJob> job;
+        Priority priority;
+    };
+
+private: /* methods */
+    HostState & hostState(const QString & host);
+    void adapt(HostState & state, Outcome outcome, qint64 bytes, qint64 elapsedMs);
+    void wakeWaiting();
+
+private: /* data */
+    SchedulerLimits m_limits;
+    QHash<QString, HostState> m_hosts;
+    QList<Waiting> m_waiting;
+    int m_active = 0;
+};
+}
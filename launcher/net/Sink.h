@@ -3,6 +3,7 @@
 #include "net/NetAction.h"
 
 #include "Validator.h"
+#include "MultiHash.h"
 
 namespace Net {
 class Sink
@@ -18,10 +19,14 @@ public: /* methods */
     virtual JobStatus finalize(QNetworkReply & reply) = 0;
     virtual bool hasLocalData() = 0;
 
+    /// Called once the size of the data is known, before it's written
+    virtual void reserve(qint64) {}
+
     void addValidator(Validator * validator)
     {
         if(validator)
         {
+            validator->attach(hasher);
             validators.push_back(std::shared_ptr<Validator>(validator));
         }
     }
@@ -47,6 +52,7 @@ protected: /* methods */
     }
     bool initAllValidators(QNetworkRequest & request)
     {
+        hasher.reset();
         for(auto & validator: validators)
         {
             if(!validator->init(request))
@@ -56,6 +62,7 @@ protected: /* methods */
     }
     bool writeAllValidators(QByteArray & data)
     {
+        hasher.addData(data.constData(), data.size());
         for(auto & validator: validators)
         {
             if(!validator->write(data))
@@ -66,5 +73,7 @@ protected: /* methods */
 
 protected: /* data */
     std::vector<std::shared_ptr<Validator>> validators;
+    /// all the hashes the validators need, computed in one pass
+    MultiHash hasher;
 };
 }
@@ -3,6 +3,8 @@
 #include "net/NetAction.h"
 
 namespace Net {
+class MultiHash;
+
 class Validator
 {
 public: /* con/des */
@@ -14,5 +16,9 @@ public: /* methods */
     virtual bool write(QByteArray & data) = 0;
     virtual bool abort() = 0;
     virtual bool validate(QNetworkReply & reply) = 0;
+
+    /// Called when the validator is added to a sink. Validators that only need a hash of the data can ask the sink's
+    /// hasher for it here, so all the hashes of a download are computed in one pass.
+    virtual void attach(MultiHash &) {}
 };
 }
@@ -247,6 +247,7 @@ void LauncherPage::applySettings()
     // Updates
     s->set("AutoUpdate", ui->autoUpdateCheckBox->isChecked());
     s->set("UpdateChannel", m_currentUpdateChannel);
+    s->set("AssetMaintenance", ui->assetMaintenanceCheckBox->isChecked());
     auto original = s->get("IconTheme").toString();
     //FIXME: make generic
     switch (ui->themeComboBox->currentIndex())
@@ -309,6 +310,7 @@ void LauncherPage::applySettings()
     s->set("InstanceDir", ui->instDirTextBox->text());
     s->set("CentralModsDir", ui->modsDirTextBox->text());
     s->set("IconsDir", ui->iconsDirTextBox->text());
+    s->set("SyncSettingsToDisk", ui->syncSettingsCheckBox->isChecked());
 
     auto sortMode = (InstSortMode)ui->sortingModeGroup->checkedId();
     switch (sortMode)
@@ -334,6 +336,7 @@ void LauncherPage::loadSettings()
     // Updates
     ui->autoUpdateCheckBox->setChecked(s->get("AutoUpdate").toBool());
     m_currentUpdateChannel = s->get("UpdateChannel").toString();
+    ui->assetMaintenanceCheckBox->setChecked(s->get("AssetMaintenance").toBool());
     //FIXME: make generic
     auto theme = s->get("IconTheme").toString();
     if (theme == "pe_dark")
@@ -411,6 +414,7 @@ void LauncherPage::loadSettings()
     ui->instDirTextBox->setText(s->get("InstanceDir").toString());
     ui->modsDirTextBox->setText(s->get("CentralModsDir").toString());
     ui->iconsDirTextBox->setText(s->get("IconsDir").toString());
+    ui->syncSettingsCheckBox->setChecked(s->get("SyncSettingsToDisk").toBool());
 
     QString sortMode = s->get("InstSortMode").toString();
 
@@ -203,6 +203,17 @@ void InstanceSettingsPage::applySettings()
     {
         m_settings->reset("JoinServerOnLaunchAddress");
     }
+
+    // Log levels
+    auto logLevelRules = ui->logLevelRules->toPlainText().trimmed();
+    if (logLevelRules.isEmpty())
+    {
+        m_settings->reset("LogLevelRules");
+    }
+    else
+    {
+        m_settings->set("LogLevelRules", logLevelRules);
+    }
 }
 
 void InstanceSettingsPage::loadSettings()
@@ -272,6 +283,8 @@ void InstanceSettingsPage::loadSettings()
 
     ui->serverJoinGroupBox->setChecked(m_settings->get("JoinServerOnLaunch").toBool());
     ui->serverJoinAddress->setText(m_settings->get("JoinServerOnLaunchAddress").toString());
+
+    ui->logLevelRules->setPlainText(m_settings->get("LogLevelRules").toString());
 }
 
 void InstanceSettingsPage::on_javaDetectBtn_clicked()
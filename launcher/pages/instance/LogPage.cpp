@@ -154,6 +154,7 @@ LogPage::LogPage(InstancePtr instance, QWidget *parent)
     connect(ui->searchBar, SIGNAL(returnPressed()), SLOT(on_findButton_clicked()));
     auto findPreviousShortcut = new QShortcut(QKeySequence(QKeySequence::FindPrevious), this);
     connect(findPreviousShortcut, SIGNAL(activated()), SLOT(findPreviousActivated()));
+    connect(&m_findWatcher, &QFutureWatcher<int>::finished, this, &LogPage::findFinished);
 }
 
 LogPage::~LogPage()
@@ -244,7 +245,13 @@ void LogPage::on_btnPaste_clicked()
             BuildConfig.LAUNCHER_NAME
         )
     );
-    auto url = GuiUtil::uploadPaste(m_model->toPlainText(), this);
+    // lines from the game are censored as they come in, this also catches anything that got in some other way
+    auto text = m_model->toPlainText();
+    if(m_process)
+    {
+        text = m_process->censorPrivateInfo(text);
+    }
+    auto url = GuiUtil::uploadPaste(text, this);
     if(!url.isEmpty())
     {
         m_model->append(
@@ -304,17 +311,41 @@ void LogPage::on_findButton_clicked()
 {
     auto modifiers = QApplication::keyboardModifiers();
     bool reverse = modifiers & Qt::ShiftModifier;
-    ui->text->findNext(ui->searchBar->text(), reverse);
+    find(reverse);
 }
 
 void LogPage::findNextActivated()
 {
-    ui->text->findNext(ui->searchBar->text(), false);
+    find(false);
 }
 
 void LogPage::findPreviousActivated()
 {
-    ui->text->findNext(ui->searchBar->text(), true);
+    find(true);
+}
+
+void LogPage::find(bool reverse)
+{
+    auto what = ui->searchBar->text();
+    if(ui->text->findNext(what, reverse) || !m_model || what.isEmpty())
+    {
+        return;
+    }
+    // not in the shown part of the log, look through all of it
+    int from = reverse ? ui->text->firstRow() : ui->text->firstRow() + ui->text->shownRows() - 1;
+    m_findText = what;
+    m_findWatcher.setFuture(m_model->find(what, from, reverse));
+}
+
+void LogPage::findFinished()
+{
+    int row = m_findWatcher.result();
+    if(row < 0)
+    {
+        return;
+    }
+    ui->text->showRow(row);
+    ui->text->findNext(m_findText, false);
 }
 
 void LogPage::findActivated()
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <QWidget>
+#include <QFutureWatcher>
 
 #include "BaseInstance.h"
 #include "launch/LaunchTask.h"
@@ -68,6 +69,7 @@ private slots:
     void findActivated();
     void findNextActivated();
     void findPreviousActivated();
+    void findFinished();
 
     void onInstanceLaunchTaskChanged(shared_qobject_ptr<LaunchTask> proc);
 
@@ -75,6 +77,7 @@ private:
     void modelStateToUI();
     void UIToModelState();
     void setInstanceLaunchTaskChanged(shared_qobject_ptr<LaunchTask> proc, bool initial);
+    void find(bool reverse);
 
 private:
     Ui::LogPage *ui;
@@ -83,4 +86,7 @@ private:
 
     LogFormatProxyModel * m_proxy;
     shared_qobject_ptr <LogModel> m_model;
+
+    QFutureWatcher<int> m_findWatcher;
+    QString m_findText;
 };
@@ -21,6 +21,7 @@
 #include <QKeyEvent>
 #include <QAbstractItemModel>
 #include <QMenu>
+#include <QScrollBar>
 
 #include "Launcher.h"
 #include "dialogs/CustomMessageBox.h"
@@ -160,6 +161,8 @@ ModFolderPage::ModFolderPage(
     ui->modTreeView->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->modTreeView, &ModListView::customContextMenuRequested, this, &ModFolderPage::ShowContextMenu);
     connect(ui->modTreeView, &ModListView::activated, this, &ModFolderPage::modItemActivated);
+    connect(ui->modTreeView->verticalScrollBar(), &QScrollBar::valueChanged, this, &ModFolderPage::prioritizeVisibleMods);
+    connect(m_mods.get(), &ModFolderModel::updateFinished, this, &ModFolderPage::prioritizeVisibleMods);
 
     auto smodel = ui->modTreeView->selectionModel();
     connect(smodel, &QItemSelectionModel::currentChanged, this, &ModFolderPage::modCurrent);
@@ -204,6 +207,24 @@ void ModFolderPage::on_filterTextChanged(const QString& newContents)
 {
     m_viewFilter = newContents;
     m_filterModel->setFilterFixedString(m_viewFilter);
+    prioritizeVisibleMods();
+}
+
+void ModFolderPage::prioritizeVisibleMods()
+{
+    // the mods on screen are looked at first
+    auto view = ui->modTreeView;
+    auto top = view->indexAt(QPoint(0, 0));
+    if(!top.isValid()) {
+        return;
+    }
+    auto bottom = view->indexAt(QPoint(0, view->viewport()->height() - 1));
+    int last = bottom.isValid() ? bottom.row() : m_filterModel->rowCount() - 1;
+    QModelIndexList visible;
+    for(int row = top.row(); row <= last; row++) {
+        visible.append(m_filterModel->mapToSource(m_filterModel->index(row, 0)));
+    }
+    m_mods->prioritize(visible);
 }
 
 
@@ -104,6 +104,7 @@ slots:
     void on_actionView_Folder_triggered();
     void on_actionView_configs_triggered();
     void ShowContextMenu(const QPoint &pos);
+    void prioritizeVisibleMods();
 };
 
 class CoreModFolderPage : public ModFolderPage
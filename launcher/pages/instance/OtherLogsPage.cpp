@@ -20,10 +20,15 @@
 
 #include "GuiUtil.h"
 #include "RecursiveFileSystemWatcher.h"
-#include <GZip.h>
+#include "LogFileModel.h"
 #include <FileSystem.h>
 #include <QShortcut>
 
+namespace {
+// the whole file goes into memory (twice) to be copied. Paste sites take a lot less than this anyway.
+const qint64 maxCopySize = 64 * 1024 * 1024;
+}
+
 OtherLogsPage::OtherLogsPage(QString path, IPathMatcher::Ptr fileFilter, QWidget *parent)
     : QWidget(parent), ui(new Ui::OtherLogsPage), m_path(path), m_fileFilter(fileFilter),
       m_watcher(new RecursiveFileSystemWatcher(this))
@@ -31,6 +36,19 @@ OtherLogsPage::OtherLogsPage(QString path, IPathMatcher::Ptr fileFilter, QWidget
     ui->setupUi(this);
     ui->tabWidget->tabBar()->hide();
 
+    // files are read from the top, while they are indexed
+    m_model = new LogFileModel(this);
+    ui->text->setFollowEnd(false);
+    ui->text->setModel(m_model);
+    connect(&m_findWatcher, &QFutureWatcher<int>::finished, this, &OtherLogsPage::findFinished);
+    connect(&m_textWatcher, &QFutureWatcher<QString>::finished, this, &OtherLogsPage::textRead);
+
+    // search as you type, once typing stops for a bit
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(300);
+    connect(&m_searchTimer, &QTimer::timeout, this, &OtherLogsPage::findIncremental);
+    connect(ui->searchBar, &QLineEdit::textEdited, &m_searchTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+
     m_watcher->setMatcher(fileFilter);
     m_watcher->setRootDir(QDir::current().absoluteFilePath(m_path));
 
@@ -98,7 +116,7 @@ void OtherLogsPage::on_selectLogBox_currentIndexChanged(const int index)
     if (file.isEmpty() || !QFile::exists(FS::PathCombine(m_path, file)))
     {
         m_currentFile = QString();
-        ui->text->clear();
+        m_model->close();
         setControlsEnabled(false);
     }
     else
@@ -116,74 +134,63 @@ void OtherLogsPage::on_btnReload_clicked()
         setControlsEnabled(false);
         return;
     }
-    QFile file(FS::PathCombine(m_path, m_currentFile));
-    if (!file.open(QFile::ReadOnly))
+    QString fontFamily = LAUNCHER->settings()->get("ConsoleFont").toString();
+    bool conversionOk = false;
+    int fontSize = LAUNCHER->settings()->get("ConsoleFontSize").toInt(&conversionOk);
+    if(!conversionOk)
+    {
+        fontSize = 11;
+    }
+    ui->text->document()->setDefaultFont(QFont(fontFamily, fontSize));
+
+    // the lines show up while the file is read in the background, however big it is
+    if (!m_model->open(FS::PathCombine(m_path, m_currentFile)))
     {
         setControlsEnabled(false);
         ui->btnReload->setEnabled(true); // allow reload
-        m_currentFile = QString();
         QMessageBox::critical(this, tr("Error"), tr("Unable to open %1 for reading: %2")
-                                                     .arg(m_currentFile, file.errorString()));
-    }
-    else
-    {
-        auto setPlainText = [&](const QString & text)
-        {
-            QString fontFamily = LAUNCHER->settings()->get("ConsoleFont").toString();
-            bool conversionOk = false;
-            int fontSize = LAUNCHER->settings()->get("ConsoleFontSize").toInt(&conversionOk);
-            if(!conversionOk)
-            {
-                fontSize = 11;
-            }
-            QTextDocument *doc = ui->text->document();
-            doc->setDefaultFont(QFont(fontFamily, fontSize));
-            ui->text->setPlainText(text);
-        };
-        auto showTooBig = [&]()
-        {
-            setPlainText(
-                tr("The file (%1) is too big. You may want to open it in a viewer optimized "
-                   "for large files.").arg(file.fileName()));
-        };
-        if(file.size() > (1024ll * 1024ll * 12ll))
-        {
-            showTooBig();
-            return;
-        }
-        QString content;
-        if(file.fileName().endsWith(".gz"))
-        {
-            QByteArray temp;
-            if(!GZip::unzip(file.readAll(), temp))
-            {
-                setPlainText(
-                    tr("The file (%1) is not readable.").arg(file.fileName()));
-                return;
-            }
-            content = QString::fromUtf8(temp);
-        }
-        else
-        {
-            content = QString::fromUtf8(file.readAll());
-        }
-        if (content.size() >= 50000000ll)
-        {
-            showTooBig();
-            return;
-        }
-        setPlainText(content);
+                                                     .arg(m_currentFile, m_model->errorString()));
+        m_currentFile = QString();
     }
 }
 
 void OtherLogsPage::on_btnPaste_clicked()
 {
-    GuiUtil::uploadPaste(ui->text->toPlainText(), this);
+    readText(true);
 }
 
 void OtherLogsPage::on_btnCopy_clicked()
 {
-    GuiUtil::setClipboardText(ui->text->toPlainText());
+    readText(false);
+}
+
+void OtherLogsPage::readText(bool paste)
+{
+    if(m_textWatcher.isRunning())
+    {
+        return;
+    }
+    if(m_model->textSize() > maxCopySize)
+    {
+        QMessageBox::warning(this, tr("Log too big"), tr("%1 is too big to copy (%2 MiB). Open the file itself instead.")
+                                                          .arg(m_currentFile).arg(m_model->textSize() / (1024 * 1024)));
+        return;
+    }
+    m_pasteText = paste;
+    m_textWatcher.setFuture(m_model->toPlainText());
+}
+
+void OtherLogsPage::textRead()
+{
+    auto text = m_textWatcher.result();
+    if(m_pasteText)
+    {
+        GuiUtil::uploadPaste(text, this);
+    }
+    else
+    {
+        GuiUtil::setClipboardText(text);
+    }
 }
 
 void OtherLogsPage::on_btnDelete_clicked()
@@ -199,6 +206,8 @@ void OtherLogsPage::on_btnDelete_clicked()
     {
         return;
     }
+    // the file is mapped while it's shown, which would keep it from going away on some systems
+    m_model->close();
     QFile file(FS::PathCombine(m_path, m_currentFile));
     if (!file.remove())
     {
@@ -237,6 +246,7 @@ void OtherLogsPage::on_btnClean_clicked()
     {
         return;
     }
+    m_model->close();
     QStringList failed;
     for(auto item: toDelete)
     {
@@ -279,27 +289,55 @@ void OtherLogsPage::setControlsEnabled(const bool enabled)
     ui->btnClean->setEnabled(enabled);
 }
 
-// FIXME: HACK, use LogView instead?
-static void findNext(QPlainTextEdit * _this, const QString& what, bool reverse)
-{
-    _this->find(what, reverse ? QTextDocument::FindFlag::FindBackward : QTextDocument::FindFlag(0));
-}
-
 void OtherLogsPage::on_findButton_clicked()
 {
     auto modifiers = QApplication::keyboardModifiers();
     bool reverse = modifiers & Qt::ShiftModifier;
-    findNext(ui->text, ui->searchBar->text(), reverse);
+    find(reverse);
 }
 
 void OtherLogsPage::findNextActivated()
 {
-    findNext(ui->text, ui->searchBar->text(), false);
+    find(false);
 }
 
 void OtherLogsPage::findPreviousActivated()
 {
-    findNext(ui->text, ui->searchBar->text(), true);
+    find(true);
+}
+
+void OtherLogsPage::findIncremental()
+{
+    // the match being typed may be the one already selected
+    auto cursor = ui->text->textCursor();
+    cursor.setPosition(cursor.selectionStart());
+    ui->text->setTextCursor(cursor);
+    find(false);
+}
+
+void OtherLogsPage::find(bool reverse)
+{
+    m_searchTimer.stop();
+    auto what = ui->searchBar->text();
+    if(ui->text->findNext(what, reverse) || what.isEmpty())
+    {
+        return;
+    }
+    // not in the shown part of the file, look through all of it
+    int from = reverse ? ui->text->firstRow() : ui->text->firstRow() + ui->text->shownRows() - 1;
+    m_findText = what;
+    m_findWatcher.setFuture(m_model->find(what, from, reverse));
+}
+
+void OtherLogsPage::findFinished()
+{
+    int row = m_findWatcher.result();
+    if(row < 0)
+    {
+        return;
+    }
+    ui->text->showRow(row);
+    ui->text->findNext(m_findText, false);
 }
 
 void OtherLogsPage::findActivated()
@@ -16,6 +16,8 @@
 #pragma once
 
 #include <QWidget>
+#include <QFutureWatcher>
+#include <QTimer>
 
 #include "pages/BasePage.h"
 #include <Launcher.h>
@@ -27,6 +29,7 @@ class OtherLogsPage;
 }
 
 class RecursiveFileSystemWatcher;
+class LogFileModel;
 
 class OtherLogsPage : public QWidget, public BasePage
 {
@@ -68,9 +71,15 @@ private slots:
     void findActivated();
     void findNextActivated();
     void findPreviousActivated();
+    void findIncremental();
+    void findFinished();
+    void textRead();
 
 private:
     void setControlsEnabled(const bool enabled);
+    void find(bool reverse);
+    /// copy or upload the file once it's read on another thread
+    void readText(bool paste);
 
 private:
     Ui::OtherLogsPage *ui;
@@ -78,4 +87,11 @@ private:
     QString m_currentFile;
     IPathMatcher::Ptr m_fileFilter;
     RecursiveFileSystemWatcher *m_watcher;
+    LogFileModel *m_model;
+
+    QTimer m_searchTimer;
+    QFutureWatcher<int> m_findWatcher;
+    QFutureWatcher<QString> m_textWatcher;
+    bool m_pasteText = false;
+    QString m_findText;
 };
@@ -77,7 +77,7 @@ QString INIFile::escape(QString orig)
     return out;
 }
 
-bool INIFile::saveFile(QString fileName)
+bool INIFile::saveFile(QString fileName, bool sync)
 {
     QByteArray outArray;
     for (Iterator iter = begin(); iter != end(); iter++)
@@ -92,7 +92,7 @@ bool INIFile::saveFile(QString fileName)
 
     try
     {
-        FS::write(fileName, outArray);
+        FS::write(fileName, outArray, sync);
     }
     catch (const Exception &e)
     {
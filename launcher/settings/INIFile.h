@@ -27,7 +27,7 @@ public:
 
     bool loadFile(QByteArray file);
     bool loadFile(QString fileName);
-    bool saveFile(QString fileName);
+    bool saveFile(QString fileName, bool sync = true);
 
     QVariant get(QString key, QVariant def) const;
     void set(QString key, QVariant val);
@@ -16,20 +16,41 @@
 #include "INISettingsObject.h"
 #include "Setting.h"
 
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
 INISettingsObject::INISettingsObject(const QString &path, QObject *parent)
     : SettingsObject(parent)
 {
     m_filePath = path;
     m_ini.loadFile(path);
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(m_saveDelay);
+    connect(&m_saveTimer, &QTimer::timeout, this, &INISettingsObject::flush);
+    // nothing is lost when quitting before the timer runs out
+    if(QCoreApplication::instance())
+    {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &INISettingsObject::flush);
+    }
+}
+
+INISettingsObject::~INISettingsObject()
+{
+    flush();
 }
 
 void INISettingsObject::setFilePath(const QString &filePath)
 {
+    // pending changes belong to the old file
+    flush();
     m_filePath = filePath;
 }
 
 bool INISettingsObject::reload()
 {
+    flush();
     return m_ini.loadFile(m_filePath) && SettingsObject::reload();
 }
 
@@ -41,10 +62,32 @@ void INISettingsObject::suspendSave()
 void INISettingsObject::resumeSave()
 {
     m_suspendSave = false;
-    if(m_doSave)
+    // whoever locked this expects the changes to be in the file now
+    flush();
+}
+
+bool INISettingsObject::flush()
+{
+    m_saveTimer.stop();
+    if(!m_doSave)
+    {
+        return true;
+    }
+    m_doSave = false;
+    // late changes to something that was deleted in the meantime shouldn't bring its folder back
+    if(!QFileInfo(m_filePath).dir().exists())
     {
-        m_ini.saveFile(m_filePath);
+        qWarning() << "Not saving" << m_filePath << "because its folder is gone";
+        return false;
     }
+    m_saveCount++;
+    return m_ini.saveFile(m_filePath, m_syncOnSave);
+}
+
+void INISettingsObject::setSaveDelay(int msecs)
+{
+    m_saveDelay = msecs;
+    m_saveTimer.setInterval(msecs);
 }
 
 void INISettingsObject::changeSetting(const Setting &setting, QVariant value)
@@ -71,13 +114,20 @@ void INISettingsObject::changeSetting(const Setting &setting, QVariant value)
 
 void INISettingsObject::doSave()
 {
+    m_doSave = true;
+    // locked objects are written when they are unlocked
     if(m_suspendSave)
     {
-        m_doSave = true;
+        return;
+    }
+    if(m_saveDelay <= 0)
+    {
+        flush();
     }
-    else
+    // the first change starts the clock, so a steady stream of changes still gets written
+    else if(!m_saveTimer.isActive())
     {
-        m_ini.saveFile(m_filePath);
+        m_saveTimer.start();
     }
 }
 
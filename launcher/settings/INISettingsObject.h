@@ -16,6 +16,7 @@
 #pragma once
 
 #include <QObject>
+#include <QTimer>
 
 #include "settings/INIFile.h"
 
@@ -23,12 +24,16 @@
 
 /*!
  * \brief A settings object that stores its settings in an INIFile.
+ *
+ * Changes are not written right away. The file is written once for everything that changed within the save delay,
+ * when the object is unlocked or flushed, when it's destroyed, and when the application quits.
  */
 class INISettingsObject : public SettingsObject
 {
     Q_OBJECT
 public:
     explicit INISettingsObject(const QString &path, QObject *parent = 0);
+    virtual ~INISettingsObject();
 
     /*!
      * \brief Gets the path to the INI file.
@@ -49,6 +54,29 @@ public:
 
     void suspendSave() override;
     void resumeSave() override;
+    bool flush() override;
+
+    /*!
+     * \brief Sets how long changes are collected before the file is written.
+     * \param msecs The delay, 0 writes every change right away.
+     */
+    void setSaveDelay(int msecs);
+
+    /*!
+     * \brief Sets whether the file is synced to disk every time it's written. On by default.
+     */
+    void setSyncOnSave(bool sync)
+    {
+        m_syncOnSave = sync;
+    }
+
+    /*!
+     * \brief How many times the file was written, for diagnostics.
+     */
+    int saveCount() const
+    {
+        return m_saveCount;
+    }
 
 protected slots:
     virtual void changeSetting(const Setting &setting, QVariant value) override;
@@ -61,4 +89,8 @@ protected:
 protected:
     INIFile m_ini;
     QString m_filePath;
+    QTimer m_saveTimer;
+    int m_saveDelay = 500;
+    bool m_syncOnSave = true;
+    int m_saveCount = 0;
 };
@@ -0,0 +1,126 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include "TestUtil.h"
+
+#include "settings/INISettingsObject.h"
+#include "settings/Setting.h"
+#include "FileSystem.h"
+
+class INISettingsObjectTest : public QObject
+{
+    Q_OBJECT
+
+    // about what the launcher settings page does when it's applied
+    void applyPage(SettingsObjectPtr settings, int count, int round)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            settings->set(QString("Setting%1").arg(i), QString("value %1 %2").arg(i).arg(round));
+        }
+    }
+
+    std::shared_ptr<INISettingsObject> makeSettings(const QString & path, int count)
+    {
+        auto settings = std::make_shared<INISettingsObject>(path);
+        for(int i = 0; i < count; i++)
+        {
+            settings->registerSetting(QString("Setting%1").arg(i), QString());
+        }
+        return settings;
+    }
+
+private
+slots:
+    void test_coalesce()
+    {
+        QTemporaryDir dir;
+        QString path = FS::PathCombine(dir.path(), "instance.cfg");
+        auto settings = makeSettings(path, 10);
+        settings->setSaveDelay(50);
+        applyPage(settings, 10, 0);
+        QCOMPARE(settings->saveCount(), 0);
+        QTRY_COMPARE(settings->saveCount(), 1);
+        QVERIFY(FS::read(path).contains("Setting9=value 9 0"));
+
+        // reading it back doesn't lose anything waiting to be saved
+        settings->set("Setting0", "changed");
+        settings->reload();
+        QCOMPARE(settings->get("Setting0").toString(), QString("changed"));
+        QCOMPARE(settings->saveCount(), 2);
+    }
+
+    void test_lock()
+    {
+        QTemporaryDir dir;
+        QString path = FS::PathCombine(dir.path(), "instance.cfg");
+        auto settings = makeSettings(path, 10);
+        {
+            SettingsObject::Lock lock(settings);
+            applyPage(settings, 10, 0);
+            QCOMPARE(settings->saveCount(), 0);
+        }
+        // unlocking writes right away
+        QCOMPARE(settings->saveCount(), 1);
+        QVERIFY(FS::read(path).contains("Setting9=value 9 0"));
+    }
+
+    void test_flushOnDestruction()
+    {
+        QTemporaryDir dir;
+        QString path = FS::PathCombine(dir.path(), "instance.cfg");
+        {
+            auto settings = makeSettings(path, 1);
+            settings->setSaveDelay(60000);
+            settings->setSyncOnSave(false);
+            settings->set("Setting0", "kept");
+            QVERIFY(!QFile::exists(path));
+        }
+        QVERIFY(FS::read(path).contains("Setting0=kept"));
+        QVERIFY(QFile(path).permissions() & QFileDevice::ReadOwner);
+
+        // a deleted instance stays deleted
+        QString gone = FS::PathCombine(dir.path(), "gone", "instance.cfg");
+        {
+            auto settings = makeSettings(gone, 1);
+            settings->setSaveDelay(60000);
+            QVERIFY(QDir().mkpath(QFileInfo(gone).path()));
+            settings->set("Setting0", "lost");
+            QVERIFY(FS::deletePath(QFileInfo(gone).path()));
+        }
+        QVERIFY(!QFileInfo(QFileInfo(gone).path()).exists());
+    }
+
+    void benchmark_apply_data()
+    {
+        QTest::addColumn<int>("delay");
+        QTest::newRow("every change") << 0;
+        QTest::newRow("coalesced") << 500;
+    }
+
+    // how many times the file gets written for a few applies of a settings page with 30 settings
+    void benchmark_apply()
+    {
+        SKIP_UNLESS_BENCHMARKING();
+        QFETCH(int, delay);
+        QTemporaryDir dir;
+        QString path = FS::PathCombine(dir.path(), "instance.cfg");
+        const int count = 30;
+        auto settings = makeSettings(path, count);
+        settings->setSaveDelay(delay);
+        QBENCHMARK_ONCE
+        {
+            for(int round = 0; round < 5; round++)
+            {
+                applyPage(settings, count, round);
+            }
+            settings->flush();
+        }
+        qDebug() << "Writes:" << settings->saveCount();
+        QCOMPARE(settings->saveCount(), delay ? 1 : count * 5);
+        QVERIFY(FS::read(path).contains("Setting29=value 29 4"));
+    }
+};
+
+QTEST_GUILESS_MAIN(INISettingsObjectTest)
+
+#include "INISettingsObject_test.moc"
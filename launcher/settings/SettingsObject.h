@@ -149,6 +149,12 @@ public:
 
     virtual void suspendSave() = 0;
     virtual void resumeSave() = 0;
+
+    /*!
+     * \brief Writes out any changes that are still waiting to be saved.
+     * \return False if writing failed
+     */
+    virtual bool flush() = 0;
 signals:
     /*!
      * \brief Signal emitted when one of this SettingsObject object's settings changes.
@@ -37,6 +37,12 @@ void Task::setProgress(qint64 current, qint64 total)
     emit progress(m_progress, m_progressTotal);
 }
 
+void Task::setByteProgress(qint64 current, qint64 total)
+{
+    // in KiB, progress is kept in ints and progress bars don't go past 2^31
+    setProgress(current / 1024, total / 1024);
+}
+
 void Task::start()
 {
     switch(m_state)
@@ -151,6 +157,11 @@ bool Task::wasSuccessful() const
     return m_state == State::Succeeded;
 }
 
+bool Task::wasAborted() const
+{
+    return m_state == State::AbortedByUser;
+}
+
 QString Task::failReason() const
 {
     return m_failReason;
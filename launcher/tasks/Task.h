@@ -39,6 +39,7 @@ public:
     bool isRunning() const;
     bool isFinished() const;
     bool wasSuccessful() const;
+    bool wasAborted() const;
 
     /*!
      * Returns the string that was passed to emitFailed as the error message when the task failed.
@@ -94,6 +95,8 @@ protected slots:
 public slots:
     void setStatus(const QString &status);
     void setProgress(qint64 current, qint64 total);
+    /// Progress in bytes, for tasks that move more data than an int counts
+    void setByteProgress(qint64 current, qint64 total);
 
 private:
     State m_state = State::Inactive;
@@ -1,11 +1,20 @@
 #include "LogView.h"
 #include <QTextBlock>
 #include <QScrollBar>
+#include <algorithm>
+
+namespace {
+// rows kept in the document, the rest of the log is only in the model
+const int windowSize = 10000;
+// rows the window moves by when scrolling reaches one of its edges
+const int windowStep = 1000;
+}
 
 LogView::LogView(QWidget* parent) : QPlainTextEdit(parent)
 {
     setWordWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
     m_defaultFormat = new QTextCharFormat(currentCharFormat());
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &LogView::scrolled);
 }
 
 LogView::~LogView()
@@ -61,15 +70,33 @@ void LogView::modelDestroyed(QObject* model)
     }
 }
 
+void LogView::setFollowEnd(bool follow)
+{
+    m_followEnd = follow;
+}
+
 void LogView::repopulate()
 {
-    auto doc = document();
-    doc->clear();
-    if(!m_model)
+    int first = 0;
+    if(m_model && m_followEnd)
     {
-        return;
+        first = std::max(0, m_model->rowCount() - windowSize);
     }
-    rowsInserted(QModelIndex(), 0, m_model->rowCount() - 1);
+    showWindow(first);
+}
+
+void LogView::showWindow(int first)
+{
+    bool moving = m_movingWindow;
+    m_movingWindow = true;
+    document()->clear();
+    m_firstRow = first;
+    m_shownRows = 0;
+    if(m_model)
+    {
+        appendRows(QModelIndex(), first, std::min(m_model->rowCount(), first + windowSize) - 1);
+    }
+    m_movingWindow = moving;
 }
 
 void LogView::rowsAboutToBeInserted(const QModelIndex& parent, int first, int last)
@@ -92,31 +119,34 @@ void LogView::rowsAboutToBeInserted(const QModelIndex& parent, int first, int la
 
 void LogView::rowsInserted(const QModelIndex& parent, int first, int last)
 {
-    for(int i = first; i <= last; i++)
+    // new lines only go to the end of the log, not to an older part of it that is being looked at
+    if(m_firstRow + m_shownRows != first)
     {
-        auto idx = m_model->index(i, 0, parent);
-        auto text = m_model->data(idx, Qt::DisplayRole).toString();
-        QTextCharFormat format(*m_defaultFormat);
-        auto font = m_model->data(idx, Qt::FontRole);
-        if(font.isValid())
-        {
-            format.setFont(font.value<QFont>());
-        }
-        auto fg = m_model->data(idx, Qt::TextColorRole);
-        if(fg.isValid())
+        // unless the view is still sitting at the bottom, then it goes back to following the end
+        if(m_followEnd && m_scroll && !m_scrolling)
         {
-            format.setForeground(fg.value<QColor>());
+            m_scrolling = true;
+            QMetaObject::invokeMethod(this, "scrollToBottom", Qt::QueuedConnection);
         }
-        auto bg = m_model->data(idx, Qt::BackgroundRole);
-        if(bg.isValid())
-        {
-            format.setBackground(bg.value<QColor>());
-        }
-        auto workCursor = textCursor();
-        workCursor.movePosition(QTextCursor::End);
-        workCursor.insertText(text, format);
-        workCursor.insertBlock();
+        return;
     }
+    if(!m_followEnd)
+    {
+        // only fill the window, the rest is shown when scrolled to
+        appendRows(parent, first, std::min(last, m_firstRow + windowSize - 1));
+        return;
+    }
+    if(last - first + 1 >= windowSize)
+    {
+        showWindow(last + 1 - windowSize);
+    }
+    else
+    {
+        appendRows(parent, first, last);
+    }
+    removeFirstBlocks(m_shownRows - windowSize);
+    m_firstRow += std::max(0, m_shownRows - windowSize);
+    m_shownRows = std::min(m_shownRows, windowSize);
     if(m_scroll && !m_scrolling)
     {
         m_scrolling = true;
@@ -124,21 +154,150 @@ void LogView::rowsInserted(const QModelIndex& parent, int first, int last)
     }
 }
 
+void LogView::appendRows(const QModelIndex& parent, int first, int last)
+{
+    bool moving = m_movingWindow;
+    m_movingWindow = true;
+    // rows come in batches, lay them out once
+    auto workCursor = textCursor();
+    workCursor.movePosition(QTextCursor::End);
+    workCursor.beginEditBlock();
+    for(int i = first; i <= last; i++)
+    {
+        insertRow(workCursor, parent, i);
+    }
+    workCursor.endEditBlock();
+    m_shownRows += std::max(0, last - first + 1);
+    m_movingWindow = moving;
+}
+
+void LogView::insertRow(QTextCursor& cursor, const QModelIndex& parent, int row)
+{
+    auto idx = m_model->index(row, 0, parent);
+    // one block per row, so rows can be found by block number
+    auto text = m_model->data(idx, Qt::DisplayRole).toString().replace('\n', QChar::LineSeparator);
+    QTextCharFormat format(*m_defaultFormat);
+    auto font = m_model->data(idx, Qt::FontRole);
+    if(font.isValid())
+    {
+        format.setFont(font.value<QFont>());
+    }
+    auto fg = m_model->data(idx, Qt::TextColorRole);
+    if(fg.isValid())
+    {
+        format.setForeground(fg.value<QColor>());
+    }
+    auto bg = m_model->data(idx, Qt::BackgroundRole);
+    if(bg.isValid())
+    {
+        format.setBackground(bg.value<QColor>());
+    }
+    cursor.insertText(text, format);
+    cursor.insertBlock();
+}
+
+void LogView::removeFirstBlocks(int count)
+{
+    if(count <= 0)
+    {
+        return;
+    }
+    bool moving = m_movingWindow;
+    m_movingWindow = true;
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.movePosition(QTextCursor::NextBlock, QTextCursor::KeepAnchor, count);
+    cursor.removeSelectedText();
+    m_movingWindow = moving;
+}
+
 void LogView::rowsRemoved(const QModelIndex& parent, int first, int last)
 {
-    // TODO: some day... maybe
     Q_UNUSED(parent)
-    Q_UNUSED(first)
-    Q_UNUSED(last)
+    int count = last - first + 1;
+    // rows before the shown ones only move them, the shown ones also go from the document
+    int hidden = qBound(0, m_firstRow - first, count);
+    int shown = std::min(count - hidden, m_shownRows);
+    removeFirstBlocks(shown);
+    m_firstRow -= hidden;
+    m_shownRows -= shown;
 }
 
 void LogView::scrollToBottom()
 {
     m_scrolling = false;
+    if(m_model && m_firstRow + m_shownRows < m_model->rowCount())
+    {
+        showWindow(std::max(0, m_model->rowCount() - windowSize));
+    }
     verticalScrollBar()->setSliderPosition(verticalScrollBar()->maximum());
 }
 
-void LogView::findNext(const QString& what, bool reverse)
+void LogView::showRow(int row)
+{
+    if(!m_model || row < 0 || row >= m_model->rowCount())
+    {
+        return;
+    }
+    if(row < m_firstRow || row >= m_firstRow + m_shownRows)
+    {
+        // show the part of the log around the row instead
+        int count = m_model->rowCount();
+        showWindow(qBound(0, row - windowSize / 2, std::max(0, count - windowSize)));
+    }
+    setTextCursor(QTextCursor(document()->findBlockByNumber(row - m_firstRow)));
+    centerCursor();
+}
+
+void LogView::scrolled(int value)
+{
+    if(!m_model || m_movingWindow)
+    {
+        return;
+    }
+    auto bar = verticalScrollBar();
+    m_movingWindow = true;
+    if(value == bar->minimum() && m_firstRow > 0)
+    {
+        // bring in rows from above and drop as many from the bottom
+        int count = std::min(windowStep, m_firstRow);
+        QTextCursor cursor(document());
+        cursor.movePosition(QTextCursor::Start);
+        cursor.beginEditBlock();
+        for(int i = m_firstRow - count; i < m_firstRow; i++)
+        {
+            insertRow(cursor, QModelIndex(), i);
+        }
+        cursor.endEditBlock();
+        m_firstRow -= count;
+        m_shownRows += count;
+        int excess = m_shownRows - windowSize;
+        if(excess > 0)
+        {
+            QTextCursor tail(document());
+            tail.movePosition(QTextCursor::End);
+            tail.movePosition(QTextCursor::PreviousBlock, QTextCursor::KeepAnchor, excess);
+            tail.removeSelectedText();
+            m_shownRows -= excess;
+        }
+        bar->setValue(bar->minimum() + count);
+    }
+    else if(value == bar->maximum() && m_firstRow + m_shownRows < m_model->rowCount())
+    {
+        // bring in rows from below and drop as many from the top
+        int first = m_firstRow + m_shownRows;
+        int last = std::min(m_model->rowCount(), first + windowStep) - 1;
+        appendRows(QModelIndex(), first, last);
+        int excess = std::max(0, m_shownRows - windowSize);
+        removeFirstBlocks(excess);
+        m_firstRow += excess;
+        m_shownRows -= excess;
+        bar->setValue(bar->maximum() - (last - first + 1));
+    }
+    m_movingWindow = false;
+}
+
+bool LogView::findNext(const QString& what, bool reverse)
 {
-    find(what, reverse ? QTextDocument::FindFlag::FindBackward : QTextDocument::FindFlag(0));
+    return find(what, reverse ? QTextDocument::FindFlag::FindBackward : QTextDocument::FindFlag(0));
 }
@@ -14,10 +14,26 @@ public:
     virtual void setModel(QAbstractItemModel *model);
     QAbstractItemModel *model() const;
 
+    /// The model row shown first. Only a window of the model's rows is shown, following the end of the log by default.
+    int firstRow() const
+    {
+        return m_firstRow;
+    }
+    int shownRows() const
+    {
+        return m_shownRows;
+    }
+
+    /// Whether new rows at the end of the model are scrolled to. When off, the view starts at the top.
+    void setFollowEnd(bool follow);
+
 public slots:
     void setWordWrap(bool wrapping);
-    void findNext(const QString & what, bool reverse);
+    /// Find in the shown rows, from the cursor on
+    bool findNext(const QString & what, bool reverse);
     void scrollToBottom();
+    /// Put the cursor on a row, showing the part of the log around it if needed
+    void showRow(int row);
 
 protected slots:
     void repopulate();
@@ -27,10 +43,22 @@ protected slots:
     // note: this supports only removing from front
     void rowsRemoved(const QModelIndex &parent, int first, int last);
     void modelDestroyed(QObject * model);
+    void scrolled(int value);
+
+protected:
+    /// Show the rows from first on, as many as fit in the window
+    void showWindow(int first);
+    void appendRows(const QModelIndex &parent, int first, int last);
+    void insertRow(QTextCursor &cursor, const QModelIndex &parent, int row);
+    void removeFirstBlocks(int count);
 
 protected:
     QAbstractItemModel *m_model = nullptr;
     QTextCharFormat *m_defaultFormat = nullptr;
     bool m_scroll = false;
     bool m_scrolling = false;
+    int m_firstRow = 0;
+    int m_shownRows = 0;
+    bool m_followEnd = true;
+    bool m_movingWindow = false;
 };